@@ -298,9 +298,45 @@ static void test(mps_pool_class_t pool_class, size_t roots_count)
   mps_arena_release(arena);
 }
 
+/* test_pause_stats -- check the arena's pause statistics
+ *
+ * The collections in test must have flipped and advanced traces.
+ */
+
+static void test_pause_stats(void)
+{
+  mps_pause_kind_t kind;
+
+  for (kind = MPS_PAUSE_MUTATOR; kind <= MPS_PAUSE_INCREMENT; ++kind) {
+    mps_pause_stats_s stats;
+    mps_arena_pause_stats(arena, kind, &stats);
+    printf("pause kind %u: count %lu total %g max %g p50 %g p99 %g\n",
+           (unsigned)kind, (unsigned long)stats.mps_count, stats.mps_total,
+           stats.mps_max, stats.mps_p50, stats.mps_p99);
+    if (kind == MPS_PAUSE_FLIP || kind == MPS_PAUSE_INCREMENT) {
+      Insist(stats.mps_count > 0);
+    }
+    Insist(0.0 <= stats.mps_p50);
+    Insist(stats.mps_p50 <= stats.mps_p90);
+    Insist(stats.mps_p90 <= stats.mps_p99);
+    Insist(stats.mps_p99 <= stats.mps_p999);
+    Insist(stats.mps_p999 <= stats.mps_max);
+    Insist(stats.mps_max <= stats.mps_total);
+  }
+
+  mps_arena_pause_stats_reset(arena);
+  for (kind = MPS_PAUSE_MUTATOR; kind <= MPS_PAUSE_INCREMENT; ++kind) {
+    mps_pause_stats_s stats;
+    mps_arena_pause_stats(arena, kind, &stats);
+    Insist(stats.mps_count == 0);
+    Insist(stats.mps_max == 0.0);
+  }
+}
+
 int main(int argc, char *argv[])
 {
   size_t i, grainSize;
+  mps_bool_t adaptivePacing;
   mps_thr_t thread;
 
   testlib_init(argc, argv);
@@ -308,11 +344,17 @@ int main(int argc, char *argv[])
   scale = (size_t)1 << (rnd() % 6);
   for (i = 0; i < genCOUNT; ++i) testChain[i].mps_capacity *= scale;
   grainSize = rnd_grain(scale * testArenaSIZE);
-  printf("Picked scale=%lu grainSize=%lu\n", (unsigned long)scale, (unsigned long)grainSize);
+  adaptivePacing = rnd() % 2;
+  dylan_scan_batch = rnd() % 2;
+  printf("Picked scale=%lu grainSize=%lu adaptivePacing=%d"
+         " dylan_scan_batch=%d\n",
+         (unsigned long)scale, (unsigned long)grainSize, adaptivePacing,
+         dylan_scan_batch);
 
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, scale * testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, grainSize);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_ADAPTIVE_PACING, adaptivePacing);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
   mps_message_type_enable(arena, mps_message_type_gc());
@@ -320,6 +362,7 @@ int main(int argc, char *argv[])
   die(mps_thread_reg(&thread, arena), "thread_reg");
   test(mps_class_amc(), exactRootsCOUNT);
   test(mps_class_amcz(), 0);
+  test_pause_stats();
   mps_thread_dereg(thread);
   report();
   mps_arena_destroy(arena);
@@ -8,6 +8,12 @@
  * runs mps_arena_formatted_objects_walk(). This checks that walking
  * works while the other threads continue to allocate in the
  * background.
+ *
+ * The arena scans grey segments using several GC threads, to test
+ * parallel scanning (see <code/trace.c#par>), and has a background
+ * collector thread (see <design/strategy#.policy.background>).  At the
+ * end, the main thread starts a collection and then stays idle, to
+ * check that the background thread finishes the collection.
  */
 
 #include "fmtdy.h"
@@ -28,10 +34,13 @@
 #define avLEN             3
 #define exactRootsCOUNT   180
 #define ambigRootsCOUNT   50
+#define gcThreadsCOUNT    4
 #define genCOUNT          2
 #define collectionsCOUNT  37
 #define rampSIZE          9
 #define initTestFREQ      6000
+#define idleSPIN          100000
+#define idleSPINMAX       100000
 
 /* testChain -- generation parameters for the test */
 
@@ -268,6 +277,35 @@ static void test_pool(const char *name, mps_pool_t pool, size_t roots_count)
     testthr_join(&kids[i], NULL);
 }
 
+/* test_idle -- check that the background thread collects while idle
+ *
+ * Start a collection, then spin without allocating or calling
+ * mps_arena_step until the collection finishes.  Only the Posix
+ * platforms have a background thread <code/bgix.c>.
+ */
+
+static void test_idle(void)
+{
+#if defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC)
+  mps_message_t msg;
+  unsigned long spins = 0;
+
+  while (mps_message_get(&msg, arena, mps_message_type_gc()))
+    mps_message_discard(arena, msg);
+
+  die(mps_arena_start_collect(arena), "start_collect");
+  while (!mps_message_get(&msg, arena, mps_message_type_gc())) {
+    volatile unsigned long i;
+    for (i = 0; i < idleSPIN; ++i)
+      NOOP;
+    ++spins;
+    Insist(spins < idleSPINMAX);
+  }
+  mps_message_discard(arena, msg);
+  printf("\nCollected while idle after %lu spins.\n", spins);
+#endif
+}
+
 static void test_arena(void)
 {
   size_t i;
@@ -281,6 +319,8 @@ static void test_arena(void)
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, rnd_grain(testArenaSIZE));
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_GC_THREADS, gcThreadsCOUNT);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_BACKGROUND, TRUE);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
   mps_message_type_enable(arena, mps_message_type_gc());
@@ -314,6 +354,7 @@ static void test_arena(void)
 
   test_pool("AMC", amc_pool, exactRootsCOUNT);
   test_pool("AMCZ", amcz_pool, 0);
+  test_idle();
 
   mps_arena_park(arena);
   mps_pool_destroy(amc_pool);
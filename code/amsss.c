@@ -31,6 +31,7 @@
 #define testArenaSIZE   ((size_t)1<<20)
 #define initTestFREQ    3000
 #define splatTestFREQ   6000
+#define stepTestFREQ    1000
 static mps_gen_param_s testChain[1] = { { 160, 0.90 } };
 
 
@@ -176,6 +177,9 @@ static void test_pool(mps_pool_class_t pool_class, mps_arg_s args[],
     if (rnd() % splatTestFREQ == 0)
       mps_pool_check_free_space(pool);
 
+    if (rnd() % stepTestFREQ == 0)
+      (void)mps_arena_step(arena, 0.0, 0.0); /* sweep lazily, perhaps */
+
     ++objs;
     if (objs % 256 == 0) {
       printf(".");
@@ -198,15 +202,21 @@ static void test_pool(mps_pool_class_t pool_class, mps_arg_s args[],
 int main(int argc, char *argv[])
 {
   int i;
+  size_t gcThreads;
   mps_thr_t thread;
   mps_fmt_t format;
   mps_chain_t chain;
 
   testlib_init(argc, argv);
 
+  /* Sometimes scan and sweep in parallel. <code/trace.c#par> */
+  gcThreads = 1 + rnd() % 3;
+  printf("Arena with GC_THREADS %lu\n", (unsigned long)gcThreads);
+
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_GRAIN_SIZE, rnd_grain(testArenaSIZE));
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_GC_THREADS, gcThreads);
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args), "arena_create");
   } MPS_ARGS_END(args);
 
@@ -220,15 +230,22 @@ int main(int argc, char *argv[])
     int debug = i % 2;
     int ownChain = (i / 2) % 2;
     int ambig = (i / 4) % 2;
-    printf("\n\n*** AMS%s with %sCHAIN and %sSUPPORT_AMBIGUOUS\n",
+    /* Chosen independently of the other options, so that over many
+       runs every combination is tested. Rerun with the seed printed by
+       testlib_init to reproduce. */
+    int lazy = rnd() % 2;
+    printf("\n\n*** AMS%s with %sCHAIN, %sSUPPORT_AMBIGUOUS"
+           " and %sLAZY_SWEEP\n",
            debug ? " Debug" : "",
            ownChain ? "" : "!",
-           ambig ? "" : "!");
+           ambig ? "" : "!",
+           lazy ? "" : "!");
     MPS_ARGS_BEGIN(args) {
       MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
       if (ownChain)
         MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
       MPS_ARGS_ADD(args, MPS_KEY_AMS_SUPPORT_AMBIGUOUS, ambig);
+      MPS_ARGS_ADD(args, MPS_KEY_LAZY_SWEEP, lazy);
       MPS_ARGS_ADD(args, MPS_KEY_POOL_DEBUG_OPTIONS, &freecheckOptions);
       test_pool(debug ? mps_class_ams_debug() : mps_class_ams(), args, ambig);
     } MPS_ARGS_END(args);
@@ -8,6 +8,7 @@
 #include "tract.h"
 #include "poolmvff.h"
 #include "mpm.h"
+#include "avl.h"
 #include "cbs.h"
 #include "bt.h"
 #include "poolmfs.h"
@@ -19,7 +20,7 @@ SRCID(arena, "$Id$");
 
 #define ArenaControlPool(arena) MVFFPool(&(arena)->controlPoolStruct)
 #define ArenaCBSBlockPool(arena) MFSPool(&(arena)->freeCBSBlockPoolStruct)
-#define ArenaFreeLand(arena) CBSLand(&(arena)->freeLandStruct)
+#define ArenaFreeLand(arena) (&(arena)->freeLandStruct.landStruct)
 
 
 /* ArenaGrainSizeCheck -- check that size is a valid arena grain size */
@@ -42,6 +43,8 @@ Bool ArenaGrainSizeCheck(Size size)
 static void ArenaTrivCompact(Arena arena, Trace trace);
 static void arenaFreePage(Arena arena, Addr base, Pool pool);
 static void arenaFreeLandFinish(Arena arena);
+static void arenaFreeCacheInit(Arena arena);
+static Bool arenaFreeCacheHasAddr(Arena arena, Addr addr);
 static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args);
 static void ArenaAbsFinish(Inst inst);
 static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth);
@@ -193,6 +196,8 @@ Bool ArenaCheck(Arena arena)
   CHECKL(0.0 <= arena->spare);
   CHECKL(arena->spare <= 1.0);
   CHECKL(0.0 <= arena->pauseTime);
+  CHECKL(BoolCheck(arena->adaptivePacing));
+  CHECKL(BoolCheck(arena->background));
 
   CHECKL(arena->zoneShift == ZoneShiftUNSET
          || ShiftCheck(arena->zoneShift));
@@ -224,11 +229,42 @@ Bool ArenaCheck(Arena arena)
     CHECKD(Land, ArenaFreeLand(arena));
 
   CHECKL(BoolCheck(arena->zoned));
+  CHECKL(arena->freeCacheCount <= FreeCacheENTRIES);
+  CHECKL(arena->freeCacheUnused <= FreeCacheENTRIES);
+  CHECKL((arena->freeCacheUnused == FreeCacheENTRIES)
+         == (arena->freeCacheCount == FreeCacheENTRIES));
+  CHECKL(arena->freeCacheCount == 0
+         || arena->freeCacheLow < arena->freeCacheHigh);
+
+  CHECKL(arena->gcThreads > 0);
+  CHECKL((arena->par == NULL) == (arena->scanJob == NULL));
+  CHECKL((arena->par == NULL) == (arena->fixLock == NULL));
+  CHECKL(arena->bg == NULL || arena->background);
 
   return TRUE;
 }
 
 
+/* Pause histograms: kind names and initialization
+ *
+ * See <design/arena#.pause.hist> and ArenaNotePause.
+ */
+
+static const char *pauseKindName[PauseKindLIMIT] = {
+  "mutator", "flip", "suspend", "increment"
+};
+
+static void pauseHistInit(PauseHist hist)
+{
+  Index i;
+  hist->count = 0;
+  hist->total = 0.0;
+  hist->max = 0;
+  for (i = 0; i < PauseHistBUCKETS; ++i)
+    hist->bucket[i] = 0;
+}
+
+
 /* ArenaAbsInit -- initialize the generic part of the arena */
 
 static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
@@ -238,7 +274,11 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   Size commitLimit = ARENA_DEFAULT_COMMIT_LIMIT;
   double spare = ARENA_SPARE_DEFAULT;
   double pauseTime = ARENA_DEFAULT_PAUSE_TIME;
+  Count gcThreads = ARENA_DEFAULT_GC_THREADS;
+  Bool adaptivePacing = ARENA_DEFAULT_ADAPTIVE_PACING;
+  Bool background = ARENA_DEFAULT_BACKGROUND;
   mps_arg_s arg;
+  Index i;
 
   AVER(arena != NULL);
   AVERT(ArenaGrainSize, grainSize);
@@ -258,6 +298,15 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
     spare = arg.val.d;
   if (ArgPick(&arg, args, MPS_KEY_PAUSE_TIME))
     pauseTime = arg.val.d;
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_GC_THREADS))
+    gcThreads = arg.val.count;
+  AVER(gcThreads > 0);
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_ADAPTIVE_PACING))
+    adaptivePacing = arg.val.b;
+  AVERT(Bool, adaptivePacing);
+  if (ArgPick(&arg, args, MPS_KEY_ARENA_BACKGROUND))
+    background = arg.val.b;
+  AVERT(Bool, background);
 
   /* Superclass init */
   InstInit(CouldBeA(Inst, arena));
@@ -268,6 +317,9 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->spareCommitted = (Size)0;
   arena->spare = spare;
   arena->pauseTime = pauseTime;
+  arena->adaptivePacing = adaptivePacing;
+  for (i = 0; i < NELEMS(arena->pauseHist); ++i)
+    pauseHistInit(&arena->pauseHist[i]);
   arena->grainSize = grainSize;
   /* zoneShift must be overridden by arena class init */
   arena->zoneShift = ZoneShiftUNSET;
@@ -277,11 +329,21 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
   arena->hasFreeLand = FALSE;
   arena->freeZones = ZoneSetUNIV;
   arena->zoned = zoned;
+  arena->gcThreads = gcThreads;
+  arena->par = NULL;
+  arena->fixLock = NULL;
+  arena->scanJob = NULL;
+  arena->background = background;
+  arena->bg = NULL;
+  arena->backgroundFill = 0.0;
 
   arena->primary = NULL;
   RingInit(ArenaChunkRing(arena));
   arena->chunkTree = TreeEMPTY;
+  for (i = 0; i < NELEMS(arena->chunkCache); ++i)
+    arena->chunkCache[i] = NULL;
   arena->chunkSerial = (Serial)0;
+  arenaFreeCacheInit(arena);
   
   LocusInit(arena);
   
@@ -300,7 +362,7 @@ static Res ArenaAbsInit(Arena arena, Size grainSize, ArgList args)
    * where the free land is used: see arenaFreeLandInsertExtend. */
 
   MPS_ARGS_BEGIN(piArgs) {
-    MPS_ARGS_ADD(piArgs, MPS_KEY_MFS_UNIT_SIZE, sizeof(CBSZonedBlockStruct));
+    MPS_ARGS_ADD(piArgs, MPS_KEY_MFS_UNIT_SIZE, FreeLandZonedBlockSIZE);
     MPS_ARGS_ADD(piArgs, MPS_KEY_EXTEND_BY, ArenaGrainSize(arena));
     MPS_ARGS_ADD(piArgs, MFSExtendSelf, FALSE);
     res = PoolInit(ArenaCBSBlockPool(arena), arena, PoolClassMFS(), piArgs);
@@ -336,6 +398,9 @@ ARG_DEFINE_KEY(VMW3_TOP_DOWN, Bool);
 ARG_DEFINE_KEY(ARENA_GRAIN_SIZE, Size);
 ARG_DEFINE_KEY(ARENA_SIZE, Size);
 ARG_DEFINE_KEY(ARENA_ZONED, Bool);
+ARG_DEFINE_KEY(ARENA_GC_THREADS, Count);
+ARG_DEFINE_KEY(ARENA_ADAPTIVE_PACING, Bool);
+ARG_DEFINE_KEY(ARENA_BACKGROUND, Bool);
 ARG_DEFINE_KEY(COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(SPARE_COMMIT_LIMIT, Size);
 ARG_DEFINE_KEY(PAUSE_TIME, double);
@@ -350,8 +415,8 @@ static Res arenaFreeLandInit(Arena arena)
 
   /* Initialise the free land. */
   MPS_ARGS_BEGIN(liArgs) {
-    MPS_ARGS_ADD(liArgs, CBSBlockPool, ArenaCBSBlockPool(arena));
-    res = LandInit(ArenaFreeLand(arena), CLASS(CBSZoned), arena,
+    MPS_ARGS_ADD(liArgs, FreeLandBlockPool, ArenaCBSBlockPool(arena));
+    res = LandInit(ArenaFreeLand(arena), FreeLandZonedCLASS, arena,
                    ArenaGrainSize(arena), arena, liArgs);
   } MPS_ARGS_END(liArgs);
   AVER(res == ResOK); /* no allocation, no failure expected */
@@ -470,9 +535,19 @@ static void arenaFreeLandFinish(Arena arena)
   AVER(arena->hasFreeLand);
   
   /* We're about to free the memory occupied by the free land, which
-     contains a CBS.  We want to make sure that LandFinish doesn't try
-     to check the CBS, so nuke it here.  TODO: LandReset? */
+     contains a tree.  We want to make sure that LandFinish doesn't try
+     to check the tree, so nuke it here.  TODO: LandReset? */
+#if defined(LAND_AVL)
+  arena->freeLandStruct.root = NULL;
+  arena->freeLandStruct.treeSize = 0;
+  arena->freeLandStruct.size = 0;
+#else
   arena->freeLandStruct.splayTreeStruct.root = TreeEMPTY;
+#endif
+
+  /* Runs in the free cache belong to the chunks, which are about to
+     be destroyed. */
+  arenaFreeCacheInit(arena);
 
   /* The CBS block pool can't free its own memory via ArenaFree because
    * that would use the free land. */
@@ -540,6 +615,7 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
 {
   Arena arena = CouldBeA(AbstractArena, inst);
   Res res;
+  PauseKind kind;
 
   if (!TESTC(AbstractArena, arena))
     return ResPARAM;
@@ -572,10 +648,25 @@ static Res ArenaAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "hasFreeLand      $S\n", WriteFYesNo(arena->hasFreeLand),
                "freeZones        $B\n", (WriteFB)arena->freeZones,
                "zoned            $S\n", WriteFYesNo(arena->zoned),
+               "freeCacheCount   $U\n", (WriteFU)arena->freeCacheCount,
                NULL);
   if (res != ResOK)
     return res;
 
+  for (kind = 0; kind < PauseKindLIMIT; ++kind) {
+    Count count;
+    double total, max;
+    ArenaPauseStats(&count, &total, &max, arena, kind);
+    res = WriteF(stream, depth + 2,
+                 "pause $S count $W total $D max $D p99 $D\n",
+                 (WriteFS)pauseKindName[kind], (WriteFW)count,
+                 (WriteFD)total, (WriteFD)max,
+                 (WriteFD)ArenaPauseQuantile(arena, kind, 0.99),
+                 NULL);
+    if (res != ResOK)
+      return res;
+  }
+
   res = WriteF(stream, depth + 2,
                "droppedMessages $U$S\n", (WriteFU)arena->droppedMessages,
                (arena->droppedMessages == 0 ? "" : "  -- MESSAGES DROPPED!"),
@@ -764,13 +855,14 @@ void ArenaChunkInsert(Arena arena, Chunk chunk)
 
 
 /* ArenaChunkRemoved -- chunk was removed from the arena and is being
- * finished, so update the total reserved address space, and unset the
- * primary chunk if necessary.
+ * finished, so update the total reserved address space, remove it
+ * from the chunk cache, and unset the primary chunk if necessary.
  */
 
 void ArenaChunkRemoved(Arena arena, Chunk chunk)
 {
   Size size;
+  Index i;
 
   AVERT(Arena, arena);
   AVERT(Chunk, chunk);
@@ -779,6 +871,12 @@ void ArenaChunkRemoved(Arena arena, Chunk chunk)
   AVER(arena->reserved >= size);
   arena->reserved -= size;
 
+  /* The chunk's memory may be unmapped once it is finished, so it
+     must not be left in the cache. <design/arena#.chunk.cache.remove> */
+  for (i = 0; i < NELEMS(arena->chunkCache); ++i)
+    if (arena->chunkCache[i] == chunk)
+      arena->chunkCache[i] = NULL;
+
   if (chunk == arena->primary) {
     /* The primary chunk must be the last chunk to be removed. */
     AVER(RingIsSingle(ArenaChunkRing(arena)));
@@ -799,7 +897,7 @@ void ArenaChunkRemoved(Arena arena, Chunk chunk)
 static Res arenaAllocPageInChunk(Addr *baseReturn, Chunk chunk, Pool pool)
 {
   Res res;
-  Index basePageIndex, limitPageIndex;
+  Index searchBase, basePageIndex, limitPageIndex;
   Arena arena;
 
   AVER(baseReturn != NULL);
@@ -807,10 +905,17 @@ static Res arenaAllocPageInChunk(Addr *baseReturn, Chunk chunk, Pool pool)
   AVERT(Pool, pool);
   arena = ChunkArena(chunk);
 
-  if (!BTFindShortResRange(&basePageIndex, &limitPageIndex,
-                           chunk->allocTable,
-                           chunk->allocBase, chunk->pages, 1))
-    return ResRESOURCE;
+  /* Pages in the free cache are free but not in the free land, so
+     they can't be excluded from it. <design/arena#.free.cache.page> */
+  for (searchBase = chunk->allocBase;; searchBase = limitPageIndex) {
+    if (searchBase >= chunk->pages
+        || !BTFindShortResRange(&basePageIndex, &limitPageIndex,
+                                chunk->allocTable,
+                                searchBase, chunk->pages, 1))
+      return ResRESOURCE;
+    if (!arenaFreeCacheHasAddr(arena, PageIndexBase(chunk, basePageIndex)))
+      break;
+  }
   
   res = Method(Arena, arena, pagesMarkAllocated)(arena, chunk,
                                                  basePageIndex, 1,
@@ -937,6 +1042,298 @@ static Res arenaFreeLandInsertExtend(Range rangeReturn, Arena arena,
 }
 
 
+/* Free cache -- small free runs in lists by length and zone
+ *
+ * <design/arena#.free.cache>. Each list is a chain of entries linked
+ * through freeCacheNext and ending with FreeCacheNONE. Unused entries
+ * are chained from freeCacheUnused in the same way.
+ */
+
+#define FreeCacheNONE ((Index)FreeCacheENTRIES)
+
+static void arenaFreeCacheInit(Arena arena)
+{
+  Index i, zone;
+
+  for (i = 0; i < FreeCacheGRAINS; ++i) {
+    arena->freeCacheZones[i] = ZoneSetEMPTY;
+    for (zone = 0; zone < MPS_WORD_WIDTH; ++zone)
+      arena->freeCacheHead[i][zone] = FreeCacheNONE;
+  }
+  for (i = 0; i < FreeCacheENTRIES; ++i) {
+    arena->freeCacheBase[i] = (Addr)0;
+    arena->freeCacheNext[i] = i + 1;
+  }
+  arena->freeCacheUnused = 0;
+  arena->freeCacheCount = 0;
+  arena->freeCacheLow = (Addr)0;
+  arena->freeCacheHigh = (Addr)0;
+}
+
+
+/* arenaFreeCacheOutside -- is the range base to limit outside the
+ * bounds of the cached runs?
+ *
+ * The bounds are only widened when a run is cached, and are reset
+ * when the cache becomes empty, so they may be larger than necessary.
+ * <design/arena#.free.cache.bounds>
+ */
+
+static Bool arenaFreeCacheOutside(Arena arena, Addr base, Addr limit)
+{
+  return arena->freeCacheCount == 0
+    || limit <= arena->freeCacheLow
+    || arena->freeCacheHigh <= base;
+}
+
+
+/* zoneSetFirst -- return the lowest zone in a non-empty zone set */
+
+static Index zoneSetFirst(ZoneSet zs)
+{
+  AVER_CRITICAL(zs != ZoneSetEMPTY);
+  return (Index)SizeFloorLog2((Size)(zs & (~zs + 1)));
+}
+
+
+/* arenaFreeCacheRemove -- remove the entry at *link from the list for
+ * runs of length + 1 grains in zone
+ */
+
+static void arenaFreeCacheRemove(Arena arena, Index length, Index zone,
+                                 Index *link)
+{
+  Index i = *link;
+
+  AVER_CRITICAL(i < FreeCacheENTRIES);
+  *link = arena->freeCacheNext[i];
+  if (arena->freeCacheHead[length][zone] == FreeCacheNONE)
+    arena->freeCacheZones[length] =
+      BS_DEL(ZoneSet, arena->freeCacheZones[length], zone);
+  arena->freeCacheNext[i] = arena->freeCacheUnused;
+  arena->freeCacheUnused = i;
+  AVER_CRITICAL(arena->freeCacheCount > 0);
+  --arena->freeCacheCount;
+}
+
+
+/* arenaFreeCachePop -- take a run of size bytes in zones from the cache
+ *
+ * This takes constant time: the zone set for the length says which
+ * lists have runs, and any run on one of those lists will do.
+ */
+
+static Bool arenaFreeCachePop(Range rangeReturn, Arena arena,
+                              ZoneSet zones, Size size)
+{
+  Count grains = size / ArenaGrainSize(arena);
+  ZoneSet avail;
+  Index zone, *link;
+
+  AVER_CRITICAL(grains > 0);
+  if (grains > FreeCacheGRAINS)
+    return FALSE;
+  avail = ZoneSetInter(arena->freeCacheZones[grains - 1], zones);
+  if (avail == ZoneSetEMPTY)
+    return FALSE;
+  zone = zoneSetFirst(avail);
+  link = &arena->freeCacheHead[grains - 1][zone];
+  RangeInitSize(rangeReturn, arena->freeCacheBase[*link], size);
+  arenaFreeCacheRemove(arena, grains - 1, zone, link);
+  return TRUE;
+}
+
+
+/* arenaFreeCachePush -- put a free run in the cache, if it fits */
+
+static Bool arenaFreeCachePush(Arena arena, Range range)
+{
+  Count grains = RangeSize(range) / ArenaGrainSize(arena);
+  Index i, zone;
+
+  AVER_CRITICAL(grains > 0);
+  if (grains > FreeCacheGRAINS || arena->freeCacheUnused == FreeCacheNONE)
+    return FALSE;
+  /* A run in more than one zone couldn't be found by its zone. */
+  if (!ZoneSetIsSingle(ZoneSetOfRange(arena, RangeBase(range),
+                                      RangeLimit(range))))
+    return FALSE;
+  zone = AddrZone(arena, RangeBase(range));
+  if (arena->freeCacheCount == 0) {
+    arena->freeCacheLow = RangeBase(range);
+    arena->freeCacheHigh = RangeLimit(range);
+  } else {
+    if (RangeBase(range) < arena->freeCacheLow)
+      arena->freeCacheLow = RangeBase(range);
+    if (RangeLimit(range) > arena->freeCacheHigh)
+      arena->freeCacheHigh = RangeLimit(range);
+  }
+  i = arena->freeCacheUnused;
+  arena->freeCacheUnused = arena->freeCacheNext[i];
+  arena->freeCacheBase[i] = RangeBase(range);
+  arena->freeCacheNext[i] = arena->freeCacheHead[grains - 1][zone];
+  arena->freeCacheHead[grains - 1][zone] = i;
+  arena->freeCacheZones[grains - 1] =
+    BS_ADD(ZoneSet, arena->freeCacheZones[grains - 1], zone);
+  ++arena->freeCacheCount;
+  return TRUE;
+}
+
+
+/* arenaFreeCacheInZones -- are any cached runs in zones? */
+
+static Bool arenaFreeCacheInZones(Arena arena, ZoneSet zones)
+{
+  Index length;
+
+  for (length = 0; length < FreeCacheGRAINS; ++length)
+    if (ZoneSetInter(arena->freeCacheZones[length], zones) != ZoneSetEMPTY)
+      return TRUE;
+  return FALSE;
+}
+
+
+/* arenaFreeCacheHasAddr -- is addr in a cached run?
+ *
+ * Only the lists for the zone of addr need to be searched, because a
+ * cached run is in a single zone.
+ */
+
+static Bool arenaFreeCacheHasAddr(Arena arena, Addr addr)
+{
+  Index length, zone = AddrZone(arena, addr), i;
+
+  if (arenaFreeCacheOutside(arena, addr, AddrAdd(addr, 1)))
+    return FALSE;
+  for (length = 0; length < FreeCacheGRAINS; ++length) {
+    Size size = (length + 1) * ArenaGrainSize(arena);
+    for (i = arena->freeCacheHead[length][zone]; i != FreeCacheNONE;
+         i = arena->freeCacheNext[i]) {
+      Addr base = arena->freeCacheBase[i];
+      if (base <= addr && addr < AddrAdd(base, size))
+        return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+
+/* arenaFreeCacheFlush -- return cached runs in zones to the free land
+ *
+ * Cached runs don't coalesce with their neighbours, so they are
+ * returned to the free land when it can't satisfy a request
+ * <design/arena#.free.cache.flush>. Stops early if the free land
+ * can't get memory for its block pool. Returns TRUE if any run was
+ * returned.
+ */
+
+static Bool arenaFreeCacheFlush(Arena arena, ZoneSet zones)
+{
+  Bool flushed = FALSE;
+  Index length;
+
+  for (length = 0; length < FreeCacheGRAINS; ++length) {
+    Size size = (length + 1) * ArenaGrainSize(arena);
+    ZoneSet zs = ZoneSetInter(arena->freeCacheZones[length], zones);
+    while (zs != ZoneSetEMPTY) {
+      Index zone = zoneSetFirst(zs);
+      Index *link = &arena->freeCacheHead[length][zone];
+      while (*link != FreeCacheNONE) {
+        RangeStruct range, oldRange;
+        RangeInitSize(&range, arena->freeCacheBase[*link], size);
+        if (arenaFreeLandInsertExtend(&oldRange, arena, &range) != ResOK)
+          return flushed;
+        arenaFreeCacheRemove(arena, length, zone, link);
+        flushed = TRUE;
+      }
+      zs = BS_DEL(ZoneSet, zs, zone);
+    }
+  }
+  return flushed;
+}
+
+
+/* arenaFreeCacheDelete -- remove cached runs in a chunk from the cache
+ *
+ * All the pages from base to limit are free, and each is either in
+ * the free land or in a cached run. Return the cached runs to the
+ * free land, so that the whole range can be deleted from it. This
+ * can't extend the block pool, because the page might come from this
+ * range. But any run next to a block in the free land coalesces with
+ * it, so that needs no new block, and so repeating the loop returns
+ * every run, unless none of the range is in the free land. In that
+ * case, drop the runs and return FALSE. <design/arena#.free.cache.chunk>
+ * If the range is outside the bounds of the cache, there is nothing
+ * to do, and this takes constant time.
+ */
+
+static Bool arenaFreeCacheDelete(Arena arena, Addr base, Addr limit)
+{
+  Land land = ArenaFreeLand(arena);
+  Bool progress, remaining;
+  Size dropped = 0;
+  Index length;
+
+  if (arenaFreeCacheOutside(arena, base, limit))
+    return TRUE;
+
+  do {
+    progress = FALSE;
+    remaining = FALSE;
+    for (length = 0; length < FreeCacheGRAINS; ++length) {
+      Size size = (length + 1) * ArenaGrainSize(arena);
+      ZoneSet zs = arena->freeCacheZones[length];
+      while (zs != ZoneSetEMPTY) {
+        Index zone = zoneSetFirst(zs);
+        Index *link = &arena->freeCacheHead[length][zone];
+        while (*link != FreeCacheNONE) {
+          Addr runBase = arena->freeCacheBase[*link];
+          if (base <= runBase && runBase < limit) {
+            RangeStruct range, oldRange;
+            Res res;
+            RangeInitSize(&range, runBase, size);
+            res = LandInsert(&oldRange, land, &range);
+            if (res == ResOK) {
+              arenaFreeCacheRemove(arena, length, zone, link);
+              progress = TRUE;
+              continue;
+            }
+            AVER(res == ResLIMIT);
+            remaining = TRUE;
+          }
+          link = &arena->freeCacheNext[*link];
+        }
+        zs = BS_DEL(ZoneSet, zs, zone);
+      }
+    }
+  } while (remaining && progress);
+
+  if (!remaining)
+    return TRUE;
+
+  for (length = 0; length < FreeCacheGRAINS; ++length) {
+    Size size = (length + 1) * ArenaGrainSize(arena);
+    ZoneSet zs = arena->freeCacheZones[length];
+    while (zs != ZoneSetEMPTY) {
+      Index zone = zoneSetFirst(zs);
+      Index *link = &arena->freeCacheHead[length][zone];
+      while (*link != FreeCacheNONE) {
+        Addr runBase = arena->freeCacheBase[*link];
+        if (base <= runBase && runBase < limit) {
+          arenaFreeCacheRemove(arena, length, zone, link);
+          dropped += size;
+        } else {
+          link = &arena->freeCacheNext[*link];
+        }
+      }
+      zs = BS_DEL(ZoneSet, zs, zone);
+    }
+  }
+  AVER(dropped == AddrOffset(base, limit));
+  return FALSE;
+}
+
+
 /* ArenaFreeLandInsert -- add range to arena's free land, maybe extending
  * block pool
  *
@@ -987,6 +1384,10 @@ void ArenaFreeLandDelete(Arena arena, Addr base, Addr limit)
   Res res;
   Land land;
 
+  /* If the whole range was in the free cache, it's already gone. */
+  if (!arenaFreeCacheDelete(arena, base, limit))
+    return;
+
   RangeInit(&range, base, limit);
   land = ArenaFreeLand(arena);
   res = LandDelete(&oldRange, land, &range);
@@ -998,11 +1399,60 @@ void ArenaFreeLandDelete(Arena arena, Addr base, Addr limit)
 }
 
 
+/* arenaAllocDeletedRange -- allocate tracts in a range of address
+ * space that has just been deleted from the arena's free land
+ *
+ * If the tracts can't be allocated, the range is returned to the free
+ * land.
+ */
+
+static Res arenaAllocDeletedRange(Tract *tractReturn, Arena arena,
+                                  Range range, Pool pool)
+{
+  Chunk chunk = NULL; /* suppress uninit warning */
+  Bool b;
+  Index baseIndex;
+  Count pages;
+  Res res;
+
+  b = ChunkOfAddr(&chunk, arena, RangeBase(range));
+  AVER(b);
+  AVER(RangeIsAligned(range, ChunkPageSize(chunk)));
+  baseIndex = INDEX_OF_ADDR(chunk, RangeBase(range));
+  pages = ChunkSizeToPages(chunk, RangeSize(range));
+
+  res = Method(Arena, arena, pagesMarkAllocated)(arena, chunk, baseIndex, pages, pool);
+  if (res != ResOK)
+    goto failMark;
+
+  arena->freeZones = ZoneSetDiff(arena->freeZones,
+                                 ZoneSetOfRange(arena,
+                                                RangeBase(range),
+                                                RangeLimit(range)));
+
+  *tractReturn = PageTract(ChunkPage(chunk, baseIndex));
+  return ResOK;
+
+failMark:
+   {
+     RangeStruct oldRange;
+     Res insertRes = arenaFreeLandInsertExtend(&oldRange, arena, range);
+     AVER(insertRes == ResOK); /* We only just deleted it. */
+     /* If the insert does fail, we lose some address space permanently. */
+   }
+   return res;
+}
+
+
 /* ArenaFreeLandAlloc -- allocate a continguous range of tracts of
  * size bytes from the arena's free land.
  *
  * size, zones, and high are as for LandFindInZones.
  *
+ * Small runs come from the free cache if possible. If the free land
+ * has no suitable range, the cached runs in zones are returned to it
+ * and the search is repeated. <design/arena#.free.cache.alloc>
+ *
  * If successful, mark the allocated tracts as belonging to pool, set
  * *tractReturn to point to the first tract in the range, and return
  * ResOK.
@@ -1012,10 +1462,7 @@ Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
                        Bool high, Size size, Pool pool)
 {
   RangeStruct range, oldRange;
-  Chunk chunk = NULL; /* suppress uninit warning */
-  Bool found, b;
-  Index baseIndex;
-  Count pages;
+  Bool found;
   Res res;
   Land land;
   
@@ -1031,8 +1478,14 @@ Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
     zones = ZoneSetUNIV;
 
   /* Step 1. Find a range of address space. */
-  
+
+  /* The cache doesn't know which run is highest, so only serve low
+     requests from it. */
+  if (!high && arenaFreeCachePop(&range, arena, zones, size))
+    return arenaAllocDeletedRange(tractReturn, arena, &range, pool);
+
   land = ArenaFreeLand(arena);
+retry:
   res = LandFindInZones(&found, &range, &oldRange, land, size, zones, high);
 
   if (res == ResLIMIT) { /* found block, but couldn't store info */
@@ -1049,36 +1502,144 @@ Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
   if (res != ResOK) /* defensive return */
     return res;
 
-  if (!found) /* out of address space */
-    return ResRESOURCE;
+  if (!found) {
+    if (arenaFreeCacheFlush(arena, zones))
+      goto retry;
+    return ResRESOURCE; /* out of address space */
+  }
   
   /* Step 2. Make memory available in the address space range. */
 
-  b = ChunkOfAddr(&chunk, arena, RangeBase(&range));
-  AVER(b);
-  AVER(RangeIsAligned(&range, ChunkPageSize(chunk)));
-  baseIndex = INDEX_OF_ADDR(chunk, RangeBase(&range));
-  pages = ChunkSizeToPages(chunk, RangeSize(&range));
+  return arenaAllocDeletedRange(tractReturn, arena, &range, pool);
+}
 
-  res = Method(Arena, arena, pagesMarkAllocated)(arena, chunk, baseIndex, pages, pool);
-  if (res != ResOK)
-    goto failMark;
 
-  arena->freeZones = ZoneSetDiff(arena->freeZones,
-                                 ZoneSetOfRange(arena,
-                                                RangeBase(&range),
-                                                RangeLimit(&range)));
+/* chunkFindFree -- find free pages in a chunk in a set of zones
+ *
+ * Search the allocation table of chunk for a range of size bytes of
+ * free pages whose zones are in zones: the lowest such range, or the
+ * highest if high is TRUE. Within each run of free pages the
+ * candidate range is moved by whole zone stripes, so this may miss a
+ * range that is not stripe-aligned when the run has no aligned one.
+ */
 
-  *tractReturn = PageTract(ChunkPage(chunk, baseIndex));
-  return ResOK;
+static Bool chunkFindFree(Range rangeReturn, Chunk chunk, Size size,
+                          ZoneSet zones, Bool high)
+{
+  Arena arena = ChunkArena(chunk);
+  Count pages = ChunkSizeToPages(chunk, size);
+  Size step = ArenaStripeSize(arena);
+  Index searchBase = chunk->allocBase, searchLimit = chunk->pages;
+  Index runBase, runLimit;
+  Addr base, limit, runBaseAddr, runLimitAddr;
+
+  if (step < ChunkPageSize(chunk))
+    step = ChunkPageSize(chunk);
+
+  while (searchBase < searchLimit && searchLimit - searchBase >= pages) {
+    if (high) {
+      if (!BTFindLongResRangeHigh(&runBase, &runLimit, chunk->allocTable,
+                                  searchBase, searchLimit, pages))
+        return FALSE;
+    } else {
+      if (!BTFindLongResRange(&runBase, &runLimit, chunk->allocTable,
+                              searchBase, searchLimit, pages))
+        return FALSE;
+    }
+    runBaseAddr = PageIndexBase(chunk, runBase);
+    runLimitAddr = PageIndexBase(chunk, runLimit);
+    if (high) {
+      limit = runLimitAddr;
+      while (limit > runBaseAddr && AddrOffset(runBaseAddr, limit) >= size) {
+        base = AddrSub(limit, size);
+        if (ZoneSetSub(ZoneSetOfRange(arena, base, limit), zones))
+          goto found;
+        limit = AddrAlignDown(AddrSub(limit, 1), step);
+      }
+      searchLimit = runBase;
+    } else {
+      base = runBaseAddr;
+      while (base < runLimitAddr && AddrOffset(base, runLimitAddr) >= size) {
+        limit = AddrAdd(base, size);
+        if (ZoneSetSub(ZoneSetOfRange(arena, base, limit), zones))
+          goto found;
+        base = AddrAlignUp(AddrAdd(base, 1), step);
+      }
+      searchBase = runLimit;
+    }
+  }
+  return FALSE;
 
-failMark:
-   {
-     Res insertRes = arenaFreeLandInsertExtend(&oldRange, arena, &range);
-     AVER(insertRes == ResOK); /* We only just deleted it. */
-     /* If the insert does fail, we lose some address space permanently. */
-   }
-   return res;
+found:
+  RangeInit(rangeReturn, base, AddrAdd(base, size));
+  return TRUE;
+}
+
+
+/* ArenaNodeAlloc -- allocate a contiguous range of tracts of size
+ * bytes from chunks on a NUMA node
+ *
+ * zones, high, and the result are as for ArenaFreeLandAlloc. The free
+ * land can't be searched by address, so this searches the allocation
+ * tables of the chunks on the node instead, and deletes what it finds
+ * from the free land. <design/arena#.numa.alloc>.
+ */
+
+Res ArenaNodeAlloc(Tract *tractReturn, Arena arena, Index node,
+                   ZoneSet zones, Bool high, Size size, Pool pool)
+{
+  Land land;
+  Ring chunkNode, next;
+
+  AVER(tractReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(node != NodeNONE);
+  /* ZoneSet is arbitrary */
+  AVER(size > (Size)0);
+  AVERT(Pool, pool);
+  AVER(arena == PoolArena(pool));
+  AVER(SizeIsArenaGrains(size, arena));
+
+  if (!arena->zoned)
+    zones = ZoneSetUNIV;
+
+  /* Free pages in zones must all be in the free land, since they are
+     found in the allocation tables. <design/arena#.free.cache.page> */
+  (void)arenaFreeCacheFlush(arena, zones);
+  if (arenaFreeCacheInZones(arena, zones))
+    return ResRESOURCE;
+
+  land = ArenaFreeLand(arena);
+  RING_FOR(chunkNode, ArenaChunkRing(arena), next) {
+    Chunk chunk = RING_ELT(Chunk, arenaRing, chunkNode);
+    RangeStruct range, oldRange;
+    Res res;
+
+    if (ChunkNode(chunk) != node
+        || !chunkFindFree(&range, chunk, size, zones, high))
+      continue;
+
+    res = LandDelete(&oldRange, land, &range);
+    if (res == ResLIMIT) { /* CBS block pool ran out of blocks */
+      RangeStruct pageRange;
+      res = arenaExtendCBSBlockPool(&pageRange, arena);
+      if (res != ResOK)
+        return res;
+      arenaExcludePage(arena, &pageRange);
+      /* The page for the block pool may have come from range. */
+      if (!chunkFindFree(&range, chunk, size, zones, high))
+        continue;
+      res = LandDelete(&oldRange, land, &range);
+      AVER(res != ResLIMIT);
+    }
+    AVER(res == ResOK); /* free pages are in the free land */
+    if (res != ResOK) /* defensive return */
+      return res;
+
+    return arenaAllocDeletedRange(tractReturn, arena, &range, pool);
+  }
+
+  return ResRESOURCE;
 }
 
 
@@ -1145,7 +1706,11 @@ void ArenaFree(Addr base, Size size, Pool pool)
     arena->lastTract = NULL;
     arena->lastTractBase = (Addr)0;
   }
-  
+
+  /* Small runs go to the free cache <design/arena#.free.cache.free>. */
+  if (arenaFreeCachePush(arena, &range))
+    goto cached;
+
   res = arenaFreeLandInsertExtend(&oldRange, arena, &range);
   if (res != ResOK) {
     Land land = ArenaFreeLand(arena);
@@ -1154,6 +1719,7 @@ void ArenaFree(Addr base, Size size, Pool pool)
     if (RangeIsEmpty(&range))
       goto done;
   }
+cached:
   Method(Arena, arena, free)(RangeBase(&range), RangeSize(&range), pool);
 
 done:
@@ -1220,6 +1786,175 @@ void ArenaSetPauseTime(Arena arena, double pauseTime)
   EVENT2(PauseTimeSet, arena, pauseTime);
 }
 
+
+/* Pause histograms
+ *
+ * Each histogram counts pauses of one kind by their duration, in
+ * buckets that grow exponentially.  See <design/arena#.pause.hist>.
+ */
+
+#define PauseHistSUBCOUNT ((Index)1 << PauseHistSUBSHIFT)
+
+Bool PauseKindCheck(PauseKind kind)
+{
+  CHECKL(kind < PauseKindLIMIT);
+  return TRUE;
+}
+
+/* pauseHistBucket -- bucket for a pause of this many clock ticks
+ *
+ * Pauses shorter than PauseHistSUBCOUNT ticks have a bucket for each
+ * duration.  Above that, each power of two is divided into
+ * PauseHistSUBCOUNT buckets by the bits below the leading one.
+ */
+
+static Index pauseHistBucket(Clock clocks)
+{
+  Shift e, s;
+  Index i;
+
+  if (clocks < PauseHistSUBCOUNT)
+    return (Index)clocks;
+  e = SizeFloorLog2((Size)clocks);
+  s = e - PauseHistSUBSHIFT;
+  i = ((Index)(s + 1) << PauseHistSUBSHIFT)
+      + ((Index)(clocks >> s) & (PauseHistSUBCOUNT - 1));
+  return i < PauseHistBUCKETS ? i : PauseHistBUCKETS - 1;
+}
+
+/* pauseHistBucketMax -- longest pause in a bucket, in clock ticks */
+
+static double pauseHistBucketMax(Index i)
+{
+  Shift s;
+
+  AVER(i < PauseHistBUCKETS - 1); /* last bucket is unbounded */
+  ++i; /* find the shortest pause in the next bucket */
+  if (i < PauseHistSUBCOUNT)
+    return (double)i - 1.0;
+  s = (Shift)(i >> PauseHistSUBSHIFT) - 1;
+  AVER(s < MPS_WORD_WIDTH);
+  return (double)(PauseHistSUBCOUNT + (i & (PauseHistSUBCOUNT - 1)))
+         * (double)((Size)1 << s) - 1.0;
+}
+
+/* ArenaNotePause -- record a pause from start to end */
+
+void ArenaNotePause(Arena arena, PauseKind kind, Clock start, Clock end)
+{
+  PauseHist hist;
+  Clock clocks;
+
+  AVERT(Arena, arena);
+  AVERT(PauseKind, kind);
+  AVER(start <= end);
+
+  hist = &arena->pauseHist[kind];
+  clocks = end - start;
+  ++ hist->count;
+  hist->total += (double)clocks;
+  if (clocks > hist->max)
+    hist->max = clocks;
+  ++ hist->bucket[pauseHistBucket(clocks)];
+}
+
+/* ArenaPauseStats -- number, total and maximum of pauses of a kind
+ *
+ * Times are in seconds.
+ */
+
+void ArenaPauseStats(Count *countReturn, double *totalReturn,
+                     double *maxReturn, Arena arena, PauseKind kind)
+{
+  PauseHist hist;
+  double clocksPerSec = (double)ClocksPerSec();
+
+  AVER(countReturn != NULL);
+  AVER(totalReturn != NULL);
+  AVER(maxReturn != NULL);
+  AVERT(Arena, arena);
+  AVERT(PauseKind, kind);
+
+  hist = &arena->pauseHist[kind];
+  *countReturn = hist->count;
+  *totalReturn = hist->total / clocksPerSec;
+  *maxReturn = (double)hist->max / clocksPerSec;
+}
+
+/* ArenaPauseQuantile -- duration not exceeded by a fraction of pauses
+ *
+ * Returns the duration, in seconds, of the longest pause in the
+ * bucket that contains the q-quantile of pauses of the kind.  This
+ * overestimates the true quantile by less than the width of the
+ * bucket.  Returns zero if there have been no pauses of the kind.
+ */
+
+double ArenaPauseQuantile(Arena arena, PauseKind kind, double q)
+{
+  PauseHist hist;
+  Count rank, seen;
+  Index i;
+  double clocks;
+
+  AVERT(Arena, arena);
+  AVERT(PauseKind, kind);
+  AVER(0.0 <= q);
+  AVER(q <= 1.0);
+
+  hist = &arena->pauseHist[kind];
+  if (hist->count == 0)
+    return 0.0;
+
+  /* The q-quantile is the rank'th shortest pause. */
+  rank = (Count)(q * (double)hist->count);
+  if ((double)rank < q * (double)hist->count)
+    ++ rank;
+  if (rank == 0)
+    rank = 1;
+
+  seen = 0;
+  for (i = 0; i < PauseHistBUCKETS - 1; ++i) {
+    seen += hist->bucket[i];
+    if (seen >= rank)
+      break;
+  }
+
+  clocks = (double)hist->max;
+  if (i < PauseHistBUCKETS - 1 && pauseHistBucketMax(i) < clocks)
+    clocks = pauseHistBucketMax(i);
+  return clocks / (double)ClocksPerSec();
+}
+
+/* ArenaPauseStatsReset -- forget all pauses so far */
+
+void ArenaPauseStatsReset(Arena arena)
+{
+  PauseKind kind;
+  AVERT(Arena, arena);
+  for (kind = 0; kind < PauseKindLIMIT; ++kind)
+    pauseHistInit(&arena->pauseHist[kind]);
+}
+
+/* ArenaPauseStatsEmit -- emit the pause statistics as events */
+
+void ArenaPauseStatsEmit(Arena arena)
+{
+  PauseKind kind;
+
+  AVERT(Arena, arena);
+
+  for (kind = 0; kind < PauseKindLIMIT; ++kind) {
+    Count count;
+    double total, max;
+    ArenaPauseStats(&count, &total, &max, arena, kind);
+    if (count > 0)
+      EVENT8(PauseStats, arena, kind, count, total, max,
+             ArenaPauseQuantile(arena, kind, 0.5),
+             ArenaPauseQuantile(arena, kind, 0.99),
+             ArenaPauseQuantile(arena, kind, 0.999));
+  }
+}
+
 /* Used by arenas which don't use spare committed memory */
 Size ArenaNoPurgeSpare(Arena arena, Size size)
 {
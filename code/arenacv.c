@@ -1,7 +1,7 @@
 /* arenacv.c: ARENA COVERAGE TEST
  *
  * $Id$
- * Copyright (c) 2001-2014 Ravenbrook Limited.  See end of file for license.
+ * Copyright (c) 2001-2018 Ravenbrook Limited.  See end of file for license.
  *
  * .coverage: At the moment, we're only trying to cover the new code
  * (partial mapping of the page table and vm overflow).
@@ -438,6 +438,88 @@ static void testPageTable(ArenaClass klass, Size size, Addr addr, Bool zoned)
 }
 
 
+/* testFreeCache -- test the arena's free cache
+ *
+ * Allocate and free many small runs of grains, with various locus
+ * preferences, in an arena that is too small for them, so that it
+ * must grow. Then free them all and collect, so that the arena
+ * destroys chunks while some of their pages are in the free cache.
+ * <design/arena#.free.cache>
+ */
+
+#define cacheRUNS     600
+#define cacheROUNDS   4
+
+static void testFreeCache(Bool zoned)
+{
+  Arena arena;
+  Pool pool;
+  LocusPrefStruct pref;
+  Addr base[cacheRUNS];
+  Size size[cacheRUNS];
+  Size grainSize, reserved;
+  ZoneSet zones = (ZoneSet)0xF0;
+  Index node = 0;
+  Count round, i;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, (Size)1 << 20);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, zoned);
+    die(ArenaCreate(&arena, (ArenaClass)mps_arena_class_vm(), args),
+        "ArenaCreate");
+  } MPS_ARGS_END(args);
+  die(PoolCreate(&pool, arena, PoolClassMVFF(), argsNone), "PoolCreate");
+  grainSize = ArenaGrainSize(arena);
+
+  for (i = 0; i < cacheRUNS; ++i)
+    base[i] = NULL;
+  for (round = 0; round < cacheROUNDS; ++round) {
+    if (round > 0) {
+      for (i = 0; i < cacheRUNS; ++i)
+        if (rnd() % 2 == 0) {
+          ArenaFree(base[i], size[i], pool);
+          base[i] = NULL;
+        }
+      Insist(arena->freeCacheCount > 0);
+      Insist(arena->freeCacheCount <= FreeCacheENTRIES);
+    }
+    for (i = 0; i < cacheRUNS; ++i) {
+      if (base[i] != NULL)
+        continue;
+      LocusPrefInit(&pref);
+      switch (rnd() % 4) {
+      case 0:
+        break;
+      case 1:
+        LocusPrefExpress(&pref, LocusPrefHIGH, NULL);
+        break;
+      case 2:
+        LocusPrefExpress(&pref, LocusPrefZONESET, &zones);
+        break;
+      default:
+        LocusPrefExpress(&pref, LocusPrefNODE, &node);
+        break;
+      }
+      size[i] = (1 + rnd() % (FreeCacheGRAINS + 2)) * grainSize;
+      die(ArenaAlloc(&base[i], &pref, size[i], pool), "ArenaAlloc");
+    }
+  }
+
+  for (i = 0; i < cacheRUNS; ++i)
+    ArenaFree(base[i], size[i], pool);
+  printf("%lu runs in the free cache.\n",
+         (unsigned long)arena->freeCacheCount);
+  reserved = ArenaReserved(arena);
+  /* Nothing is condemned, so the collection fails, but destroying
+     the trace compacts the arena anyway. */
+  (void)ArenaCollect(ArenaGlobals(arena), TraceStartWhyCLIENTFULL_BLOCK);
+  Insist(ArenaReserved(arena) < reserved);
+
+  PoolDestroy(pool);
+  ArenaDestroy(arena);
+}
+
+
 /* testSize -- test arena size overflow
  *
  * Just try allocating larger arenas, doubling the size each time, until
@@ -480,6 +562,9 @@ int main(int argc, char *argv[])
   cdie(block != NULL, "malloc");
   testPageTable((ArenaClass)mps_arena_class_cl(), TEST_ARENA_SIZE, block, FALSE);
 
+  testFreeCache(TRUE);
+  testFreeCache(FALSE);
+
   testSize(TEST_ARENA_SIZE);
 
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
@@ -489,7 +574,7 @@ int main(int argc, char *argv[])
 
 /* C. COPYRIGHT AND LICENSE
  *
- * Copyright (c) 2001-2014 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * Copyright (c) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
  * All rights reserved.  This is an open source license.  Contact
  * Ravenbrook for commercial licensing options.
  * 
@@ -262,8 +262,10 @@ static void vmArenaUnmap(VMArena vmArena, VM vm, Addr base, Addr limit)
  * chunkReturn, return parameter for the created chunk.
  * vmArena, the parent VMArena.
  * size, approximate amount of virtual address that the chunk should reserve.
+ * node, NUMA node to bind the chunk's memory to, or NodeNONE.
  */
-static Res VMChunkCreate(Chunk *chunkReturn, VMArena vmArena, Size size)
+static Res VMChunkCreate(Chunk *chunkReturn, VMArena vmArena, Size size,
+                         Index node)
 {
   Arena arena = MustBeA(AbstractArena, vmArena);
   Res res;
@@ -283,6 +285,8 @@ static Res VMChunkCreate(Chunk *chunkReturn, VMArena vmArena, Size size)
   if (res != ResOK)
     goto failVMInit;
 
+  if (node != NodeNONE)
+    VMBind(vm, node);
   base = VMBase(vm);
   limit = VMLimit(vm);
 
@@ -311,6 +315,7 @@ static Res VMChunkCreate(Chunk *chunkReturn, VMArena vmArena, Size size)
 
   BootBlockFinish(boot);
 
+  VMChunk2Chunk(vmChunk)->node = node;
   vmChunk->sig = VMChunkSig;
   AVERT(VMChunk, vmChunk);
 
@@ -629,7 +634,7 @@ static Res VMArenaCreate(Arena *arenaReturn, ArgList args)
 
   /* have to have a valid arena before calling ChunkCreate */
   vmArena->sig = VMArenaSig;
-  res = VMChunkCreate(&chunk, vmArena, size);
+  res = VMChunkCreate(&chunk, vmArena, size, NodeNONE);
   if (res != ResOK)
     goto failChunkCreate;
 
@@ -727,9 +732,10 @@ static Res VMArenaGrow(Arena arena, LocusPref pref, Size size)
   Size chunkMin;
   Res res;
   
-  /* TODO: Ensure that extended arena will be able to satisfy pref. */
+  /* TODO: Ensure that extended arena will be able to satisfy the
+     zone preferences in pref. The node preference is satisfied by
+     binding the new chunk to the node. <design/arena#.numa.grow> */
   AVERT(LocusPref, pref);
-  UNUSED(pref);
 
   res = vmArenaChunkSize(&chunkMin, vmArena, size);
   if (res != ResOK)
@@ -761,7 +767,7 @@ static Res VMArenaGrow(Arena arena, LocusPref pref, Size size)
           EVENT2(VMArenaExtendFail, chunkMin, ArenaReserved(arena));
           return res;
         }
-        res = VMChunkCreate(&newChunk, vmArena, chunkSize);
+        res = VMChunkCreate(&newChunk, vmArena, chunkSize, pref->node);
         if(res == ResOK)
           goto vmArenaGrow_Done;
       }
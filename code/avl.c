@@ -0,0 +1,1168 @@
+/* avl.c: BALANCED TREE LAND IMPLEMENTATION
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .intro: This is a Land implementation that keeps its ranges in an
+ * AVL tree, with each node augmented (like the nodes of a CBSZoned)
+ * by the largest block size and the union zone set of its sub-tree.
+ *
+ * .purpose: The CBS is built on a splay tree, so every search
+ * restructures the tree. Searching an AVL tree only reads it, and
+ * touches at most O(log n) nodes. Only insertions and deletions
+ * write to the tree, and they write only to nodes on the path from
+ * the root to the changed node.
+ *
+ * .sources: <design/avl>.
+ *
+ * .recursion: None of the functions here are recursive, since the MPS
+ * must operate in tight stack constraints (<design/sp>). Paths through
+ * the tree are recorded in arrays of size avlPathMAX on the stack.
+ */
+
+#include "avl.h"
+#include "range.h"
+#include "poolmfs.h"
+#include "mpm.h"
+
+SRCID(avl, "$Id$");
+
+
+#define avlBlockPool(avl) RVALUE((avl)->blockPool)
+#define avlBlockSize(block) AddrOffset((block)->base, (block)->limit)
+#define avlHeight(block) ((block) == NULL ? 0 : (block)->height)
+
+
+/* avlPathMAX -- bound on the length of a path through the tree
+ *
+ * An AVL tree of height h has at least Fib(h + 2) - 1 nodes, so a
+ * tree of disjoint non-empty ranges of addresses has height less
+ * than 1.5 times the word width. A path from the root link to an
+ * empty link has at most one more entry than the height.
+ */
+
+#define avlPathMAX (MPS_WORD_WIDTH + MPS_WORD_WIDTH / 2 + 1)
+
+
+/* AVLCheck -- check AVL land */
+
+Bool AVLCheck(AVL avl)
+{
+  /* See .enter-leave.simple in <code/cbs.c>. */
+  Land land;
+  CHECKS(AVL, avl);
+  land = AVLLand(avl);
+  CHECKD(Land, land);
+  CHECKD(Pool, avl->blockPool);
+  CHECKL(BoolCheck(avl->ownPool));
+  CHECKL(SizeIsAligned(avl->size, LandAlignment(land)));
+  CHECKL((avl->size == 0) == (avl->treeSize == 0));
+  CHECKL((avl->root == NULL) == (avl->treeSize == 0));
+  CHECKL(avlHeight(avl->root) < avlPathMAX);
+  return TRUE;
+}
+
+
+/* AVLBlockCheck -- check a block in the tree */
+
+static Bool AVLBlockCheck(AVLBlock block)
+{
+  CHECKL(block != NULL);
+  CHECKL(block->base < block->limit);
+  CHECKL(block->maxSize >= avlBlockSize(block));
+  CHECKL(block->height > 0);
+  CHECKL(block->left == NULL || block->left->limit < block->base);
+  CHECKL(block->right == NULL || block->limit < block->right->base);
+  return TRUE;
+}
+
+
+/* avlBlockUpdate -- recompute summary of sub-tree from its children
+ *
+ * Returns TRUE if the summary changed.
+ */
+
+static Bool avlBlockUpdate(AVL avl, AVLBlock block)
+{
+  Arena arena = LandArena(AVLLand(avl));
+  Size maxSize = avlBlockSize(block);
+  ZoneSet zones = ZoneSetOfRange(arena, block->base, block->limit);
+  Count height = 0;
+
+  if (block->left != NULL) {
+    height = block->left->height;
+    if (block->left->maxSize > maxSize)
+      maxSize = block->left->maxSize;
+    zones = ZoneSetUnion(zones, block->left->zones);
+  }
+
+  if (block->right != NULL) {
+    if (block->right->height > height)
+      height = block->right->height;
+    if (block->right->maxSize > maxSize)
+      maxSize = block->right->maxSize;
+    zones = ZoneSetUnion(zones, block->right->zones);
+  }
+
+  ++ height;
+  if (block->maxSize == maxSize && block->zones == zones
+      && block->height == height)
+    return FALSE;
+  block->maxSize = maxSize;
+  block->zones = zones;
+  block->height = height;
+  return TRUE;
+}
+
+
+/* avlRotateLeft, avlRotateRight -- rotate the sub-tree at *link */
+
+static void avlRotateLeft(AVL avl, AVLBlock *link)
+{
+  AVLBlock block = *link;
+  AVLBlock right = block->right;
+
+  AVER_CRITICAL(right != NULL);
+  block->right = right->left;
+  right->left = block;
+  (void)avlBlockUpdate(avl, block);
+  (void)avlBlockUpdate(avl, right);
+  *link = right;
+}
+
+static void avlRotateRight(AVL avl, AVLBlock *link)
+{
+  AVLBlock block = *link;
+  AVLBlock left = block->left;
+
+  AVER_CRITICAL(left != NULL);
+  block->left = left->right;
+  left->right = block;
+  (void)avlBlockUpdate(avl, block);
+  (void)avlBlockUpdate(avl, left);
+  *link = left;
+}
+
+
+/* avlRebalance -- restore balance and summary of the sub-tree at *link
+ *
+ * The children of the sub-tree must be balanced, and their heights
+ * must differ by at most two. Returns TRUE if the sub-tree's summary
+ * or shape changed.
+ */
+
+static Bool avlRebalance(AVL avl, AVLBlock *link)
+{
+  AVLBlock block = *link;
+  Count leftHeight, rightHeight;
+  Bool changed = TRUE;
+
+  if (block == NULL)
+    return TRUE;
+
+  leftHeight = avlHeight(block->left);
+  rightHeight = avlHeight(block->right);
+
+  if (leftHeight > rightHeight + 1) {
+    AVLBlock left = block->left;
+    if (avlHeight(left->left) < avlHeight(left->right))
+      avlRotateLeft(avl, &block->left);
+    avlRotateRight(avl, link);
+  } else if (rightHeight > leftHeight + 1) {
+    AVLBlock right = block->right;
+    if (avlHeight(right->right) < avlHeight(right->left))
+      avlRotateRight(avl, &block->right);
+    avlRotateLeft(avl, link);
+  } else {
+    changed = avlBlockUpdate(avl, block);
+  }
+
+  AVERT_CRITICAL(AVLBlock, *link);
+  return changed;
+}
+
+
+/* avlFixPath -- rebalance and update the sub-trees along a path
+ *
+ * Rebalances the sub-trees at the links path[depth - 1] ... path[0],
+ * deepest first. Once a sub-tree is unchanged, so are the sub-trees
+ * above it, except that the sub-tree at path[moved] (if moved is less
+ * than depth) must be fixed in any case, because a block was moved
+ * there. <design/avl#.impl.path.stop>.
+ */
+
+static void avlFixPath(AVL avl, AVLBlock **path, Index depth, Index moved)
+{
+  while (depth > 0) {
+    -- depth;
+    if (!avlRebalance(avl, path[depth])) {
+      if (moved >= depth)
+        break;
+      depth = moved + 1;
+    }
+  }
+}
+
+
+/* avlSearch -- find the block containing an address, recording the path
+ *
+ * Stores in path the links from the root link to the link to the
+ * block containing addr, if there is one, or else to the empty link
+ * where a block with base addr would be inserted. Returns the number
+ * of links on the path.
+ */
+
+static Index avlSearch(AVLBlock **path, AVL avl, Addr addr)
+{
+  AVLBlock *link = &avl->root;
+  Index depth = 0;
+
+  for (;;) {
+    AVLBlock block = *link;
+    AVER_CRITICAL(depth < avlPathMAX);
+    path[depth] = link;
+    ++ depth;
+    if (block == NULL)
+      break;
+    if (addr < block->base)
+      link = &block->left;
+    else if (addr >= block->limit)
+      link = &block->right;
+    else
+      break;
+  }
+
+  return depth;
+}
+
+
+/* avlRefresh -- update the summaries on the path to a block
+ *
+ * Call this after changing the base or limit of the block containing
+ * addr without changing its order in the tree.
+ */
+
+static void avlRefresh(AVL avl, Addr addr)
+{
+  AVLBlock *path[avlPathMAX];
+  Index depth;
+
+  depth = avlSearch(path, avl, addr);
+  AVER(*path[depth - 1] != NULL);
+  avlFixPath(avl, path, depth, depth);
+}
+
+
+/* avlBlockAlloc -- allocate a new block, but do not insert it yet */
+
+static Res avlBlockAlloc(AVLBlock *blockReturn, AVL avl, Addr base,
+                         Addr limit)
+{
+  Res res;
+  AVLBlock block;
+  Addr p;
+
+  AVER(blockReturn != NULL);
+  AVER(base < limit);
+
+  res = PoolAlloc(&p, avlBlockPool(avl), sizeof(AVLBlockStruct));
+  if (res != ResOK)
+    return res;
+  block = (AVLBlock)p;
+
+  block->left = NULL;
+  block->right = NULL;
+  block->base = base;
+  block->limit = limit;
+  block->maxSize = 0;
+  block->zones = ZoneSetEMPTY;
+  block->height = 0;
+  (void)avlBlockUpdate(avl, block);
+
+  AVERT(AVLBlock, block);
+  *blockReturn = block;
+  return ResOK;
+}
+
+
+/* avlBlockFree -- free a block that is no longer in the tree */
+
+static void avlBlockFree(AVL avl, AVLBlock block)
+{
+  AVER(avl->treeSize > 0);
+  -- avl->treeSize;
+  PoolFree(avlBlockPool(avl), (Addr)block, sizeof(AVLBlockStruct));
+}
+
+
+/* avlBlockInsert -- insert a block into the tree */
+
+static void avlBlockInsert(AVL avl, AVLBlock block)
+{
+  AVLBlock *path[avlPathMAX];
+  Index depth;
+
+  AVER(block->left == NULL);
+  AVER(block->right == NULL);
+  (void)avlBlockUpdate(avl, block);
+  depth = avlSearch(path, avl, block->base);
+  AVER(*path[depth - 1] == NULL);
+  *path[depth - 1] = block;
+  avlFixPath(avl, path, depth - 1, depth);
+  ++ avl->treeSize;
+}
+
+
+/* avlBlockRemove -- remove a block from the tree, but do not free it
+ *
+ * If the block has two children, it is replaced by its successor,
+ * which is the leftmost block in its right sub-tree. The successor
+ * takes over the block's summary, so that the comparison in
+ * avlFixPath is with the summary that the ancestors were computed
+ * from.
+ */
+
+static void avlBlockRemove(AVL avl, AVLBlock block)
+{
+  AVLBlock *path[avlPathMAX];
+  AVLBlock *link;
+  Index depth, moved;
+
+  depth = avlSearch(path, avl, block->base);
+  link = path[depth - 1];
+  AVER(*link == block);
+  moved = depth;
+
+  if (block->left == NULL) {
+    *link = block->right;
+  } else if (block->right == NULL) {
+    *link = block->left;
+  } else {
+    Index k = depth;
+    AVLBlock *succLink = &block->right;
+    AVLBlock succ;
+    AVER(depth < avlPathMAX);
+    path[depth] = succLink;
+    ++ depth;
+    while ((*succLink)->left != NULL) {
+      succLink = &(*succLink)->left;
+      AVER(depth < avlPathMAX);
+      path[depth] = succLink;
+      ++ depth;
+    }
+    succ = *succLink;
+    *succLink = succ->right;
+    succ->left = block->left;
+    succ->right = block->right;
+    succ->maxSize = block->maxSize;
+    succ->zones = block->zones;
+    succ->height = block->height;
+    *link = succ;
+    /* The path went through block->right, which is now succ->right. */
+    path[k] = &succ->right;
+    moved = k - 1;
+  }
+
+  /* The sub-tree at the end of the path is intact. */
+  avlFixPath(avl, path, depth - 1, moved);
+}
+
+
+/* avlInit -- initialise an AVL land
+ *
+ * <design/land#.function.init>.
+ */
+
+ARG_DEFINE_KEY(avl_block_pool, Pool);
+
+static Res avlInit(Land land, Arena arena, Align alignment, ArgList args)
+{
+  AVL avl;
+  ArgStruct arg;
+  Res res;
+  Pool blockPool = NULL;
+
+  AVER(land != NULL);
+  res = NextMethod(Land, AVL, init)(land, arena, alignment, args);
+  if (res != ResOK)
+    return res;
+  avl = CouldBeA(AVL, land);
+
+  if (ArgPick(&arg, args, AVLBlockPool))
+    blockPool = arg.val.pool;
+
+  if (blockPool != NULL) {
+    avl->blockPool = blockPool;
+    avl->ownPool = FALSE;
+  } else {
+    MPS_ARGS_BEGIN(pcArgs) {
+      MPS_ARGS_ADD(pcArgs, MPS_KEY_MFS_UNIT_SIZE, sizeof(AVLBlockStruct));
+      res = PoolCreate(&avl->blockPool, arena, PoolClassMFS(), pcArgs);
+    } MPS_ARGS_END(pcArgs);
+    if (res != ResOK)
+      return res;
+    avl->ownPool = TRUE;
+  }
+  avl->root = NULL;
+  avl->treeSize = 0;
+  avl->size = 0;
+
+  SetClassOfPoly(land, CLASS(AVL));
+  avl->sig = AVLSig;
+  AVERC(AVL, avl);
+
+  return ResOK;
+}
+
+
+/* avlFinish -- finish an AVL land
+ *
+ * <design/land#.function.finish>.
+ */
+
+static void avlFinish(Inst inst)
+{
+  Land land = MustBeA(Land, inst);
+  AVL avl = MustBeA(AVL, land);
+
+  avl->sig = SigInvalid;
+  avl->root = NULL;
+  if (avl->ownPool)
+    PoolDestroy(avlBlockPool(avl));
+
+  NextMethod(Inst, AVL, finish)(inst);
+}
+
+
+/* avlSize -- total size of ranges in AVL land
+ *
+ * <design/land#.function.size>.
+ */
+
+static Size avlSize(Land land)
+{
+  AVL avl = MustBeA_CRITICAL(AVL, land);
+  return avl->size;
+}
+
+
+/* avlInsert -- insert a range into the AVL land
+ *
+ * <design/land#.function.insert>.
+ *
+ * .insert.neighbours: When the search for the base of the range ends
+ * at an empty link, the blocks on either side of that link are the
+ * last blocks on the path at which the search went right and left
+ * respectively. So coalescing with them changes only blocks on the
+ * path.
+ *
+ * .insert.alloc: Will only allocate a block if the range does not
+ * abut an existing range.
+ */
+
+static Res avlInsert(Range rangeReturn, Land land, Range range)
+{
+  AVL avl = MustBeA_CRITICAL(AVL, land);
+  AVLBlock *path[avlPathMAX];
+  AVLBlock leftBlock = NULL, rightBlock = NULL;
+  Addr base, limit, newBase, newLimit;
+  Bool leftMerge, rightMerge;
+  Index depth, i, leftIndex = 0, rightIndex = 0;
+  Res res;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVERT_CRITICAL(Range, range);
+  AVER_CRITICAL(!RangeIsEmpty(range));
+  AVER_CRITICAL(RangeIsAligned(range, LandAlignment(land)));
+
+  base = RangeBase(range);
+  limit = RangeLimit(range);
+
+  depth = avlSearch(path, avl, base);
+  if (*path[depth - 1] != NULL)
+    return ResFAIL; /* base is in an existing range */
+
+  for (i = 0; i + 1 < depth; ++i) {
+    AVLBlock block = *path[i];
+    if (path[i + 1] == &block->right) {
+      leftBlock = block;
+      leftIndex = i;
+    } else {
+      rightBlock = block;
+      rightIndex = i;
+    }
+  }
+
+  AVER_CRITICAL(leftBlock == NULL || leftBlock->limit <= base);
+  if (rightBlock != NULL && limit > rightBlock->base)
+    return ResFAIL; /* range overlaps the next range */
+
+  leftMerge = leftBlock != NULL && leftBlock->limit == base;
+  rightMerge = rightBlock != NULL && rightBlock->base == limit;
+  newBase = leftMerge ? leftBlock->base : base;
+  newLimit = rightMerge ? rightBlock->limit : limit;
+
+  if (leftMerge && rightMerge) {
+    avlBlockRemove(avl, rightBlock);
+    avlBlockFree(avl, rightBlock);
+    leftBlock->limit = newLimit;
+    avlRefresh(avl, newBase);
+
+  } else if (leftMerge) {
+    leftBlock->limit = limit;
+    avlFixPath(avl, path, leftIndex + 1, depth);
+
+  } else if (rightMerge) {
+    rightBlock->base = base;
+    avlFixPath(avl, path, rightIndex + 1, depth);
+
+  } else {
+    AVLBlock block;
+    res = avlBlockAlloc(&block, avl, base, limit);
+    if (res != ResOK)
+      return res;
+    *path[depth - 1] = block;
+    avlFixPath(avl, path, depth - 1, depth);
+    ++ avl->treeSize;
+  }
+
+  avl->size += RangeSize(range);
+  RangeInit(rangeReturn, newBase, newLimit);
+  return ResOK;
+}
+
+
+/* avlExtendBlockPool -- extend block pool with memory */
+
+static void avlExtendBlockPool(AVL avl, Addr base, Addr limit)
+{
+  Tract tract;
+  Addr addr;
+
+  AVERC(AVL, avl);
+  AVER(base < limit);
+
+  /* Steal tracts from their owning pool */
+  TRACT_FOR(tract, addr, AVLLand(avl)->arena, base, limit) {
+    TractFinish(tract);
+    TractInit(tract, avl->blockPool, addr);
+  }
+
+  /* Extend the block pool with the stolen memory. */
+  MFSExtend(avl->blockPool, base, limit);
+}
+
+
+/* avlInsertSteal -- insert a range into the AVL land, possibly
+ * stealing memory for the block pool
+ */
+
+static Res avlInsertSteal(Range rangeReturn, Land land, Range rangeIO)
+{
+  AVL avl = MustBeA(AVL, land);
+  Arena arena = land->arena;
+  Size grainSize = ArenaGrainSize(arena);
+  Res res;
+
+  AVER(rangeReturn != NULL);
+  AVER(rangeReturn != rangeIO);
+  AVERT(Range, rangeIO);
+  AVER(!RangeIsEmpty(rangeIO));
+  AVER(RangeIsAligned(rangeIO, LandAlignment(land)));
+  AVER(AlignIsAligned(LandAlignment(land), grainSize));
+
+  res = avlInsert(rangeReturn, land, rangeIO);
+  if (res != ResOK && res != ResFAIL) {
+    /* Steal an arena grain and use it to extend the block pool. */
+    Addr stolenBase = RangeBase(rangeIO);
+    Addr stolenLimit = AddrAdd(stolenBase, grainSize);
+    avlExtendBlockPool(avl, stolenBase, stolenLimit);
+
+    /* Update the inserted range and try again. */
+    RangeSetBase(rangeIO, stolenLimit);
+    AVERT(Range, rangeIO);
+    if (RangeIsEmpty(rangeIO)) {
+      RangeCopy(rangeReturn, rangeIO);
+      res = ResOK;
+    } else {
+      res = avlInsert(rangeReturn, land, rangeIO);
+      AVER(res == ResOK);  /* since we just extended the block pool */
+    }
+  }
+  return res;
+}
+
+
+/* avlDelete -- remove a range from the AVL land
+ *
+ * <design/land#.function.delete>.
+ *
+ * .delete.alloc: Will only allocate a block if the range splits
+ * an existing range.
+ */
+
+static Res avlDelete(Range rangeReturn, Land land, Range range)
+{
+  AVL avl = MustBeA(AVL, land);
+  AVLBlock *path[avlPathMAX];
+  AVLBlock block;
+  Addr base, limit, oldBase, oldLimit;
+  Index depth;
+  Res res;
+
+  AVER(rangeReturn != NULL);
+  AVERT(Range, range);
+  AVER(!RangeIsEmpty(range));
+  AVER(RangeIsAligned(range, LandAlignment(land)));
+
+  base = RangeBase(range);
+  limit = RangeLimit(range);
+
+  depth = avlSearch(path, avl, base);
+  block = *path[depth - 1];
+  if (block == NULL || limit > block->limit)
+    return ResFAIL;
+
+  oldBase = block->base;
+  oldLimit = block->limit;
+  RangeInit(rangeReturn, oldBase, oldLimit);
+
+  if (base == oldBase && limit == oldLimit) {
+    /* entire block */
+    avlBlockRemove(avl, block);
+    avlBlockFree(avl, block);
+
+  } else if (base == oldBase) {
+    /* remaining fragment at right */
+    block->base = limit;
+    avlFixPath(avl, path, depth, depth);
+
+  } else if (limit == oldLimit) {
+    /* remaining fragment at left */
+    block->limit = base;
+    avlFixPath(avl, path, depth, depth);
+
+  } else {
+    /* two remaining fragments. shrink block to represent fragment at
+       left, and create new block for fragment at right. */
+    AVLBlock newBlock;
+    res = avlBlockAlloc(&newBlock, avl, limit, oldLimit);
+    if (res != ResOK)
+      return res;
+    block->limit = base;
+    avlFixPath(avl, path, depth, depth);
+    avlBlockInsert(avl, newBlock);
+  }
+
+  AVER(avl->size >= RangeSize(range));
+  avl->size -= RangeSize(range);
+  return ResOK;
+}
+
+
+static Res avlDeleteSteal(Range rangeReturn, Land land, Range range)
+{
+  AVL avl = MustBeA(AVL, land);
+  Arena arena = land->arena;
+  Size grainSize = ArenaGrainSize(arena);
+  RangeStruct containingRange;
+  Res res;
+
+  AVER(rangeReturn != NULL);
+  AVERT(Range, range);
+  AVER(!RangeIsEmpty(range));
+  AVER(RangeIsAligned(range, LandAlignment(land)));
+  AVER(AlignIsAligned(LandAlignment(land), grainSize));
+
+  res = avlDelete(&containingRange, land, range);
+  if (res == ResOK) {
+    RangeCopy(rangeReturn, &containingRange);
+  } else if (res != ResFAIL) {
+    /* Steal an arena grain from the base of the containing range and
+       use it to extend the block pool. */
+    Addr stolenBase = RangeBase(&containingRange);
+    Addr stolenLimit = AddrAdd(stolenBase, grainSize);
+    RangeStruct stolenRange;
+    AVER(stolenLimit <= RangeBase(range));
+    RangeInit(&stolenRange, stolenBase, stolenLimit);
+    res = avlDelete(&containingRange, land, &stolenRange);
+    AVER(res == ResOK);  /* since this does not split any range */
+    avlExtendBlockPool(avl, stolenBase, stolenLimit);
+
+    /* Try again with original range. */
+    res = avlDelete(rangeReturn, land, range);
+    AVER(res == ResOK);  /* since we just extended the block pool */
+  }
+  return res;
+}
+
+
+/* avlIterate -- iterate over all blocks in address order
+ *
+ * <design/land#.function.iterate>.
+ */
+
+static Bool avlIterate(Land land, LandVisitor visitor, void *visitorClosure)
+{
+  AVL avl = MustBeA(AVL, land);
+  AVLBlock stack[avlPathMAX];
+  AVLBlock block = avl->root;
+  Index depth = 0;
+
+  AVER(FUNCHECK(visitor));
+
+  for (;;) {
+    RangeStruct range;
+    while (block != NULL) {
+      AVER(depth < avlPathMAX);
+      stack[depth] = block;
+      ++ depth;
+      block = block->left;
+    }
+    if (depth == 0)
+      break;
+    -- depth;
+    block = stack[depth];
+    RangeInit(&range, block->base, block->limit);
+    if (!(*visitor)(land, &range, visitorClosure))
+      return FALSE;
+    block = block->right;
+  }
+
+  return TRUE;
+}
+
+
+/* avlIterateAndDelete -- iterate over all blocks, maybe deleting them
+ *
+ * <design/land#.function.iterate.and.delete>.
+ *
+ * The blocks that are kept are chained through their right pointers
+ * in address order, and then inserted into an empty tree.
+ */
+
+static Bool avlIterateAndDelete(Land land, LandDeleteVisitor visitor,
+                                void *visitorClosure)
+{
+  AVL avl = MustBeA(AVL, land);
+  AVLBlock stack[avlPathMAX];
+  AVLBlock block = avl->root;
+  AVLBlock kept = NULL, *keptTail = &kept;
+  Index depth = 0;
+  Bool cont = TRUE;
+
+  AVER(FUNCHECK(visitor));
+
+  for (;;) {
+    AVLBlock next;
+    Bool deleteNode = FALSE;
+    while (block != NULL) {
+      AVER(depth < avlPathMAX);
+      stack[depth] = block;
+      ++ depth;
+      block = block->left;
+    }
+    if (depth == 0)
+      break;
+    -- depth;
+    block = stack[depth];
+    next = block->right;
+    if (cont) {
+      RangeStruct range;
+      RangeInit(&range, block->base, block->limit);
+      cont = (*visitor)(&deleteNode, land, &range, visitorClosure);
+    }
+    if (deleteNode) {
+      AVER(avl->size >= avlBlockSize(block));
+      avl->size -= avlBlockSize(block);
+      avlBlockFree(avl, block);
+    } else {
+      *keptTail = block;
+      keptTail = &block->right;
+    }
+    block = next;
+  }
+  *keptTail = NULL;
+
+  avl->root = NULL;
+  avl->treeSize = 0;
+  while (kept != NULL) {
+    block = kept;
+    kept = block->right;
+    block->left = NULL;
+    block->right = NULL;
+    avlBlockInsert(avl, block);
+  }
+
+  return cont;
+}
+
+
+/* avlFindBlock -- find the first (or last) block of at least size
+ *
+ * Returns NULL if there is no such block. Uses the maxSize summaries
+ * to descend directly to the block, without backtracking.
+ */
+
+static AVLBlock avlFindBlock(AVL avl, Size size, Bool high)
+{
+  AVLBlock block = avl->root;
+
+  if (block == NULL || block->maxSize < size)
+    return NULL;
+
+  for (;;) {
+    AVLBlock near = high ? block->right : block->left;
+    AVLBlock far = high ? block->left : block->right;
+    if (near != NULL && near->maxSize >= size) {
+      block = near;
+    } else if (avlBlockSize(block) >= size) {
+      return block;
+    } else {
+      AVER_CRITICAL(far != NULL && far->maxSize >= size);
+      block = far;
+    }
+  }
+}
+
+
+/* avlFindDeleteRange -- delete appropriate range of block found */
+
+static void avlFindDeleteRange(Range rangeReturn, Range oldRangeReturn,
+                               Land land, AVLBlock block, Size size,
+                               FindDelete findDelete)
+{
+  Bool callDelete = TRUE;
+  Addr base, limit;
+
+  AVER(rangeReturn != NULL);
+  AVER(oldRangeReturn != NULL);
+  AVERT(Land, land);
+  AVERT(AVLBlock, block);
+  AVER(size > 0);
+  AVER(SizeIsAligned(size, LandAlignment(land)));
+  AVER(avlBlockSize(block) >= size);
+  AVERT(FindDelete, findDelete);
+
+  base = block->base;
+  limit = block->limit;
+
+  switch(findDelete) {
+
+  case FindDeleteNONE:
+    callDelete = FALSE;
+    break;
+
+  case FindDeleteLOW:
+    limit = AddrAdd(base, size);
+    break;
+
+  case FindDeleteHIGH:
+    base = AddrSub(limit, size);
+    break;
+
+  case FindDeleteENTIRE:
+    /* do nothing */
+    break;
+
+  default:
+    NOTREACHED;
+    break;
+  }
+
+  RangeInit(rangeReturn, base, limit);
+
+  if (callDelete) {
+    Res res;
+    res = avlDelete(oldRangeReturn, land, rangeReturn);
+    /* Can't have run out of memory, because we only deleted from one
+       end of the block, so avlDelete did not need to allocate a new
+       block. */
+    AVER(res == ResOK);
+  } else {
+    RangeCopy(oldRangeReturn, rangeReturn);
+  }
+}
+
+
+/* avlFindFirst -- find the first block of at least the given size */
+
+static Bool avlFindFirst(Range rangeReturn, Range oldRangeReturn,
+                         Land land, Size size, FindDelete findDelete)
+{
+  AVL avl = MustBeA_CRITICAL(AVL, land);
+  AVLBlock block;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(size > 0);
+  AVER_CRITICAL(SizeIsAligned(size, LandAlignment(land)));
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  block = avlFindBlock(avl, size, FALSE);
+  if (block == NULL)
+    return FALSE;
+  avlFindDeleteRange(rangeReturn, oldRangeReturn, land, block,
+                     size, findDelete);
+  return TRUE;
+}
+
+
+/* avlFindLast -- find the last block of at least the given size */
+
+static Bool avlFindLast(Range rangeReturn, Range oldRangeReturn,
+                        Land land, Size size, FindDelete findDelete)
+{
+  AVL avl = MustBeA_CRITICAL(AVL, land);
+  AVLBlock block;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(size > 0);
+  AVER_CRITICAL(SizeIsAligned(size, LandAlignment(land)));
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  block = avlFindBlock(avl, size, TRUE);
+  if (block == NULL)
+    return FALSE;
+  avlFindDeleteRange(rangeReturn, oldRangeReturn, land, block,
+                     size, findDelete);
+  return TRUE;
+}
+
+
+/* avlFindLargest -- find the largest block in the AVL land */
+
+static Bool avlFindLargest(Range rangeReturn, Range oldRangeReturn,
+                           Land land, Size size, FindDelete findDelete)
+{
+  AVL avl = MustBeA_CRITICAL(AVL, land);
+  AVLBlock block;
+
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  AVER_CRITICAL(size > 0);
+  AVERT_CRITICAL(FindDelete, findDelete);
+
+  if (avl->root == NULL || avl->root->maxSize < size)
+    return FALSE;
+
+  /* maxSize is exact, so we will find it. */
+  block = avlFindBlock(avl, avl->root->maxSize, FALSE);
+  AVER_CRITICAL(block != NULL);
+  avlFindDeleteRange(rangeReturn, oldRangeReturn, land, block,
+                     size, findDelete);
+  return TRUE;
+}
+
+
+/* avlFindInZones -- find a block within a zone set
+ *
+ * Finds a block of at least the given size that lies entirely within a
+ * zone set. (The first such block, if high is FALSE, or the last, if
+ * high is TRUE.)
+ *
+ * A sub-tree whose summary admits a block of the size in the zone
+ * set may nonetheless not contain one, so unlike avlFindBlock this
+ * must backtrack. It visits the blocks in address order (or reverse
+ * address order), skipping sub-trees whose summaries rule them out.
+ */
+
+static Res avlFindInZones(Bool *foundReturn, Range rangeReturn,
+                          Range oldRangeReturn, Land land, Size size,
+                          ZoneSet zoneSet, Bool high)
+{
+  AVL avl = MustBeA_CRITICAL(AVL, land);
+  Arena arena = LandArena(land);
+  AVLBlock stack[avlPathMAX];
+  AVLBlock block = avl->root;
+  Index depth = 0;
+  RangeInZoneSet search;
+  LandFindMethod landFind;
+  RangeStruct rangeStruct, oldRangeStruct;
+  Addr base, limit;
+  Res res;
+
+  AVER_CRITICAL(foundReturn != NULL);
+  AVER_CRITICAL(rangeReturn != NULL);
+  AVER_CRITICAL(oldRangeReturn != NULL);
+  /* AVERT_CRITICAL(ZoneSet, zoneSet); */
+  AVERT_CRITICAL(Bool, high);
+
+  landFind = high ? avlFindLast : avlFindFirst;
+  search = high ? RangeInZoneSetLast : RangeInZoneSetFirst;
+
+  if (zoneSet == ZoneSetEMPTY)
+    goto fail;
+  if (zoneSet == ZoneSetUNIV) {
+    FindDelete fd = high ? FindDeleteHIGH : FindDeleteLOW;
+    *foundReturn = (*landFind)(rangeReturn, oldRangeReturn, land, size, fd);
+    return ResOK;
+  }
+  if (ZoneSetIsSingle(zoneSet) && size > ArenaStripeSize(arena))
+    goto fail;
+
+  for (;;) {
+    while (block != NULL && block->maxSize >= size
+           && ZoneSetInter(block->zones, zoneSet) != ZoneSetEMPTY)
+    {
+      AVER_CRITICAL(depth < avlPathMAX);
+      stack[depth] = block;
+      ++ depth;
+      block = high ? block->right : block->left;
+    }
+    if (depth == 0)
+      goto fail;
+    -- depth;
+    block = stack[depth];
+    if ((*search)(&base, &limit, block->base, block->limit,
+                  arena, zoneSet, size))
+      break;
+    block = high ? block->left : block->right;
+  }
+
+  AVER_CRITICAL(block->base <= base);
+  AVER_CRITICAL(AddrOffset(base, limit) >= size);
+  AVER_CRITICAL(ZoneSetSub(ZoneSetOfRange(arena, base, limit), zoneSet));
+  AVER_CRITICAL(limit <= block->limit);
+
+  if (!high)
+    RangeInit(&rangeStruct, base, AddrAdd(base, size));
+  else
+    RangeInit(&rangeStruct, AddrSub(limit, size), limit);
+  res = avlDelete(&oldRangeStruct, land, &rangeStruct);
+  if (res != ResOK)
+    /* not enough memory to split block */
+    return res;
+  RangeCopy(rangeReturn, &rangeStruct);
+  RangeCopy(oldRangeReturn, &oldRangeStruct);
+  *foundReturn = TRUE;
+  return ResOK;
+
+fail:
+  *foundReturn = FALSE;
+  return ResOK;
+}
+
+
+/* avlDescribe -- describe an AVL land
+ *
+ * <design/land#.function.describe>.
+ */
+
+static Res avlDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
+{
+  Land land = CouldBeA(Land, inst);
+  AVL avl = CouldBeA(AVL, land);
+  AVLBlock stack[avlPathMAX];
+  AVLBlock block;
+  Index sp = 0;
+  Res res;
+
+  if (!TESTC(AVL, avl))
+    return ResPARAM;
+  if (stream == NULL)
+    return ResPARAM;
+
+  res = NextMethod(Inst, AVL, describe)(inst, stream, depth);
+  if (res != ResOK)
+    return res;
+
+  res = WriteF(stream, depth + 2,
+               "blockPool $P\n", (WriteFP)avlBlockPool(avl),
+               "ownPool   $U\n", (WriteFU)avl->ownPool,
+               "treeSize  $U\n", (WriteFU)avl->treeSize,
+               "height    $U\n", (WriteFU)avlHeight(avl->root),
+               NULL);
+  if (res != ResOK)
+    return res;
+
+  block = avl->root;
+  for (;;) {
+    while (block != NULL) {
+      stack[sp] = block;
+      ++ sp;
+      block = block->left;
+    }
+    if (sp == 0)
+      break;
+    -- sp;
+    block = stack[sp];
+    res = WriteF(stream, depth + 2,
+                 "[$P,$P) {$U, $B}\n",
+                 (WriteFP)block->base,
+                 (WriteFP)block->limit,
+                 (WriteFU)block->maxSize,
+                 (WriteFB)block->zones,
+                 NULL);
+    if (res != ResOK)
+      return res;
+    block = block->right;
+  }
+
+  return ResOK;
+}
+
+
+DEFINE_CLASS(Land, AVL, klass)
+{
+  INHERIT_CLASS(klass, AVL, Land);
+  klass->instClassStruct.describe = avlDescribe;
+  klass->instClassStruct.finish = avlFinish;
+  klass->size = sizeof(AVLStruct);
+  klass->init = avlInit;
+  klass->sizeMethod = avlSize;
+  klass->insert = avlInsert;
+  klass->insertSteal = avlInsertSteal;
+  klass->delete = avlDelete;
+  klass->deleteSteal = avlDeleteSteal;
+  klass->iterate = avlIterate;
+  klass->iterateAndDelete = avlIterateAndDelete;
+  klass->findFirst = avlFindFirst;
+  klass->findLast = avlFindLast;
+  klass->findLargest = avlFindLargest;
+  klass->findInZones = avlFindInZones;
+  AVERT(LandClass, klass);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
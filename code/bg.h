@@ -0,0 +1,95 @@
+/* bg.h: BACKGROUND COLLECTOR THREAD
+ *
+ *  $Id$
+ *  Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ *  .purpose: Provides a thread owned by the MPS that does collection
+ *  work for an arena when the mutator does not call into the MPS, so
+ *  that clients without a natural place to call mps_arena_step still
+ *  get their idle time used.  <design/strategy#.policy.background>.
+ *
+ *  .wake: The thread calls ArenaBackgroundStep once every interval
+ *  until the thread is destroyed.  The interval is measured in real
+ *  time, not in processor time, because the point is to do work while
+ *  the mutator is blocked.
+ *
+ *  .thread-safety: The thread is not registered with the arena, so it
+ *  is never suspended by the shield, and its stack is not scanned.
+ *  ArenaBackgroundStep only ever tries to claim the arena lock, so it
+ *  is safe to destroy the thread while holding the lock.
+ *
+ *  .fork: The thread does not survive a fork().  BgForkChild must be
+ *  called in the child, so that BgDestroy does not wait for it.  The
+ *  child process gets no background collection.
+ */
+
+#ifndef bg_h
+#define bg_h
+
+#include "mpmtypes.h"
+
+
+#define BgSig           ((Sig)0x519B6C01) /* SIGnature BackGround COLlector */
+
+
+extern Bool BgCheck(Bg bg);
+
+
+/*  BgCreate/Destroy
+ *
+ *  Create a background thread for the arena, waking every interval
+ *  seconds.  If the platform does not support threads, BgCreate
+ *  succeeds but the arena gets no background collection.
+ */
+
+extern Res BgCreate(Bg *bgReturn, Arena arena, double interval);
+extern void BgDestroy(Bg bg);
+
+
+/*  BgForkChild -- forget the thread in the child of a fork() */
+
+extern void BgForkChild(Bg bg);
+
+
+#endif /* bg_h */
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
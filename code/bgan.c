@@ -0,0 +1,108 @@
+/* bgan.c: ANSI BACKGROUND COLLECTOR THREAD
+ *
+ *  $Id$
+ *  Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ *  .purpose: This is a trivial implementation of the background
+ *  collector thread interface <code/bg.h> for platforms without
+ *  threads, or without an implementation of the interface.  There is
+ *  no thread, so the arena only collects when the client calls in.
+ */
+
+#include "mpm.h"
+#include "bg.h"
+
+SRCID(bgan, "$Id$");
+
+
+typedef struct BgStruct {       /* ANSI background thread structure */
+  Sig sig;                      /* <design/sig> */
+  Arena arena;                  /* owning arena */
+} BgStruct;
+
+
+Bool BgCheck(Bg bg)
+{
+  CHECKS(Bg, bg);
+  CHECKU(Arena, bg->arena);
+  return TRUE;
+}
+
+
+Res BgCreate(Bg *bgReturn, Arena arena, double interval)
+{
+  void *p;
+  Bg bg;
+  Res res;
+
+  AVER(bgReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(interval > 0.0);
+
+  res = ControlAlloc(&p, arena, sizeof(BgStruct));
+  if (res != ResOK)
+    return res;
+  bg = p;
+
+  bg->arena = arena;
+  bg->sig = BgSig;
+  AVERT(Bg, bg);
+  *bgReturn = bg;
+  return ResOK;
+}
+
+
+void BgDestroy(Bg bg)
+{
+  AVERT(Bg, bg);
+  bg->sig = SigInvalid;
+  ControlFree(bg->arena, bg, sizeof(BgStruct));
+}
+
+
+void BgForkChild(Bg bg)
+{
+  AVERT(Bg, bg);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
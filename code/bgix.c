@@ -0,0 +1,261 @@
+/* bgix.c: POSIX BACKGROUND COLLECTOR THREAD
+ *
+ *  $Id$
+ *  Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ *  .purpose: An implementation of the background collector thread
+ *  interface <code/bg.h> using Posix threads.
+ *
+ *  .design: The thread waits on a condition variable with a timeout of
+ *  one interval, so that BgDestroy can wake it up at once by setting
+ *  the exiting flag and signalling the condition.  The mutex is not
+ *  held while the thread is doing collection work.
+ *
+ *  .signals: The thread blocks all signals, as the parallel workers
+ *  do.  <code/parix.c#.signals>.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_FR) && !defined(MPS_OS_LI) && !defined(MPS_OS_XC)
+#error "bgix.c is specific to MPS_OS_FR, MPS_OS_LI or MPS_OS_XC"
+#endif
+
+#include "bg.h"
+
+#if defined(LOCK)
+
+#include <errno.h>
+#include <pthread.h> /* see .feature.li in config.h */
+#include <signal.h>
+#include <sys/time.h> /* gettimeofday; see .feature.li in config.h */
+#include <time.h>
+
+SRCID(bgix, "$Id$");
+
+
+typedef struct BgStruct {
+  Sig sig;                      /* <design/sig> */
+  Arena arena;                  /* owning arena */
+  double interval;              /* seconds between wakes */
+  pthread_t id;                 /* the thread, if alive */
+  Bool alive;                   /* thread running in this process? */
+  pthread_mutex_t mut;          /* protects the field below */
+  pthread_cond_t wake;          /* signalled when the thread must exit */
+  Bool exiting;                 /* thread must exit? */
+} BgStruct;
+
+
+Bool BgCheck(Bg bg)
+{
+  CHECKS(Bg, bg);
+  CHECKU(Arena, bg->arena);
+  CHECKL(bg->interval > 0.0);
+  CHECKL(BoolCheck(bg->alive));
+  CHECKL(BoolCheck(bg->exiting));
+  return TRUE;
+}
+
+
+/* bgDeadline -- compute the absolute time one interval from now */
+
+static void bgDeadline(struct timespec *deadlineReturn, double interval)
+{
+  struct timeval now;
+  double seconds;
+  long nsec;
+  int res;
+
+  res = gettimeofday(&now, NULL);
+  AVER(res == 0);
+  seconds = (double)now.tv_sec + interval;
+  nsec = (long)now.tv_usec * 1000
+    + (long)((interval - (double)(long)interval) * 1e9);
+  deadlineReturn->tv_sec = (time_t)seconds + nsec / 1000000000;
+  deadlineReturn->tv_nsec = nsec % 1000000000;
+}
+
+
+/* bgThread -- main loop of the background thread */
+
+static void *bgThread(void *arg)
+{
+  Bg bg = arg;
+  int res;
+
+  res = pthread_mutex_lock(&bg->mut);
+  AVER(res == 0);
+  while (!bg->exiting) {
+    struct timespec deadline;
+    bgDeadline(&deadline, bg->interval);
+    do {
+      res = pthread_cond_timedwait(&bg->wake, &bg->mut, &deadline);
+      AVER(res == 0 || res == ETIMEDOUT);
+    } while (res == 0 && !bg->exiting);
+    if (bg->exiting)
+      break;
+    res = pthread_mutex_unlock(&bg->mut);
+    AVER(res == 0);
+
+    ArenaBackgroundStep(bg->arena);
+
+    res = pthread_mutex_lock(&bg->mut);
+    AVER(res == 0);
+  }
+  res = pthread_mutex_unlock(&bg->mut);
+  AVER(res == 0);
+  return NULL;
+}
+
+
+Res BgCreate(Bg *bgReturn, Arena arena, double interval)
+{
+  void *p;
+  Bg bg;
+  sigset_t all, old;
+  Res res;
+  int pres;
+
+  AVER(bgReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(interval > 0.0);
+
+  res = ControlAlloc(&p, arena, sizeof(BgStruct));
+  if (res != ResOK)
+    goto failBgAlloc;
+  bg = p;
+
+  bg->arena = arena;
+  bg->interval = interval;
+  bg->alive = FALSE;
+  bg->exiting = FALSE;
+  pres = pthread_mutex_init(&bg->mut, NULL);
+  AVER(pres == 0);
+  pres = pthread_cond_init(&bg->wake, NULL);
+  AVER(pres == 0);
+  bg->sig = BgSig;
+  AVERT(Bg, bg);
+
+  /* The new thread inherits the signal mask. See .signals. */
+  pres = sigfillset(&all);
+  AVER(pres == 0);
+  pres = pthread_sigmask(SIG_SETMASK, &all, &old);
+  AVER(pres == 0);
+  pres = pthread_create(&bg->id, NULL, bgThread, bg);
+  (void)pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (pres != 0) {
+    res = ResRESOURCE;
+    goto failThread;
+  }
+  bg->alive = TRUE;
+
+  *bgReturn = bg;
+  return ResOK;
+
+failThread:
+  bg->sig = SigInvalid;
+  pres = pthread_cond_destroy(&bg->wake);
+  AVER(pres == 0);
+  pres = pthread_mutex_destroy(&bg->mut);
+  AVER(pres == 0);
+  ControlFree(arena, bg, sizeof(BgStruct));
+failBgAlloc:
+  return res;
+}
+
+
+void BgDestroy(Bg bg)
+{
+  int res;
+
+  AVERT(Bg, bg);
+
+  if (bg->alive) {
+    res = pthread_mutex_lock(&bg->mut);
+    AVER(res == 0);
+    bg->exiting = TRUE;
+    res = pthread_cond_signal(&bg->wake);
+    AVER(res == 0);
+    res = pthread_mutex_unlock(&bg->mut);
+    AVER(res == 0);
+    res = pthread_join(bg->id, NULL);
+    AVER(res == 0);
+    bg->alive = FALSE;
+  }
+
+  bg->sig = SigInvalid;
+  res = pthread_cond_destroy(&bg->wake);
+  AVER(res == 0);
+  res = pthread_mutex_destroy(&bg->mut);
+  AVER(res == 0);
+  ControlFree(bg->arena, bg, sizeof(BgStruct));
+}
+
+
+/* BgForkChild -- forget the thread in the child of a fork()
+ *
+ * The thread may have held the mutex at the time of the fork, so
+ * reinitialize it, as LockInit does for the arena lock.  See
+ * <design/thread-safety#.sol.fork.lock>.
+ */
+
+void BgForkChild(Bg bg)
+{
+  int res;
+
+  AVERT(Bg, bg);
+  res = pthread_mutex_init(&bg->mut, NULL);
+  AVER(res == 0);
+  res = pthread_cond_init(&bg->wake, NULL);
+  AVER(res == 0);
+  bg->alive = FALSE;
+}
+
+
+#elif defined(LOCK_NONE)
+#include "bgan.c"
+#else
+#error "No lock configuration."
+#endif
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
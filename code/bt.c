@@ -384,6 +384,48 @@ void BTResRange(BT t, Index base, Index limit)
 }
 
 
+/* btWordCount -- count the set bits in a word
+ *
+ * .count.swar: Adds adjacent fields of the word in parallel, doubling
+ * their width at each step, so that each byte holds the count of its
+ * bits, and then sums the bytes with one multiplication. The constants
+ * are the bit patterns 0x55..., 0x33..., 0x0F... and 0x01... for any
+ * word width that is a multiple of eight.
+ */
+
+static Count btWordCount(Word word)
+{
+  word -= (word >> 1) & (~(Word)0 / 3);
+  word = (word & (~(Word)0 / 5)) + ((word >> 2) & (~(Word)0 / 5));
+  word = (word + (word >> 4)) & (~(Word)0 / 17);
+  return (Count)((word * (~(Word)0 / 255)) >> (MPS_WORD_WIDTH - 8));
+}
+
+
+/* btWordLowBit, btWordHighBit -- index of lowest and highest set bit
+ *
+ * The word must not be zero. btWordLowBit counts the bits below the
+ * lowest set bit, which are the set bits of word & -word minus one.
+ * btWordHighBit first copies the highest set bit into all the bits
+ * below it, then counts them.
+ */
+
+static Index btWordLowBit(Word word)
+{
+  AVER_CRITICAL(word != 0);
+  return btWordCount((word & (~word + 1)) - 1);
+}
+
+static Index btWordHighBit(Word word)
+{
+  Shift shift;
+  AVER_CRITICAL(word != 0);
+  for (shift = 1; shift < MPS_WORD_WIDTH; shift <<= 1)
+    word |= word >> shift;
+  return btWordCount(word) - 1;
+}
+
+
 /* BTFindSet -- find the lowest set bit in a range in a bit table.
  *
  * Sets foundReturn to false if the range is entirely reset;
@@ -433,30 +475,15 @@ btFindSetLabel:; \
 /* ACTION_FIND_SET_BIT -- Find first set bit in a range
  *
  * Helper macro to find the low bit in a range of a word.
- * Works by first shifting the base of the range to the low
- * bits of the word. Then loops performing a binary chop
- * over the data looking to see if a bit is set in the lower
- * half. If not, it must be in the upper half which is then
- * shifted down. The loop completes after using a chop unit
- * of a single single bit.
+ * Masks out the bits outside the range, and then finds the
+ * lowest remaining bit with btWordLowBit, without looping.
  */
 
 #define ACTION_FIND_SET_BIT(wi,word,base,limit,label) \
   BEGIN \
-    /* no need to mask the low bits which are shifted */ \
-    Index actionIndex = (base); \
-    Word actionWord = ((word) & BTMaskHigh((limit))) >> actionIndex; \
-    Count actionMaskWidth = (MPS_WORD_WIDTH >> 1); \
-    Word actionMask = ~(Word)0 >> (MPS_WORD_WIDTH-actionMaskWidth); \
+    Word actionWord = (word) & BTMask((base), (limit)); \
     if (actionWord != (Word)0) { \
-      while (actionMaskWidth != (Count)0) { \
-        if ((actionWord & actionMask) == (Word)0) { \
-          actionIndex += actionMaskWidth; \
-          actionWord >>= actionMaskWidth; \
-        } \
-        actionMaskWidth >>= 1; \
-        actionMask >>= actionMaskWidth; \
-      } \
+      Index actionIndex = btWordLowBit(actionWord); \
       *bfsIndexReturn = ((wi) << MPS_WORD_SHIFT) | actionIndex; \
       *bfsFoundReturn = TRUE; \
       goto label; \
@@ -547,32 +574,21 @@ btFindSetHighLabel:; \
 /* ACTION_FIND_SET_BIT_HIGH -- Find highest set bit in a range
  *
  * Helper macro to find the high bit in a range of a word.
- * Essentially a mirror image of ACTION_FIND_SET
+ * Essentially a mirror image of ACTION_FIND_SET_BIT, using
+ * btWordHighBit.
  */
 
 #define ACTION_FIND_SET_BIT_HIGH(wi,word,base,limit,label) \
   BEGIN \
-    /* no need to mask the high bits which are shifted */ \
-    Index actionShift = MPS_WORD_WIDTH - (limit);  \
-    Index actionIndex = MPS_WORD_WIDTH - 1 - actionShift; \
-    Word actionWord = ((word) & BTMaskLow((base))) << actionShift; \
-    Count actionMaskWidth = (MPS_WORD_WIDTH >> 1); \
-    Word actionMask = ~(Word)0 << (MPS_WORD_WIDTH-actionMaskWidth); \
+    Word actionWord = (word) & BTMask((base), (limit)); \
     if (actionWord != (Word)0) { \
-      while (actionMaskWidth != (Count)0) { \
-        if ((actionWord & actionMask) == (Word)0) { \
-          actionIndex -= actionMaskWidth; \
-          actionWord <<= actionMaskWidth; \
-        } \
-        actionMaskWidth >>= 1; \
-        actionMask <<= actionMaskWidth; \
-      } \
+      Index actionIndex = btWordHighBit(actionWord); \
       *bfsIndexReturn = ((wi) << MPS_WORD_SHIFT) | actionIndex; \
       *bfsFoundReturn = TRUE; \
       goto label; \
     } \
   END
- 
+
 
 /* BTFindResHigh -- find the highest reset bit in a range
  *
@@ -982,12 +998,34 @@ void BTCopyRange(BT fromBT, BT toBT, Index base, Index limit)
 }
 
 
+/* btGetBits -- get a run of bits from a BT
+ *
+ * Return the count bits starting at index in the low bits of a word,
+ * and reset bits above them. count must be between 1 and
+ * MPS_WORD_WIDTH. Reads the following word of the table only if the
+ * run extends into it.
+ */
+
+static Word btGetBits(BT bt, Index index, Count count)
+{
+  Index wi = BTWordIndex(index);
+  Index bi = BTBitIndex(index);
+  Word word = bt[wi] >> bi;
+  if (bi + count > MPS_WORD_WIDTH)
+    word |= bt[wi + 1] << (MPS_WORD_WIDTH - bi);
+  if (count < MPS_WORD_WIDTH)
+    word &= BTMaskHigh(count);
+  return word;
+}
+
+
 /* BTCopyOffsetRange -- copy a range of bits from one BT to an
  * offset range in another BT
  *
- * .slow: Can't always use ACT_ON_RANGE because word alignment
- * may differ for each range. We could try to be smart about
- * detecting similar alignment - but we don't.
+ * .offset: The word alignment of the two ranges may differ, so we
+ * can't use ACT_ON_RANGE. Instead the destination range is split at
+ * its word boundaries, and each part is filled with one store from a
+ * run of bits taken from at most two source words by btGetBits.
  *
  * <design/bt#.if.copy-offset-range>
  */
@@ -1005,30 +1043,48 @@ void BTCopyOffsetRange(BT fromBT, BT toBT,
   AVER(toBase < toLimit);
   AVER((fromLimit - fromBase) == (toLimit - toBase));
 
-  for (fromBit = fromBase, toBit = toBase;
-       fromBit < fromLimit;
-       ++fromBit, ++toBit) {
-    if (BTGet(fromBT, fromBit))
-      BTSet(toBT, toBit);
-    else
-      BTRes(toBT, toBit);
+  if (fromBase == toBase) {
+    BTCopyRange(fromBT, toBT, fromBase, fromLimit);
+    return;
+  }
+
+  for (fromBit = fromBase, toBit = toBase; toBit < toLimit; ) {
+    Index bi = BTBitIndex(toBit);
+    Count count = MPS_WORD_WIDTH - bi;
+    Word *to = &toBT[BTWordIndex(toBit)];
+    Word mask;
+    if (count > toLimit - toBit)
+      count = toLimit - toBit;
+    mask = BTMask(bi, bi + count);
+    *to = (*to & ~mask) | (btGetBits(fromBT, fromBit, count) << bi);
+    fromBit += count;
+    toBit += count;
   }
 }
 
 
-/* BTCountResRange -- count number of reset bits in a range */
+/* BTCountResRange -- count number of reset bits in a range
+ *
+ * Counts a word at a time using btWordCount; see .count.swar.
+ */
 
 Count BTCountResRange(BT bt, Index base, Index limit)
 {
   Count c = 0;
-  Index bit;
 
   AVERT(BT, bt);
   AVER(base < limit);
 
-  for (bit = base; bit < limit; ++bit)
-    if (!BTGet(bt, bit))
-      ++c;
+#define SINGLE_COUNT_RES_RANGE(i) \
+  if (!BTGet(bt, (i))) \
+    ++c
+#define BITS_COUNT_RES_RANGE(i,base,limit) \
+  c += btWordCount(~bt[(i)] & BTMask((base),(limit)))
+#define WORD_COUNT_RES_RANGE(i) \
+  c += MPS_WORD_WIDTH - btWordCount(bt[(i)])
+
+  ACT_ON_RANGE(base, limit, SINGLE_COUNT_RES_RANGE,
+               BITS_COUNT_RES_RANGE, WORD_COUNT_RES_RANGE);
   return c;
 }
 
@@ -0,0 +1,267 @@
+/* btbench.c -- Bit table benchmark on ANSI C library
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * This is a benchmark of the bit table range operations, on a large
+ * table fragmented into runs of set and reset bits of random lengths,
+ * like the allocation table of a large AMS segment. It measures the
+ * time taken by each operation on random ranges of the table, and
+ * checks the results of the find operations. See <design/bt#.bench>.
+ */
+
+#include "mps.c"
+#include "testlib.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fflush, fprintf, printf, stderr, stdout */
+#include <stdlib.h> /* EXIT_FAILURE, EXIT_SUCCESS, free, malloc, strtoul */
+#include <time.h> /* CLOCKS_PER_SEC, clock */
+
+static rnd_state_t seed = 0;      /* random number seed */
+static Count nbits = 1ul << 20;   /* bits in each table */
+static unsigned long nops = 100000; /* operations per measurement */
+static unsigned maxRun = 64;      /* maximum length of a run of bits */
+
+
+/* Operations to measure */
+
+enum {
+  OpSHORT,      /* BTFindShortResRange */
+  OpSHORTHIGH,  /* BTFindShortResRangeHigh */
+  OpLONG,       /* BTFindLongResRange */
+  OpLONGHIGH,   /* BTFindLongResRangeHigh */
+  OpISRES,      /* BTIsResRange */
+  OpCOUNT,      /* BTCountResRange */
+  OpCOPY,       /* BTCopyRange */
+  OpCOPYOFFSET, /* BTCopyOffsetRange */
+  OpLIMIT
+};
+
+static const char *opNames[OpLIMIT] = {
+  "short", "shorthigh", "long", "longhigh",
+  "isres", "count", "copy", "copyoffset"
+};
+
+
+/* op -- perform one operation of kind k on bt, using scratch */
+
+static void op(BT bt, BT scratch, unsigned k)
+{
+  Index base = rnd() % (nbits / 2), limit = base + nbits / 2;
+  Count length = 1 + rnd() % maxRun;
+  Index foundBase, foundLimit;
+  Bool found = FALSE;
+
+  switch (k) {
+  case OpSHORT:
+    found = BTFindShortResRange(&foundBase, &foundLimit, bt,
+                                base, limit, length);
+    break;
+  case OpSHORTHIGH:
+    found = BTFindShortResRangeHigh(&foundBase, &foundLimit, bt,
+                                    base, limit, length);
+    break;
+  case OpLONG:
+    found = BTFindLongResRange(&foundBase, &foundLimit, bt,
+                               base, limit, length);
+    break;
+  case OpLONGHIGH:
+    found = BTFindLongResRangeHigh(&foundBase, &foundLimit, bt,
+                                   base, limit, length);
+    break;
+  case OpISRES:
+    if (BTIsResRange(bt, base, base + length))
+      NOOP;
+    break;
+  case OpCOUNT:
+    if (BTCountResRange(bt, base, limit) > limit - base) {
+      fprintf(stderr, "count out of range\n");
+      exit(EXIT_FAILURE);
+    }
+    break;
+  case OpCOPY:
+    BTCopyRange(bt, scratch, base, limit);
+    break;
+  case OpCOPYOFFSET:
+    BTCopyOffsetRange(bt, scratch, base, limit,
+                      base / 2, base / 2 + (limit - base));
+    break;
+  default:
+    NOTREACHED;
+  }
+
+  if (found && (foundLimit - foundBase < length
+                || !BTIsResRange(bt, foundBase, foundLimit))) {
+    fprintf(stderr, "%s found a bad range\n", opNames[k]);
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"nbits",            required_argument, NULL, 'b'},
+  {"nops",             required_argument, NULL, 'o'},
+  {"max-run",          required_argument, NULL, 'r'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  BT bt, scratch;
+  Index i;
+  unsigned k;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hb:o:r:x:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'b':
+      nbits = (Count)strtoul(optarg, NULL, 10);
+      if (nbits < 2) {
+        fprintf(stderr, "Bad number of bits %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'o':
+      nops = strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      maxRun = (unsigned)strtoul(optarg, NULL, 10);
+      if (maxRun == 0) {
+        fprintf(stderr, "Bad maximum run %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...]\n"
+              "Options:\n"
+              "  -b n, --nbits=n\n"
+              "    Bits in the table (default %lu)\n"
+              "  -o n, --nops=n\n"
+              "    Operations of each kind per measurement (default %lu)\n"
+              "  -r n, --max-run=n\n"
+              "    Maximum length of runs of set and reset bits,\n"
+              "    and of ranges to find (default %u)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              argv[0],
+              (unsigned long)nbits,
+              nops,
+              maxRun);
+      return EXIT_FAILURE;
+    }
+
+  if (maxRun > nbits / 2) {
+    fprintf(stderr, "Maximum run %u too long for %lu bits\n",
+            maxRun, (unsigned long)nbits);
+    return EXIT_FAILURE;
+  }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  (void)mps_lib_assert_fail_install(assert_die);
+  bt = malloc(BTSize(nbits));
+  scratch = malloc(BTSize(nbits));
+  if (bt == NULL || scratch == NULL) {
+    fprintf(stderr, "Couldn't allocate bit tables\n");
+    return EXIT_FAILURE;
+  }
+
+  rnd_state_set(seed);
+  for (i = 0; i < nbits; ) {
+    Index limit = i + 1 + rnd() % maxRun;
+    if (limit > nbits)
+      limit = nbits;
+    BTSetRange(bt, i, limit);
+    i = limit;
+    limit = i + 1 + rnd() % maxRun;
+    if (limit > nbits)
+      limit = nbits;
+    if (i < limit)
+      BTResRange(bt, i, limit);
+    i = limit;
+  }
+  BTResRange(scratch, 0, nbits);
+
+  for (k = 0; k < OpLIMIT; ++k) {
+    clock_t start, finish;
+    unsigned long m;
+    start = clock();
+    for (m = 0; m < nops; ++m)
+      op(bt, scratch, k);
+    finish = clock();
+    printf("%8lu bits %-10s %g ns/op\n", (unsigned long)nbits, opNames[k],
+           (double)(finish - start) / CLOCKS_PER_SEC * 1e9
+           / (double)nops);
+  }
+
+  free(scratch);
+  free(bt);
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -1,12 +1,13 @@
 /* btss.c: BIT TABLE COVERAGE TEST
  *
  * $Id$
- * Copyright (c) 2001-2014 Ravenbrook Limited.  See end of file for license.
+ * Copyright (c) 2001-2018 Ravenbrook Limited.  See end of file for license.
  *
  * .readership: MPS developers
  *
  * .coverage: Direct coverage of BTFind*ResRange*, BTRangesSame,
- * BTISResRange, BTIsSetRange, BTCopyRange, BTCopyOffsetRange.
+ * BTISResRange, BTIsSetRange, BTCopyRange, BTCopyOffsetRange,
+ * BTCountResRange.
  * Reasonable coverage of BTCopyInvertRange, BTResRange,
  * BTSetRange, BTRes, BTSet, BTCreate, BTDestroy.
  */
@@ -443,11 +444,25 @@ static void btIsRangeTests(BT bt1, BT bt2, Count btSize,
 }
 
 
-/* btCopyTests -- Test BTCopyRange & BTCopyOffsetRange
+/* btCountRes -- count the reset bits in a range, one bit at a time */
+
+static Count btCountRes(BT bt, Index base, Index limit)
+{
+  Count count = 0;
+  Index i;
+
+  for (i = base; i < limit; ++i)
+    if (!BTGet(bt, i))
+      ++count;
+  return count;
+}
+
+
+/* btCopyTests -- Test BTCopyRange, BTCopyOffsetRange & BTCountResRange
  *
  * Test copying ranges which are all reset or set apart from
  * single bits near to the base and limit (both inside and outside
- * the range).
+ * the range), and counting the reset bits in the copies.
  *
  */
 
@@ -473,21 +488,28 @@ static void btCopyTests(BT bt1, BT bt2, Count btSize,
       /* initialize a table which is all reset apart from a set bit */
       /* near each of the base and limit of the range in question */
       Bool outside; /* true if set bits are both outside test range */
+      Count count;  /* number of reset bits in test range */
 
       outside = (b < base) && (l > limit);
       BTResRange(bt1, 0, btSize);
       BTSet(bt1, b);
       BTSet(bt1, l - 1);
+      count = btCountRes(bt1, base, limit);
+      cdie(BTCountResRange(bt1, base, limit) == count, "BTCountResRange");
 
       /* check copying the region to the bottom of the other table */
       BTCopyOffsetRange(bt1, bt2, base, limit, 0, limit - base);
       cdie(BTIsResRange(bt2, 0, limit - base) == outside, "BTIsResRange");
+      cdie(BTCountResRange(bt2, 0, limit - base) == count,
+           "BTCountResRange");
 
       /* check copying the region to the top of the other table */
       BTCopyOffsetRange(bt1, bt2,
                         base, limit, btSize + base - limit, btSize);
       cdie(BTIsResRange(bt2, btSize + base - limit, btSize) == outside,
            "BTIsResRange");
+      cdie(BTCountResRange(bt2, btSize + base - limit, btSize) == count,
+           "BTCountResRange");
 
       /* check copying the region to the same place in the other table */
       BTCopyOffsetRange(bt1, bt2, base, limit, base, limit);
@@ -571,7 +593,7 @@ int main(int argc, char *argv[])
 
 /* C. COPYRIGHT AND LICENSE
  *
- * Copyright (c) 2001-2014 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * Copyright (c) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
  * All rights reserved.  This is an open source license.  Contact
  * Ravenbrook for commercial licensing options.
  * 
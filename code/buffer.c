@@ -28,6 +28,10 @@
 SRCID(buffer, "$Id$");
 
 
+ARG_DEFINE_KEY(AP_NODE, Cant);
+ARG_DEFINE_KEY(AP_FILL_SCALE_MAX, Count);
+
+
 /* BufferCheck -- check consistency of a buffer
  *
  * See .ap.async.  */
@@ -47,6 +51,10 @@ Bool BufferCheck(Buffer buffer)
   CHECKL(buffer->emptySize <= buffer->fillSize);
   CHECKL(buffer->alignment == buffer->pool->alignment);
   CHECKL(AlignCheck(buffer->alignment));
+  CHECKL(buffer->fillScaleMax >= 1);
+  CHECKL(1 <= buffer->fillScale);
+  CHECKL(buffer->fillScale <= buffer->fillScaleMax);
+  CHECKL(buffer->contendedCount <= buffer->lockCount);
 
   /* If any of the buffer's fields indicate that it is reset, make */
   /* sure it is really reset.  Otherwise, check various properties */
@@ -154,6 +162,11 @@ static Res BufferAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                 "poolLimit $A\n",   (WriteFA)buffer->poolLimit,
                 "alignment $W\n",   (WriteFW)buffer->alignment,
                 "rampCount $U\n",   (WriteFU)buffer->rampCount,
+                "node $W\n",        (WriteFW)buffer->node,
+                "fillScale $U\n",   (WriteFU)buffer->fillScale,
+                "fillScaleMax $U\n", (WriteFU)buffer->fillScaleMax,
+                "lockCount $U\n",   (WriteFU)buffer->lockCount,
+                "contendedCount $U\n", (WriteFU)buffer->contendedCount,
                 NULL);
 }
 
@@ -168,12 +181,21 @@ Res BufferDescribe(Buffer buffer, mps_lib_FILE *stream, Count depth)
 static Res BufferAbsInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
 {
   Arena arena;
+  Index node = NodeNONE;
+  Count fillScaleMax = BUFFER_FILL_SCALE_MAX_DEFAULT;
+  ArgStruct arg;
 
   AVER(buffer != NULL);
   AVERT(Pool, pool);
   AVER(BoolCheck(isMutator));
   AVERT(ArgList, args);
 
+  if (ArgPick(&arg, args, MPS_KEY_AP_NODE))
+    node = arg.val.u;
+  if (ArgPick(&arg, args, MPS_KEY_AP_FILL_SCALE_MAX))
+    fillScaleMax = arg.val.count;
+  AVER(fillScaleMax >= 1);
+
   /* Superclass init */
   InstInit(CouldBeA(Inst, buffer));
   
@@ -203,6 +225,12 @@ static Res BufferAbsInit(Buffer buffer, Pool pool, Bool isMutator, ArgList args)
   buffer->ap_s.limit = (mps_addr_t)0;
   buffer->poolLimit = (Addr)0;
   buffer->rampCount = 0;
+  buffer->node = node;
+  buffer->fillScale = 1;
+  buffer->fillScaleMax = fillScaleMax;
+  buffer->quietLocks = 0;
+  buffer->lockCount = 0;
+  buffer->contendedCount = 0;
 
   /* .init.sig-serial: Now the vanilla stuff is initialized, sign the
      buffer and give it a serial number. It can then be safely checked
@@ -349,6 +377,9 @@ static void BufferAbsFinish(Inst inst)
   /* Finish off the generic buffer fields. */
   RingFinish(&buffer->poolRing);
 
+  if (buffer->lockCount > 0)
+    EVENT4(BufferLocks, buffer, buffer->lockCount, buffer->contendedCount,
+           buffer->fillScale);
   EVENT1(BufferFinish, buffer);
 }
 
@@ -627,6 +658,46 @@ Res BufferFill(Addr *pReturn, Buffer buffer, Size size)
 
 
 
+/* BufferNoteLock -- note that the arena lock was claimed for a buffer
+ *
+ * Called by the out-of-line allocation point operations after
+ * claiming the arena lock, with contended TRUE if another thread held
+ * the lock at the time. Adapts the buffer's fill scale to the
+ * contention. <design/buffer#.fill.scale.adapt>
+ */
+
+void BufferNoteLock(Buffer buffer, Bool contended)
+{
+  Count scale;
+
+  AVERT(Buffer, buffer);
+  AVERT(Bool, contended);
+
+  ++buffer->lockCount;
+  scale = buffer->fillScale;
+  if (contended) {
+    ++buffer->contendedCount;
+    buffer->quietLocks = 0;
+    if (scale <= buffer->fillScaleMax / 2)
+      scale *= 2;
+    else
+      scale = buffer->fillScaleMax;
+  } else if (scale > 1) {
+    ++buffer->quietLocks;
+    if (buffer->quietLocks >= BufferFillQUIET) {
+      buffer->quietLocks = 0;
+      scale /= 2;
+    }
+  }
+
+  if (scale != buffer->fillScale) {
+    buffer->fillScale = scale;
+    EVENT4(BufferLocks, buffer, buffer->lockCount, buffer->contendedCount,
+           scale);
+  }
+}
+
+
 /* BufferCommit -- commit memory previously reserved
  *
  * .commit: Keep in sync with <code/mps.h#commit>.  */
@@ -200,6 +200,20 @@
 #endif
 
 
+/* CONFIG_LAND_AVL -- keep free memory in balanced trees
+ *
+ * This symbol causes the arena's free land and the MVFF pool's lands
+ * to be AVL trees <code/avl.c> instead of coalescing block structures
+ * <code/cbs.c>. See "Land Configuration" below.
+ */
+
+#if defined(CONFIG_LAND_AVL)
+#define LAND_AVL
+#else
+#define LAND_CBS
+#endif
+
+
 #define MPS_VARIETY_STRING \
   MPS_ASSERT_STRING "." MPS_LOG_STRING "." MPS_STATS_STRING
 
@@ -335,6 +349,12 @@
 
 #define BUFFER_RANK_DEFAULT (mps_rank_exact())
 
+/* Maximum multiple of the pool's usual fill size that a buffer may
+ * request, and the number of uncontended claims of the arena lock
+ * before the multiple is halved. <design/buffer#.fill.scale> */
+#define BUFFER_FILL_SCALE_MAX_DEFAULT ((Count)16)
+#define BufferFillQUIET ((Count)8)
+
 
 /* Format defaults: see <code/format.c> */
 
@@ -348,6 +368,42 @@
 #define FMT_CLASS_DEFAULT (&FormatDefaultClass)
 
 
+/* Land Configuration -- see <code/cbs.c> and <code/avl.c>
+ *
+ * The classes, block pool keyword and block sizes of the lands that
+ * keep free memory in the arena (FreeLandZoned) and in MVFF pools
+ * (FreeLandFast). FreeLandSig and FreeLandCheck let the lands be
+ * checked with CHECKD(FreeLand, ...). See CONFIG_LAND_AVL above.
+ */
+
+#if defined(LAND_AVL)
+#define FreeLandZonedCLASS CLASS(AVL)
+#define FreeLandFastCLASS CLASS(AVL)
+#define FreeLandBlockPool AVLBlockPool
+#define FreeLandBlockPool_FIELD AVLBlockPool_FIELD
+#define FreeLandZonedBlockSIZE sizeof(AVLBlockStruct)
+#define FreeLandFastBlockSIZE sizeof(AVLBlockStruct)
+#define FreeLandSig AVLSig
+#define FreeLandCheck AVLCheck
+#else
+#define FreeLandZonedCLASS CLASS(CBSZoned)
+#define FreeLandFastCLASS CLASS(CBSFast)
+#define FreeLandBlockPool CBSBlockPool
+#define FreeLandBlockPool_FIELD CBSBlockPool_FIELD
+#define FreeLandZonedBlockSIZE sizeof(CBSZonedBlockStruct)
+#define FreeLandFastBlockSIZE sizeof(CBSFastBlockStruct)
+#define FreeLandSig CBSSig
+#define FreeLandCheck CBSCheck
+#endif
+
+
+/* Pool Configuration -- see <code/pool.c> */
+
+/* Maximum allocation under a pool lock that has not yet been counted
+ * by the arena's allocation clock. <design/pool#.lock.clock> */
+#define PoolFastFillLIMIT ((Size)65536)
+
+
 /* Pool AMC Configuration -- see <code/poolamc.c> */
 
 #define AMC_INTERIOR_DEFAULT TRUE
@@ -360,6 +416,7 @@
 
 #define AMS_SUPPORT_AMBIGUOUS_DEFAULT TRUE
 #define AMS_GEN_DEFAULT       0
+#define AMS_LAZY_SWEEP_DEFAULT FALSE
 
 
 /* Pool AWL Configuration -- see <code/poolawl.c> */
@@ -374,6 +431,7 @@
 /* Pool LO Configuration -- see <code/poollo.c> */
 
 #define LO_GEN_DEFAULT       0
+#define LO_LAZY_SWEEP_DEFAULT FALSE
 
 
 /* Pool MFS Configuration -- see <code/poolmfs.c> */
@@ -390,6 +448,13 @@
 #define MVFF_ARENA_HIGH_DEFAULT  FALSE
 #define MVFF_FIRST_FIT_DEFAULT   TRUE
 #define MVFF_SPARE_DEFAULT       0.75
+#define MVFF_SIZE_CLASSES_DEFAULT FALSE
+
+/* MVFF_SIZE_CLASS_COUNT is the number of size classes kept by an MVFF
+ * pool with size classes: one for each multiple of the pool's
+ * alignment up to this many. <design/poolmvff#.design.size-class> */
+
+#define MVFF_SIZE_CLASS_COUNT    32
 
 
 /* Pool MVT Configuration -- see <code/poolmv2.c> */
@@ -407,6 +472,43 @@
 
 #define ArenaPollALLOCTIME (65536.0)
 
+/* Time, in seconds, between wakes of the background collector thread.
+ * <design/strategy#.policy.background>. */
+#define ArenaBackgroundINTERVAL (0.01)
+
+/* ChunkCacheSHIFT and ChunkCacheLENGTH configure the direct-mapped
+ * cache of chunks consulted by ChunkOfAddr on the critical path. An
+ * address selects the cache entry by the bits above ChunkCacheSHIFT,
+ * modulo ChunkCacheLENGTH, which must be a power of two. With these
+ * values, chunks spread over a 256 MiB range of address space (at
+ * 1 MiB granularity) each get their own entry. See
+ * <design/arena#.chunk.cache>.
+ */
+
+#define ChunkCacheSHIFT    20
+#define ChunkCacheLENGTH   256
+
+/* FreeCacheGRAINS and FreeCacheENTRIES configure the cache of small
+ * free runs of grains that the arena keeps in front of its free land.
+ * Runs of up to FreeCacheGRAINS grains are cached, in lists by length
+ * and zone, and at most FreeCacheENTRIES runs are cached at once. See
+ * <design/arena#.free.cache>.
+ */
+
+#define FreeCacheGRAINS    8
+#define FreeCacheENTRIES   256
+
+/* PauseHistSUBSHIFT and PauseHistBUCKETS configure the arena's
+ * histograms of pause durations.  Each power of two of clock ticks is
+ * split into 1 << PauseHistSUBSHIFT buckets, so that a duration read
+ * from the histogram is within 25% of the truth, and there are
+ * PauseHistBUCKETS buckets in all, the last catching any longer
+ * pauses.  See <design/arena#.pause.hist>.
+ */
+
+#define PauseHistSUBSHIFT  2
+#define PauseHistBUCKETS   128
+
 /* .client.seg-size: ARENA_CLIENT_GRAIN_SIZE is the minimum size, in
  * bytes, of a grain in the client arena. It's set at 8192 with no
  * particular justification. */
@@ -426,6 +528,27 @@
 
 #define ARENA_DEFAULT_ZONED     TRUE
 
+/* ARENA_DEFAULT_GC_THREADS is the number of threads (including the
+ * thread that is doing the collection work) that scan grey segments
+ * in parallel.  The default of one means that all scanning is done
+ * serially, as it always used to be.  See <code/trace.c#par>. */
+
+#define ARENA_DEFAULT_GC_THREADS ((Count)1)
+
+/* ARENA_DEFAULT_ADAPTIVE_PACING says whether the arena paces
+ * collections using measured allocation and collection rates, rather
+ * than doing as much work as the pause time allows at every poll.
+ * See <design/strategy#.policy.pacing>. */
+
+#define ARENA_DEFAULT_ADAPTIVE_PACING FALSE
+
+/* ARENA_DEFAULT_BACKGROUND says whether the arena has a thread of its
+ * own that does collection work when the mutator is idle or the
+ * collection is behind schedule.  See
+ * <design/strategy#.policy.background>. */
+
+#define ARENA_DEFAULT_BACKGROUND FALSE
+
 /* ARENA_MINIMUM_COLLECTABLE_SIZE is the minimum size (in bytes) of
  * collectable memory that might be considered worthwhile to run a
  * full garbage collection. */
@@ -466,10 +589,14 @@
   FALSE,               /* high */ \
   ArenaDefaultZONESET, /* zoneSet */ \
   ZoneSetEMPTY,        /* avoid */ \
+  NodeNONE,            /* node */ \
 }
 
 #define LDHistoryLENGTH ((Size)4)
 
+/* Number of addresses mps_ld_stale_keys checks per arena lock entry. */
+#define LDStaleBATCH ((Count)64)
+
 /* Value of MPS_KEY_EXTEND_BY for the arena control pool. */
 #define CONTROL_EXTEND_BY ((Size)32768)
 
@@ -483,6 +610,31 @@
 #define LocusMortalityALPHA (0.4)
 
 
+/* Policy configuration -- see <code/policy.c> */
+
+/* Weighting for the current observation, in the exponential moving
+ * averages of the allocation and collection rates used by adaptive
+ * pacing.  <design/strategy#.policy.pacing.rate>. */
+#define PolicyRateALPHA (0.25)
+
+/* Shortest time, in seconds, of mutator activity over which adaptive
+ * pacing measures the allocation rate.  Shorter intervals are
+ * accumulated, to limit the effect of the resolution of ClockNow. */
+#define PolicyRateINTERVAL (0.001)
+
+/* Fraction of processor time that adaptive pacing expects to spend
+ * tracing while a collection is in progress, and the largest fraction
+ * of the capacity of generation 0 by which it may bring forward the
+ * start of a collection.  <design/strategy#.policy.pacing.start>. */
+#define PolicyPacingUTILIZATION (0.5)
+#define PolicyPacingLEADMAX (0.25)
+
+/* Time, in seconds, that adaptive pacing aims to spend in each
+ * increment of tracing work, if the pause time allows.
+ * <design/strategy#.policy.pacing.poll>. */
+#define PolicyPacingINCREMENT (0.001)
+
+
 /* Stack probe configuration -- see <code/sp*.c> */
 
 /* Currently StackProbe has a useful implementation only on Windows. */
@@ -514,13 +666,19 @@
  *
  * Source      Symbols                   Header        Feature
  * =========== ========================= ============= ====================
+ * bgix.c      gettimeofday              <sys/time.h>  _XOPEN_SOURCE
+ * bgix.c      pthread_sigmask           <signal.h>    _XOPEN_SOURCE
+ * eventcnv.c  nanosleep                 <time.h>      _XOPEN_SOURCE
  * eventtxt.c  setenv                    <stdlib.h>    _GNU_SOURCE
  * lockix.c    pthread_mutexattr_settype <pthread.h>   _XOPEN_SOURCE >= 500
+ * mpsioix.c   ftruncate                 <unistd.h>    _XOPEN_SOURCE >= 500
+ * mpsioix.c   pthread_sigmask           <signal.h>    _XOPEN_SOURCE
  * prmcix.h    stack_t, siginfo_t        <signal.h>    _XOPEN_SOURCE
  * prmclii3.c  REG_EAX etc.              <ucontext.h>  _GNU_SOURCE
  * prmclii6.c  REG_RAX etc.              <ucontext.h>  _GNU_SOURCE
  * pthrdext.c  sigaction etc.            <signal.h>    _XOPEN_SOURCE
  * vmix.c      MAP_ANON                  <sys/mman.h>  _GNU_SOURCE
+ * vmix.c      syscall                   <unistd.h>    _GNU_SOURCE
  *
  * It is not possible to localize these feature specifications around
  * the individual headers: all headers share a common set of features
@@ -623,10 +781,25 @@
 
 /* Tracer Configuration -- see <code/trace.c> */
 
-#define TraceLIMIT ((size_t)1)
+/* TraceLIMIT is the number of traces that may be running at once.
+ * Traces never condemn the same segment, so a trace of the new part
+ * of a nursery generation can run while an older-generation trace is
+ * still in progress.  See <code/trace.c#whiten.disjoint> and
+ * <code/policy.c#nursery>. */
+#define TraceLIMIT ((size_t)2)
 /* I count 4 function calls to scan, 10 to copy. */
 #define TraceCopyScanRATIO (1.5)
 
+/* TraceParBATCH is the maximum number of grey segments that are
+ * scanned in one parallel batch.  See <code/trace.c#par>. */
+#define TraceParBATCH ((Count)64)
+
+/* TraceParSweepBATCH is the maximum number of white segments that are
+ * swept in one parallel batch.  Sweeping a segment is much cheaper
+ * than scanning one, so the batches are larger.  See
+ * <code/trace.c#par.sweep>. */
+#define TraceParSweepBATCH ((Count)256)
+
 /* Chosen so that the RememberedSummaryBlockStruct packs nicely into
    pages */
 #define RememberedSummaryBLOCK 15
@@ -780,6 +780,9 @@ void PoolClassMixInDebug(PoolClass klass)
   klass->init = DebugPoolInit;
   klass->alloc = DebugPoolAlloc;
   klass->free = DebugPoolFree;
+  /* Fenceposts and tags need the arena lock. */
+  klass->tryAlloc = PoolNoTryAlloc;
+  klass->tryFree = PoolNoTryFree;
 }
 
 
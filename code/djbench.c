@@ -37,6 +37,7 @@
 
 static mps_arena_t arena;
 static mps_pool_t pool;
+static mps_bool_t size_classes;   /* MVFF uses size classes */
 
 
 /* The benchmark behaviour is defined as a macro in order to give realistic
@@ -192,7 +193,11 @@ static void arena_wrap(dj_t dj, mps_pool_class_t pool_class, const char *name)
     MPS_ARGS_ADD(args, MPS_KEY_SPARE, spare);
     DJMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
   } MPS_ARGS_END(args);
-  DJMUST(mps_pool_create_k(&pool, arena, pool_class, mps_args_none));
+  MPS_ARGS_BEGIN(args) {
+    if (size_classes)
+      MPS_ARGS_ADD(args, MPS_KEY_MVFF_SIZE_CLASSES, TRUE);
+    DJMUST(mps_pool_create_k(&pool, arena, pool_class, args));
+  } MPS_ARGS_END(args);
   watch(dj, name);
   mps_pool_destroy(pool);
   mps_arena_destroy(arena);
@@ -232,11 +237,14 @@ static struct {
   void (*wrap)(dj_t, mps_pool_class_t, const char *name);
   dj_t dj;
   mps_pool_class_t (*pool_class)(void);
+  mps_bool_t size_classes;
 } pools[] = {
-  {"mvt",   arena_wrap, dj_reserve, mps_class_mvt},
-  {"mvff",  arena_wrap, dj_reserve, mps_class_mvff},
-  {"mvffa", arena_wrap, dj_alloc,   mps_class_mvff}, /* mvff with alloc */
-  {"an",    wrap,       dj_malloc,  dummy_class},
+  {"mvt",    arena_wrap, dj_reserve, mps_class_mvt,  FALSE},
+  {"mvff",   arena_wrap, dj_reserve, mps_class_mvff, FALSE},
+  {"mvffa",  arena_wrap, dj_alloc,   mps_class_mvff, FALSE}, /* mvff with alloc */
+  {"mvffs",  arena_wrap, dj_reserve, mps_class_mvff, TRUE},  /* mvff with size classes */
+  {"mvffsa", arena_wrap, dj_alloc,   mps_class_mvff, TRUE},  /* both */
+  {"an",     wrap,       dj_malloc,  dummy_class,    FALSE},
 };
 
 
@@ -361,10 +369,12 @@ int main(int argc, char *argv[])
               spare);
       fprintf(stderr,
               "Tests:\n"
-              "  mvt   pool class MVT\n"
-              "  mvff  pool class MVFF (buffer interface)\n"
-              "  mvffa pool class MVFF (alloc interface)\n"
-              "  an    malloc\n");
+              "  mvt    pool class MVT\n"
+              "  mvff   pool class MVFF (buffer interface)\n"
+              "  mvffa  pool class MVFF (alloc interface)\n"
+              "  mvffs  pool class MVFF with size classes (buffer interface)\n"
+              "  mvffsa pool class MVFF with size classes (alloc interface)\n"
+              "  an     malloc\n");
       return EXIT_FAILURE;
     }
   argc -= optind;
@@ -384,6 +394,7 @@ int main(int argc, char *argv[])
   found:
     (void)mps_lib_assert_fail_install(assert_die);
     rnd_state_set(seed);
+    size_classes = pools[i].size_classes;
     pools[i].wrap(pools[i].dj, pools[i].pool_class(), pools[i].name);
     --argc;
     ++argv;
@@ -108,6 +108,10 @@ extern Word EventKindControl;
 #define EVENT13 EVENT_RECORD13
 #define EVENT14 EVENT_RECORD14
 
+/* EVENT_KIND_ON -- are events of this kind written to the stream? */
+#define EVENT_KIND_ON(kind) \
+  BS_IS_MEMBER(EventKindControl, (Index)EventKind##kind)
+
 #else /* !EVENT */
 
 #define EVENT0 EVENT_IGNORE0
@@ -126,6 +130,8 @@ extern Word EventKindControl;
 #define EVENT13 EVENT_IGNORE13
 #define EVENT14 EVENT_IGNORE14
 
+#define EVENT_KIND_ON(kind) FALSE
+
 #endif /* !EVENT */
 
 #if EVENT_ALL
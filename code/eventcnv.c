@@ -31,6 +31,17 @@
  * If the environment variable does not exist, the default filename of
  * "mpsio.log" is used.
  *
+ * With the -F option, eventcnv follows a telemetry file that is still
+ * being written (in the manner of "tail -f"): when it reaches the end
+ * of the events written so far it waits for more to arrive, instead
+ * of stopping.  With -w <seconds> it stops after the file has been
+ * idle for that long, so that a pipeline like
+ *
+ *   eventcnv -F -w 10 | eventsql -b 10000
+ *
+ * loads the events of a running program into a database as they
+ * arrive, and finishes when the program does.
+ *
  * $Id$
  */
 
@@ -46,11 +57,23 @@
 #include <string.h> /* for strcmp */
 #include "mpstd.h"
 
+#if defined(MPS_OS_W3)
+#include "mpswin.h" /* for Sleep */
+#else
+#include <time.h> /* for nanosleep */
+#endif
+
 #define DEFAULT_TELEMETRY_FILENAME "mpsio.log"
 #define TELEMETRY_FILENAME_ENVAR   "MPS_TELEMETRY_FILENAME"
 
+/* FOLLOW_POLL_MS -- milliseconds between looks at a followed file */
+
+#define FOLLOW_POLL_MS 100
+
 static EventClock eventTime; /* current event time */
 static const char *prog; /* program name */
+static Bool follow = FALSE; /* wait for more events at end of file? */
+static unsigned long followLimit = 0; /* idle seconds before stopping */
 
 /* Errors and Warnings */
 
@@ -97,7 +120,7 @@ static void everror(const char *format, ...)
 
 static void usage(void)
 {
-  (void)fprintf(stderr, "Usage: %s [-f logfile] [-h]\n"
+  (void)fprintf(stderr, "Usage: %s [-f logfile] [-F [-w seconds]] [-h]\n"
                 "See \"Telemetry\" in the reference manual for instructions.\n",
                 prog);
 }
@@ -134,6 +157,20 @@ static char *parseArgs(int argc, char *argv[])
         else
           name = argv[i];
         break;
+      case 'F': /* follow */
+        follow = TRUE;
+        break;
+      case 'w': /* idle seconds before we stop following */
+        ++ i;
+        if (i == argc)
+          usageError();
+        else {
+          char *end;
+          followLimit = strtoul(argv[i], &end, 10);
+          if (end == argv[i] || *end != '\0')
+            usageError();
+        }
+        break;
       case '?': case 'h': /* help */
         usage();
         exit(EXIT_SUCCESS);
@@ -180,7 +217,12 @@ static void printParamS(const char *str)
 }
 
 
-/* EventRead -- read one event from the file */
+/* EventRead -- read one event from the file
+ *
+ * When following a file that is still being written, an incomplete
+ * event at the end is treated like the end of the file: the rest of
+ * it has not been written yet.
+ */
 
 static Res eventRead(Bool *eofOut, EventUnion *event, FILE *stream)
 {
@@ -198,6 +240,13 @@ static Res eventRead(Bool *eofOut, EventUnion *event, FILE *stream)
     return ResIO;
   }
 
+  /* A mapped telemetry file is zero beyond the events written so far
+     (see <code/mpsioix.c#.publish>). */
+  if (event->any.size == 0) {
+    *eofOut = TRUE;
+    return ResOK;
+  }
+
   if (event->any.size < sizeof(event->any))
     return ResFAIL; /* invalid size: too small */
 
@@ -209,8 +258,13 @@ static Res eventRead(Bool *eofOut, EventUnion *event, FILE *stream)
   if (rest > 0) {
     n = fread((char *)event + sizeof(event->any), rest, 1, stream);
     if (n < 1) {
-      if (feof(stream))
+      if (feof(stream)) {
+        if (follow) {
+          *eofOut = TRUE;
+          return ResOK;
+        }
         return ResFAIL; /* truncated event */
+      }
       else
         return ResIO;
     }
@@ -220,16 +274,50 @@ static Res eventRead(Bool *eofOut, EventUnion *event, FILE *stream)
   return ResOK;
 }
 
+/* followWait -- wait for a followed file to grow
+ *
+ * Returns FALSE if the file has now been idle for longer than the
+ * limit set by the -w option.
+ */
+
+static Bool followWait(unsigned long *idleIO)
+{
+  if (followLimit > 0 && *idleIO >= followLimit * 1000)
+    return FALSE;
+#if defined(MPS_OS_W3)
+  Sleep(FOLLOW_POLL_MS);
+#else
+  {
+    struct timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = FOLLOW_POLL_MS * 1000000L;
+    (void)nanosleep(&ts, NULL);
+  }
+#endif
+  *idleIO += FOLLOW_POLL_MS;
+  return TRUE;
+}
+
+
 /* readLog -- read and parse log */
 
 static void readLog(FILE *stream)
 {
+  unsigned long idle = 0; /* milliseconds spent waiting for events */
+
   for(;;) { /* loop for each event */
     EventUnion eventUnion;
     Event event = &eventUnion;
     EventCode code;
     Res res;
     Bool eof = FALSE; /* suppress warnings about uninitialized use */
+    long pos = 0;
+
+    if (follow) {
+      pos = ftell(stream);
+      if (pos < 0)
+        everror("Can't follow a log that doesn't support seeking");
+    }
 
     /* Read and parse event. */
     res = eventRead(&eof, event, stream);
@@ -239,8 +327,20 @@ static void readLog(FILE *stream)
       everror("I/O error reading log");
     else if (res != ResOK)
       everror("Unknown error reading log");
-    if (eof)
-      break;
+    if (eof) {
+      /* Pass on the events so far before waiting for more. */
+      (void)fflush(stdout);
+      if (!follow || !followWait(&idle))
+        break;
+      /* Go back to the start of the event and look again.  Seeking
+         discards the stream's buffer, so we see what has been written
+         to the file since. */
+      clearerr(stream);
+      if (fseek(stream, pos, SEEK_SET) != 0)
+        everror("Couldn't seek in log");
+      continue;
+    }
+    idle = 0;
 
     eventTime = event->any.clock;
     code = event->any.code;
@@ -292,7 +392,6 @@ static void readLog(FILE *stream)
     }
 
     putchar('\n');
-    (void)fflush(stdout);
   } /* while(!feof(input)) */
 }
 
@@ -322,9 +421,10 @@ int main(int argc, char *argv[])
       filename = DEFAULT_TELEMETRY_FILENAME;
   }
 
-  if (strcmp(filename, "-") == 0)
+  if (strcmp(filename, "-") == 0) {
     input = stdin;
-  else {
+    follow = FALSE; /* reads from a pipe already wait for the writer */
+  } else {
     input = fopen(filename, "rb");
     if (input == NULL)
       everror("unable to open \"%s\"\n", filename);
@@ -37,7 +37,7 @@
 
 #define EVENT_VERSION_MAJOR  ((unsigned)2)
 #define EVENT_VERSION_MEDIAN ((unsigned)0)
-#define EVENT_VERSION_MINOR  ((unsigned)0)
+#define EVENT_VERSION_MINOR  ((unsigned)4)
 
 
 /* EVENT_LIST -- list of event types and general properties
@@ -61,7 +61,7 @@
  */
 
 #define EventNameMAX ((size_t)19)
-#define EventCodeMAX ((EventCode)0x005c)
+#define EventCodeMAX ((EventCode)0x0061)
 
 #define EVENT_LIST(EVENT, X) \
   /*       0123456789012345678 <- don't exceed without changing EventNameMAX */ \
@@ -89,6 +89,7 @@
   EVENT(X, BufferInit         , 0x0016,  TRUE, Pool) /* see .kind.abuse */ \
   EVENT(X, BufferInitRank     , 0x0017,  TRUE, Pool) \
   EVENT(X, BufferInitSeg      , 0x0018,  TRUE, Pool) \
+  EVENT(X, BufferLocks        , 0x005f,  TRUE, Pool) \
   EVENT(X, BufferReserve      , 0x0019,  TRUE, Object) \
   EVENT(X, ChainCondemnAuto   , 0x001a,  TRUE, Trace) \
   EVENT(X, CommitLimitSet     , 0x001b,  TRUE, Arena) \
@@ -105,6 +106,9 @@
   EVENT(X, MessagesExist      , 0x0026,  TRUE, Arena) \
   EVENT(X, MeterInit          , 0x0027,  TRUE, Pool) \
   EVENT(X, MeterValues        , 0x0028,  TRUE, Pool) \
+  EVENT(X, MutatorResume      , 0x005e,  TRUE, Arena) \
+  EVENT(X, MutatorSuspend     , 0x005d,  TRUE, Arena) \
+  EVENT(X, PauseStats         , 0x0060,  TRUE, Arena) \
   EVENT(X, PauseTimeSet       , 0x0029,  TRUE, Arena) \
   EVENT(X, PoolAlloc          , 0x002a,  TRUE, Object) \
   EVENT(X, PoolFinish         , 0x002b,  TRUE, Pool) \
@@ -147,6 +151,7 @@
   EVENT(X, TraceScanSingleRef , 0x0050,  TRUE, Seg) /* see .kind.abuse */ \
   EVENT(X, TraceStart         , 0x0051,  TRUE, Trace) \
   EVENT(X, TraceStatFix       , 0x0052,  TRUE, Trace) \
+  EVENT(X, TraceStatPar       , 0x0061,  TRUE, Trace) \
   EVENT(X, TraceStatReclaim   , 0x0053,  TRUE, Trace) \
   EVENT(X, TraceStatScan      , 0x0054,  TRUE, Trace) \
   EVENT(X, VMArenaExtendDone  , 0x0055,  TRUE, Arena) \
@@ -297,6 +302,12 @@
   PARAM(X,  1, P, pool, "buffer's pool") \
   PARAM(X,  2, B, isMutator, "belongs to client program?")
 
+#define EVENT_BufferLocks_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, buffer, "the buffer") \
+  PARAM(X,  1, W, lockCount, "arena lock claims for the buffer") \
+  PARAM(X,  2, W, contendedCount, "claims that found the lock held") \
+  PARAM(X,  3, W, fillScale, "multiple of usual fill size")
+
 #define EVENT_BufferReserve_PARAMS(PARAM, X) \
   PARAM(X,  0, P, buffer, "the buffer") \
   PARAM(X,  1, A, init, "buffer's init pointer") \
@@ -376,6 +387,24 @@
   PARAM(X,  4, W, max, "maximum metered amount") \
   PARAM(X,  5, W, min, "minimum metered amount")
 
+#define EVENT_MutatorResume_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena, "the arena") \
+  PARAM(X,  1, D, stopTime, "time the mutator was suspended, in seconds")
+
+#define EVENT_MutatorSuspend_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena, "the arena") \
+  PARAM(X,  1, D, suspendTime, "time taken to suspend the mutator, in seconds")
+
+#define EVENT_PauseStats_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, arena, "the arena") \
+  PARAM(X,  1, U, kind, "kind of pause (MPS_PAUSE_*)") \
+  PARAM(X,  2, W, count, "number of pauses") \
+  PARAM(X,  3, D, total, "total duration, in seconds") \
+  PARAM(X,  4, D, max, "longest pause, in seconds") \
+  PARAM(X,  5, D, p50, "median pause, in seconds") \
+  PARAM(X,  6, D, p99, "99th percentile, in seconds") \
+  PARAM(X,  7, D, p999, "99.9th percentile, in seconds")
+
 #define EVENT_PauseTimeSet_PARAMS(PARAM, X) \
   PARAM(X,  0, P, arena, "the arena") \
   PARAM(X,  1, D, pauseTime, "the new maximum pause time, in seconds")
@@ -617,6 +646,13 @@
   PARAM(X,  9, W, preservedInPlaceCount, "objects preserved in place") \
   PARAM(X, 10, W, preservedInPlaceSize, "bytes preserved in place")
 
+#define EVENT_TraceStatPar_PARAMS(PARAM, X) \
+  PARAM(X,  0, P, trace, "the trace") \
+  PARAM(X,  1, P, arena, "trace's arena") \
+  PARAM(X,  2, W, parScanCount, "segments scanned in parallel batches") \
+  PARAM(X,  3, W, lockedFixCount, "fixes made under the fix lock") \
+  PARAM(X,  4, W, contendedFixCount, "fixes that found the fix lock held")
+
 #define EVENT_TraceStatReclaim_PARAMS(PARAM, X) \
   PARAM(X,  0, P, trace, "the trace") \
   PARAM(X,  1, P, arena, "trace's arena") \
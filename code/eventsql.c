@@ -62,6 +62,20 @@
  * specified, eventsql will use the MPS_TELEMETRY_DATABASE environment
  * variable, and default to "mpsevent.db".
  *
+ * -b <count>: Commit the imported events in batches of this many
+ * events, instead of in a single transaction at the end, so that
+ * other programs can query the events of a log that is still growing
+ * (see the -F option to eventcnv).  The completed column of the log's
+ * event_log row is updated with each batch.
+ *
+ * -s <seconds>: Also commit a batch when an event arrives more than
+ * this many seconds after the batch began, so that a slow trickle of
+ * events still reaches the database promptly.
+ *
+ * When committing in batches, the database is switched to
+ * write-ahead logging, so that readers do not block the import (and
+ * vice versa).
+ *
  * $Id$
  */
 
@@ -73,6 +87,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <sys/stat.h>
 
 /* on Windows, we build SQLite locally from the amalgamated sources */
@@ -162,11 +177,14 @@ static int force = FALSE;
 static int progress = FALSE;
 static const char *databaseName = NULL;
 static const char *logFileName = NULL;
+static int64 batchSize = 0; /* events per transaction; 0 for all */
+static long batchSeconds = 0; /* maximum age of a batch; 0 for any */
 
 static void usage(void)
 {
   fprintf(stderr,
           "Usage: %s [-rfdvt] [-i <logfile>] [-o <database>]\n"
+          "       [-b <count>] [-s <seconds>]\n"
           "    -h (help)    : this message.\n"
           "    -r (rebuild) : re-create glue tables.\n"
           "    -f (force)   : ignore previous import of same logfile.\n"
@@ -177,7 +195,9 @@ static void usage(void)
           "    -i <logfile> : read logfile (defaults to stdin)\n"
           "    -o <database>: write database (defaults to\n"
           "                   "
-          DATABASE_NAME_ENVAR " or " DEFAULT_DATABASE_NAME ").\n",
+          DATABASE_NAME_ENVAR " or " DEFAULT_DATABASE_NAME ").\n"
+          "    -b <count>   : commit every <count> events.\n"
+          "    -s <seconds> : commit batches at least this often.\n",
           prog);
 }
 
@@ -187,6 +207,21 @@ static void usageError(void)
   error("Bad usage");
 }
 
+/* parseCount -- parse a non-negative decimal option argument */
+
+static long parseCount(const char *arg)
+{
+  char *end;
+  long val;
+
+  if (arg == NULL)
+    usageError();
+  val = strtol(arg, &end, 10);
+  if (end == arg || *end != '\0' || val < 0)
+    usageError();
+  return val;
+}
+
 /* parseArgs -- parse command line arguments */
 
 static void parseArgs(int argc, char *argv[])
@@ -237,6 +272,22 @@ static void parseArgs(int argc, char *argv[])
             databaseName = p+1;
           }
           goto next_i;
+        case 'b': /* batch size */
+        case 's': /* batch seconds */
+          {
+            const char *arg;
+            if (p[1] == '\0') { /* count is next arg */
+              arg = argv[i+1];
+              ++ i;
+            } else { /* count is rest of arg */
+              arg = p+1;
+            }
+            if (*p == 'b')
+              batchSize = parseCount(arg);
+            else
+              batchSeconds = parseCount(arg);
+          }
+          goto next_i;
         case 'h':
           usage();
           exit(EXIT_SUCCESS);
@@ -815,6 +866,8 @@ static int64 readLog(FILE *input,
                      sqlite3 *db)
 {
   int64 eventCount = 0;
+  int64 batchCount = 0; /* events in the current transaction */
+  time_t batchStart;
 
   /* declare statements for every event type */
   EVENT_LIST(EVENT_TYPE_DECLARE_STATEMENT, X);
@@ -823,6 +876,7 @@ static int64 readLog(FILE *input,
   EVENT_LIST(EVENT_TYPE_PREPARE_STATEMENT, X);
 
   runStatement(db, "BEGIN", "Transaction start");
+  batchStart = time(NULL);
 
   while (TRUE) { /* loop for each event */
     char line[MAX_LOG_LINE_LENGTH];
@@ -884,6 +938,19 @@ static int64 readLog(FILE *input,
     if (res != SQLITE_OK)
       sqlite_error(res, db, "Couldn't reset insert statement of event %llu", eventCount);
 
+    ++ batchCount;
+    if ((batchSize > 0 && batchCount >= batchSize)
+        || (batchSeconds > 0
+            && difftime(time(NULL), batchStart) >= (double)batchSeconds))
+    {
+      logFileCompleted(db, eventCount);
+      runStatement(db, "COMMIT", "Batch finish");
+      evlog(LOG_SELDOM, "Committed batch of %llu events.", batchCount);
+      runStatement(db, "BEGIN", "Batch start");
+      batchCount = 0;
+      batchStart = time(NULL);
+    }
+
     if (progress) {
       if ((eventCount % SMALL_TICK) == 0) {
         printf(".");
@@ -900,8 +967,8 @@ static int64 readLog(FILE *input,
     printf("\n");
     fflush(stdout);
   }
-  runStatement(db, "COMMIT", "Transaction finish");
   logFileCompleted(db, eventCount);
+  runStatement(db, "COMMIT", "Transaction finish");
 
   /* finalize all the statements */
   EVENT_LIST(EVENT_TYPE_FINALIZE_STATEMENT, X);
@@ -952,6 +1019,14 @@ int main(int argc, char *argv[])
   if (rebuild) {
     dropGlueTables(db);
   }
+  if (batchSize > 0 || batchSeconds > 0) {
+    /* Let other programs read the database while we import, and
+       don't wait for the disk at every commit: in write-ahead mode
+       this can lose the last few batches on power failure, but can't
+       corrupt the database. */
+    runStatement(db, "PRAGMA journal_mode=WAL", "Journal mode");
+    runStatement(db, "PRAGMA synchronous=NORMAL", "Synchronous mode");
+  }
   makeTables(db);
   fillGlueTables(db);
   count = writeEventsToSQL(db);
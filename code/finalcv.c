@@ -99,7 +99,8 @@ enum {
 };
 
 
-static void test(mps_arena_t arena, mps_pool_class_t pool_class)
+static void test(mps_arena_t arena, mps_pool_class_t pool_class,
+                 mps_bool_t lazy)
 {
   size_t i;                     /* index */
   mps_ap_t ap;
@@ -114,13 +115,16 @@ static void test(mps_arena_t arena, mps_pool_class_t pool_class)
   size_t collections = 0;
   void *p;
 
-  printf("---- finalcv: pool class %s ----\n", ClassName(pool_class));
+  printf("---- finalcv: pool class %s%s ----\n", ClassName(pool_class),
+         lazy ? " (lazy sweep)" : "");
 
   die(mps_fmt_create_A(&fmt, arena, dylan_fmt_A()), "fmt_create\n");
   die(mps_chain_create(&chain, arena, genCOUNT, testChain), "chain_create");
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
     MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    if (lazy)
+      MPS_ARGS_ADD(args, MPS_KEY_LAZY_SWEEP, TRUE);
     die(mps_pool_create_k(&pool, arena, pool_class, args), "pool_create\n");
   } MPS_ARGS_END(args);
   die(mps_root_create_table(&mps_root[0], arena, mps_rank_exact(), (mps_rm_t)0,
@@ -235,11 +239,13 @@ int main(int argc, char *argv[])
   die(mps_arena_create(&arena, mps_arena_class_vm(), testArenaSIZE),
       "arena_create\n");
 
-  test(arena, mps_class_amc());
-  test(arena, mps_class_amcz());
-  test(arena, mps_class_awl());
-  test(arena, mps_class_ams());
-  test(arena, mps_class_lo());
+  test(arena, mps_class_amc(), FALSE);
+  test(arena, mps_class_amcz(), FALSE);
+  test(arena, mps_class_awl(), FALSE);
+  test(arena, mps_class_ams(), FALSE);
+  test(arena, mps_class_ams(), TRUE);
+  test(arena, mps_class_lo(), FALSE);
+  test(arena, mps_class_lo(), TRUE);
 
   mps_arena_destroy(arena);
 
@@ -0,0 +1,258 @@
+/* fixbench.c -- Fix throughput benchmark on ANSI C library
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * This is a benchmark of the critical path of the second-stage fix
+ * (_mps_fix2) as the number of chunks in the arena grows. It creates
+ * a client arena out of a number of equally sized blocks, each of
+ * which becomes a chunk, fills half of it with leaf objects, and then
+ * collects the arena repeatedly with a large ambiguous root whose
+ * references point to randomly chosen objects. Since the objects are
+ * spread over all the chunks, each reference costs a chunk lookup.
+ * See <design/arena#.chunk.cache>.
+ */
+
+#include "mps.c"
+#include "testlib.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fprintf, printf, stderr */
+#include <stdlib.h> /* exit, free, malloc, EXIT_FAILURE, EXIT_SUCCESS */
+#include <time.h> /* CLOCKS_PER_SEC, clock */
+
+#define FIXMUST(expr) \
+  do { \
+    mps_res_t res = (expr); \
+    if (res != MPS_RES_OK) { \
+      fprintf(stderr, #expr " returned %d\n", res); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+
+static rnd_state_t seed = 0;      /* random number seed */
+static unsigned niter = 5;        /* collections per measurement */
+static unsigned nchunks = 64;     /* maximum number of chunks */
+static size_t nrefs = 1ul << 20;  /* references in the root */
+static size_t chunk_size = 1ul << 20; /* size of each chunk */
+
+#define objSLOTS  30    /* slots in each object */
+
+
+/* measure -- measure the fix time per reference with n chunks */
+
+static void measure(unsigned n)
+{
+  mps_arena_t arena;
+  mps_fmt_t format;
+  mps_pool_t pool;
+  mps_ap_t ap;
+  mps_root_t root;
+  mps_word_t obj;
+  void **blocks, **refs;
+  clock_t start, finish;
+  unsigned i;
+  size_t j, nobjs;
+
+  blocks = malloc(sizeof blocks[0] * n);
+  refs = malloc(sizeof refs[0] * nrefs);
+  if (blocks == NULL || refs == NULL) {
+    fprintf(stderr, "Couldn't allocate root for %u chunks\n", n);
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < n; ++i) {
+    blocks[i] = malloc(chunk_size);
+    if (blocks[i] == NULL) {
+      fprintf(stderr, "Couldn't allocate chunk %u\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, chunk_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_CL_BASE, blocks[0]);
+    FIXMUST(mps_arena_create_k(&arena, mps_arena_class_cl(), args));
+  } MPS_ARGS_END(args);
+  for (i = 1; i < n; ++i)
+    FIXMUST(mps_arena_extend(arena, blocks[i], chunk_size));
+
+  FIXMUST(dylan_fmt(&format, arena));
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, format);
+    FIXMUST(mps_pool_create_k(&pool, arena, mps_class_lo(), args));
+  } MPS_ARGS_END(args);
+  FIXMUST(mps_ap_create_k(&ap, pool, mps_args_none));
+
+  /* The root is registered before the objects are allocated, so that
+     they survive any collections during allocation. */
+  for (j = 0; j < nrefs; ++j)
+    refs[j] = NULL;
+  FIXMUST(mps_root_create_area(&root, arena, mps_rank_ambig(), 0,
+                               refs, refs + nrefs, mps_scan_area, NULL));
+  nobjs = n * chunk_size / 2 / ((objSLOTS + 2) * sizeof(mps_word_t));
+  if (nobjs > nrefs)
+    nobjs = nrefs;
+  for (j = 0; j < nobjs; ++j) {
+    FIXMUST(make_dylan_vector(&obj, ap, objSLOTS));
+    refs[j] = (void *)obj;
+  }
+  for (j = nobjs; j < nrefs; ++j)
+    refs[j] = refs[rnd() % nobjs];
+
+  FIXMUST(mps_arena_collect(arena)); /* warm up */
+  start = clock();
+  for (i = 0; i < niter; ++i)
+    FIXMUST(mps_arena_collect(arena));
+  finish = clock();
+
+  printf("%6u chunks: %g ns/ref\n", n,
+         (double)(finish - start) / CLOCKS_PER_SEC * 1e9
+         / ((double)niter * (double)nrefs));
+
+  mps_root_destroy(root);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(format);
+  mps_arena_destroy(arena);
+  for (i = 0; i < n; ++i)
+    free(blocks[i]);
+  free(refs);
+  free(blocks);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"niter",            required_argument, NULL, 'i'},
+  {"nchunks",          required_argument, NULL, 'c'},
+  {"nrefs",            required_argument, NULL, 'r'},
+  {"chunk-size",       required_argument, NULL, 's'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  unsigned n;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hi:c:r:s:x:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'i':
+      niter = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      nchunks = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      nrefs = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 's': {
+        char *p;
+        chunk_size = (size_t)strtoul(optarg, &p, 10);
+        switch(toupper(*p)) {
+        case 'G': chunk_size <<= 30; break;
+        case 'M': chunk_size <<= 20; break;
+        case 'K': chunk_size <<= 10; break;
+        case '\0': break;
+        default:
+          fprintf(stderr, "Bad chunk size %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+      }
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...]\n"
+              "Options:\n"
+              "  -i n, --niter=n\n"
+              "    Collect n times per measurement (default %u)\n"
+              "  -c n, --nchunks=n\n"
+              "    Measure 1, 2, 4, ... up to n chunks (default %u)\n"
+              "  -r n, --nrefs=n\n"
+              "    Number of references in the root (default %lu)\n"
+              "  -s n, --chunk-size=n[KMG]?\n"
+              "    Size of each chunk (default %lu)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              argv[0],
+              niter,
+              nchunks,
+              (unsigned long)nrefs,
+              (unsigned long)chunk_size);
+      return EXIT_FAILURE;
+    }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  (void)mps_lib_assert_fail_install(assert_die);
+  rnd_state_set(seed);
+  for (n = 1; n <= nchunks; n *= 2)
+    measure(n);
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
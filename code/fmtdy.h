@@ -24,6 +24,8 @@ extern mps_res_t dylan_fmt_weak(mps_fmt_t *, mps_arena_t);
 
 extern mps_addr_t dylan_weak_dependent(mps_addr_t);
 
+extern mps_bool_t dylan_scan_batch;
+
 extern mps_addr_t dylan_skip(mps_addr_t);
 extern void dylan_pad(mps_addr_t, size_t);
 extern mps_bool_t dylan_ispad(mps_addr_t);
@@ -7,11 +7,23 @@
  * checks that the MPS correctly runs in the child process after a
  * fork() on FreeBSD, Linux or macOS.
  *
+ * .par: The arena scans in parallel, so the child must also cope with
+ * the worker threads missing <code/par.h#.fork>.
+ *
  * .format: This test case uses a trivial object format in which each
  * object contains a single reference.
+ *
+ * .telemetry: The telemetry stream is written to a memory-mapped
+ * file, and the child writes its own stream <design/io#.posix.fork>.
+ * When the child has exited, the parent decodes both streams with
+ * mpseventcnv, which must be in the same directory as this test.
  */
 
+#include "config.h" /* for setenv, see .feature.li in config.h */
+
 #include <stdio.h>
+#include <stdlib.h> /* free, getenv, malloc, setenv, system */
+#include <string.h> /* strlen, strrchr */
 #include <sys/wait.h>
 #include <unistd.h>
 
@@ -90,6 +102,23 @@ static mps_res_t obj_scan(mps_ss_t ss, mps_addr_t base, mps_addr_t limit)
   return MPS_RES_OK;
 }
 
+/* decode -- decode a telemetry stream with mpseventcnv
+ *
+ * See .telemetry.
+ */
+
+static void decode(const char *argv0, const char *filename)
+{
+  const char *slash = strrchr(argv0, '/');
+  int dirlen = slash == NULL ? 0 : (int)(slash - argv0) + 1;
+  char *command = malloc((size_t)dirlen + strlen(filename) + 64);
+  cdie(command != NULL, "malloc failed");
+  sprintf(command, "%.*smpseventcnv -f '%s' > /dev/null",
+          dirlen, argv0, filename);
+  cdie(system(command) == 0, "couldn't decode telemetry");
+  free(command);
+}
+
 int main(int argc, char *argv[])
 {
   void *marker = &marker;
@@ -102,14 +131,24 @@ int main(int argc, char *argv[])
   mps_ap_t obj_ap;
   size_t i;
   obj_t obj, first;
+  const char *filename;
 
   testlib_init(argc, argv);
 
+  /* .telemetry */
+  filename = getenv("MPS_TELEMETRY_FILENAME");
+  if (filename == NULL)
+    filename = "mpsio.log";
+  cdie(setenv("MPS_TELEMETRY_CONTROL", "Arena Trace", 0) == 0,
+       "setenv failed");
+  cdie(setenv("MPS_TELEMETRY_SIZE", "65536", 1) == 0, "setenv failed");
+
   /* Set the pause time to be very small so that the incremental
      collector (when it runs) will have to leave a read barrier in
      place for us to hit. */
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, 0.0);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_GC_THREADS, 4); /* .par */
     die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
         "mps_arena_create");
   } MPS_ARGS_END(args);
@@ -153,6 +192,9 @@ int main(int argc, char *argv[])
     first = obj;
   }
 
+  /* Open the telemetry stream, so that the child has one to replace. */
+  mps_telemetry_flush();
+
   pid = fork();
   cdie(pid >= 0, "fork failed");
 
@@ -169,12 +211,30 @@ int main(int argc, char *argv[])
 
   mps_arena_park(arena);
 
+  /* Collect the world, scanning in parallel if there are workers. */
+  mps_arena_collect(arena);
+  for (obj = first; obj != NULL; obj = obj->u.ref) {
+    Insist(obj->type == TYPE_REF);
+  }
+
   if (pid != 0) {
     /* Parent: wait for child and check that its exit status is zero. */
     int stat;
     cdie(pid == waitpid(pid, &stat, 0), "waitpid failed");
     cdie(WIFEXITED(stat), "child did not exit normally");
     cdie(WEXITSTATUS(stat) == 0, "child exited with nonzero status");
+
+    /* Decode the streams of both processes. */
+    mps_telemetry_flush();
+    decode(argv[0], filename);
+    {
+      char *childname = malloc(strlen(filename) + 32);
+      cdie(childname != NULL, "malloc failed");
+      sprintf(childname, "%s.%ld", filename, (long)pid);
+      decode(argv[0], childname);
+      free(childname);
+    }
+
     printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   }
 
@@ -57,6 +57,15 @@ static unsigned pinleaf = FALSE;  /* are leaf objects pinned at start */
 static mps_bool_t zoned = TRUE;   /* arena allocates using zones */
 static double pause_time = ARENA_DEFAULT_PAUSE_TIME; /* maximum pause time */
 static double spare = ARENA_SPARE_DEFAULT; /* spare commit fraction */
+static size_t gc_threads = ARENA_DEFAULT_GC_THREADS; /* scanning threads */
+static size_t fill_scale_max = BUFFER_FILL_SCALE_MAX_DEFAULT; /* AP fill */
+static mps_bool_t pause_stats = FALSE; /* report pause distribution */
+static mps_bool_t adaptive_pacing = FALSE; /* pace by measured rates */
+static mps_bool_t heap_peak = FALSE; /* report peak heap size */
+static mps_bool_t background = FALSE; /* collect on a background thread */
+
+#define HEAP_SAMPLE 1024 /* vectors made between heap size samples */
+static size_t heap_max;           /* largest heap size sampled */
 
 typedef struct gcthread_s *gcthread_t;
 
@@ -68,14 +77,26 @@ struct gcthread_s {
     mps_root_t reg_root;
     mps_ap_t ap;
     gcthread_fn_t fn;
+    unsigned long nvectors; /* vectors made by this thread */
+    size_t heap_max;        /* largest heap size sampled */
 };
 
 typedef mps_word_t obj_t;
 
-static obj_t mkvector(mps_ap_t ap, size_t n)
+/* sample_heap -- note the size of the heap in use, for --heap-peak */
+static void sample_heap(gcthread_t thread)
+{
+  size_t heap = mps_arena_committed(arena) - mps_arena_spare_committed(arena);
+  if (heap > thread->heap_max)
+    thread->heap_max = heap;
+}
+
+static obj_t mkvector(gcthread_t thread, size_t n)
 {
   mps_word_t v;
-  RESMUST(make_dylan_vector(&v, ap, n));
+  RESMUST(make_dylan_vector(&v, thread->ap, n));
+  if (heap_peak && ++thread->nvectors % HEAP_SAMPLE == 0)
+    sample_heap(thread);
   return v;
 }
 
@@ -90,15 +111,15 @@ static void aset(obj_t v, size_t i, obj_t val)
 }
 
 /* mktree - make a tree of nodes with depth d. */
-static obj_t mktree(mps_ap_t ap, unsigned d, obj_t leaf)
+static obj_t mktree(gcthread_t thread, unsigned d, obj_t leaf)
 {
   obj_t tree;
   size_t i;
   if (d <= 0)
     return leaf;
-  tree = mkvector(ap, width);
+  tree = mkvector(thread, width);
   for (i = 0; i < width; ++i) {
-    aset(tree, i, mktree(ap, d - 1, leaf));
+    aset(tree, i, mktree(thread, d - 1, leaf));
   }
   return tree;
 }
@@ -120,7 +141,7 @@ static obj_t random_subtree(obj_t tree, unsigned levels)
  * NOTE: Changing preuse will dramatically change how much work
  * is done.  In particular, if preuse==1, the old tree is returned
  * unchanged. */
-static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
+static obj_t new_tree(gcthread_t thread, obj_t oldtree, unsigned d)
 {
   obj_t subtree;
   size_t i;
@@ -129,9 +150,9 @@ static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
   } else {
     if (d == 0)
       return objNULL;
-    subtree = mkvector(ap, width);
+    subtree = mkvector(thread, width);
     for (i = 0; i < width; ++i) {
-      aset(subtree, i, new_tree(ap, oldtree, d - 1));
+      aset(subtree, i, new_tree(thread, oldtree, d - 1));
     }
   }
   return subtree;
@@ -140,22 +161,22 @@ static obj_t new_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
 /* Update tree to be identical tree but with nodes reallocated
  * with probability pupdate.  This avoids writing to vector slots
  * if unecessary. */
-static obj_t update_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
+static obj_t update_tree(gcthread_t thread, obj_t oldtree, unsigned d)
 {
   obj_t tree;
   size_t i;
   if (oldtree == objNULL || d == 0)
     return oldtree;
   if (rnd_double() < pupdate) {
-    tree = mkvector(ap, width);
+    tree = mkvector(thread, width);
     for (i = 0; i < width; ++i) {
-      aset(tree, i, update_tree(ap, aref(oldtree, i), d - 1));
+      aset(tree, i, update_tree(thread, aref(oldtree, i), d - 1));
     }
   } else {
     tree = oldtree;
     for (i = 0; i < width; ++i) {
       obj_t oldsubtree = aref(oldtree, i);
-      obj_t subtree = update_tree(ap, oldsubtree, d - 1);
+      obj_t subtree = update_tree(thread, oldsubtree, d - 1);
       if (subtree != oldsubtree) {
         aset(tree, i, subtree);
       }
@@ -167,15 +188,14 @@ static obj_t update_tree(mps_ap_t ap, obj_t oldtree, unsigned d)
 static void *gc_tree(gcthread_t thread)
 {
   unsigned i, j;
-  mps_ap_t ap = thread->ap;
-  obj_t leaf = pinleaf ? mktree(ap, 1, objNULL) : objNULL;
+  obj_t leaf = pinleaf ? mktree(thread, 1, objNULL) : objNULL;
   for (i = 0; i < niter; ++i) {
-    obj_t tree = mktree(ap, depth, leaf);
+    obj_t tree = mktree(thread, depth, leaf);
     for (j = 0 ; j < npass; ++j) {
       if (preuse < 1.0)
-        tree = new_tree(ap, tree, depth);
+        tree = new_tree(thread, tree, depth);
       if (pupdate > 0.0)
-        tree = update_tree(ap, tree, depth);
+        tree = update_tree(thread, tree, depth);
     }
   }
   return NULL;
@@ -186,10 +206,15 @@ static void *start(void *p)
 {
   gcthread_t thread = p;
   void *marker;
+  thread->nvectors = 0;
+  thread->heap_max = 0;
   RESMUST(mps_thread_reg(&thread->mps_thread, arena));
   RESMUST(mps_root_create_thread(&thread->reg_root, arena,
                                  thread->mps_thread, &marker));
-  RESMUST(mps_ap_create_k(&thread->ap, pool, mps_args_none));
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_AP_FILL_SCALE_MAX, fill_scale_max);
+    RESMUST(mps_ap_create_k(&thread->ap, pool, args));
+  } MPS_ARGS_END(args);
   thread->fn(thread);
   mps_ap_destroy(thread->ap);
   mps_root_destroy(thread->reg_root);
@@ -208,8 +233,11 @@ static void weave(gcthread_fn_t fn)
     testthr_create(&thread->thread, start, thread);
   }
   
-  for (t = 0; t < nthreads; ++t)
+  for (t = 0; t < nthreads; ++t) {
     testthr_join(&threads[t].thread, NULL);
+    if (threads[t].heap_max > heap_max)
+      heap_max = threads[t].heap_max;
+  }
 }
 
 static void weave1(gcthread_fn_t fn)
@@ -218,6 +246,7 @@ static void weave1(gcthread_fn_t fn)
   
   thread->fn = fn;
   start(thread);
+  heap_max = thread->heap_max;
 }
 
 
@@ -225,6 +254,7 @@ static void watch(gcthread_fn_t fn, const char *name)
 {
   clock_t begin, end;
   
+  heap_max = 0;
   begin = clock();
   if (nthreads == 1)
     weave1(fn);
@@ -233,6 +263,29 @@ static void watch(gcthread_fn_t fn, const char *name)
   end = clock();
   
   printf("%s: %g\n", name, (double)(end - begin) / CLOCKS_PER_SEC);
+  if (heap_peak)
+    printf("heap peak: %lu\n", (unsigned long)heap_max);
+}
+
+
+/* Report the distribution of pauses of each kind.  See
+ * <design/arena#.pause.hist>. */
+
+static void report_pauses(void)
+{
+  static const char *kind_name[] = {
+    "mutator", "flip", "suspend", "increment"
+  };
+  mps_pause_kind_t kind;
+
+  for (kind = MPS_PAUSE_MUTATOR; kind <= MPS_PAUSE_INCREMENT; ++kind) {
+    mps_pause_stats_s stats;
+    mps_arena_pause_stats(arena, kind, &stats);
+    printf("pause %s: count %lu total %g p50 %g p99 %g p999 %g max %g\n",
+           kind_name[kind], (unsigned long)stats.mps_count,
+           stats.mps_total, stats.mps_p50, stats.mps_p99,
+           stats.mps_p999, stats.mps_max);
+  }
 }
 
 
@@ -248,6 +301,9 @@ static void arena_setup(gcthread_fn_t fn,
     MPS_ARGS_ADD(args, MPS_KEY_ARENA_ZONED, zoned);
     MPS_ARGS_ADD(args, MPS_KEY_PAUSE_TIME, pause_time);
     MPS_ARGS_ADD(args, MPS_KEY_SPARE, spare);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_GC_THREADS, gc_threads);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_ADAPTIVE_PACING, adaptive_pacing);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_BACKGROUND, background);
     RESMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), args));
   } MPS_ARGS_END(args);
   RESMUST(dylan_fmt(&format, arena));
@@ -263,6 +319,8 @@ static void arena_setup(gcthread_fn_t fn,
     RESMUST(mps_pool_create_k(&pool, arena, pool_class, args));
   } MPS_ARGS_END(args);
   watch(fn, name);
+  if (pause_stats)
+    report_pauses();
   mps_arena_park(arena);
   mps_pool_destroy(pool);
   mps_fmt_destroy(format);
@@ -291,6 +349,13 @@ static struct option longopts[] = {
   {"arena-unzoned",    no_argument,       NULL, 'z'},
   {"pause-time",       required_argument, NULL, 'P'},
   {"spare",            required_argument, NULL, 'S'},
+  {"gc-threads",       required_argument, NULL, 'T'},
+  {"batch",            no_argument,       NULL, 'B'},
+  {"fill-scale-max",   required_argument, NULL, 'F'},
+  {"pause-stats",      no_argument,       NULL, 'Q'},
+  {"adaptive-pacing",  no_argument,       NULL, 'A'},
+  {"heap-peak",        no_argument,       NULL, 'H'},
+  {"background",       no_argument,       NULL, 'b'},
   {NULL,               0,                 NULL, 0  }
 };
 
@@ -316,7 +381,7 @@ int main(int argc, char *argv[])
 
   seed = rnd_seed();
   
-  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zP:S:",
+  while ((ch = getopt_long(argc, argv, "ht:i:p:g:m:a:w:d:r:u:lx:zP:S:T:BF:QAHb",
                            longopts, NULL)) != -1)
     switch (ch) {
     case 't':
@@ -413,6 +478,27 @@ int main(int argc, char *argv[])
     case 'S':
       spare = strtod(optarg, NULL);
       break;
+    case 'T':
+      gc_threads = strtoul(optarg, NULL, 10);
+      break;
+    case 'B':
+      dylan_scan_batch = TRUE;
+      break;
+    case 'F':
+      fill_scale_max = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'Q':
+      pause_stats = TRUE;
+      break;
+    case 'A':
+      adaptive_pacing = TRUE;
+      break;
+    case 'H':
+      heap_peak = TRUE;
+      break;
+    case 'b':
+      background = TRUE;
+      break;
     default:
       /* This is printed in parts to keep within the 509 character
          limit for string literals in portable standard C. */
@@ -462,12 +548,30 @@ int main(int argc, char *argv[])
               "    Maximum pause time in seconds (default %f)\n"
               "  -S f, --spare\n"
               "    Maximum spare committed fraction (default %f)\n"
+              "  -T n, --gc-threads=n\n"
+              "    Scan grey segments using n threads (default %lu)\n"
+              "  -B, --batch\n"
+              "    Scan vectors using the batched area scanner\n",
+              pause_time,
+              spare,
+              (unsigned long)gc_threads);
+      fprintf(stderr,
+              "  -F n, --fill-scale-max=n\n"
+              "    Scale allocation point fills by up to n (default %lu)\n"
+              "  -Q, --pause-stats\n"
+              "    Report the distribution of pause times\n",
+              (unsigned long)fill_scale_max);
+      fprintf(stderr,
+              "  -A, --adaptive-pacing\n"
+              "    Pace collections by measured allocation and collection rates\n"
+              "  -H, --heap-peak\n"
+              "    Report the largest heap size sampled\n"
+              "  -b, --background\n"
+              "    Collect on a background thread when the mutator is idle\n"
               "Tests:\n"
               "  amc   pool class AMC\n"
               "  ams   pool class AMS\n"
-              "  awl   pool class AWL\n",
-              pause_time,
-              spare);
+              "  awl   pool class AWL\n");
       return EXIT_FAILURE;
     }
   argc -= optind;
@@ -21,7 +21,9 @@
  * functions should be in some other module, they just ended up here by
  * confusion over naming.  */
 
+#include "bg.h"
 #include "bt.h"
+#include "par.h"
 #include "poolmrg.h"
 #include "mps.h" /* finalization */
 #include "mpm.h"
@@ -52,6 +54,34 @@ static void arenaReleaseRingLock(void)
 }
 
 
+/* arenaClaimPoolLocks, arenaReleasePoolLocks -- claim and release
+ * the locks of all the pools in an arena, whose lock must be held.
+ * <design/thread-safety#.sol.fork.lock>
+ */
+
+static void arenaClaimPoolLocks(Arena arena)
+{
+  Ring node, nextNode;
+
+  AVERT(Arena, arena);
+  RING_FOR(node, ArenaPoolRing(arena), nextNode) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    PoolLockClaim(pool);
+  }
+}
+
+static void arenaReleasePoolLocks(Arena arena)
+{
+  Ring node, nextNode;
+
+  AVERT(Arena, arena);
+  RING_FOR(node, ArenaPoolRing(arena), nextNode) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    PoolLockRelease(pool);
+  }
+}
+
+
 /* GlobalsClaimAll -- claim all MPS locks
  * <design/thread-safety#.sol.fork.lock>
  */
@@ -61,6 +91,7 @@ void GlobalsClaimAll(void)
   LockClaimGlobalRecursive();
   arenaClaimRingLock();
   GlobalsArenaMap(ArenaEnter);
+  GlobalsArenaMap(arenaClaimPoolLocks);
 }
 
 /* GlobalsReleaseAll -- release all MPS locks. GlobalsClaimAll must
@@ -68,18 +99,30 @@ void GlobalsClaimAll(void)
 
 void GlobalsReleaseAll(void)
 {
+  GlobalsArenaMap(arenaReleasePoolLocks);
   GlobalsArenaMap(ArenaLeave);
   arenaReleaseRingLock();
   LockReleaseGlobalRecursive();
 }
 
-/* arenaReinitLock -- reinitialize the lock for an arena */
+/* arenaReinitLock -- reinitialize the locks for an arena and its pools */
 
 static void arenaReinitLock(Arena arena)
 {
+  Ring node, nextNode;
+
   AVERT(Arena, arena);
   ShieldLeave(arena);
   LockInit(ArenaGlobals(arena)->lock);
+  if (arena->bg != NULL)
+    BgForkChild(arena->bg); /* <code/bg.h#.fork> */
+  if (arena->par != NULL)
+    ParForkChild(arena->par); /* <code/par.h#.fork> */
+  RING_FOR(node, ArenaPoolRing(arena), nextNode) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    if (pool->lock != NULL)
+      LockInit(pool->lock);
+  }
 }
 
 /* GlobalsReinitializeAll -- reinitialize all MPS locks, and leave the
@@ -227,11 +270,16 @@ Bool GlobalsCheck(Globals arenaGlobals)
 
   for(rank = RankMIN; rank < RankLIMIT; ++rank)
     CHECKD_NOSIG(Ring, &arena->greyRing[rank]);
+  CHECKD_NOSIG(Ring, &arena->sweepRing);
   CHECKD_NOSIG(Ring, &arena->chainRing);
 
   CHECKL(arena->tracedWork >= 0.0);
   CHECKL(arena->tracedTime >= 0.0);
   /* no check for arena->lastWorldCollect (Clock) */
+  CHECKL(arena->allocRate >= 0.0);
+  CHECKL(arena->scanRate >= 0.0);
+  /* no check for arena->pollClock or arena->rateClocks (Clock) */
+  CHECKL(arena->rateAlloc >= 0.0);
 
   /* can't write a check for arena->epoch */
   CHECKD(History, ArenaHistory(arena));
@@ -333,6 +381,11 @@ Res GlobalsInit(Globals arenaGlobals)
   arena->tracedWork = 0.0;
   arena->tracedTime = 0.0;
   arena->lastWorldCollect = ClockNow();
+  arena->allocRate = 0.0;
+  arena->scanRate = 0.0;
+  arena->pollClock = arena->lastWorldCollect;
+  arena->rateClocks = 0;
+  arena->rateAlloc = 0.0;
   ShieldInit(ArenaShield(arena));
 
   for (ti = 0; ti < TraceLIMIT; ++ti) {
@@ -347,6 +400,7 @@ Res GlobalsInit(Globals arenaGlobals)
 
   for(rank = RankMIN; rank < RankLIMIT; ++rank)
     RingInit(&arena->greyRing[rank]);
+  RingInit(&arena->sweepRing);
   RingInit(&arena->chainRing);
 
   HistoryInit(ArenaHistory(arena));
@@ -403,6 +457,10 @@ Res GlobalsCompleteCreate(Globals arenaGlobals)
   arenaGlobals->lock = (Lock)p;
   LockInit(arenaGlobals->lock);
 
+  res = TraceParCreate(arena);
+  if (res != ResOK)
+    return res;
+
   /* Create the arena's default generation chain. */
   {
     GenParamStruct params[] = ChainDEFAULT;
@@ -424,10 +482,22 @@ Res GlobalsCompleteCreate(Globals arenaGlobals)
     }
   }
 
+  /* The background thread only tries to claim the arena lock, and
+   * the arena is complete, so it's safe to start it before the arena
+   * is announced. <code/bg.h#.thread-safety> */
+  if (arena->background) {
+    res = BgCreate(&arena->bg, arena, ArenaBackgroundINTERVAL);
+    if (res != ResOK)
+      goto failBgCreate;
+  }
+
   arenaAnnounce(arena);
 
   return ResOK;
 
+failBgCreate:
+  ChainDestroy(arenaGlobals->defaultChain);
+  arenaGlobals->defaultChain = NULL;
 failChainCreate:
   return res;
 }
@@ -454,6 +524,7 @@ void GlobalsFinish(Globals arenaGlobals)
   RingFinish(&arena->deadRing);
   for(rank = RankMIN; rank < RankLIMIT; ++rank)
     RingFinish(&arena->greyRing[rank]);
+  RingFinish(&arena->sweepRing);
   RingFinish(&arenaGlobals->rootRing);
   RingFinish(&arenaGlobals->poolRing);
   RingFinish(&arenaGlobals->globalRing);
@@ -474,18 +545,28 @@ void GlobalsPrepareToDestroy(Globals arenaGlobals)
 
   AVERT(Globals, arenaGlobals);
 
+  arena = GlobalsArena(arenaGlobals);
+
+  /* Stop the background thread first, so that it doesn't start
+   * collecting again.  This is safe while holding the arena lock.
+   * <code/bg.h#.thread-safety> */
+  if (arena->bg != NULL) {
+    BgDestroy(arena->bg);
+    arena->bg = NULL;
+  }
+
   /* Park the arena before destroying the default chain, to ensure
    * that there are no traces using that chain. */
   ArenaPark(arenaGlobals);
 
-  arena = GlobalsArena(arenaGlobals);
-
   arenaDenounce(arena);
 
   defaultChain = arenaGlobals->defaultChain;
   arenaGlobals->defaultChain = NULL;
   ChainDestroy(defaultChain);
 
+  TraceParDestroy(arena);
+
   LockRelease(arenaGlobals->lock);
   /* Theoretically, another thread could grab the lock here, but it's */
   /* not worth worrying about, since an attempt after the lock has been */
@@ -598,6 +679,41 @@ void ArenaEnterLock(Arena arena, Bool recursive)
   }
 }
 
+/* ArenaEnterTry -- enter the arena if no other thread holds the lock
+ *
+ * Like ArenaEnter, but returns FALSE without waiting if another
+ * thread holds the arena lock.
+ */
+
+Bool ArenaEnterTry(Arena arena)
+{
+  Lock lock;
+
+  AVER(TESTT(Arena, arena)); /* see ArenaEnterLock */
+  StackProbe(StackProbeDEPTH); /* see ArenaEnterLock */
+  lock = ArenaGlobals(arena)->lock;
+  if (!LockClaimTry(lock))
+    return FALSE;
+  AVERT(Arena, arena); /* can't AVERT it until we've got the lock */
+  ShieldEnter(arena);
+  return TRUE;
+}
+
+/* ArenaEnterContended -- enter the arena, reporting contention
+ *
+ * Like ArenaEnter, but returns TRUE if another thread held the arena
+ * lock, so that the caller can adapt to contention for it.
+ * <design/buffer#.fill.scale.adapt>
+ */
+
+Bool ArenaEnterContended(Arena arena)
+{
+  if (ArenaEnterTry(arena))
+    return FALSE;
+  ArenaEnter(arena);
+  return TRUE;
+}
+
 /* Same as ArenaEnter, but for the few functions that need to be
    reentrant with respect to some part of the MPS.
    For example, mps_arena_has_addr. */
@@ -658,6 +774,7 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
   Seg seg;
   Ring node, nextNode;
   Res res;
+  Clock start = ClockNow();
 
   arenaClaimRingLock();    /* <design/arena#.lock.ring> */
   AVERT(Ring, &arenaRing);
@@ -689,6 +806,7 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
         /* Protection was already cleared, for example by another thread
            or a fault in a nested exception handler: nothing to do now. */
       }
+      ArenaNotePause(arena, PauseKindMUTATOR, start, ClockNow());
       EVENT1(ArenaAccessEnd, arena);
       ArenaLeave(arena);
       return TRUE;
@@ -697,6 +815,7 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
       mode &= RootPM(root);
       if (mode != AccessSetEMPTY)
         RootAccess(root, mode);
+      ArenaNotePause(arena, PauseKindMUTATOR, start, ClockNow());
       EVENT1(ArenaAccessEnd, arena);
       ArenaLeave(arena);
       return TRUE;
@@ -715,6 +834,37 @@ Bool ArenaAccess(Addr addr, AccessSet mode, MutatorContext context)
 }
 
 
+/* arenaPollWork -- do the tracing work that is due
+ *
+ * Call TracePoll until the policy says to stop, and return TRUE if
+ * any work was done.  The caller must have set insidePoll.
+ */
+
+static Bool arenaPollWork(Globals globals, Clock start)
+{
+  Arena arena = GlobalsArena(globals);
+  Bool worldCollected = FALSE;
+  Bool moreWork, workWasDone = FALSE;
+  Work tracedWork;
+
+  AVER(globals->insidePoll);
+
+  EVENT1(ArenaPollBegin, arena);
+
+  do {
+    moreWork = TracePoll(&tracedWork, &worldCollected, globals,
+                         !worldCollected);
+    if (moreWork) {
+      workWasDone = TRUE;
+    }
+  } while (PolicyPollAgain(arena, start, moreWork, tracedWork));
+
+  EVENT2(ArenaPollEnd, arena, BOOLOF(workWasDone));
+
+  return workWasDone;
+}
+
+
 /* ArenaPoll -- trigger periodic actions
  *
  * Poll all background activities to see if they need to do anything.
@@ -735,9 +885,6 @@ void (ArenaPoll)(Globals globals)
 {
   Arena arena;
   Clock start;
-  Bool worldCollected = FALSE;
-  Bool moreWork, workWasDone = FALSE;
-  Work tracedWork;
 
   AVERT(Globals, globals);
 
@@ -754,27 +901,59 @@ void (ArenaPoll)(Globals globals)
   /* fillMutatorSize has advanced; call TracePoll enough to catch up. */
   start = ClockNow();
 
-  EVENT1(ArenaPollBegin, arena);
-
-  do {
-    moreWork = TracePoll(&tracedWork, &worldCollected, globals,
-                         !worldCollected);
-    if (moreWork) {
-      workWasDone = TRUE;
-    }
-  } while (PolicyPollAgain(arena, start, moreWork, tracedWork));
-
   /* Don't count time spent checking for work, if there was no work to do. */
-  if (workWasDone) {
-    ArenaAccumulateTime(arena, start, ClockNow());
+  if (arenaPollWork(globals, start)) {
+    Clock end = ClockNow();
+    ArenaAccumulateTime(arena, start, end);
+    ArenaNotePause(arena, PauseKindMUTATOR, start, end);
   }
 
-  EVENT2(ArenaPollEnd, arena, BOOLOF(workWasDone));
-
   globals->insidePoll = FALSE;
 }
 
 
+/* ArenaBackgroundStep -- do collection work on the background thread
+ *
+ * Called by the arena's background thread once every
+ * ArenaBackgroundINTERVAL <code/bg.h>.  If another thread holds the
+ * arena lock, then the mutator is busy in the MPS, so there is
+ * nothing to do.  If the mutator has allocated nothing since the last
+ * wake, it is idle, and the background thread steps the collector as
+ * if the client had called mps_arena_step with the pause time as the
+ * interval.  Otherwise it polls, just as allocation does, so that the
+ * work the policy says is due gets done even if the mutator is not
+ * allocating enough to poll for itself.
+ * <design/strategy#.policy.background>.
+ */
+
+void ArenaBackgroundStep(Arena arena)
+{
+  Globals globals;
+
+  if (!ArenaEnterTry(arena))
+    return;
+  globals = ArenaGlobals(arena);
+
+  if (!globals->clamped && !globals->insidePoll) {
+    if (globals->fillMutatorSize == arena->backgroundFill) {
+      /* .background.idle: A multiplier of zero means that the idle
+       * mutator never gets the world collected behind its back, only
+       * the work the policy would have done anyway. */
+      (void)ArenaStep(globals, ArenaPauseTime(arena), 0.0);
+    } else if (PolicyPoll(arena)) {
+      Clock start = ClockNow();
+      globals->insidePoll = TRUE;
+      if (arenaPollWork(globals, start))
+        ArenaAccumulateTime(arena, start, ClockNow());
+      globals->insidePoll = FALSE;
+    }
+    arena->backgroundFill = globals->fillMutatorSize;
+  }
+
+  ArenaLeave(arena);
+}
+
+
 /* ArenaStep -- use idle time for collection work */
 
 Bool ArenaStep(Globals globals, double interval, double multiplier)
@@ -800,10 +979,15 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
   /* loop while there is work to do and time on the clock. */
   do {
     Trace trace;
-    if (arena->busyTraces != TraceSetEMPTY) {
-      trace = ArenaTrace(arena, (TraceId)0);
-    } else {
-      /* No traces are running: consider collecting the world. */
+    TraceId ti;
+    if (arena->busyTraces == TraceSetEMPTY) {
+      /* No traces are running: finish any deferred sweeps first. */
+      if (ArenaLazySweep(arena, FALSE)) {
+        workWasDone = TRUE;
+        now = ClockNow();
+        continue;
+      }
+      /* Nothing to sweep: consider collecting the world. */
       if (PolicyShouldCollectWorld(arena, (double)(availableEnd - now), now,
                                    clocks_per_sec))
       {
@@ -819,9 +1003,12 @@ Bool ArenaStep(Globals globals, double interval, double multiplier)
           break;
       }
     }
-    TraceAdvance(trace);
-    if (trace->state == TraceFINISHED)
-      TraceDestroyFinished(trace);
+    /* Advance all running traces. */
+    TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+      TraceAdvance(trace);
+      if (trace->state == TraceFINISHED)
+        TraceDestroyFinished(trace);
+    TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
     workWasDone = TRUE;
     now = ClockNow();
   } while (now < intervalEnd);
@@ -903,6 +1090,8 @@ Ref ArenaPeekSeg(Arena arena, Seg seg, Ref *p)
 {
   Ref ref;
   Rank rank;
+  TraceId ti;
+  Trace trace;
 
   AVERT(Arena, arena);
   AVERT(Seg, seg);
@@ -921,13 +1110,16 @@ Ref ArenaPeekSeg(Arena arena, Seg seg, Ref *p)
 
   /* .read.conservative: Scan according to rank phase-of-trace, */
   /* See <code/trace.c#scan.conservative> */
-  /* If the segment isn't grey it doesn't need scanning, and in fact it
-     would be wrong to even ask what rank to scan it at, since there might
-     not be any traces running. */
-  if (TraceSetInter(SegGrey(seg), arena->flippedTraces) != TraceSetEMPTY) {
-    rank = TraceRankForAccess(arena, seg);
-    TraceScanSingleRef(arena->flippedTraces, rank, arena, seg, p);
-  }
+  /* Scan for each flipped trace for which the segment is grey.  If the
+     segment isn't grey it doesn't need scanning, and in fact it would be
+     wrong to even ask what rank to scan it at, since there might not be
+     any traces running. */
+  TRACE_SET_ITER(ti, trace, arena->flippedTraces, arena)
+    if (TraceSetIsMember(SegGrey(seg), trace)) {
+      rank = TraceRankForAccess(trace, seg);
+      TraceScanSingleRef(TraceSetSingle(trace), rank, arena, seg, p);
+    }
+  TRACE_SET_ITER_END(ti, trace, arena->flippedTraces, arena);
 
   /* We don't need to update the Seg Summary as in PoolSingleAccess
    * because we are not changing it after it has been scanned. */
@@ -0,0 +1,400 @@
+/* htbench.c -- Hash table benchmark on ANSI C library
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * This is a benchmark of address-based hash tables whose keys are
+ * objects in an AMC pool, under a steady stream of nursery
+ * collections, while some keys are replaced by new objects in the
+ * nursery. It compares a table in the style of the Scheme example
+ * (example/scheme/scheme.c), which keeps its buckets in the AMC pool,
+ * depends on the addresses of its keys with mps_ld_add, and rehashes
+ * when mps_ld_isstale says a key might have moved, with a table in
+ * the HT pool, which the collector updates in place. See
+ * <design/poolht#.bench>.
+ */
+
+#include "mps.c"
+#include "testlib.h"
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "mpscht.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fflush, fprintf, printf, stderr, stdout */
+#include <stdlib.h> /* exit, EXIT_FAILURE, EXIT_SUCCESS, strtoul */
+#include <time.h> /* clock, CLOCKS_PER_SEC */
+
+#define RESMUST(expr) \
+  do { \
+    mps_res_t res = (expr); \
+    if (res != MPS_RES_OK) { \
+      fprintf(stderr, #expr " returned %d\n", res); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+
+#define keyLIMIT 65536
+
+static rnd_state_t seed = 0;      /* random number seed */
+static size_t nkeys = 4096;       /* keys in each table */
+static unsigned nrounds = 100;    /* rounds of churn and lookups */
+static size_t nchurn = 4096;      /* garbage objects per round */
+static size_t nlookups = 16384;   /* lookups per round */
+static size_t nreplace = 64;      /* keys replaced per round */
+
+static mps_arena_t arena;
+static mps_ap_t ap;
+static mps_addr_t keys[2][keyLIMIT]; /* keys of each table, and roots */
+static mps_addr_t buckets[2];      /* Scheme table buckets, and roots */
+static mps_ld_s ld;                /* Scheme table location dependency */
+static size_t schemeLength;        /* Scheme table length */
+static size_t used;                /* Scheme table keys and DELETEDs */
+static unsigned long rehashes;     /* Scheme table rehash count */
+
+/* Scheme table buckets are Dylan vectors with alternate keys and
+ * values. DELETED is not a reference, so the format ignores it. */
+#define DELETED ((mps_addr_t)DYLAN_INT(0))
+#define BUCKET_KEY(b, i)   (*(mps_addr_t *)&DYLAN_VECTOR_SLOT(b, 2 * (i)))
+#define BUCKET_VALUE(b, i) (*(mps_addr_t *)&DYLAN_VECTOR_SLOT(b, 2 * (i) + 1))
+
+
+/* make -- make a Dylan vector with slots slots */
+
+static mps_addr_t make(size_t slots)
+{
+  mps_word_t obj;
+  RESMUST(make_dylan_vector(&obj, ap, slots));
+  return (mps_addr_t)obj;
+}
+
+
+/* schemeFind -- find key in buckets b with length slots
+ *
+ * Like buckets_find in the Scheme example: return the index of key,
+ * or of the empty slot where it would go.
+ */
+
+static size_t schemeFind(mps_addr_t b, size_t length, mps_addr_t key,
+                         mps_bool_t add)
+{
+  unsigned long h = (unsigned long)(mps_word_t)key >> 4;
+  unsigned long probe = (h >> 8) | 1;
+  size_t i;
+  if (add)
+    mps_ld_add(&ld, arena, key);
+  for (i = h & (length - 1);; i = (i + probe) & (length - 1)) {
+    mps_addr_t k = BUCKET_KEY(b, i);
+    if (k == key || k == NULL)
+      return i;
+  }
+}
+
+
+/* schemeRehash -- rehash the Scheme table, like table_rehash */
+
+static void schemeRehash(size_t newLength)
+{
+  size_t i;
+  buckets[1] = make(2 * newLength);
+  for (i = 0; i < newLength; ++i)
+    BUCKET_KEY(buckets[1], i) = BUCKET_VALUE(buckets[1], i) = NULL;
+  mps_ld_reset(&ld, arena);
+  used = 0;
+  for (i = 0; i < schemeLength; ++i) {
+    mps_addr_t key = BUCKET_KEY(buckets[0], i);
+    if (key != NULL && key != DELETED) {
+      size_t j = schemeFind(buckets[1], newLength, key, TRUE);
+      BUCKET_KEY(buckets[1], j) = key;
+      BUCKET_VALUE(buckets[1], j) = BUCKET_VALUE(buckets[0], i);
+      ++used;
+    }
+  }
+  buckets[0] = buckets[1];
+  buckets[1] = NULL;
+  schemeLength = newLength;
+  ++rehashes;
+}
+
+
+/* schemeGet -- look up key in the Scheme table, like table_ref */
+
+static mps_addr_t schemeGet(mps_addr_t key)
+{
+  size_t i = schemeFind(buckets[0], schemeLength, key, FALSE);
+  if (BUCKET_KEY(buckets[0], i) == NULL
+      && mps_ld_isstale(&ld, arena, key)) {
+    schemeRehash(schemeLength);
+    i = schemeFind(buckets[0], schemeLength, key, FALSE);
+  }
+  return BUCKET_VALUE(buckets[0], i);
+}
+
+
+/* schemePut -- add a new key to the Scheme table, like table_set */
+
+static void schemePut(mps_addr_t key, mps_addr_t value)
+{
+  size_t i;
+  if (used >= schemeLength / 2)
+    schemeRehash(schemeLength * 2);
+  i = schemeFind(buckets[0], schemeLength, key, TRUE);
+  BUCKET_KEY(buckets[0], i) = key;
+  BUCKET_VALUE(buckets[0], i) = value;
+  ++used;
+}
+
+
+/* schemeRemove -- remove a key from the Scheme table, like table_delete */
+
+static void schemeRemove(mps_addr_t key)
+{
+  size_t i = schemeFind(buckets[0], schemeLength, key, FALSE);
+  if (BUCKET_KEY(buckets[0], i) == NULL
+      && mps_ld_isstale(&ld, arena, key)) {
+    schemeRehash(schemeLength);
+    i = schemeFind(buckets[0], schemeLength, key, FALSE);
+  }
+  if (BUCKET_KEY(buckets[0], i) == key) {
+    BUCKET_KEY(buckets[0], i) = DELETED;
+    BUCKET_VALUE(buckets[0], i) = NULL;
+  }
+}
+
+
+/* run -- run churn and lookups on one kind of table, and report */
+
+static void run(const char *name, mps_addr_t *tableKeys, mps_ht_t ht)
+{
+  clock_t start, finish;
+  size_t collections = mps_collections(arena);
+  unsigned r;
+  size_t i;
+
+  rnd_state_set(seed);
+  rehashes = 0;
+  start = clock();
+  for (r = 0; r < nrounds; ++r) {
+    for (i = 0; i < nchurn; ++i)
+      (void)make(4);
+    for (i = 0; i < nreplace; ++i) {
+      size_t k = rnd() % nkeys;
+      if (ht != NULL) {
+        (void)mps_ht_remove(ht, tableKeys[k]);
+        tableKeys[k] = make(1);
+        RESMUST(mps_ht_put(ht, tableKeys[k], tableKeys[k]));
+      } else {
+        schemeRemove(tableKeys[k]);
+        tableKeys[k] = make(1);
+        schemePut(tableKeys[k], tableKeys[k]);
+      }
+    }
+    for (i = 0; i < nlookups; ++i) {
+      mps_addr_t key = tableKeys[rnd() % nkeys], value;
+      if (ht != NULL) {
+        if (!mps_ht_get(&value, ht, key))
+          value = NULL;
+      } else {
+        value = schemeGet(key);
+      }
+      if (value != key) {
+        fprintf(stderr, "%s: lookup failed\n", name);
+        exit(EXIT_FAILURE);
+      }
+    }
+  }
+  finish = clock();
+  printf("%-6s %8lu keys %6lu collections %6lu rehashes %8.3f s\n",
+         name, (unsigned long)nkeys,
+         (unsigned long)(mps_collections(arena) - collections), rehashes,
+         (double)(finish - start) / CLOCKS_PER_SEC);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"nkeys",            required_argument, NULL, 'k'},
+  {"nrounds",          required_argument, NULL, 'r'},
+  {"nchurn",           required_argument, NULL, 'c'},
+  {"nlookups",         required_argument, NULL, 'l'},
+  {"nreplace",         required_argument, NULL, 'p'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  mps_fmt_t fmt;
+  mps_chain_t chain;
+  mps_pool_t amc, htPool;
+  mps_ht_t ht;
+  mps_root_t keysRoot, bucketsRoot;
+  mps_gen_param_s genParams[] = {{1024, 0.85}, {8192, 0.45}};
+  mps_bool_t seed_specified = FALSE;
+  size_t i;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hk:r:c:l:p:x:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'k':
+      nkeys = (size_t)strtoul(optarg, NULL, 10);
+      if (nkeys == 0 || nkeys > keyLIMIT) {
+        fprintf(stderr, "Bad number of keys %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'r':
+      nrounds = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      nchurn = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'l':
+      nlookups = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'p':
+      nreplace = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...]\n"
+              "Options:\n"
+              "  -k n, --nkeys=n\n"
+              "    Keys in each table (default %lu, maximum %lu)\n"
+              "  -r n, --nrounds=n\n"
+              "    Rounds of churn and lookups (default %u)\n"
+              "  -c n, --nchurn=n\n"
+              "    Garbage objects allocated per round (default %lu)\n"
+              "  -l n, --nlookups=n\n"
+              "    Lookups per round (default %lu)\n"
+              "  -p n, --nreplace=n\n"
+              "    Keys replaced by new objects per round (default %lu)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              argv[0],
+              (unsigned long)nkeys,
+              (unsigned long)keyLIMIT,
+              nrounds,
+              (unsigned long)nchurn,
+              (unsigned long)nlookups,
+              (unsigned long)nreplace);
+      return EXIT_FAILURE;
+    }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  (void)mps_lib_assert_fail_install(assert_die);
+  RESMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), mps_args_none));
+  RESMUST(dylan_fmt(&fmt, arena));
+  RESMUST(mps_chain_create(&chain, arena, NELEMS(genParams), genParams));
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    RESMUST(mps_pool_create_k(&amc, arena, mps_class_amc(), args));
+  } MPS_ARGS_END(args);
+  RESMUST(mps_ap_create_k(&ap, amc, mps_args_none));
+  RESMUST(mps_pool_create_k(&htPool, arena, mps_class_ht(), mps_args_none));
+  RESMUST(mps_ht_create(&ht, htPool, mps_rank_exact(), mps_rank_exact()));
+  RESMUST(mps_root_create_area(&keysRoot, arena, mps_rank_exact(), 0,
+                               &keys[0][0], &keys[0][0] + 2 * keyLIMIT,
+                               mps_scan_area, NULL));
+  RESMUST(mps_root_create_area(&bucketsRoot, arena, mps_rank_exact(), 0,
+                               buckets, buckets + NELEMS(buckets),
+                               mps_scan_area, NULL));
+
+  /* The Scheme table is at most half full, like table_full. */
+  for (schemeLength = 1; schemeLength <= 2 * nkeys;
+       schemeLength *= 2)
+    NOOP;
+  for (i = 0; i < nkeys; ++i) {
+    keys[0][i] = make(1);
+    keys[1][i] = make(1);
+    RESMUST(mps_ht_put(ht, keys[1][i], keys[1][i]));
+  }
+  mps_ld_reset(&ld, arena);
+  buckets[0] = make(2 * schemeLength);
+  for (i = 0; i < schemeLength; ++i)
+    BUCKET_KEY(buckets[0], i) = BUCKET_VALUE(buckets[0], i) = NULL;
+  for (i = 0; i < nkeys; ++i) {
+    size_t j = schemeFind(buckets[0], schemeLength, keys[0][i], TRUE);
+    BUCKET_KEY(buckets[0], j) = BUCKET_VALUE(buckets[0], j) = keys[0][i];
+  }
+  used = nkeys;
+
+  run("scheme", keys[0], NULL);
+  run("ht", keys[1], ht);
+
+  mps_arena_park(arena);
+  mps_root_destroy(bucketsRoot);
+  mps_root_destroy(keysRoot);
+  mps_ht_destroy(ht);
+  mps_pool_destroy(htPool);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(amc);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(fmt);
+  mps_arena_destroy(arena);
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
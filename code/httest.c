@@ -0,0 +1,223 @@
+/* httest.c: HASH TABLE POOL TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Keep hash tables whose keys are objects in an AMC pool, and check
+ * that every entry can be found by the key's current address while
+ * nursery collections move the keys. Also check that entries are
+ * removed from tables with weak keys or weak values when the key or
+ * value dies. <design/poolht#.test>
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpsavm.h"
+#include "mpscamc.h"
+#include "mpscht.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE   ((size_t)32 << 20)
+#define objCOUNT        2000
+#define roundCOUNT      40
+#define churnCOUNT      2000
+#define churnSLOTS      8
+
+
+static mps_addr_t keys[objCOUNT];   /* keys of strong and weakValue */
+static mps_addr_t weak[objCOUNT];   /* keys of weakKey, values of weakValue */
+static mps_addr_t oldKeys[objCOUNT]; /* keys[] before any collection */
+static mps_ap_t ap;
+
+
+/* make -- make an object whose first slot is n */
+
+static mps_addr_t make(size_t slots, size_t n)
+{
+  mps_word_t obj;
+  die(make_dylan_vector(&obj, ap, slots), "make_dylan_vector");
+  DYLAN_VECTOR_SLOT(obj, 0) = DYLAN_INT(n);
+  return (mps_addr_t)obj;
+}
+
+
+/* check -- check that the tables contain what they should */
+
+static void check(mps_ht_t strong, mps_ht_t weakKey, mps_ht_t weakValue,
+                  size_t live)
+{
+  size_t i;
+
+  Insist(mps_ht_count(strong) == objCOUNT);
+  Insist(mps_ht_count(weakKey) == live);
+  Insist(mps_ht_count(weakValue) == live);
+  for (i = 0; i < objCOUNT; ++i) {
+    mps_addr_t value;
+    Insist(mps_ht_get(&value, strong, keys[i]));
+    Insist(DYLAN_VECTOR_SLOT(value, 0) == DYLAN_INT(i));
+    if (weak[i] != NULL) {
+      Insist(mps_ht_get(&value, weakKey, weak[i]));
+      Insist(DYLAN_VECTOR_SLOT(value, 0) == DYLAN_INT(i));
+      Insist(mps_ht_get(&value, weakValue, keys[i]));
+      Insist(value == weak[i]);
+    } else {
+      Insist(!mps_ht_get(&value, weakValue, keys[i]));
+    }
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_fmt_t fmt;
+  mps_chain_t chain;
+  mps_pool_t amc, htPool;
+  mps_ht_t strong, weakKey, weakValue;
+  mps_root_t keysRoot, weakRoot;
+  mps_gen_param_s genParams[] = {{150, 0.85}, {170, 0.45}};
+  size_t i, round, live, moved;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  mps_arena_park(arena);
+
+  die(dylan_fmt(&fmt, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, NELEMS(genParams), genParams),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&amc, arena, mps_class_amc(), args),
+        "pool_create amc");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create_k(&ap, amc, mps_args_none), "ap_create");
+  die(mps_pool_create_k(&htPool, arena, mps_class_ht(), mps_args_none),
+      "pool_create ht");
+  die(mps_ht_create(&strong, htPool, mps_rank_exact(), mps_rank_exact()),
+      "ht_create strong");
+  die(mps_ht_create(&weakKey, htPool, mps_rank_weak(), mps_rank_exact()),
+      "ht_create weakKey");
+  die(mps_ht_create(&weakValue, htPool, mps_rank_exact(), mps_rank_weak()),
+      "ht_create weakValue");
+  die(mps_root_create_area(&keysRoot, arena, mps_rank_exact(), 0,
+                           keys, keys + NELEMS(keys),
+                           mps_scan_area, NULL),
+      "root_create keys");
+  die(mps_root_create_area(&weakRoot, arena, mps_rank_exact(), 0,
+                           weak, weak + NELEMS(weak),
+                           mps_scan_area, NULL),
+      "root_create weak");
+
+  for (i = 0; i < objCOUNT; ++i) {
+    keys[i] = make(1, i);
+    weak[i] = make(1, i);
+    oldKeys[i] = keys[i];
+    die(mps_ht_put(strong, keys[i], make(1, i)), "ht_put strong");
+    die(mps_ht_put(weakKey, weak[i], make(1, i)), "ht_put weakKey");
+    die(mps_ht_put(weakValue, keys[i], weak[i]), "ht_put weakValue");
+  }
+  live = objCOUNT;
+  check(strong, weakKey, weakValue, live);
+  mps_arena_release(arena);
+
+  for (round = 0; round < roundCOUNT; ++round) {
+    /* Allocate garbage so that there are nursery collections. */
+    for (i = 0; i < churnCOUNT; ++i)
+      (void)make(churnSLOTS, i);
+
+    /* Replace some entries, so that tables have deleted slots. */
+    for (i = round; i < objCOUNT; i += roundCOUNT) {
+      Insist(mps_ht_remove(strong, keys[i]));
+      Insist(!mps_ht_remove(strong, keys[i]));
+      die(mps_ht_put(strong, keys[i], make(1, i)), "ht_put strong");
+    }
+
+    /* Halfway through, drop the odd weak objects. */
+    if (round == roundCOUNT / 2) {
+      for (i = 1; i < objCOUNT; i += 2)
+        weak[i] = NULL;
+      live = objCOUNT / 2;
+      mps_arena_collect(arena);
+      mps_arena_release(arena);
+    }
+    check(strong, weakKey, weakValue, live);
+  }
+
+  mps_arena_collect(arena);
+  check(strong, weakKey, weakValue, live);
+
+  moved = 0;
+  for (i = 0; i < objCOUNT; ++i)
+    if (keys[i] != oldKeys[i])
+      ++moved;
+  printf("collections: %lu, keys moved: %lu, pool size: %lu\n",
+         (unsigned long)mps_collections(arena), (unsigned long)moved,
+         (unsigned long)mps_pool_total_size(htPool));
+  Insist(moved > 0);
+
+  mps_arena_park(arena);
+  mps_ht_destroy(weakValue);
+  mps_root_destroy(weakRoot);
+  mps_root_destroy(keysRoot);
+  mps_pool_destroy(htPool); /* destroys strong and weakKey */
+  mps_ap_destroy(ap);
+  mps_pool_destroy(amc);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(fmt);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,274 @@
+/* landbench.c -- Land benchmark on ANSI C library
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * This is a benchmark of the searching land implementations, CBSZoned
+ * and AVL, on a large fragmented address space, like the one managed
+ * by the arena's free land. It fills a land with ranges of random
+ * sizes separated by gaps of random sizes, and then measures the time
+ * taken by each kind of search. Where a search deletes a range, the
+ * range is inserted again afterwards, so the times include deletion
+ * and insertion. See <design/avl#.bench>.
+ */
+
+#include "mps.c"
+#include "testlib.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fprintf, printf, stderr */
+#include <stdlib.h> /* exit, EXIT_FAILURE, EXIT_SUCCESS */
+#include <time.h> /* CLOCKS_PER_SEC, clock */
+
+#define LANDMUST(expr) \
+  do { \
+    mps_res_t res = (expr); \
+    if (res != MPS_RES_OK) { \
+      fprintf(stderr, "%s returned %d\n", #expr, res); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+
+static rnd_state_t seed = 0;      /* random number seed */
+static size_t nranges = 1ul << 16; /* maximum number of ranges */
+static unsigned long nops = 100000; /* operations per measurement */
+static unsigned maxUnits = 16;    /* maximum size of range or gap */
+
+
+/* Land classes to compare */
+
+static struct {
+  const char *name;
+  LandClass (*klass)(void);
+} lands[] = {
+  {"cbs", CBSZonedClassGet},
+  {"avl", AVLClassGet},
+};
+
+
+/* Operations to measure */
+
+enum {
+  OpFIRST,      /* LandFindFirst, then insert again */
+  OpLAST,       /* LandFindLast, then insert again */
+  OpLARGEST,    /* LandFindLargest without deleting */
+  OpZONES,      /* LandFindInZones, then insert again */
+  OpLIMIT
+};
+
+static const char *opNames[OpLIMIT] = {
+  "first", "last", "largest", "zones"
+};
+
+
+/* op -- perform one operation of kind k on land */
+
+static void op(Land land, unsigned k, Size unit)
+{
+  RangeStruct range, oldRange, newRange;
+  Size size = unit * (1 + rnd() % (2 * maxUnits));
+  Bool found = FALSE;
+
+  switch (k) {
+  case OpFIRST:
+    found = LandFindFirst(&range, &oldRange, land, size, FindDeleteLOW);
+    break;
+  case OpLAST:
+    found = LandFindLast(&range, &oldRange, land, size, FindDeleteHIGH);
+    break;
+  case OpLARGEST:
+    (void)LandFindLargest(&range, &oldRange, land, unit, FindDeleteNONE);
+    break;
+  case OpZONES: {
+      ZoneSet zones = (ZoneSet)3 << (rnd() % (MPS_WORD_WIDTH - 1));
+      LANDMUST(LandFindInZones(&found, &range, &oldRange, land,
+                               unit * (1 + rnd() % maxUnits), zones,
+                               rnd() % 2 != 0));
+    }
+    break;
+  default:
+    NOTREACHED;
+    break;
+  }
+
+  if (found)
+    LANDMUST(LandInsert(&newRange, land, &range));
+}
+
+
+/* measure -- measure each operation on each land with n ranges */
+
+static void measure(Arena arena, size_t n)
+{
+  Size unit = ArenaGrainSize(arena);
+  Addr base = AddrAlignUp((Addr)((Word)1 << 20), unit);
+  size_t i, j;
+
+  if ((Word)-1 / ((Word)n * 2 * maxUnits * unit) < 2) {
+    fprintf(stderr, "Too many ranges for the address space: %lu\n",
+            (unsigned long)n);
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 0; i < NELEMS(lands); ++i) {
+    Land land;
+    union {
+      CBSStruct cbs;
+      AVLStruct avl;
+    } landStruct;
+    Addr addr = base;
+    unsigned k;
+
+    land = &landStruct.cbs.landStruct; /* both start with LandStruct */
+    LANDMUST(LandInit(land, lands[i].klass(), arena, unit, NULL,
+                      mps_args_none));
+
+    rnd_state_set(seed);
+    for (j = 0; j < n; ++j) {
+      RangeStruct range, newRange;
+      addr = AddrAdd(addr, unit * (1 + rnd() % maxUnits));
+      RangeInitSize(&range, addr, unit * (1 + rnd() % maxUnits));
+      LANDMUST(LandInsert(&newRange, land, &range));
+      addr = RangeLimit(&range);
+    }
+
+    for (k = 0; k < OpLIMIT; ++k) {
+      clock_t start, finish;
+      unsigned long m;
+      start = clock();
+      for (m = 0; m < nops; ++m)
+        op(land, k, unit);
+      finish = clock();
+      printf("%s %8lu ranges %-8s %g ns/op\n", lands[i].name,
+             (unsigned long)n, opNames[k],
+             (double)(finish - start) / CLOCKS_PER_SEC * 1e9
+             / (double)nops);
+    }
+
+    LandFinish(land);
+  }
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"nranges",          required_argument, NULL, 'r'},
+  {"nops",             required_argument, NULL, 'o'},
+  {"max-units",        required_argument, NULL, 'u'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  size_t n;
+  mps_arena_t mpsArena;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "hr:o:u:x:", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'r':
+      nranges = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'o':
+      nops = strtoul(optarg, NULL, 10);
+      break;
+    case 'u':
+      maxUnits = (unsigned)strtoul(optarg, NULL, 10);
+      if (maxUnits == 0) {
+        fprintf(stderr, "Bad maximum units %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      fprintf(stderr,
+              "Usage: %s [option...]\n"
+              "Options:\n"
+              "  -r n, --nranges=n\n"
+              "    Measure 1024, 4096, ... up to n ranges (default %lu)\n"
+              "  -o n, --nops=n\n"
+              "    Operations of each kind per measurement (default %lu)\n"
+              "  -u n, --max-units=n\n"
+              "    Maximum size of ranges and gaps in grains (default %u)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              argv[0],
+              (unsigned long)nranges,
+              nops,
+              maxUnits);
+      return EXIT_FAILURE;
+    }
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  (void)mps_lib_assert_fail_install(assert_die);
+  LANDMUST(mps_arena_create_k(&mpsArena, mps_arena_class_vm(),
+                              mps_args_none));
+  for (n = 1024; n <= nranges; n *= 4)
+    measure((Arena)mpsArena, n);
+  mps_arena_destroy(mpsArena);
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -3,12 +3,13 @@
  * $Id$
  * Copyright (c) 2001-2018 Ravenbrook Limited.  See end of file for license.
  *
- * Test all three Land implementations against duplicate operations on
+ * Test all four Land implementations against duplicate operations on
  * a bit-table.
  *
- * Test the "steal" operations on a CBS.
+ * Test the "steal" operations on a CBS and an AVL.
  */
 
+#include "avl.h"
 #include "cbs.h"
 #include "failover.h"
 #include "freelist.h"
@@ -26,9 +27,10 @@ SRCID(landtest, "$Id$");
 
 #define ArraySize ((Size)123456)
 
-/* CBS is much faster than Freelist, so we apply more operations to
- * the former. */
+/* CBS and AVL are much faster than Freelist, so we apply more
+ * operations to the former. */
 #define nCBSOperations ((Size)125000)
+#define nAVLOperations ((Size)125000)
 #define nFLOperations ((Size)12500)
 #define nFOOperations ((Size)12500)
 
@@ -447,9 +449,11 @@ static void test_land(void)
   void *p;
   MFSStruct blockPool;
   CBSStruct cbsStruct;
+  AVLStruct avlStruct;
   FreelistStruct flStruct;
   FailoverStruct foStruct;
   Land cbs = CBSLand(&cbsStruct);
+  Land avl = AVLLand(&avlStruct);
   Land fl = FreelistLand(&flStruct);
   Land fo = FailoverLand(&foStruct);
   Pool mfs = MFSPool(&blockPool);
@@ -490,7 +494,16 @@ static void test_land(void)
     LandFinish(cbs);
   }
 
-  /* 2. Test Freelist */
+  /* 2. Test AVL */
+
+  die((mps_res_t)LandInit(avl, CLASS(AVL), arena, state.align,
+                          NULL, mps_args_none),
+      "failed to initialise AVL");
+  state.land = avl;
+  test(&state, nAVLOperations, 3);
+  LandFinish(avl);
+
+  /* 3. Test Freelist */
 
   die((mps_res_t)LandInit(fl, CLASS(Freelist), arena, state.align,
                           NULL, mps_args_none),
@@ -499,7 +512,7 @@ static void test_land(void)
   test(&state, nFLOperations, 3);
   LandFinish(fl);
 
-  /* 3. Test CBS-failing-over-to-Freelist (always failing over on
+  /* 4. Test CBS-failing-over-to-Freelist (always failing over on
    * first iteration, never failing over on second; see fotest.c for a
    * test case that randomly switches fail-over on and off)
    */
@@ -562,14 +575,18 @@ static void shuffle(Addr *addr, size_t n)
   }
 }
 
-static void test_steal(void)
+static void test_steal(LandClass klass)
 {
   mps_arena_t mpsArena;
   Arena arena;
-  MFSStruct mfs;                /* stores blocks for the CBS */
+  MFSStruct mfs;                /* stores blocks for the land */
   Pool pool = MFSPool(&mfs);
-  CBSStruct cbs;                /* allocated memory land */
-  Land land = CBSLand(&cbs);
+  union {
+    CBSStruct cbs;
+    AVLStruct avl;
+  } landStruct;                 /* allocated memory land */
+  Land land = &landStruct.cbs.landStruct; /* both start with LandStruct */
+  Bool isCBS = klass == CLASS(CBS);
   Addr base;
   Addr addr[4096];
   Size grainSize;
@@ -582,16 +599,19 @@ static void test_steal(void)
   grainSize = ArenaGrainSize(arena);
 
   MPS_ARGS_BEGIN(args) {
-    MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE, sizeof(RangeTreeStruct));
+    MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE,
+                 isCBS ? sizeof(RangeTreeStruct) : sizeof(AVLBlockStruct));
     MPS_ARGS_ADD(args, MPS_KEY_EXTEND_BY, grainSize);
     MPS_ARGS_ADD(args, MFSExtendSelf, FALSE);
     die(PoolInit(pool, arena, CLASS(MFSPool), args), "pool");
   } MPS_ARGS_END(args);
   
   MPS_ARGS_BEGIN(args) {
-    MPS_ARGS_ADD(args, CBSBlockPool, pool);
-    die(LandInit(land, CLASS(CBS), arena, grainSize, NULL, args),
-        "land");
+    if (isCBS)
+      MPS_ARGS_ADD(args, CBSBlockPool, pool);
+    else
+      MPS_ARGS_ADD(args, AVLBlockPool, pool);
+    die(LandInit(land, klass, arena, grainSize, NULL, args), "land");
   } MPS_ARGS_END(args);
 
   /* Allocate a range of grains. */
@@ -644,7 +664,8 @@ int main(int argc, char *argv[])
 {
   testlib_init(argc, argv);
   test_land();
-  test_steal();
+  test_steal(CLASS(CBS));
+  test_steal(CLASS(AVL));
   printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
   return 0;
 }
@@ -194,7 +194,7 @@ void LDAdd(mps_ld_t ld, Arena arena, Addr addr)
 }
 
 
-/* LDIsStaleAny -- check whether any dependency is stale
+/* ldMoved -- summarize the movement since a dependency's epoch
  *
  * .stale.thread-safe: This function is thread safe.  It will return a
  * correct (but possibly conservative) answer regardless of the number
@@ -203,8 +203,8 @@ void LDAdd(mps_ld_t ld, Arena arena, Addr addr)
  * .stale.current: If the dependency's epoch is the current epoch,
  * nothing can have moved since it was initialized.
  *
- * .stale.recent: If the dependency is recent, see if it intersects
- * with everything which has moved since it was initialized.
+ * .stale.recent: If the dependency is recent, use the summary of
+ * everything which has moved since it was initialized.
  *
  * .stale.recent.conservative: The refset from the history table is
  * loaded before we check whether ld->_epoch is "recent" with respect to
@@ -212,9 +212,9 @@ void LDAdd(mps_ld_t ld, Arena arena, Addr addr)
  * to use the prehistory instead.
  *
  * .stale.old: Otherwise, if the dependency is older than the length
- * of the history, check it against all movement that has ever occured.
+ * of the history, use all movement that has ever occured.
  */
-Bool LDIsStaleAny(mps_ld_t ld, Arena arena)
+static RefSet ldMoved(mps_ld_t ld, Arena arena)
 {
   History history;
   RefSet rs;
@@ -225,7 +225,7 @@ Bool LDIsStaleAny(mps_ld_t ld, Arena arena)
   AVER(ld->_epoch <= history->epoch);
 
   if (history->epoch == ld->_epoch) /* .stale.current */
-    return FALSE;
+    return RefSetEMPTY;
 
   /* Load the history refset, _then_ check to see if it's recent.
    * This may in fact load an okay refset, which we decide to throw
@@ -237,7 +237,18 @@ Bool LDIsStaleAny(mps_ld_t ld, Arena arena)
     rs = history->prehistory;     /* .stale.old */
   }
 
-  return RefSetInter(ld->_rs, rs) != RefSetEMPTY;
+  return rs;
+}
+
+
+/* LDIsStaleAny -- check whether any dependency is stale
+ *
+ * A dependency is stale if its reference set intersects with the
+ * movement since its epoch.
+ */
+Bool LDIsStaleAny(mps_ld_t ld, Arena arena)
+{
+  return RefSetInter(ld->_rs, ldMoved(ld, arena)) != RefSetEMPTY;
 }
 
 
@@ -245,7 +256,11 @@ Bool LDIsStaleAny(mps_ld_t ld, Arena arena)
  *
  * .stale.conservative: In fact we just ignore the address and test if
  * any dependency is stale. This is conservatively correct (no false
- * negatives) but provides a hook for future improvement.
+ * negatives). The address can't be used to be more precise, because
+ * the client may pass the block's current address rather than the
+ * address it added (see the example in topic/location.rst), and the
+ * block may have moved to a zone that hasn't moved. LDIsStaleAddr
+ * is more precise for clients that pass the address they added.
  *
  * .stale.no-arena-check: See .add.no-arena-check.
  *
@@ -258,6 +273,67 @@ Bool LDIsStale(mps_ld_t ld, Arena arena, Addr addr)
 }
 
 
+/* LDIsStaleAddr -- check whether an added address is stale
+ *
+ * .stale.addr: addr must be an address that was added to the
+ * dependency. As well as checking whether any dependency is stale, we
+ * check whether the zone of the address itself has moved since the
+ * dependency's epoch. If the block at addr moved, then the segment it
+ * moved from was in the moved set passed to LDAge, and so that zone is
+ * in the summary. This is conservatively correct (no false negatives)
+ * but much more precise than LDIsStaleAny when the dependency has
+ * many addresses in different zones.
+ *
+ * This function is thread safe: see .stale.thread-safe.
+ */
+Bool LDIsStaleAddr(mps_ld_t ld, Arena arena, Addr addr)
+{
+  RefSet rs = ldMoved(ld, arena);
+  return RefSetInter(ld->_rs, rs) != RefSetEMPTY
+    && RefSetIsMember(arena, rs, addr);
+}
+
+
+/* LDIsStaleSeg -- check precisely whether a dependency is stale
+ *
+ * .stale.seg: This refines LDIsStaleAddr using the segment containing
+ * addr (which must also be an address that was added), whose
+ * moveEpoch is the last epoch at which objects in it may have moved,
+ * or when it was created. <design/seg#.field.moveEpoch> Unlike
+ * LDIsStaleAddr, it needs the arena lock, and so ld must not be in a
+ * protected segment (see .ld.access). The caller should pass a copy.
+ *
+ * .stale.seg.gone: If there is no segment at addr, then the segment
+ * the block was in has been freed, perhaps because the block was
+ * moved out of it.
+ *
+ * .stale.seg.white: If the segment is white for a trace and belongs
+ * to a moving pool, the block may move (or may already have been
+ * forwarded) without moveEpoch changing until the segment is
+ * reclaimed.
+ *
+ * .stale.seg.epoch: Otherwise the block may have moved only if the
+ * segment was created, or stopped being white, after the dependency's
+ * epoch. A segment created after the epoch may be at the address of a
+ * segment the block has moved from.
+ */
+Bool LDIsStaleSeg(mps_ld_t ld, Arena arena, Addr addr)
+{
+  Seg seg;
+
+  AVERT(Arena, arena);
+
+  if (!LDIsStaleAddr(ld, arena, addr))
+    return FALSE;
+  if (!SegOfAddr(&seg, arena, addr))
+    return TRUE;                                      /* .stale.seg.gone */
+  if (SegWhite(seg) != TraceSetEMPTY
+      && PoolHasAttr(SegPool(seg), AttrMOVINGGC))
+    return TRUE;                                      /* .stale.seg.white */
+  return SegMoveEpoch(seg) > ld->_epoch;              /* .stale.seg.epoch */
+}
+
+
 /* LDAge -- age the arena by adding a moved set
  *
  * This stores the fact that a set of references has changed in
@@ -0,0 +1,195 @@
+/* ldtest.c: LOCATION DEPENDENCY TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Allocate objects in an AMC pool (which moves them) and an AMS pool
+ * (which doesn't), add their addresses to a location dependency, run
+ * a collection, and check the staleness of each address. Every
+ * address whose object moved must be stale, and mps_ld_stale_keys
+ * must report the addresses of AMS objects as not stale, since
+ * their segments neither moved nor were created after the dependency.
+ * <design/seg#.field.moveEpoch>
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpsavm.h"
+#include "mpscamc.h"
+#include "mpscams.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE   ((size_t)16 << 20)
+#define objCOUNT        1000
+#define objSLOTS        4
+
+
+static mps_addr_t objs[2 * objCOUNT];   /* AMC objects, then AMS */
+static mps_addr_t keys[2 * objCOUNT];   /* addresses at dependency time */
+static mps_bool_t stale[2 * objCOUNT];  /* results from mps_ld_stale_keys */
+
+
+/* check -- check the staleness of each key after a collection */
+
+static void check(mps_arena_t arena, mps_ld_t ld)
+{
+  size_t i, count, moved = 0, reported = 0;
+
+  count = mps_ld_stale_keys(ld, arena, keys, NELEMS(keys), stale);
+  for (i = 0; i < NELEMS(keys); ++i) {
+    mps_bool_t isStale = mps_ld_isstale(ld, arena, keys[i]);
+    if (keys[i] != objs[i]) {
+      /* The object moved: there must be no false negatives. */
+      Insist(stale[i]);
+      Insist(isStale);
+      ++moved;
+    }
+    if (stale[i]) {
+      /* The precise test is never less precise than the zone test. */
+      Insist(isStale);
+      ++reported;
+    }
+  }
+  Insist(count == reported);
+
+  /* AMS objects don't move and their segments are old. */
+  for (i = objCOUNT; i < NELEMS(keys); ++i)
+    Insist(!stale[i]);
+
+  printf("%lu moved, %lu reported stale\n",
+         (unsigned long)moved, (unsigned long)reported);
+  Insist(moved > 0);
+  Insist(mps_ld_isstale_any(ld, arena));
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+  mps_fmt_t fmt;
+  mps_chain_t chain;
+  mps_pool_t amc, ams;
+  mps_ap_t apAMC, apAMS;
+  mps_root_t root;
+  mps_ld_s ld;
+  mps_gen_param_s genParams[] = {{150, 0.85}, {170, 0.45}};
+  size_t i;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+  mps_arena_park(arena);
+
+  die(mps_root_create_area(&root, arena, mps_rank_exact(), 0,
+                           objs, objs + NELEMS(objs),
+                           mps_scan_area, NULL),
+      "root_create");
+  die(dylan_fmt(&fmt, arena), "fmt_create");
+  die(mps_chain_create(&chain, arena, NELEMS(genParams), genParams),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&amc, arena, mps_class_amc(), args),
+        "pool_create amc");
+  } MPS_ARGS_END(args);
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&ams, arena, mps_class_ams(), args),
+        "pool_create ams");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create_k(&apAMC, amc, mps_args_none), "ap_create amc");
+  die(mps_ap_create_k(&apAMS, ams, mps_args_none), "ap_create ams");
+
+  for (i = 0; i < objCOUNT; ++i) {
+    mps_word_t obj;
+    die(make_dylan_vector(&obj, apAMC, objSLOTS), "make_dylan_vector");
+    objs[i] = (mps_addr_t)obj;
+    die(make_dylan_vector(&obj, apAMS, objSLOTS), "make_dylan_vector");
+    objs[objCOUNT + i] = (mps_addr_t)obj;
+  }
+
+  /* Depend on the current addresses of all the objects. */
+  mps_ld_reset(&ld, arena);
+  for (i = 0; i < NELEMS(keys); ++i) {
+    keys[i] = objs[i];
+    mps_ld_add(&ld, arena, keys[i]);
+  }
+  Insist(mps_ld_stale_keys(&ld, arena, keys, NELEMS(keys), stale) == 0);
+
+  mps_arena_collect(arena);
+  check(arena, &ld);
+
+  /* After a reset, nothing is stale. */
+  mps_ld_reset(&ld, arena);
+  for (i = 0; i < NELEMS(keys); ++i) {
+    keys[i] = objs[i];
+    mps_ld_add(&ld, arena, keys[i]);
+  }
+  Insist(mps_ld_stale_keys(&ld, arena, keys, NELEMS(keys), stale) == 0);
+  Insist(!mps_ld_isstale_any(&ld, arena));
+
+  mps_arena_park(arena);
+  mps_ap_destroy(apAMS);
+  mps_ap_destroy(apAMC);
+  mps_pool_destroy(ams);
+  mps_pool_destroy(amc);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(fmt);
+  mps_root_destroy(root);
+  mps_arena_destroy(arena);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
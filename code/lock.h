@@ -68,6 +68,16 @@ extern void LockReleaseRecursive(Lock lock);
 extern void LockClaim(Lock lock);
 
 
+/*  LockClaimTry
+ *
+ *  Like LockClaim, but if the lock is owned by another thread, return
+ *  FALSE at once instead of waiting. Return TRUE with the lock owned
+ *  otherwise.
+ */
+
+extern Bool LockClaimTry(Lock lock);
+
+
 /*  LockRelease
  *
  *  This must only be used to release a Lock symmetrically
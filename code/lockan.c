@@ -58,6 +58,14 @@ void (LockClaim)(Lock lock)
   lock->claims = 1;
 }
 
+Bool (LockClaimTry)(Lock lock)
+{
+  AVERT(Lock, lock);
+  AVER(lock->claims == 0);
+  lock->claims = 1;
+  return TRUE;
+}
+
 void (LockRelease)(Lock lock)
 {
   AVERT(Lock, lock);
@@ -63,6 +63,9 @@ int main(int argc, char *argv[])
   Insist(!LockIsHeld(b));
   LockFinish(b);
   LockInit(a);
+  Insist(LockClaimTry(a));
+  Insist(LockIsHeld(a));
+  LockRelease(a);
   LockClaim(a);
   LockClaimRecursive(a);
   LockReleaseGlobalRecursive();
@@ -132,6 +132,25 @@ void (LockClaim)(Lock lock)
 }
 
 
+/* LockClaimTry -- claim a lock (non-recursive) if it's not owned */
+
+Bool (LockClaimTry)(Lock lock)
+{
+  int res;
+
+  AVERT(Lock, lock);
+
+  res = pthread_mutex_trylock(&lock->mut);
+  if (res == EBUSY)
+    return FALSE;
+  AVER(res == 0); /* <design/check/#.common> */
+
+  AVER(lock->claims == 0);
+  lock->claims = 1;
+  return TRUE;
+}
+
+
 /* LockRelease -- release a lock (non-recursive) */
 
 void (LockRelease)(Lock lock)
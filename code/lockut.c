@@ -1,12 +1,13 @@
 /* lockut.c: LOCK UTILIZATION TEST
  *
  * $Id$
- * Copyright (c) 2001-2014 Ravenbrook Limited.  See end of file for license.
+ * Copyright (c) 2001-2018 Ravenbrook Limited.  See end of file for license.
  */
 
 #include "mps.h"
 #include "mpsavm.h"
 #include "mpscmfs.h"
+#include "mpscmvff.h"
 #include "mpm.h"
 #include "testlib.h"
 #include "testthr.h"
@@ -18,6 +19,7 @@
 
 static Lock lock;
 static unsigned long shared, tmp;
+static mps_pool_t mfs, mvff;  /* allocated from without the arena lock */
 
 
 static void incR(unsigned long i)
@@ -41,7 +43,9 @@ static void inc(unsigned long i)
   incR( (i+1) >>1);
   i >>= 1;
   while (i) {
-    LockClaim(lock);
+    /* On odd iterations, try first, so that contention is exercised. */
+    if (i % 2 == 0 || !LockClaimTry(lock))
+      LockClaim(lock);
     if (i > 10000) {
       incR(5000);
       i -= 5000;
@@ -54,6 +58,40 @@ static void inc(unsigned long i)
 }
 
 
+/* churn -- allocate and free blocks in pools that can do so holding
+ * only the pool lock, and check that no block is handed out twice.
+ */
+
+#define churnBLOCKS 64
+#define churnROUNDS 200
+
+static void churn(mps_word_t id)
+{
+  mps_word_t *blocks[2 * churnBLOCKS];
+  size_t i, round;
+
+  for (round = 0; round < churnROUNDS; ++round) {
+    for (i = 0; i < churnBLOCKS; ++i) {
+      mps_addr_t b;
+      die(mps_alloc(&b, mfs, sizeof(mps_word_t)), "alloc mfs");
+      blocks[i] = b;
+      die(mps_alloc(&b, mvff, sizeof(mps_word_t) * (1 + i % 4)),
+          "alloc mvff");
+      blocks[churnBLOCKS + i] = b;
+    }
+    for (i = 0; i < NELEMS(blocks); ++i)
+      *blocks[i] = id + i;
+    for (i = 0; i < NELEMS(blocks); ++i)
+      Insist(*blocks[i] == id + i);
+    for (i = 0; i < churnBLOCKS; ++i) {
+      mps_free(mfs, blocks[i], sizeof(mps_word_t));
+      mps_free(mvff, blocks[churnBLOCKS + i],
+               sizeof(mps_word_t) * (1 + i % 4));
+    }
+  }
+}
+
+
 #define COUNT 100000l
 static void *thread0(void *p)
 {
@@ -66,6 +104,7 @@ static void *thread0(void *p)
   for (i = 0; i < COUNT; ++i)
     LockReleaseGlobalRecursive();
   inc(COUNT);
+  churn((mps_word_t)p);
   return NULL;
 }
 
@@ -87,6 +126,17 @@ int main(int argc, char *argv[])
     die(mps_pool_create_k(&pool, arena, mps_class_mfs(), args), "pool_create");
   } MPS_ARGS_END(args);
 
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE, sizeof(mps_word_t));
+    die(mps_pool_create_k(&mfs, arena, mps_class_mfs(), args),
+        "pool_create mfs");
+  } MPS_ARGS_END(args);
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_SIZE_CLASSES, TRUE);
+    die(mps_pool_create_k(&mvff, arena, mps_class_mvff(), args),
+        "pool_create mvff");
+  } MPS_ARGS_END(args);
+
   die(mps_alloc(&p, pool, LockSize()), "alloc");
   lock = p;
   Insist(lock != NULL);
@@ -97,7 +147,7 @@ int main(int argc, char *argv[])
   shared = 0;
 
   for(i = 0; i < nTHREADS; i++)
-    testthr_create(&t[i], thread0, NULL);
+    testthr_create(&t[i], thread0, (void *)((mps_word_t)i << 16));
 
   for(i = 0; i < nTHREADS; i++)
     testthr_join(&t[i], NULL);
@@ -107,6 +157,8 @@ int main(int argc, char *argv[])
   LockFinish(lock);
 
   mps_free(pool, lock, LockSize());
+  mps_pool_destroy(mvff);
+  mps_pool_destroy(mfs);
   mps_pool_destroy(pool);
   mps_arena_destroy(arena);
 
@@ -117,7 +169,7 @@ int main(int argc, char *argv[])
 
 /* C. COPYRIGHT AND LICENSE
  *
- * Copyright (c) 2001-2014 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * Copyright (c) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
  * All rights reserved.  This is an open source license.  Contact
  * Ravenbrook for commercial licensing options.
  * 
@@ -80,6 +80,16 @@ void (LockClaim)(Lock lock)
   lock->claims = 1;
 }
 
+Bool (LockClaimTry)(Lock lock)
+{
+  AVERT(Lock, lock);
+  if (!TryEnterCriticalSection(&lock->cs))
+    return FALSE;
+  AVER(lock->claims == 0); /* <design/check/#.common> */
+  lock->claims = 1;
+  return TRUE;
+}
+
 void (LockRelease)(Lock lock)
 {
   AVERT(Lock, lock);
@@ -27,6 +27,7 @@ Bool LocusPrefCheck(LocusPref pref)
   CHECKL(BoolCheck(pref->high));
   /* zones can't be checked because it's arbitrary. */
   /* avoid can't be checked because it's arbitrary. */
+  /* node can't be checked because nodes needn't exist. */
   return TRUE;
 }
 
@@ -71,6 +72,11 @@ void LocusPrefExpress(LocusPref pref, LocusPrefKind kind, void *p)
     pref->zones = *(ZoneSet *)p;
     break;
 
+  case LocusPrefNODE:
+    AVER(p != NULL);
+    pref->node = *(Index *)p;
+    break;
+
   default:
     /* Unknown kinds are ignored for binary compatibility. */
     break;
@@ -94,6 +100,7 @@ Res LocusPrefDescribe(LocusPref pref, mps_lib_FILE *stream, Count depth)
                "  high $S\n", WriteFYesNo(pref->high),
                "  zones $B\n", (WriteFB)pref->zones,
                "  avoid $B\n", (WriteFB)pref->avoid,
+               "  node $W\n", (WriteFW)pref->node,
                "} LocusPref $P\n", (WriteFP)pref,
                NULL);
   return res;
@@ -110,6 +117,7 @@ Bool GenDescCheck(GenDesc gen)
   CHECKL(gen->capacity > 0);
   CHECKL(gen->mortality >= 0.0);
   CHECKL(gen->mortality <= 1.0);
+  CHECKL(gen->collectRate >= 0.0);
   CHECKD_NOSIG(Ring, &gen->locusRing);
   CHECKD_NOSIG(Ring, &gen->segRing);
   return TRUE;
@@ -145,6 +153,7 @@ static void GenDescInit(Arena arena, GenDesc gen, GenParamStruct *params)
   gen->zones = ZoneSetEMPTY;
   gen->capacity = params->capacity * 1024;
   gen->mortality = params->mortality;
+  gen->collectRate = 0.0;
   RingInit(&gen->locusRing);
   RingInit(&gen->segRing);
   gen->activeTraces = TraceSetEMPTY;
@@ -274,6 +283,26 @@ void GenDescSurvived(GenDesc gen, Trace trace, Size forwarded,
 }
 
 
+/* GenDescSweepDeferred -- condemned memory will be swept lazily
+ *
+ * The survivors in memory whose sweep is deferred are not known when
+ * the trace ends, so the memory is excluded from the trace's measure
+ * of the generation's mortality. <design/seg#.method.lazy-sweep>.
+ */
+
+void GenDescSweepDeferred(GenDesc gen, Trace trace, Size size)
+{
+  GenTrace genTrace;
+
+  AVERT(GenDesc, gen);
+  AVERT(Trace, trace);
+
+  genTrace = &gen->trace[trace->ti];
+  AVER(genTrace->condemned >= size);
+  genTrace->condemned -= size;
+}
+
+
 /* GenDescTotalSize -- return total size of generation */
 
 Size GenDescTotalSize(GenDesc gen)
@@ -310,6 +339,7 @@ Res GenDescDescribe(GenDesc gen, mps_lib_FILE *stream, Count depth)
                "  zones $B\n", (WriteFB)gen->zones,
                "  capacity $U\n", (WriteFW)gen->capacity,
                "  mortality $D\n", (WriteFD)gen->mortality,
+               "  collectRate $D\n", (WriteFD)gen->collectRate,
                "  activeTraces $B\n", (WriteFB)gen->activeTraces,
                NULL);
   if (res != ResOK)
@@ -459,9 +489,13 @@ GenDesc ChainGen(Chain chain, Index gen)
 }
 
 
-/* ChainDeferral -- time until next ephemeral GC for this chain */
+/* ChainDeferral -- time until next ephemeral GC for this chain
+ *
+ * lead is the amount of allocation by which to bring forward a
+ * collection of generation 0.  See <design/strategy#.policy.pacing>.
+ */
 
-double ChainDeferral(Chain chain)
+double ChainDeferral(Chain chain, double lead)
 {
   double time = DBL_MAX;
   size_t i;
@@ -474,6 +508,8 @@ double ChainDeferral(Chain chain)
     if (gen->activeTraces != TraceSetEMPTY)
       return DBL_MAX;
     genTime = (double)gen->capacity - (double)GenDescNewSize(&chain->gens[i]);
+    if (i == 0)
+      genTime -= lead;
     if (genTime < time)
       time = genTime;
   }
@@ -482,6 +518,31 @@ double ChainDeferral(Chain chain)
 }
 
 
+/* ChainNurseryDeferral -- time until next nursery GC for a busy chain
+ *
+ * Returns DBL_MAX unless the chain is being collected by traces which
+ * have all condemned older generations too (so that no nursery trace
+ * is already running on the chain). Otherwise, returns the time until
+ * the new part of generation 0 reaches its capacity. See
+ * <code/policy.c#nursery>.
+ */
+
+double ChainNurseryDeferral(Chain chain)
+{
+  GenDesc gen;
+
+  AVERT(Chain, chain);
+
+  if (chain->genCount < 2)
+    return DBL_MAX;
+  gen = &chain->gens[0];
+  if (gen->activeTraces == TraceSetEMPTY
+      || !TraceSetSub(gen->activeTraces, chain->gens[1].activeTraces))
+    return DBL_MAX;
+  return (double)gen->capacity - (double)GenDescNewSize(gen);
+}
+
+
 /* ChainDescribe -- describe a chain */
 
 Res ChainDescribe(Chain chain, mps_lib_FILE *stream, Count depth)
@@ -594,10 +655,12 @@ static void PoolGenAccountForAlloc(PoolGen pgen, Size size)
  *
  * Allocate a segment belong to klass (which must be GCSegClass or a
  * subclass), attach it to the generation, and update the accounting.
+ * The segment is preferably allocated from memory on NUMA node node,
+ * unless this is NodeNONE. <design/arena#.numa.pref>.
  */
 
 Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass, Size size,
-                 ArgList args)
+                 Index node, ArgList args)
 {
   LocusPrefStruct pref;
   Res res;
@@ -621,6 +684,7 @@ Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass, Size size,
   pref.high = FALSE;
   pref.zones = zones;
   pref.avoid = ZoneSetBlacklist(arena);
+  pref.node = node;
   res = SegAlloc(&seg, klass, &pref, size, pgen->pool, args);
   if (res != ResOK)
     return res;
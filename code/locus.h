@@ -46,6 +46,7 @@ typedef struct GenDescStruct {
   ZoneSet zones;        /* zoneset for this generation */
   Size capacity;        /* capacity in bytes */
   double mortality;     /* moving average mortality */
+  double collectRate;   /* moving average bytes condemned per second */
   RingStruct locusRing; /* Ring of all PoolGen's in this GenDesc (locus) */
   RingStruct segRing;   /* Ring of GCSegs in this generation */
   TraceSet activeTraces; /* set of traces collecting this generation */
@@ -96,6 +97,7 @@ extern void GenDescStartTrace(GenDesc gen, Trace trace);
 extern void GenDescEndTrace(GenDesc gen, Trace trace);
 extern void GenDescCondemned(GenDesc gen, Trace trace, Size size);
 extern void GenDescSurvived(GenDesc gen, Trace trace, Size forwarded, Size preservedInPlace);
+extern void GenDescSweepDeferred(GenDesc gen, Trace trace, Size size);
 extern Res GenDescDescribe(GenDesc gen, mps_lib_FILE *stream, Count depth);
 #define GenDescOfTraceRing(node, trace) PARENT(GenDescStruct, trace[trace->ti], RING_ELT(GenTrace, traceRing, node))
 
@@ -104,7 +106,8 @@ extern Res ChainCreate(Chain *chainReturn, Arena arena, size_t genCount,
 extern void ChainDestroy(Chain chain);
 extern Bool ChainCheck(Chain chain);
 
-extern double ChainDeferral(Chain chain);
+extern double ChainDeferral(Chain chain, double lead);
+extern double ChainNurseryDeferral(Chain chain);
 extern size_t ChainGens(Chain chain);
 extern GenDesc ChainGen(Chain chain, Index gen);
 extern Res ChainDescribe(Chain chain, mps_lib_FILE *stream, Count depth);
@@ -113,7 +116,7 @@ extern Bool PoolGenCheck(PoolGen pgen);
 extern Res PoolGenInit(PoolGen pgen, GenDesc gen, Pool pool);
 extern void PoolGenFinish(PoolGen pgen);
 extern Res PoolGenAlloc(Seg *segReturn, PoolGen pgen, SegClass klass,
-                        Size size, ArgList args);
+                        Size size, Index node, ArgList args);
 extern void PoolGenFree(PoolGen pgen, Seg seg, Size freeSize, Size oldSize,
                         Size newSize, Bool deferred);
 extern void PoolGenAccountForFill(PoolGen pgen, Size size);
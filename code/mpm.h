@@ -231,6 +231,8 @@ extern void PoolDestroy(Pool pool);
 extern BufferClass PoolDefaultBufferClass(Pool pool);
 extern Res PoolAlloc(Addr *pReturn, Pool pool, Size size);
 extern void (PoolFree)(Pool pool, Addr old, Size size);
+extern Bool PoolTryAlloc(Addr *pReturn, Pool pool, Size size);
+extern Bool PoolTryFree(Pool pool, Addr old, Size size);
 extern PoolGen PoolSegPoolGen(Pool pool, Seg seg);
 extern Res PoolTraceBegin(Pool pool, Trace trace);
 extern void PoolFreeWalk(Pool pool, FreeBlockVisitor f, void *p);
@@ -243,6 +245,8 @@ extern Res PoolNoAlloc(Addr *pReturn, Pool pool, Size size);
 extern Res PoolTrivAlloc(Addr *pReturn, Pool pool, Size size);
 extern void PoolNoFree(Pool pool, Addr old, Size size);
 extern void PoolTrivFree(Pool pool, Addr old, Size size);
+extern Bool PoolNoTryAlloc(Addr *pReturn, Pool pool, Size size);
+extern Bool PoolNoTryFree(Pool pool, Addr old, Size size);
 extern PoolGen PoolNoSegPoolGen(Pool pool, Seg seg);
 extern Res PoolNoBufferFill(Addr *baseReturn, Addr *limitReturn,
                             Pool pool, Buffer buffer, Size size);
@@ -274,6 +278,13 @@ extern Size PoolNoSize(Pool pool);
 #define PoolFree(pool, old, size) PoolFreeMacro(pool, old, size)
 #endif /* !defined(AVER_AND_CHECK_ALL) */
 
+/* PoolLockClaim, PoolLockRelease -- claim and release the pool lock,
+ * if the pool has one. <design/pool#.lock> */
+#define PoolLockClaim(pool) \
+  BEGIN if ((pool)->lock != NULL) LockClaim((pool)->lock); END
+#define PoolLockRelease(pool) \
+  BEGIN if ((pool)->lock != NULL) LockRelease((pool)->lock); END
+
 /* Abstract Pool Classes Interface -- see <code/poolabs.c> */
 extern void PoolClassMixInBuffer(PoolClass klass);
 extern void PoolClassMixInCollect(PoolClass klass);
@@ -378,11 +389,13 @@ extern Res TraceStart(Trace trace, double mortality, double finishingTime);
 extern Bool TracePoll(Work *workReturn, Bool *collectWorldReturn,
                       Globals globals, Bool collectWorldAllowed);
 
-extern Rank TraceRankForAccess(Arena arena, Seg seg);
+extern Rank TraceRankForAccess(Trace trace, Seg seg);
 extern void TraceSegAccess(Arena arena, Seg seg, AccessSet mode);
 
 extern void TraceAdvance(Trace trace);
 extern Res TraceStartCollectAll(Trace *traceReturn, Arena arena, TraceStartWhy why);
+extern Res TraceParCreate(Arena arena);
+extern void TraceParDestroy(Arena arena);
 extern Res TraceDescribe(Trace trace, mps_lib_FILE *stream, Count depth);
 
 /* traceanc.c -- Trace Ancillary */
@@ -507,6 +520,8 @@ extern void ArenaEnterLock(Arena arena, Bool recursive);
 extern void ArenaLeaveLock(Arena arena, Bool recursive);
 
 extern void ArenaEnter(Arena arena);
+extern Bool ArenaEnterTry(Arena arena);
+extern Bool ArenaEnterContended(Arena arena);
 extern void ArenaLeave(Arena arena);
 extern void (ArenaPoll)(Globals globals);
 
@@ -521,9 +536,11 @@ extern void ArenaEnterRecursive(Arena arena);
 extern void ArenaLeaveRecursive(Arena arena);
 
 extern Bool (ArenaStep)(Globals globals, double interval, double multiplier);
+extern void ArenaBackgroundStep(Arena arena);
 extern void ArenaClamp(Globals globals);
 extern void ArenaRelease(Globals globals);
 extern void ArenaPark(Globals globals);
+extern Bool ArenaLazySweep(Arena arena, Bool all);
 extern void ArenaPostmortem(Globals globals);
 extern void ArenaExposeRemember(Globals globals, Bool remember);
 extern void ArenaRestoreProtection(Globals globals);
@@ -583,6 +600,14 @@ extern Size ArenaCommitLimit(Arena arena);
 extern Res ArenaSetCommitLimit(Arena arena, Size limit);
 extern double ArenaPauseTime(Arena arena);
 extern void ArenaSetPauseTime(Arena arena, double pauseTime);
+extern Bool PauseKindCheck(PauseKind kind);
+extern void ArenaNotePause(Arena arena, PauseKind kind,
+                           Clock start, Clock end);
+extern void ArenaPauseStats(Count *countReturn, double *totalReturn,
+                            double *maxReturn, Arena arena, PauseKind kind);
+extern double ArenaPauseQuantile(Arena arena, PauseKind kind, double q);
+extern void ArenaPauseStatsReset(Arena arena);
+extern void ArenaPauseStatsEmit(Arena arena);
 extern Size ArenaNoPurgeSpare(Arena arena, Size size);
 extern Res ArenaNoGrow(Arena arena, LocusPref pref, Size size);
 
@@ -600,6 +625,8 @@ extern Res ArenaAlloc(Addr *baseReturn, LocusPref pref,
                       Size size, Pool pool);
 extern Res ArenaFreeLandAlloc(Tract *tractReturn, Arena arena, ZoneSet zones,
                               Bool high, Size size, Pool pool);
+extern Res ArenaNodeAlloc(Tract *tractReturn, Arena arena, Index node,
+                          ZoneSet zones, Bool high, Size size, Pool pool);
 extern void ArenaFree(Addr base, Size size, Pool pool);
 
 extern Res ArenaNoExtend(Arena arena, Addr base, Size size);
@@ -615,6 +642,7 @@ extern Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
                              Arena arena, Bool collectWorldAllowed);
 extern Bool PolicyPoll(Arena arena);
 extern Bool PolicyPollAgain(Arena arena, Clock start, Bool moreWork, Work tracedWork);
+extern void PolicyTraceEnd(Trace trace, Work tracedWork);
 
 
 /* Locus interface */
@@ -660,6 +688,10 @@ extern Res SegScan(Bool *totalReturn, Seg seg, ScanState ss);
 extern Res SegFix(Seg seg, ScanState ss, Addr *refIO);
 extern Res SegFixEmergency(Seg seg, ScanState ss, Addr *refIO);
 extern void SegReclaim(Seg seg, Trace trace);
+extern void SegDeferSweep(Seg seg);
+extern void SegUndeferSweep(Seg seg);
+extern Bool SegSweepIsDeferred(Seg seg);
+extern void SegLazySweep(Seg seg, Bool mayFree);
 extern void SegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
                     void *v, size_t s);
 extern Res SegAbsDescribe(Inst seg, mps_lib_FILE *stream, Count depth);
@@ -698,6 +730,7 @@ extern Addr (SegLimit)(Seg seg);
 #define SegGrey(seg)            RVALUE((TraceSet)(seg)->grey)
 #define SegWhite(seg)           RVALUE((TraceSet)(seg)->white)
 #define SegNailed(seg)          RVALUE((TraceSet)(seg)->nailed)
+#define SegMoveEpoch(seg)       RVALUE((seg)->moveEpoch)
 #define SegPoolRing(seg)        (&(seg)->poolRing)
 #define SegOfPoolRing(node)     RING_ELT(Seg, poolRing, (node))
 #define SegOfGreyRing(node)     (&(RING_ELT(GCSeg, greyRing, (node)) \
@@ -732,6 +765,7 @@ extern Res BufferReserve(Addr *pReturn, Buffer buffer, Size size);
    BufferFill(pReturn, buffer, size))
 
 extern Res BufferFill(Addr *pReturn, Buffer buffer, Size size);
+extern void BufferNoteLock(Buffer buffer, Bool contended);
 
 extern Bool BufferCommit(Buffer buffer, Addr p, Size size);
 /* macro equivalent for BufferCommit, keep in sync with <code/buffer.c> */
@@ -770,6 +804,8 @@ extern void BufferSetRankSet(Buffer buffer, RankSet rankset);
   ((Addr)(BufferAP(buffer)->init))
 #define BufferAlloc(buffer)     ((Addr)(BufferAP(buffer)->alloc))
 #define BufferLimit(buffer)     ((buffer)->poolLimit)
+#define BufferNode(buffer)      ((buffer)->node)
+#define BufferFillScale(buffer) ((buffer)->fillScale)
 extern Addr BufferScanLimit(Buffer buffer);
 
 extern void BufferReassignSeg(Buffer buffer, Seg seg);
@@ -913,6 +949,8 @@ extern void LDReset(mps_ld_t ld, Arena arena);
 extern void LDAdd(mps_ld_t ld, Arena arena, Addr addr);
 extern Bool LDIsStaleAny(mps_ld_t ld, Arena arena);
 extern Bool LDIsStale(mps_ld_t ld, Arena arena, Addr addr);
+extern Bool LDIsStaleAddr(mps_ld_t ld, Arena arena, Addr addr);
+extern Bool LDIsStaleSeg(mps_ld_t ld, Arena arena, Addr addr);
 extern void LDAge(Arena arena, RefSet moved);
 extern void LDMerge(mps_ld_t ld, Arena arena, mps_ld_t from);
 
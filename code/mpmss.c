@@ -163,6 +163,7 @@ static void testInArena(mps_arena_class_t arena_class, size_t arena_grain_size,
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_ARENA_HIGH, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_SLOT_HIGH, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_FIRST_FIT, TRUE);
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_SIZE_CLASSES, rnd() % 2);
     MPS_ARGS_ADD(args, MPS_KEY_SPARE, rnd_double());
     die(stress(arena, NULL, randomSizeAligned, align, "MVFF",
                mps_class_mvff(), args), "stress MVFF");
@@ -174,6 +175,7 @@ static void testInArena(mps_arena_class_t arena_class, size_t arena_grain_size,
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_ARENA_HIGH, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_SLOT_HIGH, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_FIRST_FIT, TRUE);
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_SIZE_CLASSES, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_SPARE, rnd_double());
     MPS_ARGS_ADD(args, MPS_KEY_POOL_DEBUG_OPTIONS, options);
     die(stress(arena, options, randomSizeAligned, align, "MVFF debug",
@@ -56,6 +56,8 @@ typedef struct mps_pool_class_s {
   PoolInitMethod init;          /* initialize the pool descriptor */
   PoolAllocMethod alloc;        /* allocate memory from pool */
   PoolFreeMethod free;          /* free memory to pool */
+  PoolTryAllocMethod tryAlloc;  /* allocate without the arena lock */
+  PoolTryFreeMethod tryFree;    /* free without the arena lock */
   PoolSegPoolGenMethod segPoolGen; /* get pool generation of segment */
   PoolBufferFillMethod bufferFill;      /* out-of-line reserve */
   PoolBufferEmptyMethod bufferEmpty;    /* out-of-line commit */
@@ -96,6 +98,10 @@ typedef struct mps_pool_s {     /* generic structure */
   Align alignment;              /* alignment for grains */
   Shift alignShift;             /* log2(alignment) */
   Format format;                /* format or NULL */
+  SACThreads sacThreads;        /* per-thread caches or NULL */
+  Bool wantLock;                /* create lock? <design/pool#.lock> */
+  Lock lock;                    /* <design/pool#.lock> or NULL */
+  Size fastFillSize;            /* <design/pool#.lock.clock> */
 } PoolStruct;
 
 
@@ -206,7 +212,9 @@ typedef struct SegClassStruct {
   SegScanMethod scan;           /* find references during tracing */
   SegFixMethod fix;             /* referent reachable during tracing */
   SegFixMethod fixEmergency;    /* as fix, no failure allowed */
+  SegSweepMethod sweep;         /* prepare to reclaim, in parallel */
   SegReclaimMethod reclaim;     /* reclaim dead objects after tracing */
+  SegLazySweepMethod lazySweep; /* finish a deferred sweep */
   SegWalkMethod walk;           /* walk over a segment */
   Sig sig;                      /* .class.end-sig */
 } SegClassStruct;
@@ -234,6 +242,7 @@ typedef struct SegStruct {      /* segment structure */
   TraceSet nailed : TraceLIMIT; /* traces for which seg has nailed objects */
   RankSet rankSet : RankLIMIT;  /* ranks of references in this seg */
   unsigned defer : WB_DEFER_BITS; /* defer write barrier for this many scans */
+  Epoch moveEpoch;              /* <design/seg#.field.moveEpoch> */
 } SegStruct;
 
 
@@ -250,6 +259,7 @@ typedef struct GCSegStruct {    /* GC segment structure */
   RefSet summary;               /* summary of references out of seg */
   Buffer buffer;                /* non-NULL if seg is buffered */
   RingStruct genRing;           /* link in list of segs in gen */
+  RingStruct sweepRing;         /* link in list of segs to sweep lazily */
   Sig sig;                      /* <design/sig> */
 } GCSegStruct;
 
@@ -268,6 +278,7 @@ typedef struct LocusPrefStruct { /* locus placement preferences */
   Bool high;                    /* high or low */
   ZoneSet zones;                /* preferred zones */
   ZoneSet avoid;                /* zones to avoid */
+  Index node;                   /* preferred NUMA node, or NodeNONE */
 } LocusPrefStruct;
 
 
@@ -325,6 +336,12 @@ typedef struct BufferStruct {
   Addr poolLimit;               /* the pool's idea of the limit */
   Align alignment;              /* allocation alignment */
   unsigned rampCount;           /* see <code/buffer.c#ramp.hack> */
+  Index node;                   /* preferred NUMA node, or NodeNONE */
+  Count fillScale;              /* <design/buffer#.fill.scale> */
+  Count fillScaleMax;           /* maximum fillScale */
+  Count quietLocks;             /* uncontended claims since last change */
+  Count lockCount;              /* arena lock claims for this buffer */
+  Count contendedCount;         /* claims that found the lock held */
 } BufferStruct;
 
 
@@ -408,6 +425,7 @@ typedef struct ScanStateStruct {
   Rank rank;                    /* reference rank of scanning */
   Bool wasMarked;               /* <design/fix#.protocol.was-ready> */
   RefSet fixedSummary;          /* accumulated summary of fixed references */
+  Lock fixLock;                 /* claimed by traceParFix, or NULL; see .par */
   STATISTIC_DECL(Count fixRefCount) /* refs which pass zone check */
   STATISTIC_DECL(Count segRefCount) /* refs which refer to segs */
   STATISTIC_DECL(Count whiteSegRefCount) /* refs which refer to white segs */
@@ -415,11 +433,26 @@ typedef struct ScanStateStruct {
   STATISTIC_DECL(Count snapCount) /* refs snapped to forwarded objs */
   STATISTIC_DECL(Count forwardedCount) /* objects preserved by moving */
   STATISTIC_DECL(Count preservedInPlaceCount) /* objects preserved in place */
+  STATISTIC_DECL(Count lockedFixCount) /* fixes under the fix lock */
+  STATISTIC_DECL(Count contendedFixCount) /* of those, found it held */
   STATISTIC_DECL(Size copiedSize) /* bytes copied */
   Size scannedSize;             /* bytes scanned */
 } ScanStateStruct;
 
 
+/* ScanJobStruct -- a segment to be scanned in a parallel batch
+ *
+ * See <code/trace.c#par>.
+ */
+
+typedef struct ScanJobStruct {
+  Seg seg;                      /* segment to scan */
+  ScanStateStruct ssStruct;     /* scan state for this segment */
+  Bool wasTotal;                /* was the whole segment scanned? */
+  Res res;                      /* result of scanning the segment */
+} ScanJobStruct;
+
+
 /* TraceStruct -- tracer state structure */
 
 #define TraceSig ((Sig)0x51924ACE) /* SIGnature TRACE */
@@ -442,6 +475,7 @@ typedef struct TraceStruct {
   Size notCondemned;            /* collectable but not condemned */
   Size foundation;              /* initial grey set size */
   Work quantumWork;             /* tracing work to be done in each poll */
+  Clock clocks;                 /* time spent flipping and advancing */
   STATISTIC_DECL(Count greySegCount) /* number of grey segments */
   STATISTIC_DECL(Count greySegMax) /* maximum number of grey segments */
   STATISTIC_DECL(Count rootScanCount) /* number of roots scanned */
@@ -464,6 +498,9 @@ typedef struct TraceStruct {
   Size forwardedSize;           /* bytes preserved by moving */
   STATISTIC_DECL(Count preservedInPlaceCount) /* objects preserved in place */
   Size preservedInPlaceSize;    /* bytes preserved in place */
+  STATISTIC_DECL(Count parScanCount) /* segments scanned in batches */
+  STATISTIC_DECL(Count lockedFixCount) /* fixes under the fix lock */
+  STATISTIC_DECL(Count contendedFixCount) /* of those, found it held */
   STATISTIC_DECL(Count reclaimCount) /* segments reclaimed */
   STATISTIC_DECL(Count reclaimSize) /* bytes reclaimed */
 } TraceStruct;
@@ -611,6 +648,41 @@ typedef struct CBSStruct {
 } CBSStruct;
 
 
+/* AVLStruct -- balanced tree land
+ *
+ * AVL is a Land implementation that maintains a collection of
+ * disjoint ranges in an AVL tree. Unlike the CBS, searching the tree
+ * does not modify it.
+ *
+ * See <code/avl.c>.
+ */
+
+#define AVLSig ((Sig)0x519A7B1A) /* SIGnature AVL BaLAnced */
+
+typedef struct AVLStruct {
+  LandStruct landStruct;        /* superclass fields come first */
+  struct AVLBlockStruct *root;  /* root of tree, or NULL if empty */
+  Count treeSize;               /* number of blocks in tree */
+  Pool blockPool;               /* pool that manages blocks */
+  Bool ownPool;                 /* did we create blockPool? */
+  Size size;                    /* total size of ranges in tree */
+  Sig sig;                      /* .class.end-sig */
+} AVLStruct;
+
+
+/* FreeLandStruct -- land for free memory
+ *
+ * The arena and MVFF pools keep their free memory in CBSs, or in AVL
+ * trees if the MPS was built with CONFIG_LAND_AVL <code/config.h>.
+ */
+
+#if defined(LAND_AVL)
+typedef AVLStruct FreeLandStruct;
+#else
+typedef CBSStruct FreeLandStruct;
+#endif
+
+
 /* FailoverStruct -- fail over from one land to another
  *
  * Failover is a Land implementation that combines two other Lands,
@@ -683,6 +755,7 @@ typedef struct ShieldStruct {
   Count depth;       /* sum of depths of all segs */
   Count unsynced;    /* number of unsynced segments */
   Count holds;       /* number of holds */
+  Clock suspendClock; /* when mutator was suspended */
   SortStruct sortStruct; /* workspace for queue sort */
 } ShieldStruct;
 
@@ -720,17 +793,33 @@ typedef struct MVFFStruct {     /* MVFF pool outer structure */
   Size extendBy;                /* size to extend pool by */
   Size avgSize;                 /* client estimate of allocation size */
   double spare;                 /* spare space fraction, see MVFFReduce */
-  MFSStruct cbsBlockPoolStruct; /* stores blocks for CBSs */
-  CBSStruct totalCBSStruct;     /* all memory allocated from the arena */
-  CBSStruct freeCBSStruct;      /* free memory (primary) */
+  MFSStruct cbsBlockPoolStruct; /* stores blocks for the lands */
+  FreeLandStruct totalLandStruct; /* all memory allocated from the arena */
+  FreeLandStruct freeLandStruct; /* free memory (primary) */
   FreelistStruct flStruct;      /* free memory (secondary, for emergencies) */
   FailoverStruct foStruct;      /* free memory (fail-over mechanism) */
   Bool firstFit;                /* as opposed to last fit */
   Bool slotHigh;                /* prefers high part of large block */
+  Bool sizeClasses;             /* keep small free blocks in size classes */
+  Size sizeClassFree;           /* total size of blocks in size classes */
+  Addr sizeClass[MVFF_SIZE_CLASS_COUNT]; /* free lists of small blocks */
   Sig sig;                      /* <design/sig> */
 } MVFFStruct;
 
 
+/* PauseHistStruct -- histogram of pause durations
+ *
+ * See <design/arena#.pause.hist>.
+ */
+
+typedef struct PauseHistStruct {
+  Count count;                  /* number of pauses */
+  double total;                 /* total duration, in clock ticks */
+  Clock max;                    /* longest pause, in clock ticks */
+  Count bucket[PauseHistBUCKETS]; /* number of pauses of each length */
+} PauseHistStruct;
+
+
 /* ArenaStruct -- generic arena
  *
  * See <code/arena.c>.
@@ -754,6 +843,8 @@ typedef struct mps_arena_s {
   Size spareCommitted;          /* amount of memory in hysteresis fund */
   double spare;                 /* maximum spareCommitted/committed */
   double pauseTime;             /* maximum pause time, in seconds */
+  Bool adaptivePacing;          /* <design/strategy#.policy.pacing> */
+  PauseHistStruct pauseHist[PauseKindLIMIT]; /* <design/arena#.pause.hist> */
 
   Shift zoneShift;              /* see also <code/ref.c> */
   Size grainSize;               /* <design/arena#.grain> */
@@ -764,14 +855,25 @@ typedef struct mps_arena_s {
   Chunk primary;                /* the primary chunk */
   RingStruct chunkRing;         /* all the chunks, in a ring for iteration */
   Tree chunkTree;               /* all the chunks, in a tree for fast lookup */
+  Chunk chunkCache[ChunkCacheLENGTH]; /* <design/arena#.chunk.cache> */
   Serial chunkSerial;           /* next chunk number */
 
   Bool hasFreeLand;              /* Is freeLand available? */
   MFSStruct freeCBSBlockPoolStruct;
-  CBSStruct freeLandStruct;
+  FreeLandStruct freeLandStruct;
   ZoneSet freeZones;            /* zones not yet allocated */
   Bool zoned;                   /* use zoned allocation? */
 
+  /* free cache fields <design/arena#.free.cache> */
+  ZoneSet freeCacheZones[FreeCacheGRAINS]; /* zones with runs of each length */
+  Index freeCacheHead[FreeCacheGRAINS][MPS_WORD_WIDTH]; /* list heads */
+  Addr freeCacheBase[FreeCacheENTRIES]; /* base of each cached run */
+  Index freeCacheNext[FreeCacheENTRIES]; /* next entry in list */
+  Index freeCacheUnused;        /* first unused entry */
+  Count freeCacheCount;         /* number of cached runs */
+  Addr freeCacheLow;            /* no cached run below here */
+  Addr freeCacheHigh;           /* no cached run above here */
+
   /* locus fields <code/locus.c> */
   GenDescStruct topGen;         /* generation descriptor for dynamic gen */
   Serial genSerial;             /* serial of next generation */
@@ -806,12 +908,29 @@ typedef struct mps_arena_s {
   TraceStartMessage tsMessage[TraceLIMIT];  /* <design/message-gc> */
   TraceMessage tMessage[TraceLIMIT];  /* <design/message-gc> */
 
+  /* parallel scanning fields <code/trace.c#par> */
+  Count gcThreads;              /* number of threads scanning in parallel */
+  Par par;                      /* worker threads, or NULL if serial */
+  Lock fixLock;                 /* serializes fixing in parallel scans */
+  ScanJob scanJob;              /* array of TraceParBATCH scan jobs */
+
+  /* background collection fields <design/strategy#.policy.background> */
+  Bool background;              /* collect on a background thread? */
+  Bg bg;                        /* background thread, or NULL */
+  double backgroundFill;        /* fillMutatorSize at last wake */
+
   /* policy fields */
   double tracedWork;
   double tracedTime;
   Clock lastWorldCollect;
+  double allocRate;             /* mutator bytes per second, or zero */
+  double scanRate;              /* work per second of tracing, or zero */
+  Clock pollClock;              /* end of last poll */
+  Clock rateClocks;             /* mutator time since rate measured */
+  double rateAlloc;             /* fillMutatorSize when rate measured */
 
   RingStruct greyRing[RankLIMIT]; /* ring of grey segments at each rank */
+  RingStruct sweepRing;         /* segments whose sweep is deferred */
   RingStruct chainRing;         /* ring of chains */
 
   struct HistoryStruct historyStruct;
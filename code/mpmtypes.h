@@ -61,6 +61,7 @@ typedef unsigned TraceId;               /* <design/type#.traceid> */
 typedef unsigned TraceSet;              /* <design/type#.traceset> */
 typedef unsigned TraceState;            /* <design/type#.tracestate> */
 typedef unsigned TraceStartWhy;         /* <design/type#.tracestartwhy> */
+typedef unsigned PauseKind;             /* <design/arena#.pause.hist> */
 typedef unsigned AccessSet;             /* <design/type#.access-set> */
 typedef unsigned Attr;                  /* <design/type#.attr> */
 typedef unsigned RootVar;               /* <design/type#.rootvar> */
@@ -78,6 +79,7 @@ typedef Pool AbstractPool;
 typedef struct mps_pool_class_s *PoolClass;  /* <code/poolclas.c> */
 typedef struct TraceStruct *Trace;      /* <design/trace> */
 typedef struct ScanStateStruct *ScanState; /* <design/trace> */
+typedef struct ScanJobStruct *ScanJob;  /* <code/trace.c> */
 typedef struct mps_chain_s *Chain;      /* <design/trace> */
 typedef struct TractStruct *Tract;      /* <design/arena> */
 typedef struct ChunkStruct *Chunk;      /* <code/tract.c> */
@@ -92,9 +94,13 @@ typedef struct mps_arena_class_s *ArenaClass; /* <design/arena> */
 typedef struct mps_arena_s *Arena;      /* <design/arena> */
 typedef Arena AbstractArena;
 typedef struct GlobalsStruct *Globals;  /* <design/arena> */
+typedef struct PauseHistStruct *PauseHist; /* <design/arena#.pause.hist> */
 typedef struct VMStruct *VM;            /* <code/vm.c>* */
 typedef struct RootStruct *Root;        /* <code/root.c> */
 typedef struct mps_thr_s *Thread;       /* <code/th.c>* */
+typedef struct ParStruct *Par;          /* <code/par.h> */
+typedef struct BgStruct *Bg;            /* <code/bg.h> */
+typedef struct SACThreadsStruct *SACThreads; /* <code/sac.h> */
 typedef struct MutatorContextStruct *MutatorContext; /* <design/prmc> */
 typedef struct PoolDebugMixinStruct *PoolDebugMixin;
 typedef struct AllocPatternStruct *AllocPattern;
@@ -178,7 +184,9 @@ typedef void (*SegGreyenMethod)(Seg seg, Trace trace);
 typedef void (*SegBlackenMethod)(Seg seg, TraceSet traceSet);
 typedef Res (*SegScanMethod)(Bool *totalReturn, Seg seg, ScanState ss);
 typedef Res (*SegFixMethod)(Seg seg, ScanState ss, Ref *refIO);
+typedef void (*SegSweepMethod)(Seg seg, Trace trace);
 typedef void (*SegReclaimMethod)(Seg seg, Trace trace);
+typedef void (*SegLazySweepMethod)(Seg seg, Bool mayFree);
 typedef void (*SegWalkMethod)(Seg seg, Format format, FormattedObjectsVisitor f,
                               void *v, size_t s);
 
@@ -204,6 +212,8 @@ typedef void (*PoolVarargsMethod)(ArgStruct args[], va_list varargs);
 typedef Res (*PoolInitMethod)(Pool pool, Arena arena, PoolClass klass, ArgList args);
 typedef Res (*PoolAllocMethod)(Addr *pReturn, Pool pool, Size size);
 typedef void (*PoolFreeMethod)(Pool pool, Addr old, Size size);
+typedef Bool (*PoolTryAllocMethod)(Addr *pReturn, Pool pool, Size size);
+typedef Bool (*PoolTryFreeMethod)(Pool pool, Addr old, Size size);
 typedef PoolGen (*PoolSegPoolGenMethod)(Pool pool, Seg seg);
 typedef Res (*PoolBufferFillMethod)(Addr *baseReturn, Addr *limitReturn,
                                     Pool pool, Buffer buffer, Size size);
@@ -275,13 +285,18 @@ typedef Res (*LandFindInZonesMethod)(Bool *foundReturn, Range rangeReturn, Range
 #define ZoneSetEMPTY    BS_EMPTY(ZoneSet)
 #define ZoneSetUNIV     BS_UNIV(ZoneSet)
 #define ZoneShiftUNSET  ((Shift)-1)  
+#define NodeNONE        ((Index)-1)  /* <design/arena#.numa> */
 #define TraceSetEMPTY   BS_EMPTY(TraceSet)
 #define TraceSetUNIV    ((TraceSet)((1u << TraceLIMIT) - 1))
 #define RankSetEMPTY    BS_EMPTY(RankSet)
 #define RankSetUNIV     ((RankSet)((1u << RankLIMIT) - 1))
 #define AttrGC          ((Attr)(1<<0))
 #define AttrMOVINGGC    ((Attr)(1<<1))
-#define AttrMASK        (AttrGC | AttrMOVINGGC)
+#define AttrPARSCAN     ((Attr)(1<<2))
+#define AttrPARSWEEP    ((Attr)(1<<3))
+#define AttrFREESPLIT   ((Attr)(1<<4))
+#define AttrMASK        (AttrGC | AttrMOVINGGC | AttrPARSCAN | AttrPARSWEEP \
+                         | AttrFREESPLIT)
 
 
 /* Locus preferences */
@@ -289,6 +304,7 @@ enum {
   LocusPrefHIGH = 1,
   LocusPrefLOW, 
   LocusPrefZONESET,
+  LocusPrefNODE,
   LocusPrefLIMIT
 };
 
@@ -379,7 +395,10 @@ enum {
     "Client requests: immediate full collection.")                      \
   X(WALK, "walk", "Walking all live objects.")                          \
   X(EXTENSION, "extension", \
-    "Extension: an MPS extension started the trace.")
+    "Extension: an MPS extension started the trace.")                  \
+  X(CHAIN_NURSERY, "nursery",                                           \
+    "Generation 0 of a chain has reached capacity during a major "      \
+    "collection: start a minor collection alongside it.")
 
 enum {
 #define X(WHY, SHORT, LONG) TraceStartWhy ## WHY,
@@ -389,6 +408,20 @@ enum {
 };
 
 
+/* PauseKind -- kinds of pause recorded by the arena
+ *
+ * .pause.kinds: Keep in sync with <code/mps.h#pause.kinds>.
+ * See <design/arena#.pause.hist>. */
+
+enum {
+  PauseKindMUTATOR,     /* MPS_PAUSE_MUTATOR: poll or barrier hit */
+  PauseKindFLIP,        /* MPS_PAUSE_FLIP: flip of a trace */
+  PauseKindSUSPEND,     /* MPS_PAUSE_SUSPEND: threads suspended */
+  PauseKindINCREMENT,   /* MPS_PAUSE_INCREMENT: call to TraceAdvance */
+  PauseKindLIMIT        /* not a pause kind, the limit of the enum */
+};
+
+
 /* MessageTypes -- see <design/message> */
 /* .message.types: Keep in sync with <code/mps.h#message.types> */
 
@@ -67,6 +67,7 @@
 #include "rangetree.c"
 #include "splay.c"
 #include "cbs.c"
+#include "avl.c"
 #include "ss.c"
 #include "version.c"
 #include "table.c"
@@ -86,23 +87,31 @@
 #include "poolamc.c"
 #include "poolams.c"
 #include "poolawl.c"
+#include "poolht.c"
 #include "poollo.c"
 #include "poolsnc.c"
 #include "poolmv2.c"
 #include "poolmvff.c"
 
-/* ANSI Plinth */
+/* ANSI Plinth, with Posix I/O on Posix platforms */
 
 #if defined(PLINTH)     /* see CONFIG_PLINTH_NONE in config.h  */
 #include "mpsliban.c"
+#if !defined(PLATFORM_ANSI) \
+  && (defined(MPS_OS_FR) || defined(MPS_OS_LI) || defined(MPS_OS_XC))
+#include "mpsioix.c"    /* Posix I/O, see <design/io#.posix> */
+#else
 #include "mpsioan.c"
 #endif
+#endif
 
 /* Generic ("ANSI") platform */
 
 #if defined(PLATFORM_ANSI)
 
 #include "lockan.c"     /* generic locks */
+#include "bgan.c"       /* generic background collector thread */
+#include "paran.c"      /* generic parallel workers */
 #include "than.c"       /* generic threads manager */
 #include "vman.c"       /* malloc-based pseudo memory mapping */
 #include "protan.c"     /* generic memory protection */
@@ -115,6 +124,8 @@
 #elif defined(MPS_PF_XCI3LL) || defined(MPS_PF_XCI3GC)
 
 #include "lockix.c"     /* Posix locks */
+#include "bgix.c"       /* Posix background collector thread */
+#include "parix.c"      /* Posix parallel workers */
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
@@ -129,6 +140,8 @@
 #elif defined(MPS_PF_XCI6LL) || defined(MPS_PF_XCI6GC)
 
 #include "lockix.c"     /* Posix locks */
+#include "bgix.c"       /* Posix background collector thread */
+#include "parix.c"      /* Posix parallel workers */
 #include "thxc.c"       /* macOS Mach threading */
 #include "vmix.c"       /* Posix virtual memory */
 #include "protix.c"     /* Posix protection */
@@ -143,6 +156,8 @@
 #elif defined(MPS_PF_FRI3GC) || defined(MPS_PF_FRI3LL)
 
 #include "lockix.c"     /* Posix locks */
+#include "bgix.c"       /* Posix background collector thread */
+#include "parix.c"      /* Posix parallel workers */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
@@ -158,6 +173,8 @@
 #elif defined(MPS_PF_FRI6GC) || defined(MPS_PF_FRI6LL)
 
 #include "lockix.c"     /* Posix locks */
+#include "bgix.c"       /* Posix background collector thread */
+#include "parix.c"      /* Posix parallel workers */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
@@ -173,6 +190,8 @@
 #elif defined(MPS_PF_LII3GC)
 
 #include "lockix.c"     /* Posix locks */
+#include "bgix.c"       /* Posix background collector thread */
+#include "parix.c"      /* Posix parallel workers */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
@@ -188,6 +207,8 @@
 #elif defined(MPS_PF_LII6GC) || defined(MPS_PF_LII6LL)
 
 #include "lockix.c"     /* Posix locks */
+#include "bgix.c"       /* Posix background collector thread */
+#include "parix.c"      /* Posix parallel workers */
 #include "thix.c"       /* Posix threading */
 #include "pthrdext.c"   /* Posix thread extensions */
 #include "vmix.c"       /* Posix virtual memory */
@@ -203,6 +224,8 @@
 #elif defined(MPS_PF_W3I3MV) || defined(MPS_PF_W3I3PC)
 
 #include "lockw3.c"     /* Windows locks */
+#include "bgan.c"       /* generic background collector thread */
+#include "paran.c"      /* generic parallel workers */
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
 #include "protw3.c"     /* Windows protection */
@@ -217,6 +240,8 @@
 #elif defined(MPS_PF_W3I6MV) || defined(MPS_PF_W3I6PC)
 
 #include "lockw3.c"     /* Windows locks */
+#include "bgan.c"       /* generic background collector thread */
+#include "paran.c"      /* generic parallel workers */
 #include "thw3.c"       /* Windows threading */
 #include "vmw3.c"       /* Windows virtual memory */
 #include "protw3.c"     /* Windows protection */
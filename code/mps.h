@@ -74,6 +74,7 @@ typedef size_t mps_align_t;     /* alignment (size_t) */
 typedef unsigned mps_rm_t;      /* root mode (unsigned) */
 typedef unsigned mps_rank_t;    /* ranks (unsigned) */
 typedef unsigned mps_message_type_t;    /* message type (unsigned) */
+typedef unsigned mps_pause_kind_t;      /* pause kind (unsigned) */
 typedef mps_word_t mps_clock_t;  /* processor time */
 typedef mps_word_t mps_label_t;  /* telemetry label */
 
@@ -171,6 +172,15 @@ extern const struct mps_key_s _mps_key_ARENA_SIZE;
 extern const struct mps_key_s _mps_key_ARENA_ZONED;
 #define MPS_KEY_ARENA_ZONED     (&_mps_key_ARENA_ZONED)
 #define MPS_KEY_ARENA_ZONED_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_GC_THREADS;
+#define MPS_KEY_ARENA_GC_THREADS (&_mps_key_ARENA_GC_THREADS)
+#define MPS_KEY_ARENA_GC_THREADS_FIELD count
+extern const struct mps_key_s _mps_key_ARENA_ADAPTIVE_PACING;
+#define MPS_KEY_ARENA_ADAPTIVE_PACING (&_mps_key_ARENA_ADAPTIVE_PACING)
+#define MPS_KEY_ARENA_ADAPTIVE_PACING_FIELD b
+extern const struct mps_key_s _mps_key_ARENA_BACKGROUND;
+#define MPS_KEY_ARENA_BACKGROUND (&_mps_key_ARENA_BACKGROUND)
+#define MPS_KEY_ARENA_BACKGROUND_FIELD b
 extern const struct mps_key_s _mps_key_FORMAT;
 #define MPS_KEY_FORMAT          (&_mps_key_FORMAT)
 #define MPS_KEY_FORMAT_FIELD    format
@@ -180,6 +190,15 @@ extern const struct mps_key_s _mps_key_CHAIN;
 extern const struct mps_key_s _mps_key_GEN;
 #define MPS_KEY_GEN             (&_mps_key_GEN)
 #define MPS_KEY_GEN_FIELD       u
+extern const struct mps_key_s _mps_key_LAZY_SWEEP;
+#define MPS_KEY_LAZY_SWEEP      (&_mps_key_LAZY_SWEEP)
+#define MPS_KEY_LAZY_SWEEP_FIELD b
+extern const struct mps_key_s _mps_key_AP_NODE;
+#define MPS_KEY_AP_NODE         (&_mps_key_AP_NODE)
+#define MPS_KEY_AP_NODE_FIELD   u
+extern const struct mps_key_s _mps_key_AP_FILL_SCALE_MAX;
+#define MPS_KEY_AP_FILL_SCALE_MAX (&_mps_key_AP_FILL_SCALE_MAX)
+#define MPS_KEY_AP_FILL_SCALE_MAX_FIELD count
 extern const struct mps_key_s _mps_key_RANK;
 #define MPS_KEY_RANK            (&_mps_key_RANK)
 #define MPS_KEY_RANK_FIELD      rank
@@ -298,6 +317,25 @@ enum {
 #define mps_message_type_gc_start() _mps_MESSAGE_TYPE_GC_START
 
 
+/* Pause Kinds
+ * .pause.kinds: Keep in sync with <code/mpmtypes.h#pause.kinds>. */
+
+#define MPS_PAUSE_MUTATOR   ((mps_pause_kind_t)0)
+#define MPS_PAUSE_FLIP      ((mps_pause_kind_t)1)
+#define MPS_PAUSE_SUSPEND   ((mps_pause_kind_t)2)
+#define MPS_PAUSE_INCREMENT ((mps_pause_kind_t)3)
+
+typedef struct mps_pause_stats_s {
+  size_t mps_count;             /* number of pauses */
+  double mps_total;             /* total duration, in seconds */
+  double mps_max;               /* longest duration, in seconds */
+  double mps_p50;               /* median duration, in seconds */
+  double mps_p90;               /* 90th percentile, in seconds */
+  double mps_p99;               /* 99th percentile, in seconds */
+  double mps_p999;              /* 99.9th percentile, in seconds */
+} mps_pause_stats_s;
+
+
 /* Reference Ranks
  *
  * See protocol.mps.reference. */
@@ -462,6 +500,9 @@ extern size_t mps_arena_spare_commit_limit(mps_arena_t);
 
 extern double mps_arena_pause_time(mps_arena_t);
 extern void mps_arena_pause_time_set(mps_arena_t, double);
+extern void mps_arena_pause_stats(mps_arena_t, mps_pause_kind_t,
+                                  mps_pause_stats_s *);
+extern void mps_arena_pause_stats_reset(mps_arena_t);
 
 extern mps_bool_t mps_arena_busy(mps_arena_t);
 extern mps_bool_t mps_arena_has_addr(mps_arena_t, mps_addr_t);
@@ -560,6 +601,9 @@ extern void mps_sac_destroy(mps_sac_t);
 extern mps_res_t mps_sac_alloc(mps_addr_t *, mps_sac_t, size_t, mps_bool_t);
 extern void mps_sac_free(mps_sac_t, mps_addr_t, size_t);
 extern void mps_sac_flush(mps_sac_t);
+extern mps_res_t mps_sac_thread_classes(mps_pool_t, size_t,
+                                        mps_sac_classes_s *, size_t);
+extern mps_res_t mps_sac_thread(mps_sac_t *, mps_pool_t, mps_thr_t);
 
 /* Direct access to mps_sac_fill and mps_sac_empty is not supported. */
 extern mps_res_t mps_sac_fill(mps_addr_t *, mps_sac_t, size_t, mps_bool_t);
@@ -727,6 +771,8 @@ extern void mps_ld_add(mps_ld_t, mps_arena_t, mps_addr_t);
 extern void mps_ld_merge(mps_ld_t, mps_arena_t, mps_ld_t);
 extern mps_bool_t mps_ld_isstale(mps_ld_t, mps_arena_t, mps_addr_t);
 extern mps_bool_t mps_ld_isstale_any(mps_ld_t, mps_arena_t);
+extern size_t mps_ld_stale_keys(mps_ld_t, mps_arena_t, mps_addr_t *,
+                                size_t, mps_bool_t *);
 
 extern mps_word_t mps_collections(mps_arena_t);
 
@@ -822,6 +868,10 @@ extern mps_res_t mps_scan_area(mps_ss_t, void *, void *, void *);
 extern mps_res_t mps_scan_area_masked(mps_ss_t, void *, void *, void *);
 extern mps_res_t mps_scan_area_tagged(mps_ss_t, void *, void *, void *);
 extern mps_res_t mps_scan_area_tagged_or_zero(mps_ss_t, void *, void *, void *);
+extern mps_res_t mps_scan_area_batch(mps_ss_t, void *, void *, void *);
+extern mps_res_t mps_scan_area_masked_batch(mps_ss_t, void *, void *, void *);
+extern mps_res_t mps_scan_area_tagged_batch(mps_ss_t, void *, void *, void *);
+extern mps_res_t mps_scan_area_tagged_or_zero_batch(mps_ss_t, void *, void *, void *);
 
 extern mps_res_t mps_fix(mps_ss_t, mps_addr_t *);
 
@@ -840,6 +890,18 @@ extern mps_res_t mps_fix(mps_ss_t, mps_addr_t *);
    _mps_ufs |= _mps_wt, \
    (_mps_w & _mps_wt) != 0)
 
+/* MPS_FIX1_ZONE and MPS_FIX1_ZONES split MPS_FIX1 in two, so that a
+ * scanner can apply the first-stage test to a batch of references
+ * at once. See <code/scan.c#batch>. */
+
+#define MPS_FIX1_ZONE(ss, ref) \
+  ((mps_word_t)1 << ((mps_word_t)(ref) >> _mps_zs \
+                     & (sizeof(mps_word_t) * CHAR_BIT - 1)))
+
+#define MPS_FIX1_ZONES(ss, zones) \
+  (_mps_ufs |= (zones), \
+   (_mps_w & (zones)) != 0)
+
 extern mps_res_t _mps_fix2(mps_ss_t, mps_addr_t *);
 #define MPS_FIX2(ss, ref_io) _mps_fix2(ss, ref_io)
 
@@ -83,6 +83,14 @@ static Bool mpsi_check(void)
   CHECKL((int)MessageTypeGCSTART
          == (int)_mps_MESSAGE_TYPE_GC_START);
 
+  /* Check that external and internal pause kinds match. */
+  /* See <code/mps.h#pause.kinds> and <code/mpmtypes.h#pause.kinds>. */
+  CHECKL(COMPATTYPE(mps_pause_kind_t, PauseKind));
+  CHECKL((int)PauseKindMUTATOR == (int)MPS_PAUSE_MUTATOR);
+  CHECKL((int)PauseKindFLIP == (int)MPS_PAUSE_FLIP);
+  CHECKL((int)PauseKindSUSPEND == (int)MPS_PAUSE_SUSPEND);
+  CHECKL((int)PauseKindINCREMENT == (int)MPS_PAUSE_INCREMENT);
+
   /* The external idea of a word width and the internal one */
   /* had better match.  <design/interface-c#.cons>. */
   CHECKL(sizeof(mps_word_t) == sizeof(void *));
@@ -256,6 +264,35 @@ void mps_arena_pause_time_set(mps_arena_t arena, double pause_time)
   ArenaLeave(arena);
 }
 
+void mps_arena_pause_stats(mps_arena_t arena, mps_pause_kind_t kind,
+                           mps_pause_stats_s *stats_o)
+{
+  Count count;
+  double total, max;
+
+  ArenaEnter(arena);
+  AVERT(PauseKind, kind);
+  AVER(stats_o != NULL);
+
+  ArenaPauseStats(&count, &total, &max, arena, kind);
+  stats_o->mps_count = count;
+  stats_o->mps_total = total;
+  stats_o->mps_max = max;
+  stats_o->mps_p50 = ArenaPauseQuantile(arena, kind, 0.5);
+  stats_o->mps_p90 = ArenaPauseQuantile(arena, kind, 0.9);
+  stats_o->mps_p99 = ArenaPauseQuantile(arena, kind, 0.99);
+  stats_o->mps_p999 = ArenaPauseQuantile(arena, kind, 0.999);
+
+  ArenaLeave(arena);
+}
+
+void mps_arena_pause_stats_reset(mps_arena_t arena)
+{
+  ArenaEnter(arena);
+  ArenaPauseStatsReset(arena);
+  ArenaLeave(arena);
+}
+
 
 void mps_arena_clamp(mps_arena_t arena)
 {
@@ -798,6 +835,15 @@ mps_res_t mps_alloc(mps_addr_t *p_o, mps_pool_t pool, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* Try to allocate holding only the pool lock. */
+  /* <design/thread-safety#.sol.pool> */
+  AVER_CRITICAL(p_o != NULL);
+  AVER_CRITICAL(size > 0);
+  if (PoolTryAlloc(&p, pool, size)) {
+    *p_o = (mps_addr_t)p;
+    return MPS_RES_OK;
+  }
+
   ArenaEnter(arena);
   STACK_CONTEXT_BEGIN(arena) {
 
@@ -842,6 +888,13 @@ void mps_free(mps_pool_t pool, mps_addr_t p, size_t size)
   AVER_CRITICAL(TESTT(Pool, pool));
   arena = PoolArena(pool);
 
+  /* Try to free holding only the pool lock. */
+  /* <design/thread-safety#.sol.pool> */
+  AVER_CRITICAL(p != NULL);
+  AVER_CRITICAL(size > 0);
+  if (PoolTryFree(pool, (Addr)p, size))
+    return;
+
   ArenaEnter(arena);
 
   AVERT_CRITICAL(Pool, pool);
@@ -1098,6 +1151,7 @@ mps_res_t mps_ap_fill(mps_addr_t *p_o, mps_ap_t mps_ap, size_t size)
 {
   Buffer buf = BufferOfAP(mps_ap);
   Arena arena;
+  Bool contended;
   Addr p;
   Res res;
 
@@ -1105,7 +1159,8 @@ mps_res_t mps_ap_fill(mps_addr_t *p_o, mps_ap_t mps_ap, size_t size)
   AVER(TESTT(Buffer, buf));
   arena = BufferArena(buf);
 
-  ArenaEnter(arena);
+  contended = ArenaEnterContended(arena);
+  BufferNoteLock(buf, contended);
   STACK_CONTEXT_BEGIN(arena) {
 
     ArenaPoll(ArenaGlobals(arena)); /* .poll */
@@ -1144,13 +1199,14 @@ mps_bool_t mps_ap_trip(mps_ap_t mps_ap, mps_addr_t p, size_t size)
 {
   Buffer buf = BufferOfAP(mps_ap);
   Arena arena;
-  Bool b;
+  Bool contended, b;
 
   AVER(mps_ap != NULL);
   AVER(TESTT(Buffer, buf));
   arena = BufferArena(buf);
 
-  ArenaEnter(arena);
+  contended = ArenaEnterContended(arena);
+  BufferNoteLock(buf, contended);
 
   AVERT(Buffer, buf);
   AVER(size > 0);
@@ -1226,6 +1282,55 @@ void mps_sac_flush(mps_sac_t mps_sac)
 }
 
 
+/* mps_sac_thread_classes -- make a pool provide per-thread caches */
+
+mps_res_t mps_sac_thread_classes(mps_pool_t pool, size_t classes_count,
+                                 mps_sac_classes_s *classes,
+                                 size_t cache_limit)
+{
+  Arena arena;
+  Res res;
+
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+
+  res = SACThreadsCreate(pool, (Count)classes_count, classes,
+                         (Size)cache_limit);
+
+  ArenaLeave(arena);
+
+  return (mps_res_t)res;
+}
+
+
+/* mps_sac_thread -- return the cache of a thread, creating it if needed */
+
+mps_res_t mps_sac_thread(mps_sac_t *mps_sac_o, mps_pool_t pool,
+                         mps_thr_t thread)
+{
+  Arena arena;
+  SAC sac;
+  Res res;
+
+  AVER(mps_sac_o != NULL);
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+
+  res = SACThreadsFind(&sac, pool, thread);
+
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_sac_o = ExternalSACOfSAC(sac);
+  return (mps_res_t)res;
+}
+
+
 /* mps_sac_fill -- alloc an object, and perhaps fill the cache */
 
 mps_res_t mps_sac_fill(mps_addr_t *p_o, mps_sac_t mps_sac, size_t size,
@@ -1671,6 +1776,7 @@ void mps_thread_dereg(mps_thr_t thread)
 
   ArenaEnter(arena);
 
+  SACThreadsDeregister(arena, thread);
   ThreadDeregister(thread, arena);
 
   ArenaLeave(arena);
@@ -1728,6 +1834,59 @@ mps_bool_t mps_ld_isstale_any(mps_ld_t ld, mps_arena_t arena)
   return (mps_bool_t)b;
 }
 
+
+/* mps_ld_stale_keys -- find out which of some addresses are stale
+ *
+ * Each address is tested with LDIsStaleAddr first, and only those it
+ * reports are tested precisely with LDIsStaleSeg, which needs the
+ * arena lock. The addresses are copied in batches, so that neither
+ * the client's arrays nor the location dependency are accessed while
+ * the lock is held (they might be in protected segments: see
+ * <code/ld.c#ld.access>).
+ */
+
+size_t mps_ld_stale_keys(mps_ld_t mps_ld, mps_arena_t arena,
+                         mps_addr_t *keys, size_t count,
+                         mps_bool_t *stale_o)
+{
+  mps_ld_s ld;
+  Addr addr[LDStaleBATCH];
+  Bool stale[LDStaleBATCH];
+  size_t i, n, total = 0;
+  Index j;
+
+  AVER(mps_ld != NULL);
+  AVER(keys != NULL || count == 0);
+  AVER(stale_o != NULL || count == 0);
+
+  ld = *mps_ld;
+  for (i = 0; i < count; i += n) {
+    Bool any = FALSE;
+    n = count - i;
+    if (n > LDStaleBATCH)
+      n = LDStaleBATCH;
+    for (j = 0; j < n; ++j) {
+      addr[j] = (Addr)keys[i + j];
+      stale[j] = LDIsStaleAddr(&ld, arena, addr[j]);
+      if (stale[j])
+        any = TRUE;
+    }
+    if (any) {
+      ArenaEnter(arena);
+      for (j = 0; j < n; ++j)
+        if (stale[j])
+          stale[j] = LDIsStaleSeg(&ld, arena, addr[j]);
+      ArenaLeave(arena);
+    }
+    for (j = 0; j < n; ++j) {
+      stale_o[i + j] = (mps_bool_t)stale[j];
+      if (stale[j])
+        ++total;
+    }
+  }
+  return total;
+}
+
 mps_res_t mps_fix(mps_ss_t mps_ss, mps_addr_t *ref_io)
 {
   mps_res_t res;
@@ -0,0 +1,581 @@
+/* mpsioix.c: RAVENBROOK MEMORY POOL SYSTEM I/O IMPLEMENTATION (POSIX)
+ *
+ * $Id$
+ * Copyright (c) 2001-2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * .readership: For MPS client application developers and MPS developers.
+ * .sources: <design/io>
+ *
+ * .purpose: This is the I/O module of the plinth for Posix systems.
+ * By default it behaves exactly like the ANSI I/O module
+ * <code/mpsioan.c>. If the environment variable MPS_TELEMETRY_SIZE is
+ * set to a positive number of bytes, the telemetry stream is instead
+ * written to a memory-mapped file that is pre-sized to that many bytes
+ * and extended by the same amount whenever it fills. <design/io#.posix>
+ *
+ * .thread: In the mapped mode, mps_io_write only copies the data into
+ * one of two buffers. A writer thread stores the full buffer into the
+ * mapping while the other buffer fills, so the thread that flushes an
+ * event buffer (perhaps in the middle of a collection) does not wait
+ * for the file system unless the writer thread has fallen a whole
+ * buffer behind. mps_io_flush waits for the writer thread to store
+ * everything that has been written.
+ *
+ * .publish: The unwritten part of the mapped file is zero. The writer
+ * thread stores the first word of each buffer last, after a memory
+ * barrier, so a reader of the file that finds a non-zero word where
+ * the data ends can be sure that the rest of the buffer is present.
+ * Each buffer holds whole calls to mps_io_write, and the telemetry
+ * system writes whole events, so a reader such as <code/eventcnv.c>
+ * can read the file while it is being written, and stop when it
+ * finds an event whose size is zero.
+ *
+ * .fork: The parent and the child of a fork would share the mapping
+ * but each keep their own count of the bytes stored, so they would
+ * overwrite each other's data. So a child handler gives the child its
+ * own stream, in a file whose name is the parent's followed by "." and
+ * the child's process id. Only the thread that calls fork exists in
+ * the child, so the child has no writer thread, and the mutex may
+ * have been held by the parent's writer thread at the time of the
+ * fork. So the handler also reinitializes the mutex and the condition
+ * variables, and the child stores each write into its mapping itself,
+ * in the thread that calls mps_io_write. The data that was waiting for
+ * the parent's writer thread belongs to the parent, which will still
+ * store it.
+ */
+
+#include "mpstd.h"
+
+/* See <code/mpsioan.c> for why this uses AVER rather than assert.
+   This comes first because it also defines the feature macros, see
+   .feature.li in config.h. */
+#include "check.h"
+
+#include "mpsio.h"
+
+#if !defined(MPS_OS_FR) && !defined(MPS_OS_LI) && !defined(MPS_OS_XC)
+#error "mpsioix.c is specific to MPS_OS_FR, MPS_OS_LI or MPS_OS_XC"
+#endif
+
+#include <fcntl.h> /* O_CREAT, O_RDWR, O_TRUNC, open */
+#include <pthread.h> /* see .feature.li in config.h */
+#include <signal.h> /* pthread_sigmask, sigfillset */
+#include <stdio.h> /* FILE, fclose, fflush, fopen, fwrite, sprintf */
+#include <stdlib.h> /* free, getenv, malloc, strtoul */
+#include <string.h> /* memcpy, strlen */
+#include <sys/mman.h> /* MAP_SHARED, mmap, msync, munmap */
+#include <unistd.h> /* close, ftruncate, getpid, sysconf */
+
+
+/* IO_BUFFER_SIZE -- size of each buffer in the mapped mode
+ *
+ * A write that is larger than this is stored by the thread that calls
+ * mps_io_write, after waiting for the writer thread to finish, so it
+ * is still published whole (.publish). The telemetry system writes
+ * one event buffer at a time, and with the default configuration a
+ * buffer holds several of these.
+ */
+
+#define IO_BUFFER_SIZE ((size_t)1 << 17)
+
+
+/* ioBarrier -- make earlier stores visible before later stores */
+
+#if defined(MPS_BUILD_GC) || defined(MPS_BUILD_LL)
+#define ioBarrier() __sync_synchronize()
+#else
+#error "Unknown compiler: no memory barrier for mpsioix.c"
+#endif
+
+
+/* IOStruct -- state of the telemetry stream
+ *
+ * There can only be one stream at a time (see <code/event.c#trans.log>
+ * and <code/mpsioan.c>). The fields below mut are protected by it.
+ * The mapping fields above it are only touched by the writer thread
+ * while it is busy, or by another thread that holds the mutex while
+ * the writer thread is not busy.
+ */
+
+typedef struct IOStruct {
+  FILE *file;                   /* stdio stream, if not mapped */
+  int fd;                       /* mapped file, if mapped */
+  size_t step;                  /* size by which to extend the file */
+  char *base;                   /* base of mapping */
+  size_t mapped;                /* size of mapping and file */
+  size_t stored;                /* bytes stored in mapping */
+  size_t storing;               /* bytes writer thread is storing */
+  int threaded;                 /* writer thread exists? (.fork) */
+  pthread_t writer;             /* writer thread */
+  pthread_mutex_t mut;          /* protects the fields below */
+  pthread_cond_t ready;         /* signalled when there is data or exiting */
+  pthread_cond_t done;          /* signalled when writer is idle */
+  char *buffer[2];              /* buffers; buffer[fill] is filling */
+  unsigned fill;                /* index of buffer being filled */
+  size_t size;                  /* bytes in buffer being filled */
+  int busy;                     /* writer is storing the other buffer? */
+  int exiting;                  /* writer thread must exit? */
+  mps_res_t res;                /* first error from writer thread */
+} IOStruct, *IO;
+
+static IOStruct ioStruct;
+static IO ioOpen = NULL;
+static int ioHandlerInstalled = 0;
+
+
+/* ioFilename -- name of the telemetry file */
+
+static const char *ioFilename(void)
+{
+  const char *filename = getenv("MPS_TELEMETRY_FILENAME");
+  if(filename == NULL)
+    filename = "mpsio.log";
+  return filename;
+}
+
+
+/* ioMap -- make sure the mapping has room for size more bytes */
+
+static mps_res_t ioMap(IO io, size_t size)
+{
+  size_t mapped;
+  void *base;
+
+  if (io->stored + size <= io->mapped)
+    return MPS_RES_OK;
+
+  mapped = io->mapped;
+  while (mapped < io->stored + size)
+    mapped += io->step;
+  if (ftruncate(io->fd, (off_t)mapped) != 0)
+    return MPS_RES_IO;
+  base = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, io->fd, 0);
+  if (base == MAP_FAILED)
+    return MPS_RES_IO;
+  if (io->base != NULL)
+    (void)munmap(io->base, io->mapped);
+  io->base = base;
+  io->mapped = mapped;
+  return MPS_RES_OK;
+}
+
+
+/* ioStore -- store a buffer at the end of the mapping
+ *
+ * See .publish.
+ */
+
+static mps_res_t ioStore(IO io, const char *buf, size_t size)
+{
+  char *p;
+  mps_res_t res;
+
+  res = ioMap(io, size);
+  if (res != MPS_RES_OK)
+    return res;
+
+  p = io->base + io->stored;
+  if (size > sizeof(mps_word_t)) {
+    memcpy(p + sizeof(mps_word_t), buf + sizeof(mps_word_t),
+           size - sizeof(mps_word_t));
+    ioBarrier();
+    memcpy(p, buf, sizeof(mps_word_t));
+  } else {
+    memcpy(p, buf, size);
+  }
+  io->stored += size;
+  return MPS_RES_OK;
+}
+
+
+/* ioWriter -- the writer thread
+ *
+ * Waits for data in the filling buffer, swaps the buffers, and
+ * stores the full one without holding the mutex.
+ */
+
+static void *ioWriter(void *closure)
+{
+  IO io = closure;
+  int pres;
+
+  pres = pthread_mutex_lock(&io->mut);
+  AVER(pres == 0);
+  for (;;) {
+    char *buf;
+    size_t size;
+    mps_res_t res;
+
+    while (io->size == 0 && !io->exiting) {
+      pres = pthread_cond_wait(&io->ready, &io->mut);
+      AVER(pres == 0);
+    }
+    if (io->size == 0)
+      break;
+
+    buf = io->buffer[io->fill];
+    size = io->size;
+    io->fill = 1 - io->fill;
+    io->size = 0;
+    io->busy = 1;
+    io->storing = size;
+    pres = pthread_mutex_unlock(&io->mut);
+    AVER(pres == 0);
+
+    res = ioStore(io, buf, size);
+
+    pres = pthread_mutex_lock(&io->mut);
+    AVER(pres == 0);
+    if (res != MPS_RES_OK && io->res == MPS_RES_OK)
+      io->res = res;
+    io->busy = 0;
+    pres = pthread_cond_broadcast(&io->done);
+    AVER(pres == 0);
+  }
+  pres = pthread_mutex_unlock(&io->mut);
+  AVER(pres == 0);
+  return NULL;
+}
+
+
+/* ioMappedCreate -- open the file and start the writer thread */
+
+static mps_res_t ioMappedCreate(IO io, const char *filename, size_t step)
+{
+  long pageSize = sysconf(_SC_PAGESIZE);
+  sigset_t all, old;
+  mps_res_t res;
+  int pres;
+
+  if (pageSize > 0)
+    step = (step + (size_t)pageSize - 1) / (size_t)pageSize
+           * (size_t)pageSize;
+  io->step = step;
+  io->base = NULL;
+  io->mapped = 0;
+  io->stored = 0;
+  io->storing = 0;
+  io->threaded = 1;
+  io->fill = 0;
+  io->size = 0;
+  io->busy = 0;
+  io->exiting = 0;
+  io->res = MPS_RES_OK;
+
+  io->buffer[0] = malloc(IO_BUFFER_SIZE);
+  io->buffer[1] = malloc(IO_BUFFER_SIZE);
+  if (io->buffer[0] == NULL || io->buffer[1] == NULL) {
+    res = MPS_RES_MEMORY;
+    goto failBuffers;
+  }
+
+  io->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (io->fd < 0) {
+    res = MPS_RES_IO;
+    goto failOpen;
+  }
+  res = ioMap(io, 1);
+  if (res != MPS_RES_OK)
+    goto failMap;
+
+  pres = pthread_mutex_init(&io->mut, NULL);
+  AVER(pres == 0);
+  pres = pthread_cond_init(&io->ready, NULL);
+  AVER(pres == 0);
+  pres = pthread_cond_init(&io->done, NULL);
+  AVER(pres == 0);
+
+  /* Block all signals in the writer thread, as in <code/parix.c#.signals>. */
+  pres = sigfillset(&all);
+  AVER(pres == 0);
+  pres = pthread_sigmask(SIG_SETMASK, &all, &old);
+  AVER(pres == 0);
+  pres = pthread_create(&io->writer, NULL, ioWriter, io);
+  (void)pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (pres != 0) {
+    res = MPS_RES_RESOURCE;
+    goto failThread;
+  }
+  return MPS_RES_OK;
+
+failThread:
+  (void)pthread_cond_destroy(&io->done);
+  (void)pthread_cond_destroy(&io->ready);
+  (void)pthread_mutex_destroy(&io->mut);
+  (void)munmap(io->base, io->mapped);
+failMap:
+  (void)close(io->fd);
+failOpen:
+failBuffers:
+  free(io->buffer[1]);
+  free(io->buffer[0]);
+  return res;
+}
+
+
+/* ioForkChild -- give a child its own stream
+ *
+ * See .fork. This is installed with pthread_atfork. If the child's
+ * file can't be opened, the child's writes fail with MPS_RES_IO.
+ */
+
+static void ioForkChild(void)
+{
+  IO io = ioOpen;
+  const char *filename;
+  char *childname;
+  int pres;
+
+  if (io == NULL || io->file != NULL)
+    return;
+
+  pres = pthread_mutex_init(&io->mut, NULL);
+  AVER(pres == 0);
+  pres = pthread_cond_init(&io->ready, NULL);
+  AVER(pres == 0);
+  pres = pthread_cond_init(&io->done, NULL);
+  AVER(pres == 0);
+
+  /* The parent's mapping and the data waiting to be stored in it
+     belong to the parent. */
+  if (io->base != NULL)
+    (void)munmap(io->base, io->mapped);
+  if (io->fd >= 0)
+    (void)close(io->fd);
+  io->fd = -1;
+  io->base = NULL;
+  io->mapped = 0;
+  io->stored = 0;
+  io->storing = 0;
+  io->size = 0;
+  io->busy = 0;
+  io->threaded = 0;
+
+  filename = ioFilename();
+  childname = malloc(strlen(filename) + 32);
+  if (childname == NULL) {
+    io->res = MPS_RES_MEMORY;
+    return;
+  }
+  (void)sprintf(childname, "%s.%ld", filename, (long)getpid());
+  io->fd = open(childname, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  free(childname);
+  if (io->fd < 0)
+    io->res = MPS_RES_IO;
+  else
+    io->res = ioMap(io, 1);
+}
+
+
+mps_res_t mps_io_create(mps_io_t *mps_io_r)
+{
+  IO io = &ioStruct;
+  const char *filename;
+  const char *sizeString;
+  unsigned long step = 0;
+
+  if(ioOpen != NULL) /* See <code/event.c#trans.log> */
+    return MPS_RES_LIMIT; /* Cannot currently open more than one log */
+
+  filename = ioFilename();
+
+  sizeString = getenv("MPS_TELEMETRY_SIZE");
+  if (sizeString != NULL)
+    step = strtoul(sizeString, NULL, 0);
+
+  if (step > 0) {
+    mps_res_t res;
+    if (!ioHandlerInstalled) {
+      if (pthread_atfork(NULL, NULL, ioForkChild) != 0)
+        return MPS_RES_RESOURCE;
+      ioHandlerInstalled = 1;
+    }
+    res = ioMappedCreate(io, filename, (size_t)step);
+    if (res != MPS_RES_OK)
+      return res;
+    io->file = NULL;
+  } else {
+    io->file = fopen(filename, "wb");
+    if(io->file == NULL)
+      return MPS_RES_IO;
+  }
+
+  *mps_io_r = (mps_io_t)io;
+  ioOpen = io;
+  return MPS_RES_OK;
+}
+
+
+void mps_io_destroy(mps_io_t mps_io)
+{
+  IO io = (IO)mps_io;
+  int pres;
+  AVER(io == ioOpen);
+  AVER(io != NULL);
+
+  ioOpen = NULL;
+  if (io->file != NULL) {
+    (void)fclose(io->file);
+    return;
+  }
+
+  if (io->threaded) {
+    pres = pthread_mutex_lock(&io->mut);
+    AVER(pres == 0);
+    io->exiting = 1;
+    pres = pthread_cond_signal(&io->ready);
+    AVER(pres == 0);
+    pres = pthread_mutex_unlock(&io->mut);
+    AVER(pres == 0);
+    pres = pthread_join(io->writer, NULL);
+    AVER(pres == 0);
+  }
+
+  (void)pthread_cond_destroy(&io->done);
+  (void)pthread_cond_destroy(&io->ready);
+  (void)pthread_mutex_destroy(&io->mut);
+  if (io->base != NULL)
+    (void)munmap(io->base, io->mapped);
+  if (io->fd >= 0) {
+    /* Cut off the unwritten part of the file. */
+    (void)ftruncate(io->fd, (off_t)io->stored);
+    (void)close(io->fd);
+  }
+  free(io->buffer[1]);
+  free(io->buffer[0]);
+}
+
+
+mps_res_t mps_io_write(mps_io_t mps_io, void *buf, size_t size)
+{
+  IO io = (IO)mps_io;
+  mps_res_t res = MPS_RES_OK;
+  int pres;
+  AVER(io == ioOpen);
+  AVER(io != NULL);
+
+  if (io->file != NULL) {
+    size_t n = fwrite(buf, size, 1, io->file);
+    if(n != 1)
+      return MPS_RES_IO;
+    return MPS_RES_OK;
+  }
+
+  pres = pthread_mutex_lock(&io->mut);
+  AVER(pres == 0);
+  if (!io->threaded) {
+    /* No writer thread, so store it from this thread (.fork). */
+    res = io->res;
+    if (res == MPS_RES_OK)
+      res = ioStore(io, buf, size);
+    pres = pthread_mutex_unlock(&io->mut);
+    AVER(pres == 0);
+    return res;
+  }
+  /* If the data won't fit in the filling buffer, wait for the writer
+     thread to take it. */
+  while (io->size > 0 && io->size + size > IO_BUFFER_SIZE) {
+    pres = pthread_cond_signal(&io->ready);
+    AVER(pres == 0);
+    pres = pthread_cond_wait(&io->done, &io->mut);
+    AVER(pres == 0);
+  }
+  if (size > IO_BUFFER_SIZE) {
+    /* Too big for a buffer: wait until the writer thread is idle,
+       and store it from this thread. */
+    while (io->busy) {
+      pres = pthread_cond_wait(&io->done, &io->mut);
+      AVER(pres == 0);
+    }
+    res = ioStore(io, buf, size);
+  } else {
+    memcpy(io->buffer[io->fill] + io->size, buf, size);
+    io->size += size;
+    pres = pthread_cond_signal(&io->ready);
+    AVER(pres == 0);
+  }
+  pres = pthread_mutex_unlock(&io->mut);
+  AVER(pres == 0);
+  return res;
+}
+
+
+mps_res_t mps_io_flush(mps_io_t mps_io)
+{
+  IO io = (IO)mps_io;
+  mps_res_t res;
+  int pres;
+  AVER(io == ioOpen);
+  AVER(io != NULL);
+
+  if (io->file != NULL) {
+    int e = fflush(io->file);
+    if(e == EOF)
+      return MPS_RES_IO;
+    return MPS_RES_OK;
+  }
+
+  /* Wait for the writer thread to store everything. */
+  pres = pthread_mutex_lock(&io->mut);
+  AVER(pres == 0);
+  while (io->size > 0 || io->busy) {
+    pres = pthread_cond_signal(&io->ready);
+    AVER(pres == 0);
+    pres = pthread_cond_wait(&io->done, &io->mut);
+    AVER(pres == 0);
+  }
+  res = io->res;
+
+  /* Start writing the stored data back to the file. This does not
+     wait for the write to finish. Other processes see the data in the
+     mapping in any case. The mutex stops the writer thread from
+     remapping the file meanwhile. */
+  if (res == MPS_RES_OK && io->base != NULL
+      && msync(io->base, io->mapped, MS_ASYNC) != 0)
+    res = MPS_RES_IO;
+  pres = pthread_mutex_unlock(&io->mut);
+  AVER(pres == 0);
+  return res;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,174 @@
+/* numatest.c: NUMA NODE PREFERENCE TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Create an allocation point for each of several NUMA nodes in pools
+ * of each automatically managed class, allocate from them, and check
+ * that the objects were allocated in chunks on the preferred node. The
+ * nodes needn't exist on the test machine, since the binding of a
+ * chunk's memory to its node is only a hint to the operating system.
+ * In the client arena, which can't bind memory to nodes, check that
+ * the preference is ignored. <design/arena#.numa>.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpm.h"
+#include "mpsavm.h"
+#include "mpsacl.h"
+#include "mpscamc.h"
+#include "mpscams.h"
+#include "mpscawl.h"
+#include "mpsclo.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+#include <stdlib.h> /* free, malloc */
+
+
+#define testArenaSIZE   ((size_t)16 << 20)
+#define nodeCOUNT       4
+#define objCOUNT        200
+#define objSLOTS        4
+
+
+static mps_addr_t objs[nodeCOUNT][objCOUNT];
+
+
+/* test -- allocate on each node in a pool of class klass */
+
+static void test(mps_arena_t arena, mps_pool_class_t klass, mps_bool_t numa)
+{
+  mps_fmt_t fmt;
+  mps_pool_t pool;
+  mps_root_t root;
+  mps_ap_t ap[nodeCOUNT];
+  unsigned node;
+  size_t i;
+
+  die(mps_root_create_area(&root, arena, mps_rank_ambig(), 0,
+                           (void *)objs, (void *)(objs + nodeCOUNT),
+                           mps_scan_area, NULL),
+      "root_create");
+  die(dylan_fmt(&fmt, arena), "fmt_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    die(mps_pool_create_k(&pool, arena, klass, args), "pool_create");
+  } MPS_ARGS_END(args);
+
+  for (node = 0; node < nodeCOUNT; ++node) {
+    MPS_ARGS_BEGIN(args) {
+      MPS_ARGS_ADD(args, MPS_KEY_AP_NODE, node);
+      if (klass == mps_class_awl())
+        MPS_ARGS_ADD(args, MPS_KEY_RANK, mps_rank_exact());
+      die(mps_ap_create_k(&ap[node], pool, args), "ap_create");
+    } MPS_ARGS_END(args);
+  }
+
+  for (i = 0; i < objCOUNT; ++i) {
+    for (node = 0; node < nodeCOUNT; ++node) {
+      mps_word_t obj;
+      die(make_dylan_vector(&obj, ap[node], objSLOTS), "make_dylan_vector");
+      objs[node][i] = (mps_addr_t)obj;
+    }
+  }
+
+  for (node = 0; node < nodeCOUNT; ++node) {
+    for (i = 0; i < objCOUNT; ++i) {
+      Chunk chunk;
+      Bool b = ChunkOfAddr(&chunk, arena, (Addr)objs[node][i]);
+      Insist(b);
+      Insist(ChunkNode(chunk) == (numa ? node : NodeNONE));
+      objs[node][i] = NULL;
+    }
+    mps_ap_destroy(ap[node]);
+  }
+
+  mps_pool_destroy(pool);
+  mps_fmt_destroy(fmt);
+  mps_root_destroy(root);
+}
+
+
+static void testArena(mps_arena_class_t arenaClass, mps_arg_s args[],
+                      mps_bool_t numa)
+{
+  mps_arena_t arena;
+
+  die(mps_arena_create_k(&arena, arenaClass, args), "arena_create");
+  test(arena, mps_class_amc(), numa);
+  test(arena, mps_class_amcz(), numa);
+  test(arena, mps_class_ams(), numa);
+  test(arena, mps_class_awl(), numa);
+  test(arena, mps_class_lo(), numa);
+  mps_arena_destroy(arena);
+}
+
+
+int main(int argc, char *argv[])
+{
+  void *block;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    testArena(mps_arena_class_vm(), args, TRUE);
+  } MPS_ARGS_END(args);
+
+  block = malloc(testArenaSIZE);
+  cdie(block != NULL, "malloc");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_CL_BASE, block);
+    testArena(mps_arena_class_cl(), args, FALSE);
+  } MPS_ARGS_END(args);
+  free(block);
+
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,380 @@
+/* nurserytest.c: NURSERY TRACE TEST
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * Start a collection of the world in an AMC pool, then fill
+ * generation 0 with objects that refer to the old objects, and start a
+ * nursery trace alongside the collection of the world
+ * <code/policy.c#nursery>.  With the arena clamped, so that nothing
+ * else does any tracing work, advance the two traces in turn until
+ * both have finished, and after each step check that:
+ *
+ *   - the white sets of the traces are disjoint
+ *     <code/trace.c#whiten.disjoint>;
+ *   - advancing one trace doesn't remove the other from the grey set
+ *     of any segment that survives the step;
+ *   - a segment is only nailed for a trace that it is white for, and
+ *     objects referred to by ambiguous roots don't move, whichever
+ *     trace nailed them;
+ *   - each nursery object still refers to its old object, whichever
+ *     trace moved them.
+ *
+ * Between steps, the mutator reads and writes a few objects, hitting
+ * the barriers on segments that are grey for one or both of the
+ * traces.
+ */
+
+#include "fmtdy.h"
+#include "fmtdytst.h"
+#include "testlib.h"
+#include "mpm.h"
+#include "mpsavm.h"
+#include "mpscamc.h"
+#include "mps.h"
+
+#include <stdio.h> /* printf */
+
+
+#define testArenaSIZE   ((size_t)32 << 20)
+#define gen0SIZE        ((size_t)256)   /* kB */
+#define gen1SIZE        ((size_t)16384) /* kB */
+#define objCOUNT        2000
+#define oldSLOTS        4
+#define newSLOTS        30
+#define pinnedCOUNT     50
+#define pinnedSTEP      (objCOUNT / pinnedCOUNT)
+#define mutateCOUNT     10
+#define stepsMAX        100000
+#define segsMAX         8192
+
+/* Slots in the vectors */
+#define slotID          0       /* DYLAN_INT identifying the object */
+#define slotOLD         1       /* reference to an old object */
+
+
+static mps_gen_param_s testChain[] = {
+  { gen0SIZE, 0.85 }, { gen1SIZE, 0.45 } };
+
+static mps_ap_t ap;
+
+/* oldRoots[i] is old object i, and newRoots[i] is its nursery object
+ * objCOUNT + i. */
+static mps_addr_t oldRoots[objCOUNT];
+static mps_addr_t newRoots[objCOUNT];
+
+/* ambigRoots[k] is old object k * pinnedSTEP, and
+ * ambigRoots[pinnedCOUNT + k] is that object's nursery object. */
+static mps_addr_t ambigRoots[2 * pinnedCOUNT];
+
+/* The segments and their grey sets before a step. */
+static struct {
+  Addr base;
+  TraceSet grey;
+} segs[segsMAX];
+static Count segCount;
+
+static unsigned long sawWhiteBoth;  /* checks with white segs for both */
+static unsigned long sawGreyOther;  /* grey segs white or grey for other */
+static unsigned long sawNailed;     /* nailed segs */
+
+
+/* make -- create a vector with an identifying number */
+
+static mps_addr_t make(size_t slots, size_t id)
+{
+  mps_word_t v;
+  die(make_dylan_vector(&v, ap, slots), "make_dylan_vector");
+  DYLAN_VECTOR_SLOT(v, slotID) = DYLAN_INT(id);
+  return (mps_addr_t)v;
+}
+
+
+/* makeNew -- create the nursery object for old object i */
+
+static mps_addr_t makeNew(size_t i)
+{
+  mps_addr_t new = make(newSLOTS, objCOUNT + i);
+  DYLAN_VECTOR_SLOT(new, slotOLD) = (mps_word_t)oldRoots[i];
+  return new;
+}
+
+
+/* checkObject -- check old object i and its nursery object */
+
+static void checkObject(size_t i)
+{
+  mps_addr_t obj = oldRoots[i];
+  mps_addr_t new = newRoots[i];
+
+  cdie(dylan_check(obj), "old object");
+  cdie(DYLAN_VECTOR_SLOT(obj, slotID) == DYLAN_INT(i), "old object id");
+  cdie(dylan_check((mps_addr_t)DYLAN_VECTOR_SLOT(obj, slotOLD)),
+       "old object's old object");
+  cdie(dylan_check(new), "nursery object");
+  cdie(DYLAN_VECTOR_SLOT(new, slotID) == DYLAN_INT(objCOUNT + i),
+       "nursery object id");
+  cdie(DYLAN_VECTOR_SLOT(new, slotOLD) == (mps_word_t)obj,
+       "nursery object's old object");
+  if (i % pinnedSTEP == 0) {
+    size_t k = i / pinnedSTEP;
+    cdie(obj == ambigRoots[k], "old object moved");
+    cdie(new == ambigRoots[pinnedCOUNT + k], "nursery object moved");
+  }
+}
+
+
+/* checkSegs -- check the colour of the segments
+ *
+ * If stepped is not NULL, it's the trace that was advanced since the
+ * last call, and no other trace can have scanned any segments since
+ * then.  Record the grey sets for the next call.
+ */
+
+static void checkSegs(Arena arena, Trace stepped)
+{
+  TraceSet busy = arena->busyTraces;
+  TraceSet white = TraceSetEMPTY;
+  Seg seg;
+  Index i;
+
+  if (stepped != NULL) {
+    for (i = 0; i < segCount; ++i) {
+      if (SegOfAddr(&seg, arena, segs[i].base)
+          && SegBase(seg) == segs[i].base)
+      {
+        TraceSet others = TraceSetDel(TraceSetInter(segs[i].grey, busy),
+                                      stepped);
+        cdie(TraceSetSub(others, SegGrey(seg)), "lost grey for other trace");
+      }
+    }
+  }
+
+  segCount = 0;
+  if (SegFirst(&seg, arena)) {
+    do {
+      TraceSet segWhite = SegWhite(seg), segGrey = SegGrey(seg);
+      cdie(segWhite == TraceSetEMPTY || TraceSetIsSingle(segWhite),
+           "white for more than one trace");
+      cdie(TraceSetSub(segWhite, busy), "white for idle trace");
+      cdie(TraceSetSub(segGrey, busy), "grey for idle trace");
+      cdie(TraceSetSub(SegNailed(seg), segWhite), "nailed but not white");
+      if (SegNailed(seg) != TraceSetEMPTY)
+        ++sawNailed;
+      white = TraceSetUnion(white, segWhite);
+      if (segGrey != TraceSetEMPTY
+          && !TraceSetIsSingle(TraceSetUnion(segGrey, segWhite)))
+        ++sawGreyOther;
+      cdie(segCount < segsMAX, "too many segments");
+      segs[segCount].base = SegBase(seg);
+      segs[segCount].grey = segGrey;
+      ++segCount;
+    } while (SegNext(&seg, arena, seg));
+  }
+  if (white != TraceSetEMPTY && !TraceSetIsSingle(white))
+    ++sawWhiteBoth;
+}
+
+
+static void test(mps_arena_t mpsArena)
+{
+  Arena arena = (Arena)mpsArena; /* avoid pun */
+  mps_fmt_t fmt;
+  mps_chain_t chain;
+  mps_pool_t pool;
+  mps_root_t oldRoot, newRoot, ambigRoot;
+  Trace trace;
+  TraceId ti;
+  Bool collectWorld = FALSE;
+  unsigned long steps;
+  size_t i, j;
+
+  die(dylan_fmt(&fmt, mpsArena), "fmt_create");
+  die(mps_chain_create(&chain, mpsArena, NELEMS(testChain), testChain),
+      "chain_create");
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_FORMAT, fmt);
+    MPS_ARGS_ADD(args, MPS_KEY_CHAIN, chain);
+    die(mps_pool_create_k(&pool, mpsArena, mps_class_amc(), args),
+        "pool_create");
+  } MPS_ARGS_END(args);
+  die(mps_ap_create_k(&ap, pool, mps_args_none), "ap_create");
+  die(mps_root_create_area(&oldRoot, mpsArena, mps_rank_exact(), 0,
+                           &oldRoots[0], &oldRoots[objCOUNT],
+                           mps_scan_area, NULL),
+      "root_create old");
+  die(mps_root_create_area(&newRoot, mpsArena, mps_rank_exact(), 0,
+                           &newRoots[0], &newRoots[objCOUNT],
+                           mps_scan_area, NULL),
+      "root_create new");
+  die(mps_root_create_area(&ambigRoot, mpsArena, mps_rank_ambig(), 0,
+                           &ambigRoots[0], &ambigRoots[NELEMS(ambigRoots)],
+                           mps_scan_area, NULL),
+      "root_create ambig");
+
+  /* Make the old objects and promote them out of generation 0. */
+  for (i = 0; i < objCOUNT; ++i)
+    oldRoots[i] = make(oldSLOTS, i);
+  for (i = 0; i < objCOUNT; ++i)
+    DYLAN_VECTOR_SLOT(oldRoots[i], slotOLD)
+      = (mps_word_t)oldRoots[rnd() % objCOUNT];
+  mps_arena_collect(mpsArena);
+  for (i = 0; i < pinnedCOUNT; ++i)
+    ambigRoots[i] = oldRoots[i * pinnedSTEP];
+
+  /* Start collecting the world, and keep the arena from advancing it.
+   * Each trace is advanced once before the mutator touches a protected
+   * segment, to get it out of the ambiguous band (see
+   * TraceRankForAccess). */
+  die(mps_arena_start_collect(mpsArena), "start_collect");
+  mps_arena_clamp(mpsArena);
+  ArenaEnter(arena);
+  cdie(TraceSetIsSingle(arena->busyTraces), "world trace");
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+    TraceAdvance(trace);
+  TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+  ArenaLeave(arena);
+
+  /* Fill generation 0 with objects that refer to the old objects. */
+  for (i = 0; i < objCOUNT; ++i) {
+    newRoots[i] = makeNew(i);
+    if (i % pinnedSTEP == 0)
+      ambigRoots[pinnedCOUNT + i / pinnedSTEP] = newRoots[i];
+  }
+
+  ArenaEnter(arena);
+  cdie(TraceSetIsSingle(arena->busyTraces), "world trace");
+  checkSegs(arena, NULL);
+  cdie(PolicyStartTrace(&trace, &collectWorld, arena, FALSE),
+       "nursery trace");
+  cdie(trace->why == TraceStartWhyCHAIN_NURSERY, "nursery trace why");
+  cdie(!collectWorld, "nursery trace collects world");
+  cdie(!TraceSetIsSingle(arena->busyTraces), "both traces busy");
+  checkSegs(arena, NULL);
+  TraceAdvance(trace);
+  checkSegs(arena, trace);
+  ArenaLeave(arena);
+  cdie(sawWhiteBoth > 0, "no segments white for both traces");
+
+  /* Advance each trace in turn, until both have finished. */
+  for (steps = 0; ; ++steps) {
+    Bool busy;
+
+    cdie(steps < stepsMAX, "traces didn't finish");
+    ArenaEnter(arena);
+    /* The mutator may have hit a barrier, which scans the segment for
+     * all flipped traces, so take a new snapshot of the grey sets. */
+    checkSegs(arena, NULL);
+    TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+      TraceAdvance(trace);
+      if (trace->state == TraceFINISHED)
+        TraceDestroyFinished(trace);
+      checkSegs(arena, trace);
+    TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+    busy = arena->busyTraces != TraceSetEMPTY;
+    ArenaLeave(arena);
+
+    for (j = 0; j < mutateCOUNT; ++j) {
+      i = rnd() % objCOUNT;
+      checkObject(i);
+      switch (rnd() % 3) {
+      case 0:
+        DYLAN_VECTOR_SLOT(oldRoots[i], slotOLD)
+          = (mps_word_t)oldRoots[rnd() % objCOUNT];
+        break;
+      case 1:
+        if (i % pinnedSTEP != 0)
+          newRoots[i] = makeNew(i);
+        break;
+      default:
+        break;
+      }
+    }
+
+    if (!busy)
+      break;
+  }
+  cdie(sawGreyOther > 0, "no segments grey for one trace and not the other");
+  cdie(sawNailed > 0, "no segments nailed");
+
+  for (i = 0; i < objCOUNT; ++i)
+    checkObject(i);
+  mps_arena_release(mpsArena);
+  mps_arena_collect(mpsArena);
+  for (i = 0; i < objCOUNT; ++i)
+    checkObject(i);
+
+  printf("%lu steps; %lu white for both; %lu grey for other; %lu nailed\n",
+         steps, sawWhiteBoth, sawGreyOther, sawNailed);
+
+  mps_arena_park(mpsArena);
+  mps_root_destroy(ambigRoot);
+  mps_root_destroy(newRoot);
+  mps_root_destroy(oldRoot);
+  mps_ap_destroy(ap);
+  mps_pool_destroy(pool);
+  mps_chain_destroy(chain);
+  mps_fmt_destroy(fmt);
+}
+
+
+int main(int argc, char *argv[])
+{
+  mps_arena_t arena;
+
+  testlib_init(argc, argv);
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_ARENA_SIZE, testArenaSIZE);
+    die(mps_arena_create_k(&arena, mps_arena_class_vm(), args),
+        "arena_create");
+  } MPS_ARGS_END(args);
+
+  test(arena);
+
+  mps_arena_destroy(arena);
+  printf("%s: Conclusion: Failed to find any defects.\n", argv[0]);
+  return 0;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
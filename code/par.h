@@ -0,0 +1,133 @@
+/* par.h: PARALLEL WORKER THREADS
+ *
+ *  $Id$
+ *  Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ *  .purpose: Provides a set of worker threads on which the collector
+ *  can run independent jobs in parallel, for example scanning a batch
+ *  of grey segments.
+ *
+ *  .fork-join: ParRun is fork-join: it distributes the jobs among the
+ *  workers, runs them, and returns only when every job has finished.
+ *  The calling thread takes part as worker 0, so a set of N workers
+ *  has N-1 threads of its own.  The jobs may not return a result
+ *  through the interface: the job function must store any results in
+ *  the closure.
+ *
+ *  .steal: Each worker starts with a contiguous range of jobs and takes
+ *  them from the front of its range.  A worker that runs out of jobs
+ *  steals one from the back of the largest remaining range, so that an
+ *  uneven batch still keeps all the workers busy.
+ *
+ *  .thread-safety: The jobs run concurrently, so a job function must
+ *  only touch memory that no other job touches, or serialize its access
+ *  with a lock.  The worker threads are not registered with the arena,
+ *  so they are never suspended by the shield, and must not touch
+ *  protected memory.
+ *
+ *  .fork: The worker threads do not survive a fork().  ParForkChild
+ *  must be called in the child, so that ParDestroy does not wait for
+ *  them.  In the child process, ParRun runs all the jobs on the
+ *  calling thread.
+ */
+
+#ifndef par_h
+#define par_h
+
+#include "mpmtypes.h"
+
+
+#define ParSig          ((Sig)0x519BA2A1) /* SIGnature PARALlel */
+
+
+/* ParJobFunction -- a job to run on a worker
+ *
+ * The first argument is the index of the job, the second is the index
+ * of the worker running it (which is less than ParWorkers).
+ */
+
+typedef void (*ParJobFunction)(Index job, Index worker, void *closure);
+
+
+extern Bool ParCheck(Par par);
+
+
+/*  ParCreate/Destroy
+ *
+ *  Create a set of workers for the arena, starting workers-1 new
+ *  threads.  If the platform does not support threads, ParCreate
+ *  succeeds but all jobs run on the calling thread.
+ */
+
+extern Res ParCreate(Par *parReturn, Arena arena, Count workers);
+extern void ParDestroy(Par par);
+
+
+/*  ParWorkers -- return the number of workers, including the caller */
+
+extern Count ParWorkers(Par par);
+
+
+/*  ParRun -- run jobs 0 to count-1 on the workers and wait for them */
+
+extern void ParRun(Par par, Count count, ParJobFunction job,
+                   void *closure);
+
+
+/*  ParIsRunning -- are jobs running on more than one thread?
+ *
+ *  Jobs may call this to find out whether they must avoid work that
+ *  is not thread-safe.
+ */
+
+extern Bool ParIsRunning(Par par);
+
+
+/*  ParForkChild -- forget the worker threads in the child of a fork() */
+
+extern void ParForkChild(Par par);
+
+
+#endif /* par_h */
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
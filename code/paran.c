@@ -0,0 +1,142 @@
+/* paran.c: ANSI PARALLEL WORKER THREADS
+ *
+ *  $Id$
+ *  Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ *  .purpose: This is a trivial implementation of the parallel workers
+ *  interface <code/par.h> for platforms without threads, or without
+ *  an implementation of the interface.  All the jobs run in order on
+ *  the calling thread, however many workers were asked for.
+ */
+
+#include "mpm.h"
+#include "par.h"
+
+SRCID(paran, "$Id$");
+
+
+typedef struct ParStruct {      /* ANSI parallel workers structure */
+  Sig sig;                      /* <design/sig> */
+  Arena arena;                  /* owning arena */
+  Bool running;                 /* inside ParRun? */
+} ParStruct;
+
+
+Bool ParCheck(Par par)
+{
+  CHECKS(Par, par);
+  CHECKU(Arena, par->arena);
+  CHECKL(BoolCheck(par->running));
+  return TRUE;
+}
+
+
+Res ParCreate(Par *parReturn, Arena arena, Count workers)
+{
+  void *p;
+  Par par;
+  Res res;
+
+  AVER(parReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(workers > 0);
+
+  res = ControlAlloc(&p, arena, sizeof(ParStruct));
+  if (res != ResOK)
+    return res;
+  par = p;
+
+  par->arena = arena;
+  par->running = FALSE;
+  par->sig = ParSig;
+  AVERT(Par, par);
+  *parReturn = par;
+  return ResOK;
+}
+
+
+void ParDestroy(Par par)
+{
+  AVERT(Par, par);
+  AVER(!par->running);
+  par->sig = SigInvalid;
+  ControlFree(par->arena, par, sizeof(ParStruct));
+}
+
+
+Count ParWorkers(Par par)
+{
+  AVERT(Par, par);
+  return 1;
+}
+
+
+void ParRun(Par par, Count count, ParJobFunction job, void *closure)
+{
+  Index i;
+
+  AVERT(Par, par);
+  AVER(FUNCHECK(job));
+  /* closure is arbitrary and can't be checked */
+  AVER(!par->running);
+
+  par->running = TRUE;
+  for (i = 0; i < count; ++i)
+    (*job)(i, 0, closure);
+  par->running = FALSE;
+}
+
+
+Bool ParIsRunning(Par par)
+{
+  AVERT(Par, par);
+  return FALSE; /* all jobs run on the calling thread */
+}
+
+
+void ParForkChild(Par par)
+{
+  AVERT(Par, par);
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
@@ -0,0 +1,452 @@
+/* parix.c: POSIX PARALLEL WORKER THREADS
+ *
+ *  $Id$
+ *  Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ *  .purpose: An implementation of the parallel workers interface
+ *  <code/par.h> using Posix threads.
+ *
+ *  .design: All the state is protected by a single mutex.  ParRun
+ *  divides the jobs into one range per worker, bumps the generation
+ *  count and broadcasts the start condition.  Each worker thread waits
+ *  for the generation to change, runs jobs until there are none left
+ *  to take or steal <code/par.h#.steal>, then decrements the count of
+ *  busy workers and signals the done condition if it was the last.  The
+ *  mutex is only held while taking a job, not while running it, so the
+ *  jobs should be large enough that the locking is insignificant.
+ *
+ *  .signals: The worker threads block all signals, so that signals sent
+ *  to the process are delivered to the client's threads, as they would
+ *  be if the MPS had no threads of its own.
+ *
+ *  .fork: In the child of a fork(), ParForkChild reinitializes the
+ *  mutex and conditions (which a worker thread may have been using at
+ *  the time of the fork) and clears alive, so that ParRun runs all the
+ *  jobs on the calling thread and ParDestroy does not wait for the
+ *  worker threads.
+ */
+
+#include "mpm.h"
+
+#if !defined(MPS_OS_FR) && !defined(MPS_OS_LI) && !defined(MPS_OS_XC)
+#error "parix.c is specific to MPS_OS_FR, MPS_OS_LI or MPS_OS_XC"
+#endif
+
+#include "par.h"
+
+#if defined(LOCK)
+
+#include <pthread.h> /* see .feature.li in config.h */
+#include <signal.h>
+
+SRCID(parix, "$Id$");
+
+
+/* ParWorkerStruct -- per-worker state
+ *
+ * next and limit are the range of jobs that the worker has still to
+ * take.  They are protected by the mutex in the ParStruct.
+ */
+
+typedef struct ParWorkerStruct {
+  Par par;                      /* the workers this belongs to */
+  Index index;                  /* index of this worker */
+  pthread_t id;                 /* thread, unless index is 0 */
+  Index next;                   /* next job to take */
+  Index limit;                  /* limit of jobs to take */
+} ParWorkerStruct, *ParWorker;
+
+
+typedef struct ParStruct {
+  Sig sig;                      /* <design/sig> */
+  Arena arena;                  /* owning arena */
+  Count workers;                /* number of workers, including caller */
+  ParWorker worker;             /* array of workers' state */
+  Bool alive;                   /* worker threads running in this process? */
+  pthread_mutex_t mut;          /* protects all fields below */
+  pthread_cond_t start;         /* signalled when jobs are ready */
+  pthread_cond_t done;          /* signalled when last worker is done */
+  Count generation;             /* number of ParRun calls so far */
+  Count busy;                   /* threads still running this generation */
+  Bool running;                 /* inside ParRun? */
+  Bool exiting;                 /* worker threads must exit? */
+  ParJobFunction job;           /* job function for this generation */
+  void *closure;                /* closure for job function */
+} ParStruct;
+
+
+Bool ParCheck(Par par)
+{
+  CHECKS(Par, par);
+  CHECKU(Arena, par->arena);
+  CHECKL(par->workers > 0);
+  CHECKL(par->worker != NULL);
+  CHECKL(par->busy < par->workers);
+  CHECKL(BoolCheck(par->alive));
+  CHECKL(BoolCheck(par->running));
+  CHECKL(!par->running || par->alive);
+  CHECKL(BoolCheck(par->exiting));
+  return TRUE;
+}
+
+
+/* parTake -- take a job for a worker, stealing if necessary
+ *
+ * Must be called with the mutex held.  Returns FALSE if there are no
+ * jobs left for any worker.
+ */
+
+static Bool parTake(Index *jobReturn, Par par, ParWorker worker)
+{
+  ParWorker victim = NULL;
+  Count most = 0;
+  Index i;
+
+  if (worker->next < worker->limit) {
+    *jobReturn = worker->next;
+    ++worker->next;
+    return TRUE;
+  }
+
+  for (i = 0; i < par->workers; ++i) {
+    ParWorker w = &par->worker[i];
+    if (w->limit - w->next > most) {
+      most = w->limit - w->next;
+      victim = w;
+    }
+  }
+  if (victim == NULL)
+    return FALSE;
+
+  --victim->limit;
+  *jobReturn = victim->limit;
+  return TRUE;
+}
+
+
+/* parWork -- run jobs until there are none left */
+
+static void parWork(Par par, ParWorker worker)
+{
+  int res;
+
+  for (;;) {
+    Index job;
+    Bool found;
+
+    res = pthread_mutex_lock(&par->mut);
+    AVER(res == 0);
+    found = parTake(&job, par, worker);
+    res = pthread_mutex_unlock(&par->mut);
+    AVER(res == 0);
+    if (!found)
+      break;
+    (*par->job)(job, worker->index, par->closure);
+  }
+}
+
+
+/* parThread -- main loop of a worker thread */
+
+static void *parThread(void *arg)
+{
+  ParWorker worker = arg;
+  Par par = worker->par;
+  Count seen = 0;
+  int res;
+
+  res = pthread_mutex_lock(&par->mut);
+  AVER(res == 0);
+  for (;;) {
+    while (par->generation == seen && !par->exiting) {
+      res = pthread_cond_wait(&par->start, &par->mut);
+      AVER(res == 0);
+    }
+    if (par->exiting)
+      break;
+    seen = par->generation;
+    res = pthread_mutex_unlock(&par->mut);
+    AVER(res == 0);
+
+    parWork(par, worker);
+
+    res = pthread_mutex_lock(&par->mut);
+    AVER(res == 0);
+    AVER(par->busy > 0);
+    --par->busy;
+    if (par->busy == 0) {
+      res = pthread_cond_signal(&par->done);
+      AVER(res == 0);
+    }
+  }
+  res = pthread_mutex_unlock(&par->mut);
+  AVER(res == 0);
+  return NULL;
+}
+
+
+/* parStop -- make the worker threads exit and wait for them */
+
+static void parStop(Par par, Count threads)
+{
+  Index i;
+  int res;
+
+  res = pthread_mutex_lock(&par->mut);
+  AVER(res == 0);
+  par->exiting = TRUE;
+  res = pthread_cond_broadcast(&par->start);
+  AVER(res == 0);
+  res = pthread_mutex_unlock(&par->mut);
+  AVER(res == 0);
+
+  for (i = 1; i <= threads; ++i) {
+    res = pthread_join(par->worker[i].id, NULL);
+    AVER(res == 0);
+  }
+}
+
+
+Res ParCreate(Par *parReturn, Arena arena, Count workers)
+{
+  void *p;
+  Par par;
+  sigset_t all, old;
+  Index i;
+  Res res;
+  int pres;
+
+  AVER(parReturn != NULL);
+  AVERT(Arena, arena);
+  AVER(workers > 0);
+
+  res = ControlAlloc(&p, arena, sizeof(ParStruct));
+  if (res != ResOK)
+    goto failParAlloc;
+  par = p;
+  res = ControlAlloc(&p, arena, workers * sizeof(ParWorkerStruct));
+  if (res != ResOK)
+    goto failWorkerAlloc;
+  par->worker = p;
+
+  par->arena = arena;
+  par->workers = workers;
+  par->alive = TRUE;
+  par->generation = 0;
+  par->busy = 0;
+  par->running = FALSE;
+  par->exiting = FALSE;
+  par->job = NULL;
+  par->closure = NULL;
+  for (i = 0; i < workers; ++i) {
+    par->worker[i].par = par;
+    par->worker[i].index = i;
+    par->worker[i].next = 0;
+    par->worker[i].limit = 0;
+  }
+  pres = pthread_mutex_init(&par->mut, NULL);
+  AVER(pres == 0);
+  pres = pthread_cond_init(&par->start, NULL);
+  AVER(pres == 0);
+  pres = pthread_cond_init(&par->done, NULL);
+  AVER(pres == 0);
+  par->sig = ParSig;
+  AVERT(Par, par);
+
+  /* The new threads inherit the signal mask. See .signals. */
+  pres = sigfillset(&all);
+  AVER(pres == 0);
+  pres = pthread_sigmask(SIG_SETMASK, &all, &old);
+  AVER(pres == 0);
+  for (i = 1; i < workers; ++i) {
+    pres = pthread_create(&par->worker[i].id, NULL, parThread,
+                          &par->worker[i]);
+    if (pres != 0)
+      break;
+  }
+  pres = pthread_sigmask(SIG_SETMASK, &old, NULL);
+  AVER(pres == 0);
+  if (i < workers) {
+    res = ResRESOURCE;
+    goto failThreads;
+  }
+
+  *parReturn = par;
+  return ResOK;
+
+failThreads:
+  parStop(par, i - 1);
+  par->sig = SigInvalid;
+  pres = pthread_cond_destroy(&par->done);
+  AVER(pres == 0);
+  pres = pthread_cond_destroy(&par->start);
+  AVER(pres == 0);
+  pres = pthread_mutex_destroy(&par->mut);
+  AVER(pres == 0);
+  ControlFree(arena, par->worker, workers * sizeof(ParWorkerStruct));
+failWorkerAlloc:
+  ControlFree(arena, par, sizeof(ParStruct));
+failParAlloc:
+  return res;
+}
+
+
+void ParDestroy(Par par)
+{
+  Arena arena;
+  Count workers;
+  int res;
+
+  AVERT(Par, par);
+  AVER(!par->running);
+  arena = par->arena;
+  workers = par->workers;
+
+  if (par->alive)
+    parStop(par, workers - 1);
+  par->sig = SigInvalid;
+  res = pthread_cond_destroy(&par->done);
+  AVER(res == 0);
+  res = pthread_cond_destroy(&par->start);
+  AVER(res == 0);
+  res = pthread_mutex_destroy(&par->mut);
+  AVER(res == 0);
+  ControlFree(arena, par->worker, workers * sizeof(ParWorkerStruct));
+  ControlFree(arena, par, sizeof(ParStruct));
+}
+
+
+Count ParWorkers(Par par)
+{
+  AVERT(Par, par);
+  return par->alive ? par->workers : 1;
+}
+
+
+void ParRun(Par par, Count count, ParJobFunction job, void *closure)
+{
+  Index i, base;
+  int res;
+
+  AVERT(Par, par);
+  AVER(FUNCHECK(job));
+  /* closure is arbitrary and can't be checked */
+  AVER(!par->running);
+
+  if (count == 0)
+    return;
+
+  /* Not worth waking the threads for a single job. */
+  if (count == 1 || par->workers == 1 || !par->alive) {
+    for (i = 0; i < count; ++i)
+      (*job)(i, 0, closure);
+    return;
+  }
+
+  res = pthread_mutex_lock(&par->mut);
+  AVER(res == 0);
+  par->running = TRUE;
+  par->job = job;
+  par->closure = closure;
+  base = 0;
+  for (i = 0; i < par->workers; ++i) {
+    Index limit = count * (i + 1) / par->workers;
+    par->worker[i].next = base;
+    par->worker[i].limit = limit;
+    base = limit;
+  }
+  AVER(base == count);
+  par->busy = par->workers - 1;
+  ++par->generation;
+  res = pthread_cond_broadcast(&par->start);
+  AVER(res == 0);
+  res = pthread_mutex_unlock(&par->mut);
+  AVER(res == 0);
+
+  parWork(par, &par->worker[0]);
+
+  res = pthread_mutex_lock(&par->mut);
+  AVER(res == 0);
+  while (par->busy > 0) {
+    res = pthread_cond_wait(&par->done, &par->mut);
+    AVER(res == 0);
+  }
+  par->running = FALSE;
+  par->job = NULL;
+  par->closure = NULL;
+  res = pthread_mutex_unlock(&par->mut);
+  AVER(res == 0);
+}
+
+
+Bool ParIsRunning(Par par)
+{
+  AVERT(Par, par);
+  return par->running;
+}
+
+
+void ParForkChild(Par par)
+{
+  int res;
+
+  AVERT(Par, par);
+  AVER(!par->running); /* the forking thread was not in ParRun */
+  res = pthread_mutex_init(&par->mut, NULL);
+  AVER(res == 0);
+  res = pthread_cond_init(&par->start, NULL);
+  AVER(res == 0);
+  res = pthread_cond_init(&par->done, NULL);
+  AVER(res == 0);
+  par->busy = 0;
+  par->alive = FALSE;
+}
+
+
+#elif defined(LOCK_NONE)
+#include "paran.c"
+#else
+#error "No lock configuration."
+#endif
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
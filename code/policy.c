@@ -11,10 +11,67 @@
 
 #include "locus.h"
 #include "mpm.h"
+#include "par.h"
 
 SRCID(policy, "$Id$");
 
 
+/* policyGrow -- extend the arena
+ *
+ * .grow.par: Extending the arena rebalances the chunk tree, which the
+ * workers in a parallel scan search without holding the fix lock
+ * <code/trace.c#par.fix>.  So don't extend it while they are running:
+ * the fix fails, and the segment is scanned again serially.
+ */
+
+static Res policyGrow(Arena arena, LocusPref pref, Size size)
+{
+  if (arena->par != NULL && ParIsRunning(arena->par))
+    return ResRESOURCE;
+  return Method(Arena, arena, grow)(arena, pref, size);
+}
+
+
+/* policyAllocOnNode -- allocate memory on the preferred NUMA node
+ *
+ * Try the zones in the same order as PolicyAlloc, but only in chunks
+ * on pref->node, and extend the arena with a chunk on that node if
+ * none of them has room. <design/arena#.numa.policy>.
+ */
+
+static Res policyAllocOnNode(Tract *tractReturn, Arena arena,
+                             LocusPref pref, Size size, Pool pool)
+{
+  ZoneSet zoneSets[3];
+  Index i;
+  Bool grown = FALSE;
+  Res res;
+
+  zoneSets[0] = ZoneSetDiff(pref->zones, pref->avoid);
+  zoneSets[1] = ZoneSetUnion(pref->zones,
+                             ZoneSetDiff(arena->freeZones, pref->avoid));
+  zoneSets[2] = ZoneSetDiff(ZoneSetUNIV, pref->avoid);
+
+  for (;;) {
+    for (i = 0; i < NELEMS(zoneSets); ++i) {
+      if (zoneSets[i] == ZoneSetEMPTY
+          || (i > 0 && zoneSets[i] == zoneSets[i - 1]))
+        continue;
+      res = ArenaNodeAlloc(tractReturn, arena, pref->node, zoneSets[i],
+                           pref->high, size, pool);
+      if (res == ResOK)
+        return ResOK;
+    }
+    if (grown)
+      return ResRESOURCE;
+    res = policyGrow(arena, pref, size);
+    if (res != ResOK)
+      return res;
+    grown = TRUE;
+  }
+}
+
+
 /* PolicyAlloc -- allocation policy
  *
  * This is the code responsible for making decisions about where to allocate
@@ -54,6 +111,15 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
     }
   }
 
+  /* Plan N: allocate from memory on the preferred NUMA node. If that
+   * fails, carry on with the plans below, which may return memory on
+   * any node. */
+  if (pref->node != NodeNONE) {
+    res = policyAllocOnNode(&tract, arena, pref, size, pool);
+    if (res == ResOK)
+      goto found;
+  }
+
   /* Plan A: allocate from the free land in the requested zones */
   zones = ZoneSetDiff(pref->zones, pref->avoid);
   if (zones != ZoneSetEMPTY) {
@@ -76,14 +142,14 @@ Res PolicyAlloc(Tract *tractReturn, Arena arena, LocusPref pref,
 
   /* Plan C: Extend the arena, then try A and B again. */
   if (moreZones != ZoneSetEMPTY) {
-    res = Method(Arena, arena, grow)(arena, pref, size);
+    res = policyGrow(arena, pref, size);
     /* If we can't extend because we hit the commit limit, try purging
        some spare committed memory and try again.*/
     /* TODO: This would be a good time to *remap* VM instead of
        returning it to the OS. */
     if (res == ResCOMMIT_LIMIT) {
       if (Method(Arena, arena, purgeSpare)(arena, size) >= size)
-        res = Method(Arena, arena, grow)(arena, pref, size);
+        res = policyGrow(arena, pref, size);
     }
     if (res == ResOK) {
       if (zones != ZoneSetEMPTY) {
@@ -131,6 +197,20 @@ found:
 }
 
 
+/* policyAverage -- update an exponential moving average of a rate
+ *
+ * A zero average means that there have been no observations yet.
+ * <design/strategy#.policy.pacing.rate>.
+ */
+
+static double policyAverage(double average, double rate)
+{
+  if (average == 0.0)
+    return rate;
+  return average * (1.0 - PolicyRateALPHA) + rate * PolicyRateALPHA;
+}
+
+
 /* policyCollectionTime -- estimate time to collect the world, in seconds */
 
 static double policyCollectionTime(Arena arena)
@@ -144,7 +224,9 @@ static double policyCollectionTime(Arena arena)
   collectableSize = ArenaCollectable(arena);
   /* The condition arena->tracedTime >= 1.0 ensures that the division
    * can't overflow. */
-  if (arena->tracedTime >= 1.0)
+  if (arena->adaptivePacing && arena->scanRate > 0.0)
+    collectionRate = arena->scanRate;
+  else if (arena->tracedTime >= 1.0)
     collectionRate = arena->tracedWork / arena->tracedTime;
   else
     collectionRate = ARENA_DEFAULT_COLLECTION_RATE;
@@ -198,6 +280,39 @@ Bool PolicyShouldCollectWorld(Arena arena, double availableTime,
 }
 
 
+/* policyCondemnGens -- condemn the lowest generations of a chain
+ *
+ * Condemn generation topCondemnedGen and all lower generations in the
+ * chain, except for segments already condemned by another trace (see
+ * <code/trace.c#whiten.disjoint>). If successful, set
+ * *mortalityReturn to an estimate of the mortality of the condemned
+ * memory and return ResOK.
+ */
+
+static Res policyCondemnGens(double *mortalityReturn, Chain chain,
+                             Trace trace, size_t topCondemnedGen)
+{
+  size_t i;
+  GenDesc gen;
+
+  AVER(mortalityReturn != NULL);
+  AVERT(Chain, chain);
+  AVERT(Trace, trace);
+  AVER(chain->arena == trace->arena);
+  AVER(topCondemnedGen < chain->genCount);
+
+  TraceCondemnStart(trace);
+  for (i = 0; i <= topCondemnedGen; ++i) {
+    gen = &chain->gens[i];
+    AVERT(GenDesc, gen);
+    GenDescStartTrace(gen, trace);
+  }
+  EVENT5(ChainCondemnAuto, chain->arena, chain, trace, topCondemnedGen,
+         chain->genCount);
+  return TraceCondemnEnd(mortalityReturn, trace);
+}
+
+
 /* policyCondemnChain -- condemn approriate parts of this chain
  *
  * If successful, set *mortalityReturn to an estimate of the mortality
@@ -206,12 +321,15 @@ Bool PolicyShouldCollectWorld(Arena arena, double availableTime,
  * This is only called if ChainDeferral returned a value sufficiently
  * low that we decided to start the collection. (Usually such values
  * are less than zero; see <design/strategy#.policy.start.chain>.)
+ * lead is the value that was passed to ChainDeferral.
  */
 
-static Res policyCondemnChain(double *mortalityReturn, Chain chain, Trace trace)
+static Res policyCondemnChain(double *mortalityReturn, Chain chain,
+                              Trace trace, double lead)
 {
-  size_t topCondemnedGen, i;
+  size_t topCondemnedGen;
   GenDesc gen;
+  double newSize;
 
   AVER(mortalityReturn != NULL);
   AVERT(Chain, chain);
@@ -230,21 +348,44 @@ static Res policyCondemnChain(double *mortalityReturn, Chain chain, Trace trace)
     -- topCondemnedGen;
     gen = &chain->gens[topCondemnedGen];
     AVERT(GenDesc, gen);
-    if (GenDescNewSize(gen) >= gen->capacity)
+    newSize = (double)GenDescNewSize(gen);
+    if (topCondemnedGen == 0)
+      newSize += lead;
+    if (newSize >= (double)gen->capacity)
       break;
   }
 
-  /* At this point, we've decided to condemn topCondemnedGen and all
-   * lower generations. */
-  TraceCondemnStart(trace);
-  for (i = 0; i <= topCondemnedGen; ++i) {
-    gen = &chain->gens[i];
-    AVERT(GenDesc, gen);
-    GenDescStartTrace(gen, trace);
-  }
-  EVENT5(ChainCondemnAuto, chain->arena, chain, trace, topCondemnedGen,
-         chain->genCount);
-  return TraceCondemnEnd(mortalityReturn, trace);
+  return policyCondemnGens(mortalityReturn, chain, trace, topCondemnedGen);
+}
+
+
+/* policyLead -- how far to bring forward a collection of a chain
+ *
+ * Return the amount of allocation that the mutator is expected to do
+ * while generation 0 of the chain is collected, if the arena uses
+ * adaptive pacing, so that the collection can be started in time to
+ * finish as the generation reaches its capacity.  Return zero
+ * otherwise.  <design/strategy#.policy.pacing.start>.
+ */
+
+static double policyLead(Arena arena, Chain chain)
+{
+  GenDesc gen;
+  double collectionRate, collectionTime, lead, leadMax;
+
+  if (!arena->adaptivePacing)
+    return 0.0;
+
+  gen = ChainGen(chain, 0);
+  if (gen->collectRate > 0.0)
+    collectionRate = gen->collectRate;
+  else
+    collectionRate = ARENA_DEFAULT_COLLECTION_RATE;
+  collectionTime = (double)gen->capacity / collectionRate;
+  lead = arena->allocRate * collectionTime
+    * (1.0 - PolicyPacingUTILIZATION) / PolicyPacingUTILIZATION;
+  leadMax = (double)gen->capacity * PolicyPacingLEADMAX;
+  return lead < leadMax ? lead : leadMax;
 }
 
 
@@ -259,6 +400,23 @@ static Res policyCondemnChain(double *mortalityReturn, Chain chain, Trace trace)
  *
  * If a trace was started, update *traceReturn and return TRUE.
  * Otherwise, leave *traceReturn unchanged and return FALSE.
+ *
+ * This may be called while other traces are running, in which case
+ * collectWorldAllowed must be FALSE.
+ *
+ * .nursery: If traces are running and no idle chain needs collecting,
+ * consider starting a nursery trace on a chain whose generation 0 has
+ * filled up again while an older-generation trace of that chain is in
+ * progress. The nursery trace condemns only generation 0, and only
+ * the segments that the running traces have not condemned (see
+ * <code/trace.c#whiten.disjoint>), so it can run alongside them. This
+ * avoids the nursery growing without limit during a long collection
+ * of the older generations.
+ *
+ * .finish: If the arena uses adaptive pacing, a chain's trace is
+ * scheduled to finish by the time generation 0 of the chain reaches
+ * its capacity, or as soon as possible if it already has.  See
+ * <design/strategy#.policy.pacing.finish>.
  */
 
 Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
@@ -275,6 +433,11 @@ Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
 
   AVER(traceReturn != NULL);
   AVERT(Arena, arena);
+  AVER(!collectWorldAllowed || arena->busyTraces == TraceSetEMPTY);
+
+  if (arena->busyTraces == TraceSetUNIV)
+    /* No trace is available. */
+    return FALSE;
 
   if (collectWorldAllowed) {
     Size sFoundation, sCondemned, sSurvivors, sConsTrace;
@@ -305,32 +468,63 @@ Bool PolicyStartTrace(Trace *traceReturn, Bool *collectWorldReturn,
   {
     /* Find the chain most over its capacity. */
     Ring node, nextNode;
-    double firstTime = 0.0;
+    double firstTime = 0.0, firstLead = 0.0;
     Chain firstChain = NULL;
+    TraceStartWhy why = TraceStartWhyCHAIN_GEN0CAP;
 
     RING_FOR(node, &arena->chainRing, nextNode) {
       Chain chain = RING_ELT(Chain, chainRing, node);
-      double time;
+      double time, lead;
 
       AVERT(Chain, chain);
-      time = ChainDeferral(chain);
+      lead = policyLead(arena, chain);
+      time = ChainDeferral(chain, lead);
       if (time < firstTime) {
-        firstTime = time; firstChain = chain;
+        firstTime = time; firstChain = chain; firstLead = lead;
+      }
+    }
+
+    /* If none was found, consider a nursery trace: see .nursery. */
+    if (firstChain == NULL && arena->busyTraces != TraceSetEMPTY) {
+      RING_FOR(node, &arena->chainRing, nextNode) {
+        Chain chain = RING_ELT(Chain, chainRing, node);
+        double time;
+
+        AVERT(Chain, chain);
+        time = ChainNurseryDeferral(chain);
+        if (time < firstTime) {
+          firstTime = time; firstChain = chain; firstLead = 0.0;
+        }
       }
+      why = TraceStartWhyCHAIN_NURSERY;
     }
 
     /* If one was found, start collection on that chain. */
     if(firstTime < 0) {
-      double mortality;
+      double mortality, finishingTime, headroom = 0.0;
 
-      res = TraceCreate(&trace, arena, TraceStartWhyCHAIN_GEN0CAP);
+      if (arena->adaptivePacing) {
+        /* Measure before condemning: see .finish. */
+        GenDesc gen = ChainGen(firstChain, 0);
+        headroom = (double)gen->capacity - (double)GenDescNewSize(gen);
+      }
+      res = TraceCreate(&trace, arena, why);
       AVER(res == ResOK);
-      res = policyCondemnChain(&mortality, firstChain, trace);
+      if (why == TraceStartWhyCHAIN_NURSERY)
+        res = policyCondemnGens(&mortality, firstChain, trace, 0);
+      else
+        res = policyCondemnChain(&mortality, firstChain, trace, firstLead);
       if (res != ResOK) /* should try some other trace, really @@@@ */
         goto failCondemn;
       if (TraceIsEmpty(trace))
         goto nothingCondemned;
-      res = TraceStart(trace, mortality, trace->condemned * TraceWorkFactor);
+      if (!arena->adaptivePacing)
+        finishingTime = trace->condemned * TraceWorkFactor;
+      else if (headroom > ArenaPollALLOCTIME)
+        finishingTime = headroom;
+      else
+        finishingTime = ArenaPollALLOCTIME;
+      res = TraceStart(trace, mortality, finishingTime);
       /* We don't expect normal GC traces to fail to start. */
       AVER(res == ResOK);
       *traceReturn = trace;
@@ -347,6 +541,29 @@ failStart:
 }
 
 
+/* policyPollDelay -- how far to let tracing work fall behind
+ *
+ * Return the amount of allocation by which adaptive pacing lets the
+ * scheduled tracing work fall behind before doing it, so that each
+ * increment takes about PolicyPacingINCREMENT seconds (or the pause
+ * time, if less) when the tracing has PolicyPacingUTILIZATION of the
+ * processor time.  <design/strategy#.policy.pacing.poll>.
+ */
+
+static double policyPollDelay(Arena arena)
+{
+  double increment = PolicyPacingINCREMENT, delay;
+
+  if (ArenaPauseTime(arena) < increment)
+    increment = ArenaPauseTime(arena);
+  delay = arena->allocRate * increment
+    * (1.0 - PolicyPacingUTILIZATION) / PolicyPacingUTILIZATION;
+  if (delay < ArenaPollALLOCTIME)
+    return 0.0;
+  return delay - ArenaPollALLOCTIME;
+}
+
+
 /* PolicyPoll -- do some tracing work?
  *
  * Return TRUE if the MPS should do some tracing work; FALSE if it
@@ -358,10 +575,65 @@ Bool PolicyPoll(Arena arena)
   Globals globals;
   AVERT(Arena, arena);
   globals = ArenaGlobals(arena);
+  if (arena->adaptivePacing)
+    return globals->pollThreshold + policyPollDelay(arena)
+      <= globals->fillMutatorSize;
   return globals->pollThreshold <= globals->fillMutatorSize;
 }
 
 
+/* policyNoteAllocation -- measure the allocation rate of the mutator
+ *
+ * Called at the end of a poll that started at start and ended at end.
+ * The mutator ran from the end of the previous poll until start.
+ * <design/strategy#.policy.pacing.rate>.
+ */
+
+static void policyNoteAllocation(Arena arena, Clock start, Clock end)
+{
+  Globals globals = ArenaGlobals(arena);
+  double seconds;
+
+  arena->rateClocks += start - arena->pollClock;
+  arena->pollClock = end;
+  seconds = (double)arena->rateClocks / (double)ClocksPerSec();
+  if (seconds >= PolicyRateINTERVAL) {
+    double rate = (globals->fillMutatorSize - arena->rateAlloc) / seconds;
+    arena->allocRate = policyAverage(arena->allocRate, rate);
+    arena->rateClocks = 0;
+    arena->rateAlloc = globals->fillMutatorSize;
+  }
+}
+
+
+/* policyPollAgainPaced -- do another unit of work, if behind schedule?
+ *
+ * This is PolicyPollAgain for arenas that use adaptive pacing.  Each
+ * call to TracePoll does the work scheduled for ArenaPollALLOCTIME
+ * bytes of allocation, so the MPS carries on only while the traces are
+ * behind schedule and the pause time allows.
+ * <design/strategy#.policy.pacing.poll>.
+ */
+
+static Bool policyPollAgainPaced(Arena arena, Clock start, Clock now,
+                                 Bool moreWork, Bool moreTime)
+{
+  Globals globals = ArenaGlobals(arena);
+
+  if (moreWork) {
+    globals->pollThreshold += ArenaPollALLOCTIME;
+    if (moreTime && globals->pollThreshold <= globals->fillMutatorSize)
+      return TRUE;
+  } else {
+    /* No more work to do.  Sleep until NOW + a bit. */
+    globals->pollThreshold = globals->fillMutatorSize + ArenaPollALLOCTIME;
+  }
+
+  policyNoteAllocation(arena, start, now);
+  return FALSE;
+}
+
+
 /* PolicyPollAgain -- do another unit of work?
  *
  * Return TRUE if the MPS should do another unit of work; FALSE if it
@@ -376,6 +648,7 @@ Bool PolicyPollAgain(Arena arena, Clock start, Bool moreWork, Work tracedWork)
   Bool moreTime;
   Globals globals;
   double nextPollThreshold;
+  Clock now;
 
   AVERT(Arena, arena);
   UNUSED(tracedWork);
@@ -384,7 +657,10 @@ Bool PolicyPollAgain(Arena arena, Clock start, Bool moreWork, Work tracedWork)
     return TRUE;
 
   /* Is there more work to do and more time to do it in? */
-  moreTime = (ClockNow() - start) < ArenaPauseTime(arena) * ClocksPerSec();
+  now = ClockNow();
+  moreTime = (now - start) < ArenaPauseTime(arena) * ClocksPerSec();
+  if (arena->adaptivePacing)
+    return policyPollAgainPaced(arena, start, now, moreWork, moreTime);
   if (moreWork && moreTime)
     return TRUE;
 
@@ -408,6 +684,37 @@ Bool PolicyPollAgain(Arena arena, Clock start, Bool moreWork, Work tracedWork)
 }
 
 
+/* PolicyTraceEnd -- measure the collection rates of a finished trace
+ *
+ * tracedWork is the work done by the trace.  Update the moving
+ * averages of the scanning rate of the arena, and of the collection
+ * rate of each generation condemned by the trace.
+ * <design/strategy#.policy.pacing.rate>.
+ */
+
+void PolicyTraceEnd(Trace trace, Work tracedWork)
+{
+  Arena arena;
+  double seconds;
+  Ring node, nextNode;
+
+  AVERT(Trace, trace);
+  arena = trace->arena;
+
+  if (trace->clocks == 0 || trace->condemned == 0)
+    return;
+  seconds = (double)trace->clocks / (double)ClocksPerSec();
+  arena->scanRate = policyAverage(arena->scanRate,
+                                  (double)tracedWork / seconds);
+  RING_FOR(node, &trace->genRing, nextNode) {
+    GenDesc gen = GenDescOfTraceRing(node, trace);
+    AVERT(GenDesc, gen);
+    gen->collectRate = policyAverage(gen->collectRate,
+                                     (double)trace->condemned / seconds);
+  }
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
@@ -29,6 +29,7 @@
  */
 
 #include "mpm.h"
+#include "sac.h"
 
 SRCID(pool, "$Id$");
 
@@ -41,10 +42,14 @@ Bool PoolClassCheck(PoolClass klass)
   CHECKL(klass->size >= sizeof(PoolStruct));
   CHECKL(AttrCheck(klass->attr));
   CHECKL(!(klass->attr & AttrMOVINGGC) || (klass->attr & AttrGC));
+  CHECKL(!(klass->attr & AttrPARSCAN) || (klass->attr & AttrGC));
+  CHECKL(!(klass->attr & AttrPARSWEEP) || (klass->attr & AttrGC));
   CHECKL(FUNCHECK(klass->varargs));
   CHECKL(FUNCHECK(klass->init));
   CHECKL(FUNCHECK(klass->alloc));
   CHECKL(FUNCHECK(klass->free));
+  CHECKL(FUNCHECK(klass->tryAlloc));
+  CHECKL(FUNCHECK(klass->tryFree));
   CHECKL(FUNCHECK(klass->segPoolGen));
   CHECKL(FUNCHECK(klass->bufferFill));
   CHECKL(FUNCHECK(klass->bufferEmpty));
@@ -61,6 +66,8 @@ Bool PoolClassCheck(PoolClass klass)
   /* Check that pool classes overide sets of related methods. */
   CHECKL((klass->init == PoolAbsInit) ==
          (klass->instClassStruct.finish == PoolAbsFinish));
+  CHECKL((klass->tryAlloc == PoolNoTryAlloc) ==
+         (klass->tryFree == PoolNoTryFree));
   CHECKL((klass->bufferFill == PoolNoBufferFill) ==
          (klass->bufferEmpty == PoolNoBufferEmpty));
   CHECKL((klass->framePush == PoolNoFramePush) ==
@@ -95,6 +102,9 @@ Bool PoolCheck(Pool pool)
   CHECKL(pool->alignment == PoolGrainsSize(pool, (Align)1));
   if (pool->format != NULL)
     CHECKD(Format, pool->format);
+  CHECKL(BoolCheck(pool->wantLock));
+  if (pool->lock != NULL)
+    CHECKL(LockCheck(pool->lock));
   return TRUE;
 }
 
@@ -104,6 +114,7 @@ Bool PoolCheck(Pool pool)
 ARG_DEFINE_KEY(FORMAT, Format);
 ARG_DEFINE_KEY(CHAIN, Chain);
 ARG_DEFINE_KEY(GEN, Cant);
+ARG_DEFINE_KEY(LAZY_SWEEP, Bool);
 ARG_DEFINE_KEY(RANK, Rank);
 ARG_DEFINE_KEY(EXTEND_BY, Size);
 ARG_DEFINE_KEY(LARGE_SIZE, Size);
@@ -145,7 +156,7 @@ Res PoolCreate(Pool *poolReturn, Arena arena,
 {
   Res res;
   Pool pool;
-  void *base;
+  void *base, *lock;
 
   AVER(poolReturn != NULL);
   AVERT(Arena, arena);
@@ -162,10 +173,22 @@ Res PoolCreate(Pool *poolReturn, Arena arena,
   res = PoolInit(pool, arena, klass, args);
   if (res != ResOK)
     goto failPoolInit;
+
+  /* .lock.create: A pool that can allocate without the arena lock */
+  /* gets a lock of its own. <design/pool#.lock> */
+  if (pool->wantLock && klass->tryAlloc != PoolNoTryAlloc) {
+    res = ControlAlloc(&lock, arena, LockSize());
+    if (res != ResOK)
+      goto failLockAlloc;
+    LockInit(lock);
+    pool->lock = lock;
+  }
  
   *poolReturn = pool; 
   return ResOK;
 
+failLockAlloc:
+  PoolFinish(pool);
 failPoolInit:
   ControlFree(arena, base, klass->size);
 failControlAlloc:
@@ -188,12 +211,22 @@ void PoolDestroy(Pool pool)
 {
   Arena arena;
   Size size;
+  Lock lock;
 
   AVERT(Pool, pool); 
   arena = pool->arena;
   size = ClassOfPoly(Pool, pool)->size;
+  lock = pool->lock;
+  if (pool->sacThreads != NULL)
+    SACThreadsDestroy(pool);
   PoolFinish(pool);
 
+  /* See .lock.create */
+  if (lock != NULL) {
+    LockFinish(lock);
+    ControlFree(arena, lock, LockSize());
+  }
+
   /* .space.free: Free the pool instance structure.  See .space.alloc */
   ControlFree(arena, pool, size);
 }
@@ -217,6 +250,7 @@ BufferClass PoolDefaultBufferClass(Pool pool)
 Res PoolAlloc(Addr *pReturn, Pool pool, Size size)
 {
   Res res;
+  Size fill = size;
 
   AVER_CRITICAL(pReturn != NULL);
   AVERT_CRITICAL(Pool, pool);
@@ -231,8 +265,16 @@ Res PoolAlloc(Addr *pReturn, Pool pool, Size size)
   AVER_CRITICAL(AddrIsAligned(*pReturn, pool->alignment));
 
   /* All PoolAllocs should advance the allocation clock, so we count */
-  /* it all in the fillMutatorSize field. */
-  ArenaGlobals(PoolArena(pool))->fillMutatorSize += size;
+  /* it all in the fillMutatorSize field, together with allocation */
+  /* under the pool lock since the last PoolAlloc. */
+  /* <design/pool#.lock.clock> */
+  if (pool->lock != NULL) {
+    LockClaim(pool->lock);
+    fill += pool->fastFillSize;
+    pool->fastFillSize = 0;
+    LockRelease(pool->lock);
+  }
+  ArenaGlobals(PoolArena(pool))->fillMutatorSize += fill;
 
   EVENT_CRITICAL3(PoolAlloc, pool, *pReturn, size);
 
@@ -257,6 +299,63 @@ void (PoolFree)(Pool pool, Addr old, Size size)
 }
 
 
+/* PoolTryAlloc -- allocate a block without the arena lock
+ *
+ * Returns FALSE if the pool can't allocate the block while holding
+ * only its own lock, in which case the caller must enter the arena
+ * and call PoolAlloc. <design/pool#.lock.fast>
+ */
+
+Bool PoolTryAlloc(Addr *pReturn, Pool pool, Size size)
+{
+  Bool b;
+
+  AVER_CRITICAL(pReturn != NULL);
+  AVER_CRITICAL(TESTT(Pool, pool));
+  AVER_CRITICAL(size > 0);
+
+  /* Events are only written with the arena lock held.
+     <design/telemetry#.thread.fast> */
+  if (pool->lock == NULL || EVENT_KIND_ON(Object))
+    return FALSE;
+
+  LockClaim(pool->lock);
+  b = (pool->fastFillSize < PoolFastFillLIMIT
+       && Method(Pool, pool, tryAlloc)(pReturn, pool, size));
+  if (b)
+    pool->fastFillSize += size;
+  LockRelease(pool->lock);
+  return b;
+}
+
+
+/* PoolTryFree -- free a block without the arena lock
+ *
+ * Returns FALSE if the pool can't free the block while holding only
+ * its own lock, in which case the caller must enter the arena and
+ * call PoolFree. <design/pool#.lock.fast>
+ */
+
+Bool PoolTryFree(Pool pool, Addr old, Size size)
+{
+  Bool b;
+
+  AVER_CRITICAL(TESTT(Pool, pool));
+  AVER_CRITICAL(old != NULL);
+  AVER_CRITICAL(size > 0);
+
+  /* Events are only written with the arena lock held.
+     <design/telemetry#.thread.fast> */
+  if (pool->lock == NULL || EVENT_KIND_ON(Object))
+    return FALSE;
+
+  LockClaim(pool->lock);
+  b = Method(Pool, pool, tryFree)(pool, old, size);
+  LockRelease(pool->lock);
+  return b;
+}
+
+
 /* PoolSegPoolGen -- get pool generation for a segment */
 
 PoolGen PoolSegPoolGen(Pool pool, Seg seg)
@@ -89,6 +89,10 @@ Res PoolAbsInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   pool->alignment = MPS_PF_ALIGN;
   pool->alignShift = SizeLog2(pool->alignment);
   pool->format = NULL;
+  pool->sacThreads = NULL;
+  pool->wantLock = FALSE;
+  pool->lock = NULL;
+  pool->fastFillSize = 0;
 
   if (ArgPick(&arg, args, MPS_KEY_FORMAT)) {
     Format format = arg.val.format;
@@ -125,6 +129,9 @@ void PoolAbsFinish(Inst inst)
  
   EVENT2(PoolFinish, pool, PoolArena(pool));
   
+  /* Thread caches were destroyed by PoolDestroy. */
+  AVER(pool->sacThreads == NULL);
+
   /* Detach the pool from the arena and format, and unsig it. */
   RingRemove(PoolArenaRing(pool));
 
@@ -161,6 +168,8 @@ DEFINE_CLASS(Pool, AbstractPool, klass)
   klass->init = PoolAbsInit;
   klass->alloc = PoolNoAlloc;
   klass->free = PoolNoFree;
+  klass->tryAlloc = PoolNoTryAlloc;
+  klass->tryFree = PoolNoTryFree;
   klass->bufferFill = PoolNoBufferFill;
   klass->bufferEmpty = PoolNoBufferEmpty;
   klass->rampBegin = PoolNoRampBegin;
@@ -238,6 +247,22 @@ void PoolTrivFree(Pool pool, Addr old, Size size)
   NOOP;                         /* trivial free has no effect */
 }
 
+Bool PoolNoTryAlloc(Addr *pReturn, Pool pool, Size size)
+{
+  AVER(pReturn != NULL);
+  AVER(TESTT(Pool, pool));
+  AVER(size > 0);
+  return FALSE;
+}
+
+Bool PoolNoTryFree(Pool pool, Addr old, Size size)
+{
+  AVER(TESTT(Pool, pool));
+  AVER(old != NULL);
+  AVER(size > 0);
+  return FALSE;
+}
+
 PoolGen PoolNoSegPoolGen(Pool pool, Seg seg)
 {
   AVERT(Pool, pool);
@@ -339,6 +364,9 @@ Res PoolAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                (WriteFP)pool->arena, (WriteFU)pool->arena->serial,
                "alignment $W\n", (WriteFW)pool->alignment,
                "alignShift $W\n", (WriteFW)pool->alignShift,
+               "wantLock $S\n", WriteFYesNo(pool->wantLock),
+               "lock $P\n", (WriteFP)pool->lock,
+               "fastFillSize $W\n", (WriteFW)pool->fastFillSize,
                NULL);
   if (res != ResOK)
     return res;
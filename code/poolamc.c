@@ -940,13 +940,15 @@ static Res AMCBufferFill(Addr *baseReturn, Addr *limitReturn,
   /* expressed via the pool generation. We rely on the arena to */
   /* organize locations appropriately.  */
   if (size < amc->extendBy) {
-    grainsSize = amc->extendBy; /* .extend-by.aligned */
+    /* .extend-by.aligned, <design/buffer#.fill.scale> */
+    grainsSize = amc->extendBy * BufferFillScale(buffer);
   } else {
     grainsSize = SizeArenaGrains(size, arena);
   }
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD_FIELD(args, amcKeySegGen, p, gen);
-    res = PoolGenAlloc(&seg, pgen, CLASS(amcSeg), grainsSize, args);
+    res = PoolGenAlloc(&seg, pgen, CLASS(amcSeg), grainsSize,
+                       BufferNode(buffer), args);
   } MPS_ARGS_END(args);
   if(res != ResOK)
     return res;
@@ -1239,8 +1241,10 @@ static Res amcSegWhiten(Seg seg, Trace trace)
   /* Ensure we are forwarding into the right generation. */
 
   /* see <design/poolamc#.gen.ramp> */
-  /* This switching needs to be more complex for multiple traces. */
-  AVER(TraceSetIsSingle(PoolArena(pool)->busyTraces));
+  /* .ramp.multi: Only the trace that condemns the ramp generation */
+  /* gets here with gen == amc->rampGen, and it is the same trace */
+  /* that leaves RampCOLLECTING in amcSegReclaim, so this switching */
+  /* is correct when other traces are running too. */
   if(amc->rampMode == RampBEGIN && gen == amc->rampGen) {
     BufferDetach(gen->forward, pool);
     amcBufSetGen(gen->forward, gen);
@@ -1376,7 +1380,10 @@ static Res amcSegScanNailed(Bool *totalReturn, ScanState ss, Pool pool,
 
     refset = ScanStateSummary(ss);
 
-    /* A rare event, which might prompt a rare defect to appear. */
+    /* A rare event, which might prompt a rare defect to appear.  Not
+       in a parallel scan, which doesn't use emergency mode, so the
+       arena lock is held <code/trace.c#par.event>. */
+    AVER(ss->fixLock == NULL);
     EVENT6(AMCScanNailed, loops, SegSummary(seg), ScanStateWhite(ss),
            ScanStateUnfixedSummary(ss), ss->fixedSummary, refset);
 
@@ -1409,7 +1416,11 @@ static Res amcSegScan(Bool *totalReturn, Seg seg, ScanState ss)
   amc = MustBeA(AMCZPool, pool);
   format = pool->format;
 
-  if(amcSegHasNailboard(seg)) {
+  /* The nailboard only records which objects are preserved for the */
+  /* traces the segment is nailed for (and so white for).  For any */
+  /* other trace, all the objects are grey and must be scanned. */
+  if(amcSegHasNailboard(seg)
+     && TraceSetInter(SegNailed(seg), ss->traces) != TraceSetEMPTY) {
     return amcSegScanNailed(totalReturn, ss, pool, seg, amc);
   }
 
@@ -1803,9 +1814,10 @@ static void amcSegReclaim(Seg seg, Trace trace)
   gen = amcSegGen(seg);
   AVERT_CRITICAL(amcGen, gen);
 
-  /* This switching needs to be more complex for multiple traces. */
-  AVER_CRITICAL(TraceSetIsSingle(PoolArena(pool)->busyTraces));
-  if(amc->rampMode == RampCOLLECTING) {
+  /* Leave RampCOLLECTING only when reclaiming for the trace that */
+  /* condemned the ramp generation.  See .ramp.multi. */
+  if(amc->rampMode == RampCOLLECTING
+     && TraceSetIsMember(amc->rampGen->pgen.gen->activeTraces, trace)) {
     if(amc->rampCount > 0) {
       /* Entered ramp mode before previous one was cleaned up */
       amc->rampMode = RampBEGIN;
@@ -1998,7 +2010,7 @@ DEFINE_CLASS(Pool, AMCZPool, klass)
   klass->instClassStruct.describe = AMCDescribe;
   klass->instClassStruct.finish = AMCFinish;
   klass->size = sizeof(AMCStruct);
-  klass->attr |= AttrMOVINGGC;
+  klass->attr |= AttrMOVINGGC | AttrPARSCAN; /* <code/trace.c#par> */
   klass->varargs = AMCVarargs;
   klass->init = AMCZInit;
   klass->bufferFill = AMCBufferFill;
@@ -33,7 +33,10 @@ static void amsSegBlacken(Seg seg, TraceSet traceSet);
 static Res amsSegWhiten(Seg seg, Trace trace);
 static Res amsSegScan(Bool *totalReturn, Seg seg, ScanState ss);
 static Res amsSegFix(Seg seg, ScanState ss, Ref *refIO);
+static void amsSegSweep(Seg seg, Trace trace);
+static void amsSegSweepDeferred(Seg seg);
 static void amsSegReclaim(Seg seg, Trace trace);
+static void amsSegLazySweep(Seg seg, Bool mayFree);
 static void amsSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
                        void *p, size_t s);
 
@@ -83,13 +86,25 @@ Bool AMSSegCheck(AMSSeg amsseg)
   CHECKL(BoolCheck(amsseg->marksChanged));
   CHECKL(BoolCheck(amsseg->ambiguousFixes));
   CHECKL(BoolCheck(amsseg->colourTablesInUse));
+  CHECKL(BoolCheck(amsseg->swept));
+  if (amsseg->swept) {
+    CHECKL(amsseg->colourTablesInUse);
+    CHECKL(amsseg->sweptFreeGrains <= amsseg->grains);
+  }
   CHECKD_NOSIG(BT, amsseg->nongreyTable);
   CHECKD_NOSIG(BT, amsseg->nonwhiteTable);
 
-  /* If tables are shared, they mustn't both be in use. */
+  /* A segment whose sweep is deferred still has its colour tables.
+     <design/poolams#.sweep.lazy> */
+  if (SegSweepIsDeferred(seg))
+    CHECKL(amsseg->colourTablesInUse);
+
+  /* If tables are shared, they mustn't both be in use, except between
+     sweep and reclaim. */
   CHECKL(!(amsseg->ams->shareAllocTable
            && amsseg->allocTableInUse
-           && amsseg->colourTablesInUse));
+           && amsseg->colourTablesInUse
+           && !amsseg->swept));
 
   return TRUE;
 }
@@ -266,6 +281,8 @@ static Res AMSSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   amsseg->allocTableInUse = FALSE;
   amsseg->firstFree = 0;
   amsseg->colourTablesInUse = FALSE;
+  amsseg->swept = FALSE;
+  amsseg->sweptFreeGrains = 0;
   amsseg->ams = ams;
   SetClassOfPoly(seg, CLASS(AMSSeg));
   amsseg->sig = AMSSegSig;
@@ -632,7 +649,9 @@ DEFINE_CLASS(Seg, AMSSeg, klass)
   klass->scan = amsSegScan;
   klass->fix = amsSegFix;
   klass->fixEmergency = amsSegFix;
+  klass->sweep = amsSegSweep;
   klass->reclaim = amsSegReclaim;
+  klass->lazySweep = amsSegLazySweep;
   klass->walk = amsSegWalk;
   AVERT(SegClass, klass);
 }
@@ -668,7 +687,7 @@ static Res AMSSegSizePolicy(Size *sizeReturn,
 /* AMSSegCreate -- create a single AMSSeg */
 
 static Res AMSSegCreate(Seg *segReturn, Pool pool, Size size,
-                        RankSet rankSet)
+                        Count scale, RankSet rankSet, Index node)
 {
   Seg seg;
   AMS ams;
@@ -688,15 +707,18 @@ static Res AMSSegCreate(Seg *segReturn, Pool pool, Size size,
   res = ams->segSize(&prefSize, pool, size, rankSet);
   if (res != ResOK)
     goto failSize;
+  /* Scale up segments for small requests: <design/buffer#.fill.scale> */
+  if (prefSize == ArenaGrainSize(arena))
+    prefSize *= scale;
 
   res = PoolGenAlloc(&seg, ams->pgen, (*ams->segClass)(), prefSize,
-                     argsNone);
+                     node, argsNone);
   if (res != ResOK) { /* try to allocate one that's just large enough */
     Size minSize = SizeArenaGrains(size, arena);
     if (minSize == prefSize)
       goto failSeg;
-    res = PoolGenAlloc(&seg, ams->pgen, (*ams->segClass)(), prefSize,
-                       argsNone);
+    res = PoolGenAlloc(&seg, ams->pgen, (*ams->segClass)(), minSize,
+                       node, argsNone);
     if (res != ResOK)
       goto failSeg;
   }
@@ -780,6 +802,7 @@ static Res AMSInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   Res res;
   Chain chain;
   Bool supportAmbiguous = AMS_SUPPORT_AMBIGUOUS_DEFAULT;
+  Bool lazySweep = AMS_LAZY_SWEEP_DEFAULT;
   unsigned gen = AMS_GEN_DEFAULT;
   ArgStruct arg;
   AMS ams;
@@ -799,6 +822,8 @@ static Res AMSInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
     gen = arg.val.u;
   if (ArgPick(&arg, args, MPS_KEY_AMS_SUPPORT_AMBIGUOUS))
     supportAmbiguous = arg.val.b;
+  if (ArgPick(&arg, args, MPS_KEY_LAZY_SWEEP))
+    lazySweep = arg.val.b;
 
   AVERT(Chain, chain);
   AVER(gen <= ChainGens(chain));
@@ -816,6 +841,7 @@ static Res AMSInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   /* .ambiguous.noshare: If the pool is required to support ambiguous */
   /* references, the alloc and white tables cannot be shared. */
   ams->shareAllocTable = !supportAmbiguous;
+  ams->lazySweep = lazySweep;
   ams->pgen = NULL;
 
   /* The next four might be overridden by a subclass. */
@@ -883,6 +909,11 @@ static Bool amsSegBufferFill(Addr *baseReturn, Addr *limitReturn,
   AVER(size > 0);
   AVERT(RankSet, rankSet);
 
+  /* Only now is the free space in the segment needed.
+     <design/poolams#.sweep.lazy> */
+  if (SegSweepIsDeferred(seg))
+    amsSegSweepDeferred(seg);
+
   requestedGrains = PoolSizeGrains(pool, size);
   if (amsseg->freeGrains < requestedGrains)
     /* Not enough space to satisfy the request. */
@@ -981,7 +1012,9 @@ static Res AMSBufferFill(Addr *baseReturn, Addr *limitReturn,
   }
 
   /* No segment had enough space, so make a new one. */
-  res = AMSSegCreate(&seg, pool, size, BufferRankSet(buffer));
+  res = AMSSegCreate(&seg, pool, size, BufferFillScale(buffer),
+                     BufferRankSet(buffer),
+                     BufferNode(buffer));
   if (res != ResOK)
     return res;
   b = SegBufferFill(baseReturn, limitReturn, seg, size, rankSet);
@@ -1554,73 +1587,127 @@ static void amsSegBlacken(Seg seg, TraceSet traceSet)
 }
 
 
-/* amsSegReclaim -- the segment reclamation method */
+/* amsSegSweepIsLazy -- should the sweep of a white segment be deferred?
+ *
+ * Only if the pool was so configured. See <design/poolams#.sweep.lazy>.
+ */
 
-static void amsSegReclaim(Seg seg, Trace trace)
+static Bool amsSegSweepIsLazy(AMSSeg amsseg)
 {
-  AMSSeg amsseg = MustBeA(AMSSeg, seg);
-  Pool pool = SegPool(seg);
-  PoolGen pgen = PoolSegPoolGen(pool, seg);
-  Count nowFree, grains, reclaimedGrains;
-  Size preservedInPlaceSize;
-  PoolDebugMixin debug;
+  return amsseg->ams->lazySweep;
+}
 
-  AVERT(Trace, trace);
 
-  /* It's a white seg, so it must have colour tables. */
-  AVER(amsseg->colourTablesInUse);
-  AVER(!amsseg->marksChanged); /* there must be nothing grey */
-  grains = amsseg->grains;
+/* amsSegSweepTables -- find the free grains in a white segment
+ *
+ * This counts the grains that are now free and makes the allocation
+ * table reflect them. It touches only the segment's own tables, not
+ * its memory.
+ */
 
-  /* Loop over all white blocks and splat them, if it's a debug class. */
-  debug = Method(Pool, pool, debugMixin)(pool);
-  if (debug != NULL) {
-    Index i, j = 0;
+static void amsSegSweepTables(AMSSeg amsseg)
+{
+  Count nowFree, grains;
 
-    while(j < grains && AMS_FIND_WHITE_RANGE(&i, &j, seg, j, grains)) {
-      AVER(!AMS_IS_INVALID_COLOUR(seg, i));
-      DebugPoolFreeSplat(pool, PoolAddrOfIndex(SegBase(seg), pool, i),
-                         PoolAddrOfIndex(SegBase(seg), pool, j));
-      ++j; /* we know next grain is not white */
-    }
-  }
+  /* It's a white seg, so it must have colour tables. */
+  AVER_CRITICAL(amsseg->colourTablesInUse);
+  AVER_CRITICAL(!amsseg->marksChanged); /* there must be nothing grey */
+  AVER_CRITICAL(!amsseg->swept);
+  grains = amsseg->grains;
 
   nowFree = BTCountResRange(amsseg->nonwhiteTable, 0, grains);
 
   /* If the free space is all after firstFree, keep on using firstFree. */
   /* It could have a more complicated condition, but not worth the trouble. */
   if (!amsseg->allocTableInUse && amsseg->firstFree + nowFree == grains) {
-    AVER(amsseg->firstFree == grains
-         || BTIsResRange(amsseg->nonwhiteTable,
-                         amsseg->firstFree, grains));
+    AVER_CRITICAL(amsseg->firstFree == grains
+                  || BTIsResRange(amsseg->nonwhiteTable,
+                                  amsseg->firstFree, grains));
   } else {
     if (amsseg->ams->shareAllocTable) {
       /* Stop using allocTable as the white table. */
       amsseg->allocTableInUse = TRUE;
     } else {
-      AVER(amsseg->allocTableInUse);
+      AVER_CRITICAL(amsseg->allocTableInUse);
       BTCopyRange(amsseg->nonwhiteTable, amsseg->allocTable, 0, grains);
     }
   }
 
-  reclaimedGrains = nowFree - amsseg->freeGrains;
+  amsseg->sweptFreeGrains = nowFree;
+  amsseg->swept = TRUE;
+}
+
+
+/* amsSegSweep -- the segment sweep method
+ *
+ * Called on the tracer's worker threads <code/trace.c#par.sweep>,
+ * which is safe because sweeping touches only the segment's own
+ * tables. The accounting is left to amsSegReclaim.
+ */
+
+static void amsSegSweep(Seg seg, Trace trace)
+{
+  AMSSeg amsseg = MustBeA_CRITICAL(AMSSeg, seg);
+
+  AVERT_CRITICAL(Trace, trace);
+
+  if (!amsSegSweepIsLazy(amsseg))
+    amsSegSweepTables(amsseg);
+}
+
+
+/* amsSegFreeSwept -- free the white grains found by the sweep
+ *
+ * Splats them, if it's a debug class, accounts for them, and turns
+ * off the colour tables. Returns the number of grains reclaimed.
+ */
+
+static Count amsSegFreeSwept(Seg seg)
+{
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+  Pool pool = SegPool(seg);
+  Count grains, reclaimedGrains;
+  PoolDebugMixin debug;
+
+  AVER(amsseg->swept);
+  grains = amsseg->grains;
+
+  /* Loop over all white blocks and splat them, if it's a debug class. */
+  debug = Method(Pool, pool, debugMixin)(pool);
+  if (debug != NULL) {
+    Index i, j = 0;
+
+    while(j < grains && AMS_FIND_WHITE_RANGE(&i, &j, seg, j, grains)) {
+      AVER(!AMS_IS_INVALID_COLOUR(seg, i));
+      DebugPoolFreeSplat(pool, PoolAddrOfIndex(SegBase(seg), pool, i),
+                         PoolAddrOfIndex(SegBase(seg), pool, j));
+      ++j; /* we know next grain is not white */
+    }
+  }
+
+  reclaimedGrains = amsseg->sweptFreeGrains - amsseg->freeGrains;
+  amsseg->swept = FALSE;
   AVER(amsseg->oldGrains >= reclaimedGrains);
   amsseg->oldGrains -= reclaimedGrains;
   amsseg->freeGrains += reclaimedGrains;
-  PoolGenAccountForReclaim(pgen, PoolGrainsSize(pool, reclaimedGrains), FALSE);
-  STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
-  /* preservedInPlaceCount is updated on fix */
-  preservedInPlaceSize = PoolGrainsSize(pool, amsseg->oldGrains);
-  GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
+  PoolGenAccountForReclaim(PoolSegPoolGen(pool, seg),
+                           PoolGrainsSize(pool, reclaimedGrains), FALSE);
 
-  /* Ensure consistency of segment even if are just about to free it */
   amsseg->colourTablesInUse = FALSE;
-  SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
+  return reclaimedGrains;
+}
+
 
-  if (amsseg->freeGrains == grains && !SegHasBuffer(seg)) {
-    /* No survivors */
+/* amsSegFreeIfEmpty -- free a segment with no survivors */
+
+static void amsSegFreeIfEmpty(Seg seg)
+{
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+  Pool pool = SegPool(seg);
+
+  if (amsseg->freeGrains == amsseg->grains && !SegHasBuffer(seg)) {
     AVER(amsseg->bufferedGrains == 0);
-    PoolGenFree(pgen, seg,
+    PoolGenFree(PoolSegPoolGen(pool, seg), seg,
                 PoolGrainsSize(pool, amsseg->freeGrains),
                 PoolGrainsSize(pool, amsseg->oldGrains),
                 PoolGrainsSize(pool, amsseg->newGrains),
@@ -1629,6 +1716,78 @@ static void amsSegReclaim(Seg seg, Trace trace)
 }
 
 
+/* amsSegReclaim -- the segment reclamation method
+ *
+ * If the segment has not already been swept in parallel, sweep it
+ * first, unless the sweep is to be deferred. The colour tables are
+ * unchanged by sweeping, so the white blocks can still be found
+ * afterwards.
+ */
+
+static void amsSegReclaim(Seg seg, Trace trace)
+{
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+  Pool pool = SegPool(seg);
+  PoolGen pgen = PoolSegPoolGen(pool, seg);
+  Count reclaimedGrains;
+  Size preservedInPlaceSize;
+
+  AVERT(Trace, trace);
+
+  if (amsSegSweepIsLazy(amsseg)) {
+    /* <design/poolams#.sweep.lazy> */
+    AVER(!amsseg->swept);
+    GenDescSweepDeferred(pgen->gen, trace,
+                         PoolGrainsSize(pool, amsseg->oldGrains));
+    SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
+    SegDeferSweep(seg);
+    return;
+  }
+
+  if (!amsseg->swept)
+    amsSegSweepTables(amsseg);
+  reclaimedGrains = amsSegFreeSwept(seg);
+  STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
+  /* preservedInPlaceCount is updated on fix */
+  preservedInPlaceSize = PoolGrainsSize(pool, amsseg->oldGrains);
+  GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
+
+  /* Ensure consistency of segment even if are just about to free it */
+  SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
+  amsSegFreeIfEmpty(seg);
+}
+
+
+/* amsSegSweepDeferred -- finish a deferred sweep, keeping the segment
+ *
+ * Called when the free space in the segment is needed for
+ * allocation. <design/poolams#.sweep.lazy>.
+ */
+
+static void amsSegSweepDeferred(Seg seg)
+{
+  AMSSeg amsseg = MustBeA(AMSSeg, seg);
+
+  SegUndeferSweep(seg);
+  amsSegSweepTables(amsseg);
+  (void)amsSegFreeSwept(seg);
+}
+
+
+/* amsSegLazySweep -- the segment lazy sweep method
+ *
+ * Finishes the deferred sweep and, if allowed, frees the segment if
+ * it turns out to have no survivors, as amsSegReclaim would have done.
+ */
+
+static void amsSegLazySweep(Seg seg, Bool mayFree)
+{
+  amsSegSweepDeferred(seg);
+  if (mayFree)
+    amsSegFreeIfEmpty(seg);
+}
+
+
 /* amsSegWalk -- walk formatted objects in AMC segment */
 
 static void amsSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
@@ -1776,6 +1935,7 @@ DEFINE_CLASS(Pool, AMSPool, klass)
   klass->instClassStruct.describe = AMSDescribe;
   klass->instClassStruct.finish = AMSFinish;
   klass->size = sizeof(AMSStruct);
+  klass->attr |= AttrPARSCAN | AttrPARSWEEP; /* <code/trace.c#par> */
   klass->varargs = AMSVarargs;
   klass->init = AMSInit;
   klass->bufferClass = RankBufClassGet;
@@ -1847,6 +2007,7 @@ Bool AMSCheck(AMS ams)
   CHECKL(FUNCHECK(ams->segSize));
   CHECKL(FUNCHECK(ams->segsDestroy));
   CHECKL(FUNCHECK(ams->segClass));
+  CHECKL(BoolCheck(ams->lazySweep));
 
   return TRUE;
 }
@@ -48,6 +48,7 @@ typedef struct AMSStruct {
   AMSSegsDestroyFunction segsDestroy;
   AMSSegClassFunction segClass;/* fn to get the class for segments */
   Bool shareAllocTable;        /* the alloc table is also used as white table */
+  Bool lazySweep;              /* defer sweeping, <design/poolams#.sweep.lazy> */
   Sig sig;                     /* <design/pool#.outer-structure.sig> */
 } AMSStruct;
 
@@ -67,6 +68,8 @@ typedef struct AMSSegStruct {
   Bool marksChanged;     /* seg has been marked since last scan */
   Bool ambiguousFixes;   /* seg has been ambiguously marked since last scan */
   Bool colourTablesInUse;/* the colour tables are in use */
+  Bool swept;            /* swept but not yet reclaimed? */
+  Count sweptFreeGrains; /* free grains found by sweep, if swept */
   BT nonwhiteTable;      /* set if grain not white */
   BT nongreyTable;       /* set if not first grain of grey object */
   Sig sig;
@@ -322,6 +322,9 @@ static Bool awlSegCanTrySingleAccess(Arena arena, Seg seg, Addr addr)
 {
   AWLSeg awlseg;
   AWL awl;
+  TraceId ti;
+  Trace trace;
+  Bool allWeak;
 
   AVERT(Arena, arena);
   AVERT(Seg, seg);
@@ -340,9 +343,14 @@ static Bool awlSegCanTrySingleAccess(Arena arena, Seg seg, Addr addr)
     return FALSE;
   }
 
-  /* The trace is already in the weak band, so we can scan the whole
-     segment without retention anyway.  Go for it. */
-  if (TraceRankForAccess(arena, seg) == RankWEAK)
+  /* The traces are all already in the weak band, so we can scan the
+     whole segment without retention anyway.  Go for it. */
+  allWeak = TRUE;
+  TRACE_SET_ITER(ti, trace, arena->flippedTraces, arena)
+    if (TraceRankForAccess(trace, seg) != RankWEAK)
+      allWeak = FALSE;
+  TRACE_SET_ITER_END(ti, trace, arena->flippedTraces, arena);
+  if (allWeak)
     return FALSE;
 
   awlseg = MustBeA(AWLSeg, seg);
@@ -660,7 +668,8 @@ static Res awlBufferFill(Addr *baseReturn, Addr *limitReturn,
   MPS_ARGS_BEGIN(args) {
     MPS_ARGS_ADD_FIELD(args, awlKeySegRankSet, u, BufferRankSet(buffer));
     res = PoolGenAlloc(&seg, awl->pgen, CLASS(AWLSeg),
-                       SizeArenaGrains(size, PoolArena(pool)), args);
+                       SizeArenaGrains(size, PoolArena(pool)),
+                       BufferNode(buffer), args);
   } MPS_ARGS_END(args);
   if (res != ResOK)
     return res;
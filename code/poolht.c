@@ -0,0 +1,1065 @@
+/* poolht.c: HASH TABLE POOL CLASS
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * DESIGN
+ *
+ * .design: <design/poolht>.
+ *
+ * TRANSGRESSIONS
+ *
+ * .addr.void-star: Like MRG (see <code/poolmrg.c#addr.void-star>),
+ * this pool accesses the key and value segments of its tables with
+ * C pointers, having exposed them with ShieldExpose.
+ */
+
+#include "mpscht.h"
+#include "mpm.h"
+
+SRCID(poolht, "$Id$");
+
+
+/* Slot states <design/poolht#.slot.state> */
+
+enum {
+  HTSlotFREE = 0,       /* never used since the table was built */
+  HTSlotUSED,           /* contains an entry */
+  HTSlotDELETED,        /* contained an entry that has been removed */
+  HTSlotMOVED           /* entry's key moved during this scan */
+};
+
+
+/* HTStruct -- hash table pool structure */
+
+#define HTSig           ((Sig)0x51947AB0) /* SIGnature Hash TABle pOol */
+
+typedef struct HTStruct *HT;
+typedef struct HTTableStruct *HTTable;
+typedef struct HTSegStruct *HTSeg;
+
+typedef struct HTStruct {
+  PoolStruct poolStruct;    /* generic pool structure */
+  RingStruct tableRing;     /* ring of tables in this pool */
+  Size totalSize;           /* total size of segments of tables */
+  Sig sig;                  /* <code/mps.h#sig> */
+} HTStruct;
+
+typedef HT HTPool;
+#define HTPoolCheck HTCheck
+DECLARE_CLASS(Pool, HTPool, AbstractPool);
+
+
+/* HTTableStruct -- hash table structure
+ *
+ * The table is the structure that the client refers to as an
+ * mps_ht_t. It is allocated from the control pool, so that its fields
+ * (and its slot states) can be accessed without going through the
+ * shield. <design/poolht#.table>
+ */
+
+#define HTTableSig      ((Sig)0x51947AB7) /* SIGnature Hash TABle Table */
+
+typedef struct HTTableStruct {
+  Sig sig;                  /* <code/mps.h#sig> */
+  HT ht;                    /* pool containing the table */
+  RingStruct htRing;        /* node in the pool's ring of tables */
+  Rank keyRank;             /* rank of references in key segment */
+  Rank valueRank;           /* rank of references in value segment */
+  Count length;             /* number of slots (a power of two) */
+  Count count;              /* number of slots in use */
+  Count deleted;            /* number of deleted slots */
+  unsigned char *state;     /* state of each slot */
+  Seg keySeg;               /* segment containing keys */
+  Seg valueSeg;             /* segment containing values */
+  Count reinsertCount;      /* entries reinserted by scanning */
+} HTTableStruct;
+
+
+/* HTSegStruct -- hash table segment structure
+ *
+ * Each table has two segments, one containing the keys and the other
+ * the values, so that they can have different ranks.
+ */
+
+#define HTSegSig        ((Sig)0x51947A55) /* SIGnature Hash TAble SeG */
+
+typedef struct HTSegStruct {
+  GCSegStruct gcSegStruct;  /* superclass fields must come first */
+  HTTable table;            /* table that owns this segment */
+  Sig sig;                  /* <code/misc.h#sig> */
+} HTSegStruct;
+
+DECLARE_CLASS(Seg, HTSeg, GCSeg);
+
+
+#define htTableKeys(table) ((Ref *)SegBase((table)->keySeg))
+#define htTableValues(table) ((Ref *)SegBase((table)->valueSeg))
+
+
+/* HTCheck -- check an HT pool */
+
+ATTRIBUTE_UNUSED
+static Bool HTCheck(HT ht)
+{
+  CHECKS(HT, ht);
+  CHECKC(HTPool, ht);
+  CHECKD(Pool, CouldBeA(AbstractPool, ht));
+  CHECKD_NOSIG(Ring, &ht->tableRing);
+  return TRUE;
+}
+
+
+/* HTTableCheck -- check a hash table */
+
+ATTRIBUTE_UNUSED
+static Bool HTTableCheck(HTTable table)
+{
+  CHECKS(HTTable, table);
+  CHECKU(HT, table->ht);
+  CHECKD_NOSIG(Ring, &table->htRing);
+  CHECKL(table->keyRank == RankEXACT || table->keyRank == RankWEAK);
+  CHECKL(table->valueRank == RankEXACT || table->valueRank == RankWEAK);
+  CHECKL(SizeIsP2(table->length));
+  CHECKL(table->count + table->deleted <= table->length);
+  CHECKL(table->state != NULL);
+  CHECKD(Seg, table->keySeg);
+  CHECKD(Seg, table->valueSeg);
+  CHECKL(SegSize(table->keySeg) == table->length * sizeof(Ref));
+  CHECKL(SegSize(table->valueSeg) == table->length * sizeof(Ref));
+  return TRUE;
+}
+
+
+/* HTSegCheck -- check a hash table segment */
+
+ATTRIBUTE_UNUSED
+static Bool HTSegCheck(HTSeg htseg)
+{
+  Seg seg = CouldBeA(Seg, htseg);
+  CHECKS(HTSeg, htseg);
+  CHECKD(GCSeg, &htseg->gcSegStruct);
+  CHECKL(SegRankSet(seg) == RankSetSingle(RankEXACT)
+         || SegRankSet(seg) == RankSetSingle(RankWEAK));
+  /* Can't check table: it's not attached until after initialization. */
+  return TRUE;
+}
+
+
+/* HTSegInit -- initialise a hash table segment */
+
+ARG_DEFINE_KEY(ht_seg_rank, Rank);
+#define htKeySegRank (&_mps_key_ht_seg_rank)
+
+static Res HTSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
+{
+  HTSeg htseg;
+  ArgStruct arg;
+  Rank rank;
+  Res res;
+
+  ArgRequire(&arg, args, htKeySegRank);
+  rank = (Rank)arg.val.rank;
+  AVER(rank == RankEXACT || rank == RankWEAK);
+
+  /* Initialize the superclass fields first via next-method call */
+  res = NextMethod(Seg, HTSeg, init)(seg, pool, base, size, args);
+  if (res != ResOK)
+    return res;
+  htseg = CouldBeA(HTSeg, seg);
+
+  /* <design/seg#.field.rankSet.start> */
+  SegSetRankSet(seg, RankSetSingle(rank));
+  htseg->table = NULL;
+
+  SetClassOfPoly(seg, CLASS(HTSeg));
+  htseg->sig = HTSegSig;
+  AVERC(HTSeg, htseg);
+
+  return ResOK;
+}
+
+
+/* htSegFinish -- finish a hash table segment */
+
+static void htSegFinish(Inst inst)
+{
+  Seg seg = MustBeA(Seg, inst);
+  HTSeg htseg = MustBeA(HTSeg, seg);
+
+  htseg->sig = SigInvalid;
+
+  /* finish the superclass fields last */
+  NextMethod(Inst, HTSeg, finish)(inst);
+}
+
+
+/* htHash -- hash an address to a slot index
+ *
+ * The top half of the word is folded into the bottom half, then mixed
+ * by a multiplicative hash. <design/poolht#.hash>
+ */
+
+#define htHashMULT      ((Word)2654435761UL)   /* 2^32 / golden ratio */
+
+static Index htHash(HTTable table, Ref key)
+{
+  Word h = (Word)key;
+  h ^= h >> (MPS_WORD_WIDTH / 2);
+  h *= htHashMULT;
+  h ^= h >> 15;
+  return (Index)(h & (table->length - 1));
+}
+
+
+/* htProbeFree -- find the first free or deleted slot for key */
+
+static Index htProbeFree(HTTable table, Ref key)
+{
+  Index i = htHash(table, key);
+  Count n;
+
+  for (n = 0; n < table->length; ++n) {
+    unsigned char state = table->state[i];
+    if (state == HTSlotFREE || state == HTSlotDELETED)
+      return i;
+    i = (i + 1) & (table->length - 1);
+  }
+  NOTREACHED; /* the caller guarantees that there is room */
+  return 0;
+}
+
+
+/* htReinsertMoved -- move entries whose keys moved to their new slots
+ *
+ * Called at the end of scanning a table's key segment (which is
+ * exposed), for the slots that htKeySegScan marked HTSlotMOVED.
+ * <design/poolht#.scan.reinsert>
+ */
+
+static void htReinsertMoved(HTTable table, Count moved)
+{
+  Arena arena = PoolArena(MustBeA(AbstractPool, table->ht));
+  Ref *keys = htTableKeys(table);
+  Ref *values;
+  Index i;
+
+  if (moved == 0)
+    return;
+
+  /* <design/poolht#.scan.reinsert.expose> */
+  ShieldExpose(arena, table->valueSeg);
+  values = htTableValues(table);
+  for (i = 0; i < table->length && moved > 0; ++i) {
+    if (table->state[i] == HTSlotMOVED) {
+      Ref key = keys[i];
+      Ref value = values[i];
+      --moved;
+      table->state[i] = HTSlotDELETED;
+      ++table->deleted;
+      keys[i] = NULL;
+      values[i] = NULL;
+      if (key == NULL) {
+        /* <design/poolht#.scan.weak.key> */
+        --table->count;
+      } else {
+        Index j = htProbeFree(table, key);
+        if (table->state[j] == HTSlotDELETED)
+          --table->deleted;
+        table->state[j] = HTSlotUSED;
+        keys[j] = key;
+        values[j] = value;
+        ++table->reinsertCount;
+      }
+    }
+  }
+  ShieldCover(arena, table->valueSeg);
+  AVER(moved == 0);
+}
+
+
+/* htKeySegScan -- scan the keys of a table
+ *
+ * <design/poolht#.scan.key>
+ */
+
+static Res htKeySegScan(Bool *totalReturn, HTTable table, ScanState ss)
+{
+  Ref *keys = htTableKeys(table);
+  Count moved = 0;
+  Res res = ResOK;
+  Index i;
+
+  TRACE_SCAN_BEGIN(ss) {
+    for (i = 0; i < table->length; ++i) {
+      if (table->state[i] == HTSlotUSED) {
+        Ref key = keys[i];
+        if (TRACE_FIX1(ss, key)) {
+          res = TRACE_FIX2(ss, &keys[i]);
+          if (res != ResOK)
+            break;
+          if (keys[i] != key) {
+            table->state[i] = HTSlotMOVED;
+            ++moved;
+          }
+        }
+        ss->scannedSize += sizeof(Ref);
+      }
+    }
+  } TRACE_SCAN_END(ss);
+
+  /* <design/poolht#.scan.reinsert.fail> */
+  htReinsertMoved(table, moved);
+
+  *totalReturn = (res == ResOK);
+  return res;
+}
+
+
+/* htValueSegScan -- scan the values of a table
+ *
+ * <design/poolht#.scan.value>
+ */
+
+static Res htValueSegScan(Bool *totalReturn, HTTable table, ScanState ss)
+{
+  Ref *values = htTableValues(table);
+  Index i;
+
+  TRACE_SCAN_BEGIN(ss) {
+    for (i = 0; i < table->length; ++i) {
+      if (table->state[i] == HTSlotUSED) {
+        Ref value = values[i];
+        if (TRACE_FIX1(ss, value)) {
+          Res res = TRACE_FIX2(ss, &values[i]);
+          if (res != ResOK) {
+            *totalReturn = FALSE;
+            return res;
+          }
+          if (values[i] == NULL && value != NULL) {
+            /* <design/poolht#.scan.weak.value> */
+            table->state[i] = HTSlotDELETED;
+            --table->count;
+            ++table->deleted;
+          }
+        }
+        ss->scannedSize += sizeof(Ref);
+      }
+    }
+  } TRACE_SCAN_END(ss);
+
+  *totalReturn = TRUE;
+  return ResOK;
+}
+
+
+/* htSegScan -- scan method for hash table segments */
+
+static Res htSegScan(Bool *totalReturn, Seg seg, ScanState ss)
+{
+  HTSeg htseg = MustBeA(HTSeg, seg);
+  HTTable table = htseg->table;
+
+  AVERT(ScanState, ss);
+  AVERT(HTTable, table);
+
+  if (seg == table->keySeg)
+    return htKeySegScan(totalReturn, table, ss);
+  AVER(seg == table->valueSeg);
+  return htValueSegScan(totalReturn, table, ss);
+}
+
+
+/* HTSegClass -- class definition */
+
+DEFINE_CLASS(Seg, HTSeg, klass)
+{
+  INHERIT_CLASS(klass, HTSeg, GCSeg);
+  SegClassMixInNoSplitMerge(klass);  /* no support for this */
+  klass->instClassStruct.finish = htSegFinish;
+  klass->size = sizeof(HTSegStruct);
+  klass->init = HTSegInit;
+  klass->scan = htSegScan;
+  AVERT(SegClass, klass);
+}
+
+
+/* htSegCreate -- create a key or value segment for a table */
+
+static Res htSegCreate(Seg *segReturn, HT ht, Rank rank, Count length)
+{
+  Pool pool = MustBeA(AbstractPool, ht);
+  Seg seg;
+  Ref *base;
+  Index i;
+  Res res;
+
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD_FIELD(args, htKeySegRank, rank, rank);
+    res = SegAlloc(&seg, CLASS(HTSeg), LocusPrefDefault(),
+                   length * sizeof(Ref), pool, args);
+  } MPS_ARGS_END(args);
+  if (res != ResOK)
+    return res;
+
+  /* A new segment is not grey, so it can't have a read barrier. */
+  ShieldExpose(PoolArena(pool), seg);
+  base = (Ref *)SegBase(seg);
+  for (i = 0; i < length; ++i)
+    base[i] = NULL;
+  ShieldCover(PoolArena(pool), seg);
+
+  ht->totalSize += SegSize(seg);
+  *segReturn = seg;
+  return ResOK;
+}
+
+
+static void htSegDestroy(HT ht, Seg seg)
+{
+  AVER(ht->totalSize >= SegSize(seg));
+  ht->totalSize -= SegSize(seg);
+  SegFree(seg);
+}
+
+
+/* htTableAccess -- prepare to access a table's segments
+ *
+ * The MPS accesses the table on behalf of the mutator, so it treats
+ * the access as if the mutator had hit the barriers on both of the
+ * table's segments, and then exposes them. The caller must call
+ * htTableCover afterwards. <design/poolht#.access>
+ */
+
+static void htTableAccess(HTTable table)
+{
+  Arena arena = PoolArena(MustBeA(AbstractPool, table->ht));
+  AccessSet mode = AccessREAD | AccessWRITE;
+
+  /* Scanning the key segment may write to the value segment
+     (.scan.reinsert), so access the keys first. */
+  if (BS_INTER(SegSM(table->keySeg), mode) != AccessSetEMPTY)
+    TraceSegAccess(arena, table->keySeg, mode);
+  if (BS_INTER(SegSM(table->valueSeg), mode) != AccessSetEMPTY)
+    TraceSegAccess(arena, table->valueSeg, mode);
+  ShieldExpose(arena, table->keySeg);
+  ShieldExpose(arena, table->valueSeg);
+}
+
+static void htTableCover(HTTable table)
+{
+  Arena arena = PoolArena(MustBeA(AbstractPool, table->ht));
+  ShieldCover(arena, table->valueSeg);
+  ShieldCover(arena, table->keySeg);
+}
+
+
+/* htTableFind -- find a key in an exposed table
+ *
+ * If the key is found, update *indexReturn to its slot and return
+ * TRUE. Otherwise update *indexReturn to the slot where it should be
+ * inserted (or to table->length if there is no room) and return FALSE.
+ */
+
+static Bool htTableFind(Index *indexReturn, HTTable table, Ref key)
+{
+  Ref *keys = htTableKeys(table);
+  Index i = htHash(table, key);
+  Index avail = table->length;
+  Count n;
+
+  for (n = 0; n < table->length; ++n) {
+    switch (table->state[i]) {
+    case HTSlotFREE:
+      *indexReturn = avail < table->length ? avail : i;
+      return FALSE;
+    case HTSlotUSED:
+      if (keys[i] == key) {
+        *indexReturn = i;
+        return TRUE;
+      }
+      break;
+    case HTSlotDELETED:
+      if (avail == table->length)
+        avail = i;
+      break;
+    default:
+      NOTREACHED;
+      break;
+    }
+    i = (i + 1) & (table->length - 1);
+  }
+  *indexReturn = avail;
+  return FALSE;
+}
+
+
+/* htTableSet -- store an entry in an exposed slot
+ *
+ * The caller must add the key and value to the summaries of the
+ * segments (compare ArenaPokeSeg).
+ */
+
+static void htTableSet(HTTable table, Index i, Ref key, Ref value)
+{
+  AVER(i < table->length);
+  htTableKeys(table)[i] = key;
+  htTableValues(table)[i] = value;
+}
+
+
+/* htTableRebuild -- rebuild a table with a new length
+ *
+ * The entries are copied to new segments, discarding the deleted
+ * slots. The table must be exposed, and it is exposed on return.
+ * <design/poolht#.rebuild>
+ */
+
+static Res htTableRebuild(HTTable table, Count length)
+{
+  HT ht = table->ht;
+  Arena arena = PoolArena(MustBeA(AbstractPool, ht));
+  Seg keySeg, valueSeg, oldKeySeg, oldValueSeg;
+  unsigned char *state, *oldState;
+  void *p;
+  Ref *oldKeys, *oldValues;
+  RefSet keySummary = RefSetEMPTY, valueSummary = RefSetEMPTY;
+  Count oldLength;
+  Index i;
+  Res res;
+
+  AVER(SizeIsP2(length));
+  AVER(table->count < length);
+
+  res = ControlAlloc(&p, arena, length);
+  if (res != ResOK)
+    goto failState;
+  state = p;
+  res = htSegCreate(&keySeg, ht, table->keyRank, length);
+  if (res != ResOK)
+    goto failKeySeg;
+  res = htSegCreate(&valueSeg, ht, table->valueRank, length);
+  if (res != ResOK)
+    goto failValueSeg;
+  for (i = 0; i < length; ++i)
+    state[i] = HTSlotFREE;
+
+  oldKeySeg = table->keySeg;
+  oldValueSeg = table->valueSeg;
+  oldState = table->state;
+  oldLength = table->length;
+  oldKeys = htTableKeys(table);
+  oldValues = htTableValues(table);
+
+  MustBeA(HTSeg, keySeg)->table = table;
+  MustBeA(HTSeg, valueSeg)->table = table;
+  ShieldExpose(arena, keySeg);
+  ShieldExpose(arena, valueSeg);
+  table->keySeg = keySeg;
+  table->valueSeg = valueSeg;
+  table->state = state;
+  table->length = length;
+  table->deleted = 0;
+  for (i = 0; i < oldLength; ++i) {
+    if (oldState[i] == HTSlotUSED) {
+      Index j = htProbeFree(table, oldKeys[i]);
+      table->state[j] = HTSlotUSED;
+      htTableSet(table, j, oldKeys[i], oldValues[i]);
+      keySummary = RefSetAdd(arena, keySummary, oldKeys[i]);
+      valueSummary = RefSetAdd(arena, valueSummary, oldValues[i]);
+    }
+  }
+  SegSetSummary(keySeg, keySummary);
+  SegSetSummary(valueSeg, valueSummary);
+
+  ShieldCover(arena, oldValueSeg);
+  ShieldCover(arena, oldKeySeg);
+  htSegDestroy(ht, oldValueSeg);
+  htSegDestroy(ht, oldKeySeg);
+  ControlFree(arena, oldState, oldLength);
+  AVERT(HTTable, table);
+  return ResOK;
+
+failValueSeg:
+  htSegDestroy(ht, keySeg);
+failKeySeg:
+  ControlFree(arena, state, length);
+failState:
+  return res;
+}
+
+
+/* HTTableCreate -- create a hash table */
+
+static Res HTTableCreate(HTTable *tableReturn, HT ht,
+                         Rank keyRank, Rank valueRank)
+{
+  Arena arena = PoolArena(MustBeA(AbstractPool, ht));
+  HTTable table;
+  Count length;
+  void *p;
+  Index i;
+  Res res;
+
+  AVER(tableReturn != NULL);
+  AVER(keyRank == RankEXACT || keyRank == RankWEAK);
+  AVER(valueRank == RankEXACT || valueRank == RankWEAK);
+
+  /* <design/poolht#.length.min> */
+  length = ArenaGrainSize(arena) / sizeof(Ref);
+
+  res = ControlAlloc(&p, arena, sizeof(HTTableStruct));
+  if (res != ResOK)
+    goto failTable;
+  table = p;
+  res = ControlAlloc(&p, arena, length);
+  if (res != ResOK)
+    goto failState;
+  table->state = p;
+  res = htSegCreate(&table->keySeg, ht, keyRank, length);
+  if (res != ResOK)
+    goto failKeySeg;
+  res = htSegCreate(&table->valueSeg, ht, valueRank, length);
+  if (res != ResOK)
+    goto failValueSeg;
+
+  for (i = 0; i < length; ++i)
+    table->state[i] = HTSlotFREE;
+  table->ht = ht;
+  RingInit(&table->htRing);
+  table->keyRank = keyRank;
+  table->valueRank = valueRank;
+  table->length = length;
+  table->count = 0;
+  table->deleted = 0;
+  table->reinsertCount = 0;
+  MustBeA(HTSeg, table->keySeg)->table = table;
+  MustBeA(HTSeg, table->valueSeg)->table = table;
+  RingAppend(&ht->tableRing, &table->htRing);
+
+  table->sig = HTTableSig;
+  AVERT(HTTable, table);
+  *tableReturn = table;
+  return ResOK;
+
+failValueSeg:
+  htSegDestroy(ht, table->keySeg);
+failKeySeg:
+  ControlFree(arena, table->state, length);
+failState:
+  ControlFree(arena, table, sizeof(HTTableStruct));
+failTable:
+  return res;
+}
+
+
+/* HTTableDestroy -- destroy a hash table */
+
+static void HTTableDestroy(HTTable table)
+{
+  HT ht = table->ht;
+  Arena arena = PoolArena(MustBeA(AbstractPool, ht));
+
+  AVERT(HTTable, table);
+
+  RingRemove(&table->htRing);
+  RingFinish(&table->htRing);
+  htSegDestroy(ht, table->valueSeg);
+  htSegDestroy(ht, table->keySeg);
+  ControlFree(arena, table->state, table->length);
+  table->sig = SigInvalid;
+  ControlFree(arena, table, sizeof(HTTableStruct));
+}
+
+
+/* htTableTidy -- rebuild an exposed table if it has many deleted slots
+ *
+ * Scanning may delete entries (.scan.reinsert), so a table that is
+ * only read may fill up with deleted slots. Failure to rebuild is not
+ * an error. <design/poolht#.rebuild.when>
+ */
+
+static void htTableTidy(HTTable table)
+{
+  if (table->deleted * 4 > table->length)
+    (void)htTableRebuild(table, table->length);
+}
+
+
+/* HTTableGet -- look up a key */
+
+static Bool HTTableGet(Ref *valueReturn, HTTable table, Ref key)
+{
+  Index i;
+  Bool found;
+
+  AVER(valueReturn != NULL);
+  AVERT(HTTable, table);
+
+  htTableAccess(table);
+  htTableTidy(table);
+  found = htTableFind(&i, table, key);
+  if (found)
+    *valueReturn = htTableValues(table)[i];
+  htTableCover(table);
+  return found;
+}
+
+
+/* HTTablePut -- add an entry or replace the value of an entry
+ *
+ * <design/poolht#.rebuild.when>
+ */
+
+static Res HTTablePut(HTTable table, Ref key, Ref value)
+{
+  Arena arena = PoolArena(MustBeA(AbstractPool, table->ht));
+  Index i;
+  Res res = ResOK;
+
+  AVERT(HTTable, table);
+
+  htTableAccess(table);
+  if (!htTableFind(&i, table, key)) {
+    if ((table->count + table->deleted + 1) * 4 > table->length * 3) {
+      Count length = table->length;
+      if ((table->count + 1) * 2 > length)
+        length *= 2;
+      res = htTableRebuild(table, length);
+      if (res != ResOK)
+        goto done;
+      (void)htTableFind(&i, table, key);
+    }
+    AVER(i < table->length);
+    if (table->state[i] == HTSlotDELETED)
+      --table->deleted;
+    table->state[i] = HTSlotUSED;
+    ++table->count;
+  }
+  htTableSet(table, i, key, value);
+  SegSetSummary(table->keySeg,
+                RefSetAdd(arena, SegSummary(table->keySeg), key));
+  SegSetSummary(table->valueSeg,
+                RefSetAdd(arena, SegSummary(table->valueSeg), value));
+
+done:
+  htTableCover(table);
+  return res;
+}
+
+
+/* HTTableRemove -- remove an entry */
+
+static Bool HTTableRemove(HTTable table, Ref key)
+{
+  Index i;
+  Bool found;
+
+  AVERT(HTTable, table);
+
+  htTableAccess(table);
+  htTableTidy(table);
+  found = htTableFind(&i, table, key);
+  if (found) {
+    table->state[i] = HTSlotDELETED;
+    --table->count;
+    ++table->deleted;
+    htTableKeys(table)[i] = NULL;
+    htTableValues(table)[i] = NULL;
+  }
+  htTableCover(table);
+  return found;
+}
+
+
+/* HTInit -- init method for HT */
+
+static Res HTInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
+{
+  HT ht;
+  Res res;
+
+  AVER(pool != NULL);
+  AVERT(Arena, arena);
+  AVERT(ArgList, args);
+  UNUSED(klass); /* used for debug pools only */
+
+  res = NextMethod(Pool, HTPool, init)(pool, arena, klass, args);
+  if (res != ResOK)
+    return res;
+  ht = CouldBeA(HTPool, pool);
+
+  RingInit(&ht->tableRing);
+  ht->totalSize = 0;
+
+  SetClassOfPoly(pool, CLASS(HTPool));
+  ht->sig = HTSig;
+  AVERC(HTPool, ht);
+
+  return ResOK;
+}
+
+
+/* HTFinish -- finish an HT pool, destroying its tables */
+
+static void HTFinish(Inst inst)
+{
+  Pool pool = MustBeA(AbstractPool, inst);
+  HT ht = MustBeA(HTPool, pool);
+  Ring node, nextNode;
+
+  RING_FOR(node, &ht->tableRing, nextNode) {
+    HTTable table = RING_ELT(HTTable, htRing, node);
+    HTTableDestroy(table);
+  }
+  AVER(ht->totalSize == 0);
+
+  ht->sig = SigInvalid;
+  RingFinish(&ht->tableRing);
+
+  NextMethod(Inst, HTPool, finish)(inst);
+}
+
+
+/* HTTotalSize -- total memory allocated from the arena */
+
+static Size HTTotalSize(Pool pool)
+{
+  HT ht = MustBeA(HTPool, pool);
+  return ht->totalSize;
+}
+
+
+/* HTFreeSize -- free memory (unused by client program)
+ *
+ * The unused slots of tables aren't counted as free, because the
+ * client program can't allocate from them.
+ */
+
+static Size HTFreeSize(Pool pool)
+{
+  UNUSED(MustBeA(HTPool, pool));
+  return 0;
+}
+
+
+/* HTDescribe -- describe an HT pool */
+
+static Res HTDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
+{
+  Pool pool = CouldBeA(AbstractPool, inst);
+  HT ht = CouldBeA(HTPool, pool);
+  Ring node, nextNode;
+  Res res;
+
+  if (!TESTC(HTPool, ht))
+    return ResPARAM;
+  if (stream == NULL)
+    return ResPARAM;
+
+  res = NextMethod(Inst, HTPool, describe)(inst, stream, depth);
+  if (res != ResOK)
+    return res;
+
+  res = WriteF(stream, depth + 2,
+               "totalSize $U\n", (WriteFU)ht->totalSize,
+               NULL);
+  if (res != ResOK)
+    return res;
+
+  RING_FOR(node, &ht->tableRing, nextNode) {
+    HTTable table = RING_ELT(HTTable, htRing, node);
+    res = WriteF(stream, depth + 2,
+                 "Table $P {\n", (WriteFP)table,
+                 "  keyRank $U valueRank $U\n",
+                 (WriteFU)table->keyRank, (WriteFU)table->valueRank,
+                 "  length $U count $U deleted $U\n",
+                 (WriteFU)table->length, (WriteFU)table->count,
+                 (WriteFU)table->deleted,
+                 "  reinsertCount $U\n", (WriteFU)table->reinsertCount,
+                 "} Table $P\n", (WriteFP)table,
+                 NULL);
+    if (res != ResOK)
+      return res;
+  }
+
+  return ResOK;
+}
+
+
+DEFINE_CLASS(Pool, HTPool, klass)
+{
+  INHERIT_CLASS(klass, HTPool, AbstractPool);
+  klass->instClassStruct.describe = HTDescribe;
+  klass->instClassStruct.finish = HTFinish;
+  klass->size = sizeof(HTStruct);
+  klass->init = HTInit;
+  klass->totalSize = HTTotalSize;
+  klass->freeSize = HTFreeSize;
+  AVERT(PoolClass, klass);
+}
+
+
+/* mps_class_ht -- return the pool class descriptor to the client */
+
+mps_pool_class_t mps_class_ht(void)
+{
+  return (mps_pool_class_t)CLASS(HTPool);
+}
+
+
+/* Client interface <design/poolht#.if>
+ *
+ * .if.copy: Values are copied to and from client memory outside the
+ * arena lock, because client memory might be protected (compare
+ * <code/ld.c#ld.access>).
+ */
+
+mps_res_t mps_ht_create(mps_ht_t *mps_ht_o, mps_pool_t mps_pool,
+                        mps_rank_t key_rank, mps_rank_t value_rank)
+{
+  Pool pool = (Pool)mps_pool;
+  Arena arena;
+  HTTable table = NULL; /* suppress "may be used uninitialized" */
+  Res res;
+
+  AVER(mps_ht_o != NULL);
+  AVER(TESTT(Pool, pool));
+  arena = PoolArena(pool);
+
+  ArenaEnter(arena);
+  res = HTTableCreate(&table, MustBeA(HTPool, pool),
+                      (Rank)key_rank, (Rank)value_rank);
+  ArenaLeave(arena);
+
+  if (res != ResOK)
+    return (mps_res_t)res;
+  *mps_ht_o = (mps_ht_t)table;
+  return MPS_RES_OK;
+}
+
+void mps_ht_destroy(mps_ht_t mps_ht)
+{
+  HTTable table = (HTTable)mps_ht;
+  Arena arena;
+
+  AVER(TESTT(HTTable, table));
+  arena = PoolArena(CouldBeA(AbstractPool, table->ht));
+
+  ArenaEnter(arena);
+  HTTableDestroy(table);
+  ArenaLeave(arena);
+}
+
+mps_bool_t mps_ht_get(mps_addr_t *value_o, mps_ht_t mps_ht,
+                      mps_addr_t key)
+{
+  HTTable table = (HTTable)mps_ht;
+  Arena arena;
+  Ref value = NULL;
+  Bool found;
+
+  AVER(value_o != NULL);
+  AVER(TESTT(HTTable, table));
+  arena = PoolArena(CouldBeA(AbstractPool, table->ht));
+
+  ArenaEnter(arena);
+  found = HTTableGet(&value, table, (Ref)key);
+  ArenaLeave(arena);
+
+  if (found)
+    *value_o = (mps_addr_t)value; /* .if.copy */
+  return (mps_bool_t)found;
+}
+
+mps_res_t mps_ht_put(mps_ht_t mps_ht, mps_addr_t key, mps_addr_t value)
+{
+  HTTable table = (HTTable)mps_ht;
+  Arena arena;
+  Res res;
+
+  AVER(TESTT(HTTable, table));
+  AVER(key != NULL);
+  arena = PoolArena(CouldBeA(AbstractPool, table->ht));
+
+  ArenaEnter(arena);
+  res = HTTablePut(table, (Ref)key, (Ref)value);
+  ArenaLeave(arena);
+
+  return (mps_res_t)res;
+}
+
+mps_bool_t mps_ht_remove(mps_ht_t mps_ht, mps_addr_t key)
+{
+  HTTable table = (HTTable)mps_ht;
+  Arena arena;
+  Bool found;
+
+  AVER(TESTT(HTTable, table));
+  arena = PoolArena(CouldBeA(AbstractPool, table->ht));
+
+  ArenaEnter(arena);
+  found = HTTableRemove(table, (Ref)key);
+  ArenaLeave(arena);
+
+  return (mps_bool_t)found;
+}
+
+size_t mps_ht_count(mps_ht_t mps_ht)
+{
+  HTTable table = (HTTable)mps_ht;
+  Arena arena;
+  Count count;
+
+  AVER(TESTT(HTTable, table));
+  arena = PoolArena(CouldBeA(AbstractPool, table->ht));
+
+  ArenaEnter(arena);
+  AVERT(HTTable, table);
+  count = table->count;
+  ArenaLeave(arena);
+
+  return (size_t)count;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
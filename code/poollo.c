@@ -25,6 +25,7 @@ typedef struct LOStruct {
   PoolStruct poolStruct;        /* generic pool structure */
   PoolGenStruct pgenStruct;     /* generation representing the pool */
   PoolGen pgen;                 /* NULL or pointer to pgenStruct */
+  Bool lazySweep;               /* defer sweeping, <design/poollo#.sweep.lazy> */
   Sig sig;                      /* <code/misc.h#sig> */
 } LOStruct;
 
@@ -73,6 +74,8 @@ static void loSegBufferEmpty(Seg seg, Buffer buffer);
 static Res loSegWhiten(Seg seg, Trace trace);
 static Res loSegFix(Seg seg, ScanState ss, Ref *refIO);
 static void loSegReclaim(Seg seg, Trace trace);
+static void loSegSweepDeferred(Seg seg);
+static void loSegLazySweep(Seg seg, Bool mayFree);
 static void loSegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
                       void *p, size_t s);
 
@@ -92,6 +95,7 @@ DEFINE_CLASS(Seg, LOSeg, klass)
   klass->fix = loSegFix;
   klass->fixEmergency = loSegFix;
   klass->reclaim = loSegReclaim;
+  klass->lazySweep = loSegLazySweep;
   klass->walk = loSegWalk;
   AVERT(SegClass, klass);
 }
@@ -211,6 +215,11 @@ static Bool loSegBufferFill(Addr *baseReturn, Addr *limitReturn,
   AVER_CRITICAL(size > 0);
   AVER_CRITICAL(rankSet == RankSetEMPTY);
 
+  /* Only now is the free space in the segment needed.
+     <design/poollo#.sweep.lazy> */
+  if (SegSweepIsDeferred(seg))
+    loSegSweepDeferred(seg);
+
   requestedGrains = PoolSizeGrains(pool, size);
   if (loseg->freeGrains < requestedGrains)
     /* Not enough space to satisfy the request. */
@@ -296,16 +305,19 @@ static void loSegBufferEmpty(Seg seg, Buffer buffer)
 }
 
 
-/* loSegReclaim -- reclaim white objects in an LO segment
+/* loSegSweep -- free the unmarked objects in an LO segment
+ *
+ * Returns the number of grains reclaimed, and the number and size of
+ * the surviving objects.
  *
  * Could consider implementing this using Walk.
  */
 
-static void loSegReclaim(Seg seg, Trace trace)
+static Count loSegSweep(Seg seg, Count *preservedInPlaceCountReturn,
+                        Size *preservedInPlaceSizeReturn)
 {
   LOSeg loseg = MustBeA(LOSeg, seg);
   Pool pool = SegPool(seg);
-  PoolGen pgen = PoolSegPoolGen(pool, seg);
   Addr p, base, limit;
   Buffer buffer;
   Bool hasBuffer = SegBuffer(&buffer, seg);
@@ -315,7 +327,8 @@ static void loSegReclaim(Seg seg, Trace trace)
   Size preservedInPlaceSize = (Size)0;
   Bool b;
 
-  AVERT(Trace, trace);
+  AVER(preservedInPlaceCountReturn != NULL);
+  AVER(preservedInPlaceSizeReturn != NULL);
 
   base = SegBase(seg);
   limit = SegLimit(seg);
@@ -369,16 +382,25 @@ static void loSegReclaim(Seg seg, Trace trace)
   AVER(loseg->oldGrains >= reclaimedGrains);
   loseg->oldGrains -= reclaimedGrains;
   loseg->freeGrains += reclaimedGrains;
-  PoolGenAccountForReclaim(pgen, PoolGrainsSize(pool, reclaimedGrains), FALSE);
+  PoolGenAccountForReclaim(PoolSegPoolGen(pool, seg),
+                           PoolGrainsSize(pool, reclaimedGrains), FALSE);
 
-  STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
-  STATISTIC(trace->preservedInPlaceCount += preservedInPlaceCount);
-  GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
-  SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
+  *preservedInPlaceCountReturn = preservedInPlaceCount;
+  *preservedInPlaceSizeReturn = preservedInPlaceSize;
+  return reclaimedGrains;
+}
+
+
+/* loSegFreeIfEmpty -- free a segment with no survivors */
 
-  if (loseg->freeGrains == PoolSizeGrains(pool, SegSize(seg)) && !hasBuffer) {
+static void loSegFreeIfEmpty(Seg seg)
+{
+  LOSeg loseg = MustBeA(LOSeg, seg);
+  Pool pool = SegPool(seg);
+
+  if (loseg->freeGrains == loSegGrains(loseg) && !SegHasBuffer(seg)) {
     AVER(loseg->bufferedGrains == 0);
-    PoolGenFree(pgen, seg,
+    PoolGenFree(PoolSegPoolGen(pool, seg), seg,
                 PoolGrainsSize(pool, loseg->freeGrains),
                 PoolGrainsSize(pool, loseg->oldGrains),
                 PoolGrainsSize(pool, loseg->newGrains),
@@ -386,6 +408,67 @@ static void loSegReclaim(Seg seg, Trace trace)
   }
 }
 
+
+/* loSegReclaim -- reclaim white objects in an LO segment
+ *
+ * If the pool sweeps lazily, leave the sweep until later.
+ * <design/poollo#.sweep.lazy>.
+ */
+
+static void loSegReclaim(Seg seg, Trace trace)
+{
+  LOSeg loseg = MustBeA(LOSeg, seg);
+  Pool pool = SegPool(seg);
+  PoolGen pgen = PoolSegPoolGen(pool, seg);
+  Count reclaimedGrains;
+  Count preservedInPlaceCount;
+  Size preservedInPlaceSize;
+
+  AVERT(Trace, trace);
+
+  if (MustBeA(LOPool, pool)->lazySweep) {
+    GenDescSweepDeferred(pgen->gen, trace,
+                         PoolGrainsSize(pool, loseg->oldGrains));
+    SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
+    SegDeferSweep(seg);
+    return;
+  }
+
+  reclaimedGrains = loSegSweep(seg, &preservedInPlaceCount,
+                               &preservedInPlaceSize);
+  STATISTIC(trace->reclaimSize += PoolGrainsSize(pool, reclaimedGrains));
+  STATISTIC(trace->preservedInPlaceCount += preservedInPlaceCount);
+  GenDescSurvived(pgen->gen, trace, 0, preservedInPlaceSize);
+  SegSetWhite(seg, TraceSetDel(SegWhite(seg), trace));
+  loSegFreeIfEmpty(seg);
+}
+
+
+/* loSegSweepDeferred -- finish a deferred sweep, keeping the segment
+ *
+ * Called when the free space in the segment is needed for
+ * allocation. <design/poollo#.sweep.lazy>.
+ */
+
+static void loSegSweepDeferred(Seg seg)
+{
+  Count preservedInPlaceCount;
+  Size preservedInPlaceSize;
+
+  SegUndeferSweep(seg);
+  (void)loSegSweep(seg, &preservedInPlaceCount, &preservedInPlaceSize);
+}
+
+
+/* loSegLazySweep -- the segment lazy sweep method */
+
+static void loSegLazySweep(Seg seg, Bool mayFree)
+{
+  loSegSweepDeferred(seg);
+  if (mayFree)
+    loSegFreeIfEmpty(seg);
+}
+
 /* Walks over _all_ objects in the segnent: whether they are black or
  * white, they are still validly formatted as this is a leaf pool, so
  * there can't be any dangling references.
@@ -462,6 +545,7 @@ static Res LOInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   ArgStruct arg;
   Chain chain;
   unsigned gen = LO_GEN_DEFAULT;
+  Bool lazySweep = LO_LAZY_SWEEP_DEFAULT;
 
   AVER(pool != NULL);
   AVERT(Arena, arena);
@@ -484,6 +568,8 @@ static Res LOInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   }
   if (ArgPick(&arg, args, MPS_KEY_GEN))
     gen = arg.val.u;
+  if (ArgPick(&arg, args, MPS_KEY_LAZY_SWEEP))
+    lazySweep = arg.val.b;
   
   AVERT(Format, pool->format);
   AVER(FormatArena(pool->format) == arena);
@@ -495,6 +581,7 @@ static Res LOInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   pool->alignShift = SizeLog2(pool->alignment);
 
   lo->pgen = NULL;
+  lo->lazySweep = lazySweep;
 
   SetClassOfPoly(pool, CLASS(LOPool));
   lo->sig = LOSig;
@@ -575,7 +662,7 @@ static Res LOBufferFill(Addr *baseReturn, Addr *limitReturn,
   /* No segment had enough space, so make a new one. */
   res = PoolGenAlloc(&seg, lo->pgen, CLASS(LOSeg),
                      SizeArenaGrains(size, PoolArena(pool)),
-                     argsNone);
+                     BufferNode(buffer), argsNone);
   if (res != ResOK)
     return res;
   b = SegBufferFill(baseReturn, limitReturn, seg, size, rankSet);
@@ -754,6 +841,7 @@ static Bool LOCheck(LO lo)
     CHECKL(lo->pgen == &lo->pgenStruct);
     CHECKD(PoolGen, lo->pgen);
   }
+  CHECKL(BoolCheck(lo->lazySweep));
   return TRUE;
 }
 
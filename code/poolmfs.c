@@ -108,6 +108,7 @@ static Res MFSInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   mfs->extendSelf = extendSelf;
   mfs->unitSize = unitSize;
   mfs->freeList = NULL;
+  pool->wantLock = TRUE; /* <design/poolmfs#.impl.lock> */
   RingInit(&mfs->extentRing);
   mfs->total = 0;
   mfs->free = 0;
@@ -199,6 +200,7 @@ void MFSExtend(Pool pool, Addr base, Addr limit)
   size = AddrOffset(base, limit);
 
   /* Update accounting */
+  PoolLockClaim(pool);
   mfs->total += size;
   mfs->free += size;
 
@@ -220,11 +222,44 @@ void MFSExtend(Pool pool, Addr base, Addr limit)
     header->next = mfs->freeList;
     mfs->freeList = header;
   }
+  PoolLockRelease(pool);
 
 #undef SUB
 }
 
 
+/* mfsPop, mfsPush -- take a unit from, or return it to, the freelist
+ *
+ * The freelist is protected by the pool lock, so that MFSTryAlloc and
+ * MFSTryFree can use it without the arena lock. The caller must hold
+ * the pool lock, if the pool has one. <design/poolmfs#.impl.lock>
+ */
+
+static Bool mfsPop(Addr *pReturn, MFS mfs)
+{
+  Header f = mfs->freeList;
+
+  if (f == NULL)
+    return FALSE;
+  mfs->freeList = f->next;
+  AVER(mfs->free >= mfs->unitSize);
+  mfs->free -= mfs->unitSize;
+  AVER_CRITICAL((mfs->total - mfs->free) % mfs->unitSize == 0);
+  *pReturn = (Addr)f;
+  return TRUE;
+}
+
+static void mfsPush(MFS mfs, Addr old)
+{
+  /* .freelist.fragments */
+  Header h = (Header)old;
+  h->next = mfs->freeList;
+  mfs->freeList = h;
+  mfs->free += mfs->unitSize;
+  AVER_CRITICAL(mfs->free <= mfs->total);
+}
+
+
 /*  == Allocate ==
  *
  *  Allocation simply involves taking a unit from the front of the freelist
@@ -235,45 +270,36 @@ void MFSExtend(Pool pool, Addr base, Addr limit)
 static Res MFSAlloc(Addr *pReturn, Pool pool, Size size)
 {
   MFS mfs = MustBeA(MFSPool, pool);
-  Header f;
   Res res;
 
   AVER(pReturn != NULL);
   AVER(size == mfs->unroundedUnitSize);
 
-  f = mfs->freeList;
+  for (;;) {
+    Addr base;
+    Bool b;
 
-  /* If the free list is empty then extend the pool with a new region. */
+    PoolLockClaim(pool);
+    b = mfsPop(pReturn, mfs);
+    PoolLockRelease(pool);
+    if (b)
+      return ResOK;
 
-  if(f == NULL)
-  {
-    Addr base;
+    /* The free list is empty, so extend the pool with a new region. */
 
     /* <design/bootstrap#.land.sol.pool>. */
     if (!mfs->extendSelf)
       return ResLIMIT;
 
-    /* Create a new extent and attach it to the pool. */
+    /* Create a new extent and attach it to the pool. Loop, because */
+    /* threads allocating without the arena lock may have taken all */
+    /* its units before we get one. */
     res = ArenaAlloc(&base, LocusPrefDefault(), mfs->extendBy, pool);
     if(res != ResOK)
       return res;
 
     MFSExtend(pool, base, AddrAdd(base, mfs->extendBy));
-
-    /* The first unit in the region is now the head of the new free list. */
-    f = mfs->freeList;
   }
-
-  AVER(f != NULL);
-
-  /* Detach the first free unit from the free list and return its address. */
-
-  mfs->freeList = f->next;
-  AVER(mfs->free >= mfs->unitSize);
-  mfs->free -= mfs->unitSize;
-
-  *pReturn = (Addr)f;
-  return ResOK;
 }
 
 
@@ -286,16 +312,42 @@ static Res MFSAlloc(Addr *pReturn, Pool pool, Size size)
 static void MFSFree(Pool pool, Addr old, Size size)
 {
   MFS mfs = MustBeA(MFSPool, pool);
-  Header h;
 
   AVER(old != (Addr)0);
   AVER(size == mfs->unroundedUnitSize);
 
-  /* .freelist.fragments */
-  h = (Header)old;
-  h->next = mfs->freeList;
-  mfs->freeList = h;
-  mfs->free += mfs->unitSize;
+  PoolLockClaim(pool);
+  mfsPush(mfs, old);
+  PoolLockRelease(pool);
+}
+
+
+/* MFSTryAlloc -- allocate a unit without the arena lock */
+
+static Bool MFSTryAlloc(Addr *pReturn, Pool pool, Size size)
+{
+  MFS mfs = PARENT(MFSStruct, poolStruct, pool);
+
+  AVER_CRITICAL(pReturn != NULL);
+  AVER_CRITICAL(TESTT(MFS, mfs));
+  AVER_CRITICAL(size == mfs->unroundedUnitSize);
+
+  return mfsPop(pReturn, mfs);
+}
+
+
+/* MFSTryFree -- free a unit without the arena lock */
+
+static Bool MFSTryFree(Pool pool, Addr old, Size size)
+{
+  MFS mfs = PARENT(MFSStruct, poolStruct, pool);
+
+  AVER_CRITICAL(TESTT(MFS, mfs));
+  AVER_CRITICAL(old != (Addr)0);
+  AVER_CRITICAL(size == mfs->unroundedUnitSize);
+
+  mfsPush(mfs, old);
+  return TRUE;
 }
 
 
@@ -308,12 +360,22 @@ static Size MFSTotalSize(Pool pool)
 }
 
 
-/* MFSFreeSize -- free memory (unused by client program) */
+/* MFSFreeSize -- free memory (unused by client program)
+ *
+ * The free size changes on the fast path, so it is read under the
+ * pool lock. <design/poolmfs#.impl.lock>
+ */
 
 static Size MFSFreeSize(Pool pool)
 {
   MFS mfs = MustBeA(MFSPool, pool);
-  return mfs->free;
+  Size free;
+
+  PoolLockClaim(pool);
+  AVER(mfs->free <= mfs->total);
+  free = mfs->free;
+  PoolLockRelease(pool);
+  return free;
 }
 
 
@@ -354,6 +416,8 @@ DEFINE_CLASS(Pool, MFSPool, klass)
   klass->init = MFSInit;
   klass->alloc = MFSAlloc;
   klass->free = MFSFree;
+  klass->tryAlloc = MFSTryAlloc;
+  klass->tryFree = MFSTryFree;
   klass->totalSize = MFSTotalSize;
   klass->freeSize = MFSFreeSize;  
   AVERT(PoolClass, klass);
@@ -388,8 +452,9 @@ Bool MFSCheck(MFS mfs)
   CHECKL(SizeAlignUp(mfs->unroundedUnitSize, PoolAlignment(MFSPool(mfs))) ==
          mfs->unitSize);
   CHECKD_NOSIG(Ring, &mfs->extentRing);
-  CHECKL(mfs->free <= mfs->total);
-  CHECKL((mfs->total - mfs->free) % mfs->unitSize == 0);
+  /* The free list and free size belong to the pool lock, which the
+     caller might not hold, so they aren't checked here.
+     <design/poolmfs#.impl.lock> */
   return TRUE;
 }
 
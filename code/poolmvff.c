@@ -18,6 +18,7 @@
  * PoolAlloc, MVFFAlloc) and mps_free (and then PoolFree, MVFFFree).
  */
 
+#include "avl.h"
 #include "cbs.h"
 #include "dbgpool.h"
 #include "failover.h"
@@ -41,14 +42,34 @@ DECLARE_CLASS(Pool, MVFFDebugPool, MVFFPool);
 
 
 #define PoolMVFF(pool)     PARENT(MVFFStruct, poolStruct, pool)
-#define MVFFTotalLand(mvff)  (&(mvff)->totalCBSStruct.landStruct)
-#define MVFFFreePrimary(mvff)   (&(mvff)->freeCBSStruct.landStruct)
+#define MVFFTotalLand(mvff)  (&(mvff)->totalLandStruct.landStruct)
+#define MVFFFreePrimary(mvff)   (&(mvff)->freeLandStruct.landStruct)
 #define MVFFFreeSecondary(mvff)  FreelistLand(&(mvff)->flStruct)
 #define MVFFFreeLand(mvff)  FailoverLand(&(mvff)->foStruct)
 #define MVFFLocusPref(mvff) (&(mvff)->locusPrefStruct)
 #define MVFFBlockPool(mvff) MFSPool(&(mvff)->cbsBlockPoolStruct)
 
 
+/* Size classes
+ *
+ * If mvff->sizeClasses is TRUE, freed blocks no bigger than
+ * MVFF_SIZE_CLASS_COUNT alignment units are pushed on to the free
+ * list for their size, and popped off again by MVFFAlloc, so that
+ * most small allocations don't have to search the free land.
+ * <design/poolmvff#.design.size-class>.
+ *
+ * The size classes are protected by the pool lock, so that
+ * MVFFTryAlloc and MVFFTryFree can use them without the arena lock.
+ * <design/poolmvff#.design.size-class.lock>
+ */
+
+#define mvffSizeClassMax(mvff) \
+  ((Size)MVFF_SIZE_CLASS_COUNT << MVFFPool(mvff)->alignShift)
+#define mvffSizeClassIndex(mvff, size) \
+  (((size) >> MVFFPool(mvff)->alignShift) - 1)
+#define mvffSizeClassNext(block) (*(Addr *)(block))
+
+
 /* MVFFDebug -- MVFFDebug class */
 
 typedef struct MVFFDebugStruct {
@@ -231,13 +252,105 @@ static Res MVFFExtend(Range rangeReturn, MVFF mvff, Size size)
 }
 
 
+/* mvffSizeClassFlush -- return the size classes to the free land
+ *
+ * Blocks in the size classes are never coalesced, so they are
+ * returned to the free land (where they are) whenever the pool would
+ * otherwise have to extend. Returns FALSE if there were none.
+ */
+static Bool mvffSizeClassFlush(MVFF mvff)
+{
+  Pool pool = MVFFPool(mvff);
+  Land freeLand = MVFFFreeLand(mvff);
+  Index i;
+
+  PoolLockClaim(pool);
+  AVER(mvff->sizeClassFree <= mvff->extendBy);
+  AVER(SizeIsAligned(mvff->sizeClassFree, PoolAlignment(pool)));
+  if (mvff->sizeClassFree == 0) {
+    PoolLockRelease(pool);
+    return FALSE;
+  }
+  for (i = 0; i < NELEMS(mvff->sizeClass); ++i) {
+    Size size = (Size)(i + 1) << pool->alignShift;
+    Addr block = mvff->sizeClass[i];
+    while (block != NULL) {
+      RangeStruct range, coalescedRange;
+      Addr next = mvffSizeClassNext(block);
+      Res res;
+      DebugPoolFreeSplat(pool, block, AddrAdd(block, sizeof(Addr)));
+      RangeInitSize(&range, block, size);
+      res = LandInsert(&coalescedRange, freeLand, &range);
+      /* Insertion must succeed because it fails over to a Freelist. */
+      AVER(res == ResOK);
+      AVER(mvff->sizeClassFree >= size);
+      mvff->sizeClassFree -= size;
+      block = next;
+    }
+    mvff->sizeClass[i] = NULL;
+  }
+  AVER(mvff->sizeClassFree == 0);
+  PoolLockRelease(pool);
+  return TRUE;
+}
+
+
+/* mvffSizeClassPop -- allocate a block from its size class
+ *
+ * The caller must hold the pool lock, if the pool has one. Size must
+ * be aligned to the pool alignment.
+ */
+static Bool mvffSizeClassPop(Addr *aReturn, MVFF mvff, Size size)
+{
+  Pool pool = MVFFPool(mvff);
+  Index i;
+  Addr block;
+
+  if (!mvff->sizeClasses || size > mvffSizeClassMax(mvff))
+    return FALSE;
+  i = mvffSizeClassIndex(mvff, size);
+  block = mvff->sizeClass[i];
+  if (block == NULL)
+    return FALSE;
+  mvff->sizeClass[i] = mvffSizeClassNext(block);
+  AVER_CRITICAL(mvff->sizeClassFree >= size);
+  mvff->sizeClassFree -= size;
+  DebugPoolFreeSplat(pool, block, AddrAdd(block, sizeof(Addr)));
+  *aReturn = block;
+  return TRUE;
+}
+
+
+/* mvffSizeClassPush -- free a block to its size class
+ *
+ * Keep at most extendBy bytes in the size classes, so that the
+ * fragmentation they cause is bounded. The caller must hold the pool
+ * lock, if the pool has one. Size must be aligned to the pool
+ * alignment.
+ */
+static Bool mvffSizeClassPush(MVFF mvff, Addr old, Size size)
+{
+  Index i;
+
+  if (!mvff->sizeClasses || size > mvffSizeClassMax(mvff)
+      || mvff->sizeClassFree + size > mvff->extendBy)
+    return FALSE;
+  i = mvffSizeClassIndex(mvff, size);
+  mvffSizeClassNext(old) = mvff->sizeClass[i];
+  mvff->sizeClass[i] = old;
+  mvff->sizeClassFree += size;
+  return TRUE;
+}
+
+
 /* mvffFindFree -- find a suitable free block or add one
  *
  * Finds a free block of the given (pool aligned) size, using the
  * policy (first fit, last fit, or worst fit) specified by findMethod
  * and findDelete.
  *
- * If there is no suitable free block, try extending the pool.
+ * If there is no suitable free block, try flushing the size classes,
+ * and then try extending the pool.
  */
 static Res mvffFindFree(Range rangeReturn, MVFF mvff, Size size,
                         LandFindMethod findMethod, FindDelete findDelete)
@@ -255,6 +368,9 @@ static Res mvffFindFree(Range rangeReturn, MVFF mvff, Size size,
 
   land = MVFFFreeLand(mvff);
   found = (*findMethod)(rangeReturn, &oldRange, land, size, findDelete);
+  if (!found && mvff->sizeClasses && mvffSizeClassFlush(mvff)) {
+    found = (*findMethod)(rangeReturn, &oldRange, land, size, findDelete);
+  }
   if (!found) {
     RangeStruct newRange;
     Res res;
@@ -291,6 +407,16 @@ static Res MVFFAlloc(Addr *aReturn, Pool pool, Size size)
   AVER_CRITICAL(size > 0);
 
   size = SizeAlignUp(size, PoolAlignment(pool));
+
+  if (mvff->sizeClasses) {
+    Bool b;
+    PoolLockClaim(pool);
+    b = mvffSizeClassPop(aReturn, mvff, size);
+    PoolLockRelease(pool);
+    if (b)
+      return ResOK;
+  }
+
   findMethod = mvff->firstFit ? LandFindFirst : LandFindLast;
   findDelete = mvff->slotHigh ? FindDeleteHIGH : FindDeleteLOW;
 
@@ -321,7 +447,18 @@ static void MVFFFree(Pool pool, Addr old, Size size)
   AVER_CRITICAL(AddrIsAligned(old, PoolAlignment(pool)));
   AVER_CRITICAL(size > 0);
 
-  RangeInitSize(&range, old, SizeAlignUp(size, PoolAlignment(pool)));
+  size = SizeAlignUp(size, PoolAlignment(pool));
+
+  if (mvff->sizeClasses) {
+    Bool b;
+    PoolLockClaim(pool);
+    b = mvffSizeClassPush(mvff, old, size);
+    PoolLockRelease(pool);
+    if (b)
+      return;
+  }
+
+  RangeInitSize(&range, old, size);
   freeLand = MVFFFreeLand(mvff);
   res = LandInsert(&coalescedRange, freeLand, &range);
   /* Insertion must succeed because it fails over to a Freelist. */
@@ -330,6 +467,41 @@ static void MVFFFree(Pool pool, Addr old, Size size)
 }
 
 
+/* MVFFTryAlloc -- allocate a block without the arena lock
+ *
+ * Only the size classes can be used without the arena lock.
+ * <design/poolmvff#.design.size-class.lock>
+ */
+
+static Bool MVFFTryAlloc(Addr *aReturn, Pool pool, Size size)
+{
+  MVFF mvff = PoolMVFF(pool);
+
+  AVER_CRITICAL(aReturn != NULL);
+  AVER_CRITICAL(TESTT(MVFF, mvff));
+  AVER_CRITICAL(size > 0);
+
+  return mvffSizeClassPop(aReturn, mvff,
+                          SizeAlignUp(size, PoolAlignment(pool)));
+}
+
+
+/* MVFFTryFree -- free a block without the arena lock */
+
+static Bool MVFFTryFree(Pool pool, Addr old, Size size)
+{
+  MVFF mvff = PoolMVFF(pool);
+
+  AVER_CRITICAL(TESTT(MVFF, mvff));
+  AVER_CRITICAL(old != (Addr)0);
+  AVER_CRITICAL(AddrIsAligned(old, PoolAlignment(pool)));
+  AVER_CRITICAL(size > 0);
+
+  return mvffSizeClassPush(mvff, old,
+                           SizeAlignUp(size, PoolAlignment(pool)));
+}
+
+
 /* MVFFBufferFill -- Fill the buffer
  *
  * Fill it with the largest block we can find. This is worst-fit
@@ -395,6 +567,7 @@ static void MVFFDebugVarargs(ArgStruct args[MPS_ARGS_MAX], va_list varargs)
 ARG_DEFINE_KEY(MVFF_SLOT_HIGH, Bool);
 ARG_DEFINE_KEY(MVFF_ARENA_HIGH, Bool);
 ARG_DEFINE_KEY(MVFF_FIRST_FIT, Bool);
+ARG_DEFINE_KEY(MVFF_SIZE_CLASSES, Bool);
 
 static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
 {
@@ -404,10 +577,12 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   Bool slotHigh = MVFF_SLOT_HIGH_DEFAULT;
   Bool arenaHigh = MVFF_ARENA_HIGH_DEFAULT;
   Bool firstFit = MVFF_FIRST_FIT_DEFAULT;
+  Bool sizeClasses = MVFF_SIZE_CLASSES_DEFAULT;
   double spare = MVFF_SPARE_DEFAULT;
   MVFF mvff;
   Res res;
   ArgStruct arg;
+  Index i;
 
   AVER(pool != NULL);
   AVERT(Arena, arena);
@@ -440,6 +615,9 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   if (ArgPick(&arg, args, MPS_KEY_MVFF_FIRST_FIT))
     firstFit = arg.val.b;
 
+  if (ArgPick(&arg, args, MPS_KEY_MVFF_SIZE_CLASSES))
+    sizeClasses = arg.val.b;
+
   AVER(extendBy > 0);           /* .arg.check */
   AVER(avgSize > 0);            /* .arg.check */
   AVER(avgSize <= extendBy);    /* .arg.check */
@@ -454,6 +632,7 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   AVERT(Bool, slotHigh);
   AVERT(Bool, arenaHigh);
   AVERT(Bool, firstFit);
+  AVERT(Bool, sizeClasses);
 
   res = NextMethod(Pool, MVFFPool, init)(pool, arena, klass, args);
   if (res != ResOK)
@@ -469,33 +648,39 @@ static Res MVFFInit(Pool pool, Arena arena, PoolClass klass, ArgList args)
   mvff->slotHigh = slotHigh;
   mvff->firstFit = firstFit;
   mvff->spare = spare;
+  mvff->sizeClasses = sizeClasses;
+  /* Only the size classes can be used without the arena lock. */
+  pool->wantLock = sizeClasses;
+  mvff->sizeClassFree = 0;
+  for (i = 0; i < NELEMS(mvff->sizeClass); ++i)
+    mvff->sizeClass[i] = NULL;
 
   LocusPrefInit(MVFFLocusPref(mvff));
   LocusPrefExpress(MVFFLocusPref(mvff),
                    arenaHigh ? LocusPrefHIGH : LocusPrefLOW, NULL);
 
-  /* An MFS pool is explicitly initialised for the two CBSs partly to
+  /* An MFS pool is explicitly initialised for the two lands partly to
    * share space, but mostly to avoid a call to PoolCreate, so that
    * MVFF can be used during arena bootstrap as the control pool. */
 
   MPS_ARGS_BEGIN(piArgs) {
-    MPS_ARGS_ADD(piArgs, MPS_KEY_MFS_UNIT_SIZE, sizeof(CBSFastBlockStruct));
+    MPS_ARGS_ADD(piArgs, MPS_KEY_MFS_UNIT_SIZE, FreeLandFastBlockSIZE);
     res = PoolInit(MVFFBlockPool(mvff), arena, PoolClassMFS(), piArgs);
   } MPS_ARGS_END(piArgs);
   if (res != ResOK)
     goto failBlockPoolInit;
 
   MPS_ARGS_BEGIN(liArgs) {
-    MPS_ARGS_ADD(liArgs, CBSBlockPool, MVFFBlockPool(mvff));
-    res = LandInit(MVFFTotalLand(mvff), CLASS(CBSFast), arena, align,
+    MPS_ARGS_ADD(liArgs, FreeLandBlockPool, MVFFBlockPool(mvff));
+    res = LandInit(MVFFTotalLand(mvff), FreeLandFastCLASS, arena, align,
                    mvff, liArgs);
   } MPS_ARGS_END(liArgs);
   if (res != ResOK)
     goto failTotalLandInit;
 
   MPS_ARGS_BEGIN(liArgs) {
-    MPS_ARGS_ADD(liArgs, CBSBlockPool, MVFFBlockPool(mvff));
-    res = LandInit(MVFFFreePrimary(mvff), CLASS(CBSFast), arena, align,
+    MPS_ARGS_ADD(liArgs, FreeLandBlockPool, MVFFBlockPool(mvff));
+    res = LandInit(MVFFFreePrimary(mvff), FreeLandFastCLASS, arena, align,
                    mvff, liArgs);
   } MPS_ARGS_END(liArgs);
   if (res != ResOK)
@@ -619,13 +804,19 @@ static Size MVFFFreeSize(Pool pool)
 {
   MVFF mvff;
   Land freeLand;
+  Size sizeClassFree;
 
   AVERT(Pool, pool);
   mvff = PoolMVFF(pool);
   AVERT(MVFF, mvff);
 
+  /* <design/poolmvff#.design.size-class.lock> */
+  PoolLockClaim(pool);
+  sizeClassFree = mvff->sizeClassFree;
+  PoolLockRelease(pool);
+
   freeLand = MVFFFreeLand(mvff);
-  return LandSize(freeLand);
+  return LandSize(freeLand) + sizeClassFree;
 }
 
 
@@ -651,6 +842,8 @@ static Res MVFFDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "avgSize   $W\n",  (WriteFW)mvff->avgSize,
                "firstFit  $U\n",  (WriteFU)mvff->firstFit,
                "slotHigh  $U\n",  (WriteFU)mvff->slotHigh,
+               "sizeClasses $U\n", (WriteFU)mvff->sizeClasses,
+               "sizeClassFree $W\n", (WriteFW)mvff->sizeClassFree,
                "spare     $D\n",  (WriteFD)mvff->spare,
                NULL);
   if (res != ResOK)
@@ -682,6 +875,7 @@ static Res MVFFDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
 DEFINE_CLASS(Pool, MVFFPool, klass)
 {
   INHERIT_CLASS(klass, MVFFPool, AbstractBufferPool);
+  klass->attr |= AttrFREESPLIT; /* <design/sac#.fill.chunk> */
   klass->instClassStruct.describe = MVFFDescribe;
   klass->instClassStruct.finish = MVFFFinish;
   klass->size = sizeof(MVFFStruct);
@@ -689,6 +883,8 @@ DEFINE_CLASS(Pool, MVFFPool, klass)
   klass->init = MVFFInit;
   klass->alloc = MVFFAlloc;
   klass->free = MVFFFree;
+  klass->tryAlloc = MVFFTryAlloc;
+  klass->tryFree = MVFFTryFree;
   klass->bufferFill = MVFFBufferFill;
   klass->totalSize = MVFFTotalSize;
   klass->freeSize = MVFFFreeSize;
@@ -708,6 +904,7 @@ DEFINE_CLASS(Pool, MVFFDebugPool, klass)
 {
   INHERIT_CLASS(klass, MVFFDebugPool, MVFFPool);
   PoolClassMixInDebug(klass);
+  klass->attr &= ~AttrFREESPLIT; /* fenceposts and tags are per block */
   klass->size = sizeof(MVFFDebugStruct);
   klass->varargs = MVFFDebugVarargs;
   klass->debugMixin = MVFFDebugMixin;
@@ -743,15 +940,20 @@ Bool MVFFCheck(MVFF mvff)
   CHECKL(mvff->spare >= 0.0);                   /* see .arg.check */
   CHECKL(mvff->spare <= 1.0);                   /* see .arg.check */
   CHECKD(MFS, &mvff->cbsBlockPoolStruct);
-  CHECKD(CBS, &mvff->totalCBSStruct);
-  CHECKD(CBS, &mvff->freeCBSStruct);
+  CHECKD(FreeLand, &mvff->totalLandStruct);
+  CHECKD(FreeLand, &mvff->freeLandStruct);
   CHECKD(Freelist, &mvff->flStruct);
   CHECKD(Failover, &mvff->foStruct);
-  CHECKL((LandSize)(MVFFTotalLand(mvff)) >= (LandSize)(MVFFFreeLand(mvff)));
+  CHECKL((LandSize)(MVFFTotalLand(mvff))
+         >= (LandSize)(MVFFFreeLand(mvff)));
   CHECKL(SizeIsAligned((LandSize)(MVFFFreeLand(mvff)), PoolAlignment(MVFFPool(mvff))));
   CHECKL(SizeIsArenaGrains((LandSize)(MVFFTotalLand(mvff)), PoolArena(MVFFPool(mvff))));
   CHECKL(BoolCheck(mvff->slotHigh));
   CHECKL(BoolCheck(mvff->firstFit));
+  CHECKL(BoolCheck(mvff->sizeClasses));
+  /* The size classes belong to the pool lock, which the caller might
+     not hold, so they aren't checked here.
+     <design/poolmvff#.design.size-class.lock> */
   return TRUE;
 }
 
@@ -50,7 +50,7 @@ static Bool pthreadextModuleInitialized = FALSE;
  * <design/pthreadext#.impl.global>
  */
 
-static PThreadext suspendingVictim = NULL;  /* current victim */
+static Ring suspendingBatch = NULL;         /* current victims */
 static RingStruct suspendedRing;            /* PThreadext suspend ring */
 
 
@@ -74,17 +74,33 @@ static void suspendSignalHandler(int sig,
     sigset_t signal_set;
     ucontext_t ucontext;
     MutatorContextStruct context;
+    PThreadext victim = NULL;
+    pthread_t self;
+    Ring node, next;
 
     AVER(sig == PTHREADEXT_SIGSUSPEND);
     UNUSED(sig);
     UNUSED(info);
 
-    AVER(suspendingVictim != NULL);
+    /* Find this thread's pthreadext in the batch being suspended.  The
+     * controlling thread does not change the batch until all the
+     * victims have posted the semaphore. */
+    AVER(suspendingBatch != NULL);
+    self = pthread_self();
+    RING_FOR(node, suspendingBatch, next) {
+      PThreadext pt = RING_ELT(PThreadext, batchRing, node);
+      if (pthread_equal(pt->id, self)) {
+        victim = pt;
+        break;
+      }
+    }
+    AVER(victim != NULL);
+
     /* copy the ucontext structure so we definitely have it on our stack,
      * not (e.g.) shared with other threads. */
     ucontext = *(ucontext_t *)uap;
     MutatorContextInitThread(&context, &ucontext);
-    suspendingVictim->context = &context;
+    victim->context = &context;
     /* Block all signals except PTHREADEXT_SIGRESUME while suspended. */
     sigfillset(&signal_set);
     sigdelset(&signal_set, PTHREADEXT_SIGRESUME);
@@ -170,6 +186,7 @@ Bool PThreadextCheck(PThreadext pthreadext)
   /* can't check ID */
   CHECKD_NOSIG(Ring, &pthreadext->threadRing);
   CHECKD_NOSIG(Ring, &pthreadext->idRing);
+  CHECKD_NOSIG(Ring, &pthreadext->batchRing);
   if (pthreadext->context == NULL) {
     /* not suspended */
     CHECKL(RingIsSingle(&pthreadext->threadRing));
@@ -205,6 +222,7 @@ void PThreadextInit(PThreadext pthreadext, pthread_t id)
   pthreadext->context = NULL;
   RingInit(&pthreadext->threadRing);
   RingInit(&pthreadext->idRing);
+  RingInit(&pthreadext->batchRing);
   pthreadext->sig = PThreadextSig;
   AVERT(PThreadext, pthreadext);
 }
@@ -240,120 +258,256 @@ void PThreadextFinish(PThreadext pthreadext)
 
   RingFinish(&pthreadext->threadRing);
   RingFinish(&pthreadext->idRing);
+  RingFinish(&pthreadext->batchRing);
   pthreadext->sig = SigInvalid;
 }
 
 
-/* PThreadextSuspend -- suspend a thread
+/* PThreadextBatchAdd -- add a pthreadext to a batch
+ *
+ * <design/pthreadext#.impl.batch>
+ */
+
+void PThreadextBatchAdd(Ring batch, PThreadext target)
+{
+  AVERT(Ring, batch);
+  AVERT(PThreadext, target);
+  AVER(RingIsSingle(&target->batchRing));
+
+  RingAppend(batch, &target->batchRing);
+}
+
+
+/* suspendedWithId -- find a suspended pthreadext with the given id */
+
+static PThreadext suspendedWithId(pthread_t id)
+{
+  Ring node, next;
+
+  RING_FOR(node, &suspendedRing, next) {
+    PThreadext alreadySusp = RING_ELT(PThreadext, threadRing, node);
+    if (pthread_equal(alreadySusp->id, id))
+      return alreadySusp;
+  }
+  return NULL;
+}
+
+
+/* PThreadextSuspendBatch -- suspend a batch of threads
  *
  * <design/pthreadext#.impl.suspend>
  */
 
-Res PThreadextSuspend(PThreadext target, MutatorContext *contextReturn)
+void PThreadextSuspendBatch(Ring batch)
 {
   Ring node, next;
-  Res res;
+  Count signalled = 0;
   int status;
 
-  AVERT(PThreadext, target);
-  AVER(contextReturn != NULL);
-  AVER(target->context == NULL); /* multiple suspends illegal */
+  AVERT(Ring, batch);
+  if (RingIsSingle(batch))
+    return;
 
   /* Serialize access to suspend, makes life easier */
   status = pthread_mutex_lock(&pthreadextMut);
   AVER(status == 0);
-  AVER(suspendingVictim == NULL);
+  AVER(suspendingBatch == NULL);
 
   /* Threads are added to the suspended ring on suspension */
-  /* If the same thread Id has already been suspended, then */
-  /* don't signal the thread, just add the target onto the id ring */
-  RING_FOR(node, &suspendedRing, next) {
-    PThreadext alreadySusp = RING_ELT(PThreadext, threadRing, node);
-    if (alreadySusp->id == target->id) {
-      RingAppend(&alreadySusp->idRing, &target->idRing);
-      target->context = alreadySusp->context;
-      goto noteSuspended;
+  /* If the same thread Id has already been suspended, or is earlier */
+  /* in the batch, then don't signal the thread, just add the target */
+  /* onto the id ring of the other one */
+  RING_FOR(node, batch, next) {
+    PThreadext target = RING_ELT(PThreadext, batchRing, node);
+    PThreadext other;
+    Ring earlier, earlierNext;
+
+    AVER(target->context == NULL); /* multiple suspends illegal */
+    other = suspendedWithId(target->id);
+    if (other != NULL) {
+      RingAppend(&other->idRing, &target->idRing);
+      target->context = other->context;
+      RingAppend(&suspendedRing, &target->threadRing);
+      RingRemove(&target->batchRing);
+      continue;
+    }
+    RING_FOR(earlier, batch, earlierNext) {
+      if (earlier == node)
+        break;
+      other = RING_ELT(PThreadext, batchRing, earlier);
+      if (pthread_equal(other->id, target->id)) {
+        /* .batch.duplicate: gets the context once other is suspended */
+        RingAppend(&other->idRing, &target->idRing);
+        RingRemove(&target->batchRing);
+        break;
+      }
     }
   }
 
-  /* Ok, we really need to suspend this thread. */
-  suspendingVictim = target;
-  status = pthread_kill(target->id, PTHREADEXT_SIGSUSPEND);
-  if (status != 0) {
-    res = ResFAIL;
-    goto unlock;
+  /* Ok, we really need to suspend these threads.  Signal them all */
+  /* before waiting for any of them, so that they suspend in parallel. */
+  /* A thread that can't be signalled keeps a NULL context. */
+  suspendingBatch = batch;
+  RING_FOR(node, batch, next) {
+    PThreadext target = RING_ELT(PThreadext, batchRing, node);
+    status = pthread_kill(target->id, PTHREADEXT_SIGSUSPEND);
+    if (status == 0)
+      ++signalled;
   }
 
-  /* Wait for the victim to acknowledge suspension. */
-  while (sem_wait(&pthreadextSem) != 0) {
-    if (errno != EINTR) {
-      res = ResFAIL;
-      goto unlock;
+  /* Wait for the victims to acknowledge suspension. */
+  while (signalled > 0) {
+    if (sem_wait(&pthreadextSem) == 0)
+      --signalled;
+    else
+      AVER(errno == EINTR);
+  }
+  suspendingBatch = NULL;
+
+  RING_FOR(node, batch, next) {
+    PThreadext target = RING_ELT(PThreadext, batchRing, node);
+    Ring dup, dupNext;
+    RingRemove(&target->batchRing);
+    RING_FOR(dup, &target->idRing, dupNext) {
+      PThreadext pt = RING_ELT(PThreadext, idRing, dup);
+      if (target->context != NULL) {
+        pt->context = target->context; /* .batch.duplicate */
+        RingAppend(&suspendedRing, &pt->threadRing);
+      } else {
+        RingRemove(&pt->idRing);
+      }
     }
+    if (target->context != NULL)
+      RingAppend(&suspendedRing, &target->threadRing);
   }
+  AVER(RingIsSingle(batch));
 
-noteSuspended:
-  AVER(target->context != NULL);
-  RingAppend(&suspendedRing, &target->threadRing);
-  *contextReturn = target->context;
-  res = ResOK;
-
-unlock:
-  suspendingVictim = NULL;
   status = pthread_mutex_unlock(&pthreadextMut);
   AVER(status == 0);
+}
+
+
+/* PThreadextSuspended -- return the context of a suspended thread */
+
+Res PThreadextSuspended(PThreadext target, MutatorContext *contextReturn)
+{
+  AVERT(PThreadext, target);
+  AVER(contextReturn != NULL);
+
+  if (target->context == NULL)
+    return ResFAIL;
+  *contextReturn = target->context;
+  return ResOK;
+}
+
+
+/* PThreadextSuspend -- suspend a thread
+ *
+ * <design/pthreadext#.impl.suspend>
+ */
+
+Res PThreadextSuspend(PThreadext target, MutatorContext *contextReturn)
+{
+  RingStruct batchStruct;
+  Res res;
+
+  AVERT(PThreadext, target);
+  AVER(contextReturn != NULL);
+  AVER(target->context == NULL); /* multiple suspends illegal */
+
+  RingInit(&batchStruct);
+  PThreadextBatchAdd(&batchStruct, target);
+  PThreadextSuspendBatch(&batchStruct);
+  RingFinish(&batchStruct);
+
+  res = PThreadextSuspended(target, contextReturn);
   return res;
 }
 
 
-/* PThreadextResume -- resume a suspended thread
+/* pthreadextResume -- resume a suspended thread, with the mutex held
  *
  * <design/pthreadext#.impl.resume>
  */
 
-Res PThreadextResume(PThreadext target)
+static Res pthreadextResume(PThreadext target)
 {
-  Res res;
   int status;
 
-  AVERT(PThreadext, target);
-  AVER(pthreadextModuleInitialized);  /* must have been a prior suspend */
   AVER(target->context != NULL);
 
-  /* Serialize access to suspend, makes life easier. */
-  status = pthread_mutex_lock(&pthreadextMut);
-  AVER(status == 0);
-
   if (RingIsSingle(&target->idRing)) {
     /* Really want to resume the thread. Signal it to continue. */
     status = pthread_kill(target->id, PTHREADEXT_SIGRESUME);
-    if (status == 0) {
-      goto noteResumed;
-    } else {
-      res = ResFAIL;
-      goto unlock;
-    }
-
+    if (status != 0)
+      return ResFAIL;
   } else {
     /* Leave thread suspended on behalf of another PThreadext. */
     /* Remove it from the id ring */
     RingRemove(&target->idRing);
-    goto noteResumed;
   }
 
-noteResumed:
   /* Remove the thread from the suspended ring */
   RingRemove(&target->threadRing);
   target->context = NULL;
-  res = ResOK;
+  return ResOK;
+}
+
+
+/* PThreadextResume -- resume a suspended thread */
+
+Res PThreadextResume(PThreadext target)
+{
+  Res res;
+  int status;
+
+  AVERT(PThreadext, target);
+  AVER(pthreadextModuleInitialized);  /* must have been a prior suspend */
+  AVER(target->context != NULL);
+
+  /* Serialize access to suspend, makes life easier. */
+  status = pthread_mutex_lock(&pthreadextMut);
+  AVER(status == 0);
+
+  res = pthreadextResume(target);
 
-unlock:
   status = pthread_mutex_unlock(&pthreadextMut);
   AVER(status == 0);
   return res;
 }
 
 
+/* PThreadextResumeBatch -- resume a batch of suspended threads
+ *
+ * Resuming doesn't wait for the thread to acknowledge, so the only
+ * saving over resuming the threads one at a time is in claiming the
+ * mutex once.
+ */
+
+void PThreadextResumeBatch(Ring batch)
+{
+  Ring node, next;
+  int status;
+
+  AVERT(Ring, batch);
+  if (RingIsSingle(batch))
+    return;
+  AVER(pthreadextModuleInitialized);  /* must have been a prior suspend */
+
+  status = pthread_mutex_lock(&pthreadextMut);
+  AVER(status == 0);
+
+  RING_FOR(node, batch, next) {
+    PThreadext target = RING_ELT(PThreadext, batchRing, node);
+    RingRemove(&target->batchRing);
+    (void)pthreadextResume(target);
+  }
+
+  status = pthread_mutex_unlock(&pthreadextMut);
+  AVER(status == 0);
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
@@ -35,6 +35,7 @@ typedef struct PThreadextStruct {
   MutatorContext context;          /* context if suspended */
   RingStruct threadRing;           /* ring of suspended threads */
   RingStruct idRing;               /* duplicate suspensions for id */
+  RingStruct batchRing;            /* batch being suspended or resumed */
 } PThreadextStruct;
 
 
@@ -65,6 +66,38 @@ extern Res PThreadextSuspend(PThreadext pthreadext,
 extern Res PThreadextResume(PThreadext pthreadext);
 
 
+/*  PThreadextBatchAdd -- Add a pthreadext to a batch
+ *
+ * A batch is a ring of pthreadexts that are suspended or resumed
+ * together by PThreadextSuspendBatch or PThreadextResumeBatch. */
+
+extern void PThreadextBatchAdd(Ring batch, PThreadext pthreadext);
+
+
+/*  PThreadextSuspendBatch -- Suspend a batch of pthreadexts
+ *
+ * Signals all the threads before waiting for any of them, and empties
+ * the batch.  Use PThreadextSuspended to find out which succeeded. */
+
+extern void PThreadextSuspendBatch(Ring batch);
+
+
+/*  PThreadextSuspended -- Return the context of a suspended pthreadext
+ *
+ * Returns ResFAIL if the pthreadext is not suspended. */
+
+extern Res PThreadextSuspended(PThreadext pthreadext,
+                               MutatorContext *contextReturn);
+
+
+/*  PThreadextResumeBatch -- Resume a batch of suspended pthreadexts
+ *
+ * Empties the batch.  Any pthreadexts that fail to resume are left
+ * suspended. */
+
+extern void PThreadextResumeBatch(Ring batch);
+
+
 #endif /* pthreadext_h */
 
 
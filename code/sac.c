@@ -43,6 +43,8 @@ static Bool SACCheck(SAC sac)
   CHECKS(SAC, sac);
   esac = ExternalSACOfSAC(sac);
   CHECKU(Pool, sac->pool);
+  CHECKL(sac->thread == NULL || ThreadCheckSimple(sac->thread));
+  CHECKD_NOSIG(Ring, &sac->threadsRing);
   CHECKL(sac->classesCount > 0);
   CHECKL(sac->classesCount > sac->middleIndex);
   CHECKL(BoolCheck(esac->_trapped));
@@ -184,6 +186,8 @@ Res SACCreate(SAC *sacReturn, Pool pool, Count classesCount,
   sac->pool = pool;
   sac->classesCount = classesCount;
   sac->middleIndex = middleIndex;
+  sac->thread = NULL;
+  RingInit(&sac->threadsRing);
   sac->sig = SACSig;
   AVERT(SAC, sac);
   *sacReturn = sac;
@@ -199,8 +203,10 @@ failSACAlloc:
 void SACDestroy(SAC sac)
 {
   AVERT(SAC, sac);
+  AVER(sac->thread == NULL); /* thread SACs use sacThreadDestroy */
   SACFlush(sac);
   sac->sig = SigInvalid;
+  RingFinish(&sac->threadsRing);
   ControlFree(PoolArena(sac->pool), sac,
               sacSize(sac->middleIndex, sac->classesCount));
 }
@@ -268,8 +274,27 @@ Res SACFill(Addr *p_o, SAC sac, Size size)
   if (blockSize == SizeMAX)
     /* .align: align 'cause some classes don't accept unaligned. */
     blockSize = SizeAlignUp(size, PoolAlignment(sac->pool));
-  for (j = 0, fl = esac->_freelists[i]._blocks;
-       j <= blockCount; ++j) {
+  fl = esac->_freelists[i]._blocks;
+  j = 0;
+  /* .fill.chunk: If the pool allows it, allocate all the blocks in
+     one chunk and split it up, so that a fill costs one call to
+     PoolAlloc. <design/sac#.fill.chunk> */
+  if (blockCount > 0 && PoolHasAttr(sac->pool, AttrFREESPLIT)
+      && blockCount < SizeMAX / blockSize)
+  {
+    res = PoolAlloc(&p, sac->pool, blockSize * (blockCount + 1));
+    if (res == ResOK) {
+      /* Link the blocks so that the lowest is at the head. */
+      for (j = blockCount + 1; j > 0; --j) {
+        Addr cb = AddrAdd(p, blockSize * (j - 1));
+        /* @@@@ ignoring shields for now */
+        *ADDR_PTR(Addr, cb) = fl; fl = cb;
+      }
+      j = blockCount + 1;
+    }
+  }
+  /* Otherwise, or if the chunk can't be had, allocate one by one. */
+  for (; j <= blockCount; ++j) {
     res = PoolAlloc(&p, sac->pool, blockSize);
     if (res != ResOK)
       break;
@@ -294,22 +319,40 @@ Res SACFill(Addr *p_o, SAC sac, Size size)
 /* sacClassFlush -- discard elements from the cache for a given class
  *
  * blockCount says how many elements to discard.
+ *
+ * .flush.chunk: If the pool allows it, runs of adjacent blocks are
+ * freed together, so that blocks that were filled as a chunk (see
+ * .fill.chunk) usually go back to the pool in one call to PoolFree.
+ * <design/sac#.flush.chunk>
  */
 
 static void sacClassFlush(SAC sac, Index i, Size blockSize,
                           Count blockCount)
 {
-  Addr cb, fl;
+  Addr cb, fl, base = NULL, limit = NULL;
   Count j;
+  Bool split;
   mps_sac_t esac;
   
   esac = ExternalSACOfSAC(sac);
+  split = PoolHasAttr(sac->pool, AttrFREESPLIT);
   for (j = 0, fl = esac->_freelists[i]._blocks;
        j < blockCount; ++j) {
     /* @@@@ ignoring shields for now */
     cb = fl; fl = *ADDR_PTR(Addr, cb);
-    PoolFree(sac->pool, cb, blockSize);
+    if (split && cb == limit) {
+      limit = AddrAdd(cb, blockSize);
+    } else if (split && base != NULL && AddrAdd(cb, blockSize) == base) {
+      base = cb;
+    } else {
+      if (base != NULL)
+        PoolFree(sac->pool, base, AddrOffset(base, limit));
+      base = cb;
+      limit = AddrAdd(cb, blockSize);
+    }
   }
+  if (base != NULL)
+    PoolFree(sac->pool, base, AddrOffset(base, limit));
   esac->_freelists[i]._count -= blockCount;
   esac->_freelists[i]._blocks = fl;
 }
@@ -388,6 +431,194 @@ void SACFlush(SAC sac)
 }
 
 
+/* SACThreadsCheck -- check function for per-thread caches */
+
+ATTRIBUTE_UNUSED
+static Bool SACThreadsCheck(SACThreads threads)
+{
+  CHECKS(SACThreads, threads);
+  CHECKU(Pool, threads->pool);
+  CHECKL(threads->pool->sacThreads == threads);
+  CHECKL(threads->classesCount > 0);
+  CHECKL(threads->classes != NULL);
+  /* nothing to check about cacheLimit */
+  CHECKD_NOSIG(Ring, &threads->sacRing);
+  return TRUE;
+}
+
+
+/* SACThreadsCreate -- make a pool provide per-thread caches
+ *
+ * .thread.limit: Each class gets an equal share of the cache limit,
+ * and its cached count is reduced so that a full freelist fits in its
+ * share. The limit therefore holds without the fast path in
+ * <code/mps.h> having to count bytes. <design/sac#.thread.limit>
+ */
+
+Res SACThreadsCreate(Pool pool, Count classesCount, SACClasses classes,
+                     Size cacheLimit)
+{
+  Arena arena;
+  SACThreads threads;
+  void *p;
+  Res res;
+  Index i;
+  Size prevSize, share;
+
+  AVERT(Pool, pool);
+  AVER(pool->sacThreads == NULL);
+  AVER(classesCount > 0);
+  AVER(classes != NULL);
+  /* These are checked by SACCreate too, but that's too late. */
+  prevSize = sizeof(Addr) - 1;
+  for (i = 0; i < classesCount; ++i) {
+    AVER(SizeIsAligned(classes[i].mps_block_size, PoolAlignment(pool)));
+    AVER(prevSize < classes[i].mps_block_size);
+    prevSize = classes[i].mps_block_size;
+  }
+  arena = PoolArena(pool);
+
+  res = ControlAlloc(&p, arena, sizeof(SACThreadsStruct));
+  if (res != ResOK)
+    goto failThreadsAlloc;
+  threads = p;
+  res = ControlAlloc(&p, arena, classesCount * sizeof classes[0]);
+  if (res != ResOK)
+    goto failClassesAlloc;
+  threads->classes = p;
+
+  share = cacheLimit / classesCount;
+  for (i = 0; i < classesCount; ++i) {
+    Count maxCount = share / classes[i].mps_block_size;
+    threads->classes[i] = classes[i];
+    if (threads->classes[i].mps_cached_count > maxCount)
+      threads->classes[i].mps_cached_count = (size_t)maxCount;
+  }
+
+  threads->pool = pool;
+  threads->classesCount = classesCount;
+  threads->cacheLimit = cacheLimit;
+  RingInit(&threads->sacRing);
+  threads->sig = SACThreadsSig;
+  pool->sacThreads = threads;
+  AVERT(SACThreads, threads);
+  return ResOK;
+
+failClassesAlloc:
+  ControlFree(arena, threads, sizeof(SACThreadsStruct));
+failThreadsAlloc:
+  return res;
+}
+
+
+/* sacThreadDestroy -- flush and destroy the cache of one thread */
+
+static void sacThreadDestroy(SAC sac)
+{
+  AVERT(SAC, sac);
+  AVER(sac->thread != NULL);
+  RingRemove(&sac->threadsRing);
+  sac->thread = NULL;
+  SACDestroy(sac);
+}
+
+
+/* SACThreadsDestroy -- destroy all the per-thread caches of a pool
+ *
+ * Called when the pool is destroyed.
+ */
+
+void SACThreadsDestroy(Pool pool)
+{
+  SACThreads threads;
+  Arena arena;
+  Ring node, next;
+
+  AVERT(Pool, pool);
+  threads = pool->sacThreads;
+  AVERT(SACThreads, threads);
+  arena = PoolArena(pool);
+
+  RING_FOR(node, &threads->sacRing, next) {
+    SAC sac = RING_ELT(SAC, threadsRing, node);
+    sacThreadDestroy(sac);
+  }
+  RingFinish(&threads->sacRing);
+  pool->sacThreads = NULL;
+  threads->sig = SigInvalid;
+  ControlFree(arena, threads->classes,
+              threads->classesCount * sizeof threads->classes[0]);
+  ControlFree(arena, threads, sizeof(SACThreadsStruct));
+}
+
+
+/* sacThreadsLookup -- find the cache of a thread, or NULL */
+
+static SAC sacThreadsLookup(SACThreads threads, Thread thread)
+{
+  Ring node, next;
+  RING_FOR(node, &threads->sacRing, next) {
+    SAC sac = RING_ELT(SAC, threadsRing, node);
+    if (sac->thread == thread)
+      return sac;
+  }
+  return NULL;
+}
+
+
+/* SACThreadsFind -- find the cache of a thread, creating it if needed */
+
+Res SACThreadsFind(SAC *sacReturn, Pool pool, Thread thread)
+{
+  SACThreads threads;
+  SAC sac;
+  Res res;
+
+  AVER(sacReturn != NULL);
+  AVERT(Pool, pool);
+  threads = pool->sacThreads;
+  AVERT(SACThreads, threads);
+  AVERT(Thread, thread);
+  AVER(ThreadArena(thread) == PoolArena(pool));
+
+  sac = sacThreadsLookup(threads, thread);
+  if (sac == NULL) {
+    res = SACCreate(&sac, pool, threads->classesCount, threads->classes);
+    if (res != ResOK)
+      return res;
+    sac->thread = thread;
+    RingAppend(&threads->sacRing, &sac->threadsRing);
+  }
+
+  *sacReturn = sac;
+  return ResOK;
+}
+
+
+/* SACThreadsDeregister -- destroy the caches of a thread
+ *
+ * Called when the thread is deregistered from the arena, so that the
+ * memory cached for it goes back to the pools.
+ */
+
+void SACThreadsDeregister(Arena arena, Thread thread)
+{
+  Ring node, next;
+
+  AVERT(Arena, arena);
+  AVERT(Thread, thread);
+
+  RING_FOR(node, ArenaPoolRing(arena), next) {
+    Pool pool = RING_ELT(Pool, arenaRing, node);
+    if (pool->sacThreads != NULL) {
+      SAC sac = sacThreadsLookup(pool->sacThreads, thread);
+      if (sac != NULL)
+        sacThreadDestroy(sac);
+    }
+  }
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2014 Ravenbrook Limited <http://www.ravenbrook.com/>.
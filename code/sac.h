@@ -25,6 +25,8 @@ typedef struct SACStruct {
   Pool pool;
   Count classesCount;  /* number of classes */
   Index middleIndex;   /* index of the middle */
+  Thread thread;       /* owning thread, or NULL <design/sac#.thread> */
+  RingStruct threadsRing; /* link in ring of thread SACs for pool */
   _mps_sac_s esac_s;   /* variable length, must be last */
 } SACStruct;
 
@@ -41,12 +43,37 @@ typedef struct SACStruct {
 typedef struct mps_sac_classes_s *SACClasses;
 
 
+/* SACThreads -- per-thread caches for a pool
+ *
+ * <design/sac#.thread>.  A pool has one of these if the client has
+ * asked it to provide per-thread caches.  The classes are those
+ * passed by the client, with the cached counts reduced to respect
+ * the cache limit.
+ */
+
+#define SACThreadsSig ((Sig)0x5195AC7D) /* SIGnature SAC THreaDs */
+
+typedef struct SACThreadsStruct {
+  Sig sig;
+  Pool pool;             /* pool providing the caches */
+  Count classesCount;    /* number of classes */
+  SACClasses classes;    /* classes for each thread's cache */
+  Size cacheLimit;       /* limit on bytes cached per thread */
+  RingStruct sacRing;    /* ring of thread SACs */
+} SACThreadsStruct;
+
+
 extern Res SACCreate(SAC *sac_o, Pool pool, Count classesCount,
                      SACClasses classes);
 extern void SACDestroy(SAC sac);
 extern Res SACFill(Addr *p_o, SAC sac, Size size);
 extern void SACEmpty(SAC sac, Addr p, Size size);
 extern void SACFlush(SAC sac);
+extern Res SACThreadsCreate(Pool pool, Count classesCount,
+                            SACClasses classes, Size cacheLimit);
+extern void SACThreadsDestroy(Pool pool);
+extern Res SACThreadsFind(SAC *sacReturn, Pool pool, Thread thread);
+extern void SACThreadsDeregister(Arena arena, Thread thread);
 
 
 #endif /* sac_h */
@@ -0,0 +1,348 @@
+/* sacbench.c -- Segregated allocation cache benchmark on ANSI C library
+ *
+ * $Id$
+ * Copyright (c) 2018 Ravenbrook Limited.  See end of file for license.
+ *
+ * This is a multi-threaded variant of sacss.c. Several threads share
+ * an MVFF pool, and each repeatedly frees and reallocates random
+ * blocks in an array of its own. The "alloc" test uses mps_alloc and
+ * mps_free, which take the arena lock on every call. The "classes"
+ * test also uses mps_alloc and mps_free, but the pool keeps small free
+ * blocks in size classes, which are protected by the pool lock, so
+ * that most calls don't take the arena lock. See
+ * <design/thread-safety#.sol.pool>. The "sac" test uses the cache
+ * that the pool provides for each thread, which takes the arena lock
+ * only to fill or empty a freelist. See <design/sac#.thread>.
+ */
+
+#include "mps.c"
+
+#include "testlib.h"
+#include "testthr.h"
+
+#ifdef MPS_OS_W3
+#include "getopt.h"
+#else
+#include <getopt.h>
+#endif
+
+#include <stdio.h> /* fprintf, printf, stderr */
+#include <stdlib.h> /* alloca, exit, EXIT_FAILURE, EXIT_SUCCESS, strtoul */
+#include <time.h> /* CLOCKS_PER_SEC, clock */
+
+#define SACMUST(expr) \
+  do { \
+    mps_res_t res = (expr); \
+    if (res != MPS_RES_OK) { \
+      fprintf(stderr, #expr " returned %d\n", res); \
+      exit(EXIT_FAILURE); \
+    } \
+  } while(0)
+
+static mps_arena_t arena;
+static mps_pool_t pool;
+static mps_bool_t cached;         /* pool provides per-thread caches */
+static mps_bool_t size_classes;   /* pool keeps size classes */
+
+static rnd_state_t seed = 0;      /* random number seed */
+static unsigned nthreads = 4;     /* threads */
+static unsigned niter = 50;       /* iterations */
+static unsigned npass = 100;      /* passes over blocks */
+static unsigned nblocks = 64;     /* number of blocks */
+static unsigned sshift = 8;       /* log2 max block size in words */
+static size_t cached_count = 64;  /* blocks cached per class */
+static size_t cache_limit = 256ul * 1024; /* bytes cached per thread */
+
+#define classCOUNT 8              /* classes of MPS_PF_ALIGN << i */
+
+
+/* The benchmark behaviour is defined as a macro so that the
+   MPS_SAC_ALLOC_FAST and MPS_SAC_FREE_FAST macros are inlined, as they
+   would be in a client. */
+
+#define SACRUN(fname, alloc, free) \
+  static void *fname(void *p) { \
+    struct {void *p; size_t s;} *blocks = alloca(sizeof(blocks[0]) * nblocks); \
+    mps_thr_t thread; \
+    mps_sac_t sac = NULL; \
+    unsigned i, j, k; \
+    mps_res_t ares; \
+    \
+    SACMUST(mps_thread_reg(&thread, arena)); \
+    if (cached) \
+      SACMUST(mps_sac_thread(&sac, pool, thread)); \
+    \
+    for (i = 0; i < niter; ++i) { \
+      for (k = 0; k < nblocks; ++k) { \
+        blocks[k].p = NULL; \
+        blocks[k].s = 0; \
+      } \
+      for (j = 0; j < npass; ++j) { \
+        for (k = 0; k < nblocks; ++k) { \
+          if (blocks[k].p != NULL) \
+            free(blocks[k].p, blocks[k].s); \
+          blocks[k].s = 1 + rnd() % ((sizeof(void *) << (rnd() % sshift)) - 1); \
+          alloc(blocks[k].p, blocks[k].s); \
+        } \
+      } \
+      for (k = 0; k < nblocks; ++k) \
+        free(blocks[k].p, blocks[k].s); \
+    } \
+    \
+    mps_thread_dereg(thread); \
+    return p; \
+  }
+
+
+/* mps_alloc/mps_free benchmark */
+
+#define MPS_ALLOC(p, s) \
+  do { \
+    ares = mps_alloc(&p, pool, s); \
+    if (ares != MPS_RES_OK) \
+      exit(EXIT_FAILURE); \
+  } while(0)
+#define MPS_FREE(p, s)  do { mps_free(pool, p, s); } while(0)
+
+SACRUN(sac_alloc, MPS_ALLOC, MPS_FREE)
+
+
+/* per-thread cache benchmark */
+
+#define SAC_ALLOC(p, s) \
+  do { \
+    MPS_SAC_ALLOC_FAST(ares, p, sac, s, FALSE); \
+    if (ares != MPS_RES_OK) \
+      exit(EXIT_FAILURE); \
+  } while(0)
+#define SAC_FREE(p, s)  MPS_SAC_FREE_FAST(sac, p, s)
+
+SACRUN(sac_cached, SAC_ALLOC, SAC_FREE)
+
+
+typedef void *(*sacrun_t)(void *);
+
+static void weave(sacrun_t run)
+{
+  testthr_t *threads = alloca(sizeof(threads[0]) * nthreads);
+  unsigned t;
+
+  for (t = 0; t < nthreads; ++t)
+    testthr_create(&threads[t], run, NULL);
+
+  for (t = 0; t < nthreads; ++t)
+    testthr_join(&threads[t], NULL);
+}
+
+
+/* watch -- run a test in a new arena and pool, and time it */
+
+static void watch(sacrun_t run, const char *name)
+{
+  clock_t start, finish;
+
+  SACMUST(mps_arena_create_k(&arena, mps_arena_class_vm(), mps_args_none));
+  MPS_ARGS_BEGIN(args) {
+    MPS_ARGS_ADD(args, MPS_KEY_MVFF_SIZE_CLASSES, size_classes);
+    SACMUST(mps_pool_create_k(&pool, arena, mps_class_mvff(), args));
+  } MPS_ARGS_END(args);
+  if (cached) {
+    mps_sac_classes_s classes[classCOUNT];
+    size_t i;
+    for (i = 0; i < classCOUNT; ++i) {
+      classes[i].mps_block_size = (size_t)MPS_PF_ALIGN << i;
+      classes[i].mps_cached_count = cached_count;
+      classes[i].mps_frequency = 1;
+    }
+    SACMUST(mps_sac_thread_classes(pool, classCOUNT, classes, cache_limit));
+  }
+
+  start = clock();
+  weave(run);
+  finish = clock();
+
+  printf("%s: %g\n", name, (double)(finish - start) / CLOCKS_PER_SEC);
+
+  mps_pool_destroy(pool);
+  mps_arena_destroy(arena);
+}
+
+
+/* Command-line options definitions.  See getopt_long(3). */
+
+static struct option longopts[] = {
+  {"help",             no_argument,       NULL, 'h'},
+  {"nthreads",         required_argument, NULL, 't'},
+  {"niter",            required_argument, NULL, 'i'},
+  {"npass",            required_argument, NULL, 'p'},
+  {"nblocks",          required_argument, NULL, 'b'},
+  {"sshift",           required_argument, NULL, 's'},
+  {"cached-count",     required_argument, NULL, 'n'},
+  {"cache-limit",      required_argument, NULL, 'l'},
+  {"seed",             required_argument, NULL, 'x'},
+  {NULL,               0,                 NULL, 0  }
+};
+
+
+/* Test definitions. */
+
+static struct {
+  const char *name;
+  sacrun_t run;
+  mps_bool_t cached;
+  mps_bool_t classes;
+} tests[] = {
+  {"alloc",   sac_alloc,  FALSE, FALSE},
+  {"classes", sac_alloc,  FALSE, TRUE},
+  {"sac",     sac_cached, TRUE,  FALSE},
+};
+
+
+/* Command-line driver */
+
+int main(int argc, char *argv[])
+{
+  int ch;
+  unsigned i;
+  mps_bool_t seed_specified = FALSE;
+
+  seed = rnd_seed();
+
+  while ((ch = getopt_long(argc, argv, "ht:i:p:b:s:n:l:x:",
+                           longopts, NULL)) != -1)
+    switch (ch) {
+    case 't':
+      nthreads = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'i':
+      niter = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'p':
+      npass = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'b':
+      nblocks = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 's':
+      sshift = (unsigned)strtoul(optarg, NULL, 10);
+      if (sshift == 0) {
+        fprintf(stderr, "Bad sshift %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'n':
+      cached_count = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'l':
+      cache_limit = (size_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'x':
+      seed = strtoul(optarg, NULL, 10);
+      seed_specified = TRUE;
+      break;
+    default:
+      /* This is printed in parts to keep within the 509 character
+         limit for string literals in portable standard C. */
+      fprintf(stderr,
+              "Usage: %s [option...] [test...]\n"
+              "Options:\n"
+              "  -t n, --nthreads=n\n"
+              "    Launch n threads each running the test (default %u)\n"
+              "  -i n, --niter=n\n"
+              "    Iterate each test n times (default %u)\n"
+              "  -p n, --npass=n\n"
+              "    Pass over the block array n times (default %u)\n"
+              "  -b n, --nblocks=n\n"
+              "    Length of the block array (default %u)\n"
+              "  -s n, --sshift=n\n"
+              "    Log2 max block size in words (default %u)\n",
+              argv[0],
+              nthreads,
+              niter,
+              npass,
+              nblocks,
+              sshift);
+      fprintf(stderr,
+              "  -n n, --cached-count=n\n"
+              "    Blocks cached per class (default %lu)\n"
+              "  -l n, --cache-limit=n\n"
+              "    Bytes cached per thread (default %lu)\n"
+              "  -x n, --seed=n\n"
+              "    Random number seed (default from entropy)\n",
+              (unsigned long)cached_count,
+              (unsigned long)cache_limit);
+      fprintf(stderr,
+              "Tests:\n"
+              "  alloc    pool class MVFF (alloc interface)\n"
+              "  classes  pool class MVFF (alloc interface, size classes)\n"
+              "  sac      pool class MVFF (per-thread caches)\n");
+      return EXIT_FAILURE;
+    }
+  argc -= optind;
+  argv += optind;
+
+  if (!seed_specified) {
+    printf("seed: %lu\n", seed);
+    (void)fflush(stdout);
+  }
+
+  while (argc > 0) {
+    for (i = 0; i < NELEMS(tests); ++i)
+      if (strcmp(argv[0], tests[i].name) == 0)
+        goto found;
+    fprintf(stderr, "unknown test \"%s\"\n", argv[0]);
+    return EXIT_FAILURE;
+  found:
+    (void)mps_lib_assert_fail_install(assert_die);
+    rnd_state_set(seed);
+    cached = tests[i].cached;
+    size_classes = tests[i].classes;
+    watch(tests[i].run, tests[i].name);
+    --argc;
+    ++argv;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+
+/* C. COPYRIGHT AND LICENSE
+ *
+ * Copyright (C) 2018 Ravenbrook Limited <http://www.ravenbrook.com/>.
+ * All rights reserved.  This is an open source license.  Contact
+ * Ravenbrook for commercial licensing options.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Redistributions in any form must be accompanied by information on how
+ * to obtain complete source code for this software and any accompanying
+ * software that uses this software.  The source code must either be
+ * included in the distribution or be available for no more than the cost
+ * of distribution plus a nominal fee, and must be freely redistributable
+ * under reasonable conditions.  For an executable file, complete source
+ * code means the source code for all modules it contains. It does not
+ * include source code for modules or files that typically accompany the
+ * major components of the operating system on which the executable file
+ * runs.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE, OR NON-INFRINGEMENT, ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDERS AND CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ * USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ * ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
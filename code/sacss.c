@@ -38,16 +38,21 @@ static mps_res_t make(mps_addr_t *p, mps_sac_t sac, size_t size)
 }
 
 
-/* stress -- create a pool of the requested type and allocate in it */
+/* stress -- create a pool of the requested type and allocate in it
+ *
+ * If per_thread is true, use the cache that the pool provides for the
+ * current thread, instead of creating one.
+ */
 
 static mps_res_t stress(mps_arena_t arena, mps_align_t align,
                         size_t (*size)(size_t i),
                         const char *name, mps_pool_class_t pool_class,
-                        mps_arg_s *args)
+                        mps_arg_s *args, mps_bool_t per_thread)
 {
   mps_res_t res;
   mps_pool_t pool;
   mps_sac_t sac;
+  mps_thr_t thread = NULL;
   size_t i, k;
   int *ps[testSetSIZE];
   size_t ss[testSetSIZE];
@@ -68,8 +73,19 @@ static mps_res_t stress(mps_arena_t arena, mps_align_t align,
   if (res != MPS_RES_OK)
     return res;
 
-  die(mps_sac_create(&sac, pool, classes_count, classes),
-      "SACCreate");
+  if (per_thread) {
+    mps_sac_t again;
+    die(mps_thread_reg(&thread, arena), "mps_thread_reg");
+    die(mps_sac_thread_classes(pool, classes_count, classes,
+                               (size_t)1 << 20),
+        "mps_sac_thread_classes");
+    die(mps_sac_thread(&sac, pool, thread), "mps_sac_thread");
+    die(mps_sac_thread(&again, pool, thread), "mps_sac_thread again");
+    cdie(again == sac, "thread cache not found again");
+  } else {
+    die(mps_sac_create(&sac, pool, classes_count, classes),
+        "SACCreate");
+  }
 
   /* allocate a load of objects */
   for (i = 0; i < testSetSIZE; ++i) {
@@ -129,7 +145,10 @@ static mps_res_t stress(mps_arena_t arena, mps_align_t align,
     }
   }
    
-  mps_sac_destroy(sac);
+  if (per_thread)
+    mps_thread_dereg(thread); /* destroys the thread's cache */
+  else
+    mps_sac_destroy(sac);
   mps_pool_destroy(pool);
 
   return MPS_RES_OK;
@@ -184,10 +203,19 @@ static void testInArena(mps_arena_class_t arena_class, mps_arg_s *arena_args)
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_ARENA_HIGH, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_SLOT_HIGH, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_FIRST_FIT, TRUE);
-    die(stress(arena, align, randomSize, "MVFF", mps_class_mvff(), args),
+    die(stress(arena, align, randomSize, "MVFF", mps_class_mvff(), args,
+               FALSE),
         "stress MVFF");
   } MPS_ARGS_END(args);
 
+  MPS_ARGS_BEGIN(args) {
+    mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
+    MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
+    die(stress(arena, align, randomSize, "MVFF per-thread",
+               mps_class_mvff(), args, TRUE),
+        "stress MVFF per-thread");
+  } MPS_ARGS_END(args);
+
   MPS_ARGS_BEGIN(args) {
     mps_align_t align = rnd_align(sizeof(void *), arena_grain_size);
     MPS_ARGS_ADD(args, MPS_KEY_ALIGN, align);
@@ -196,14 +224,15 @@ static void testInArena(mps_arena_class_t arena_class, mps_arg_s *arena_args)
     MPS_ARGS_ADD(args, MPS_KEY_MVFF_FIRST_FIT, TRUE);
     MPS_ARGS_ADD(args, MPS_KEY_POOL_DEBUG_OPTIONS, &debugOptions);
     die(stress(arena, align, randomSize, "MVFF debug",
-               mps_class_mvff_debug(), args),
+               mps_class_mvff_debug(), args, FALSE),
         "stress MVFF debug");
   } MPS_ARGS_END(args);
 
   MPS_ARGS_BEGIN(args) {
     fixedSizeSize = MPS_PF_ALIGN * (1 + rnd() % 100);
     MPS_ARGS_ADD(args, MPS_KEY_MFS_UNIT_SIZE, fixedSizeSize);
-    die(stress(arena, fixedSizeSize, fixedSize, "MFS", mps_class_mfs(), args),
+    die(stress(arena, fixedSizeSize, fixedSize, "MFS", mps_class_mfs(), args,
+               FALSE),
       "stress MFS");
   } MPS_ARGS_END(args);
 
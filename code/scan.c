@@ -43,6 +43,60 @@
   } MPS_SCAN_END(ss);
 
 
+/* .batch: The batched scanners scan the area in batches of SCAN_BATCH
+ * words. The zones of all the references in a batch are computed
+ * without branching and tested against the white set in one go using
+ * MPS_FIX1_ZONES, so that a batch in which no reference can be white
+ * costs a few arithmetic instructions per word. Only if the test
+ * succeeds are the words of the batch examined one at a time. The
+ * fixed-length inner loop is written so that the compiler can unroll
+ * it and use vector instructions where they are available. Any words
+ * left over at the end of the area are scanned one at a time.
+ *
+ * This is slower than MPS_SCAN_AREA when many references are white,
+ * because those words are examined twice, so the client must choose
+ * these scanners explicitly.
+ */
+
+#define SCAN_BATCH 4
+
+#define SCAN_AREA_FIX(p, tag_bits)                      \
+  MPS_BEGIN                                             \
+    mps_addr_t ref = (mps_addr_t)(*(p) ^ (tag_bits));   \
+    mps_res_t res = MPS_FIX2(ss, &ref);                 \
+    if (res != MPS_RES_OK)                              \
+      return res;                                       \
+    *(p) = (mps_word_t)ref | (tag_bits);                \
+  MPS_END
+
+#define MPS_SCAN_AREA_BATCH(test) \
+  MPS_SCAN_BEGIN(ss) {                                  \
+    mps_word_t *p = base;                               \
+    while ((mps_word_t *)limit - p >= SCAN_BATCH) {     \
+      mps_word_t zone[SCAN_BATCH], zones = 0;           \
+      int i;                                            \
+      for (i = 0; i < SCAN_BATCH; ++i) {                \
+        mps_word_t word = p[i];                         \
+        mps_word_t tag_bits = word & mask;              \
+        zone[i] = (test) ? MPS_FIX1_ZONE(ss, word ^ tag_bits) : 0; \
+        zones |= zone[i];                               \
+      }                                                 \
+      if (MPS_FIX1_ZONES(ss, zones))                    \
+        for (i = 0; i < SCAN_BATCH; ++i)                \
+          if (MPS_FIX1_ZONES(ss, zone[i]))              \
+            SCAN_AREA_FIX(&p[i], p[i] & mask);          \
+      p += SCAN_BATCH;                                  \
+    }                                                   \
+    while (p < (mps_word_t *)limit) {                   \
+      mps_word_t word = *p;                             \
+      mps_word_t tag_bits = word & mask;                \
+      if ((test) && MPS_FIX1(ss, word ^ tag_bits))      \
+        SCAN_AREA_FIX(p, tag_bits);                     \
+      ++p;                                              \
+    }                                                   \
+  } MPS_SCAN_END(ss);
+
+
 /* mps_scan_area -- scan contiguous area of references
  *
  * This is a convenience function for scanning the contiguous area
@@ -144,6 +198,66 @@ mps_res_t mps_scan_area_tagged_or_zero(mps_ss_t ss,
 }  
 
 
+/* mps_scan_area_batch, mps_scan_area_masked_batch,
+ * mps_scan_area_tagged_batch, mps_scan_area_tagged_or_zero_batch --
+ * batched versions of the area scanners
+ *
+ * These fix the same words as the scanners above, but apply the
+ * first-stage fix to a batch of words at a time. See .batch.
+ */
+
+mps_res_t mps_scan_area_batch(mps_ss_t ss,
+                              void *base, void *limit,
+                              void *closure)
+{
+  mps_word_t mask = 0;
+
+  (void)closure; /* unused */
+
+  MPS_SCAN_AREA_BATCH(1);
+
+  return MPS_RES_OK;
+}
+
+mps_res_t mps_scan_area_masked_batch(mps_ss_t ss,
+                                     void *base, void *limit,
+                                     void *closure)
+{
+  mps_scan_tag_t tag = closure;
+  mps_word_t mask = tag->mask;
+
+  MPS_SCAN_AREA_BATCH(1);
+
+  return MPS_RES_OK;
+}
+
+mps_res_t mps_scan_area_tagged_batch(mps_ss_t ss,
+                                     void *base, void *limit,
+                                     void *closure)
+{
+  mps_scan_tag_t tag = closure;
+  mps_word_t mask = tag->mask;
+  mps_word_t pattern = tag->pattern;
+
+  MPS_SCAN_AREA_BATCH(tag_bits == pattern);
+
+  return MPS_RES_OK;
+}
+
+mps_res_t mps_scan_area_tagged_or_zero_batch(mps_ss_t ss,
+                                             void *base, void *limit,
+                                             void *closure)
+{
+  mps_scan_tag_t tag = closure;
+  mps_word_t mask = tag->mask;
+  mps_word_t pattern = tag->pattern;
+
+  MPS_SCAN_AREA_BATCH(tag_bits == 0 || tag_bits == pattern);
+
+  return MPS_RES_OK;
+}
+
+
 /* C. COPYRIGHT AND LICENSE
  *
  * Copyright (C) 2001-2016 Ravenbrook Limited
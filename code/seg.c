@@ -132,6 +132,7 @@ static Res segAbsInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   seg->defer = WB_DEFER_INIT;
   seg->depth = 0;
   seg->queued = FALSE;
+  seg->moveEpoch = ArenaHistory(arena)->epoch;
   seg->firstTract = NULL;
   RingInit(SegPoolRing(seg));
 
@@ -271,12 +272,19 @@ void SegFlip(Seg seg, Trace trace)
 /* SegSetWhite -- change the whiteness of a segment
  *
  * Sets the segment whiteness to the trace set ts.
+ *
+ * .white.move: If the segment belongs to a moving pool and stops being
+ * white for a trace, objects in it may have moved, so record the
+ * current epoch. <design/seg#.field.moveEpoch>
  */
 
 void SegSetWhite(Seg seg, TraceSet white)
 {
   AVERT(Seg, seg);
   AVERT(TraceSet, white);
+  if (TraceSetDiff(SegWhite(seg), white) != TraceSetEMPTY
+      && PoolHasAttr(SegPool(seg), AttrMOVINGGC))
+    seg->moveEpoch = ArenaHistory(PoolArena(SegPool(seg)))->epoch;
   Method(Seg, seg, setWhite)(seg, white);
 }
 
@@ -441,6 +449,7 @@ static Res segAbsDescribe(Inst inst, mps_lib_FILE *stream, Count depth)
                "grey $B\n", (WriteFB)seg->grey,
                "white $B\n", (WriteFB)seg->white,
                "nailed $B\n", (WriteFB)seg->nailed,
+               "moveEpoch $U\n", (WriteFU)seg->moveEpoch,
                "rankSet",
                seg->rankSet == RankSetEMPTY ? " EMPTY" : "",
                BS_IS_MEMBER(seg->rankSet, RankAMBIG) ? " AMBIG" : "",
@@ -831,6 +840,59 @@ void SegReclaim(Seg seg, Trace trace)
 }
 
 
+/* SegDeferSweep -- defer the sweep of a segment
+ *
+ * Called by a reclaim method that leaves the sweep of a segment
+ * until later. The segment goes on the arena's ring of segments to
+ * sweep lazily, and its lazy sweep method will be called if it is
+ * still there when the arena has idle time to spend, or when a trace
+ * needs to condemn or scan it. <design/seg#.method.lazy-sweep>.
+ */
+
+void SegDeferSweep(Seg seg)
+{
+  GCSeg gcseg = SegGCSeg(seg);
+  Arena arena = PoolArena(SegPool(seg));
+
+  AVER(SegWhite(seg) == TraceSetEMPTY);
+  AVER(RingIsSingle(&gcseg->sweepRing));
+  RingAppend(&arena->sweepRing, &gcseg->sweepRing);
+}
+
+
+/* SegUndeferSweep -- note that a deferred sweep is being finished */
+
+void SegUndeferSweep(Seg seg)
+{
+  GCSeg gcseg = SegGCSeg(seg);
+  AVER(!RingIsSingle(&gcseg->sweepRing));
+  RingRemove(&gcseg->sweepRing);
+}
+
+
+/* SegSweepIsDeferred -- is the sweep of a segment deferred? */
+
+Bool SegSweepIsDeferred(Seg seg)
+{
+  return !RingIsSingle(&SegGCSeg(seg)->sweepRing);
+}
+
+
+/* SegLazySweep -- finish the deferred sweep of a segment
+ *
+ * If mayFree is TRUE, the segment may be freed by its lazy sweep
+ * method.
+ */
+
+void SegLazySweep(Seg seg, Bool mayFree)
+{
+  AVERT(Seg, seg);
+  AVER(SegSweepIsDeferred(seg));
+  AVERT(Bool, mayFree);
+  Method(Seg, seg, lazySweep)(seg, mayFree);
+}
+
+
 /* SegWalk -- walk objects in this segment */
 
 void SegWalk(Seg seg, Format format, FormattedObjectsVisitor f,
@@ -876,6 +938,7 @@ Bool SegCheck(Seg seg)
   CHECKL(AddrIsArenaGrain(TractBase(seg->firstTract), arena));
   CHECKL(AddrIsArenaGrain(seg->limit, arena));
   CHECKL(seg->limit > TractBase(seg->firstTract));
+  CHECKL(seg->moveEpoch <= ArenaHistory(arena)->epoch);
   /* CHECKL(BoolCheck(seq->queued)); <design/type#.bool.bitfield.check> */
 
   /* Each tract of the segment must agree about the segment and its
@@ -1117,6 +1180,8 @@ static Res segTrivMerge(Seg seg, Seg segHi,
   /* no need to update fields which match. See .similar */
 
   seg->limit = limit;
+  if (segHi->moveEpoch > seg->moveEpoch)
+    seg->moveEpoch = segHi->moveEpoch;
   TRACT_FOR(tract, addr, arena, mid, limit) {
     AVERT(Tract, tract);
     AVER(segHi == TractSeg(tract));
@@ -1190,6 +1255,7 @@ static Res segTrivSplit(Seg seg, Seg segHi,
   segHi->sm = seg->sm;
   segHi->depth = seg->depth;
   segHi->queued = seg->queued;
+  segHi->moveEpoch = seg->moveEpoch;
   segHi->firstTract = NULL;
   RingInit(SegPoolRing(segHi));
 
@@ -1310,13 +1376,16 @@ Res SegSingleAccess(Seg seg, Arena arena, Addr addr,
       /* .tagging: Check that the reference is aligned to a word boundary */
       /* (we assume it is not a reference otherwise). */
       if(WordIsAligned((Word)ref, sizeof(Word))) {
-        Rank rank;
+        TraceId ti;
+        Trace trace;
         /* See the note in TraceRankForAccess */
         /* <code/trace.c#scan.conservative>. */
 
-        rank = TraceRankForAccess(arena, seg);
-        TraceScanSingleRef(arena->flippedTraces, rank, arena,
-                           seg, (Ref *)addr);
+        TRACE_SET_ITER(ti, trace, arena->flippedTraces, arena)
+          TraceScanSingleRef(TraceSetSingle(trace),
+                             TraceRankForAccess(trace, seg), arena,
+                             seg, (Ref *)addr);
+        TRACE_SET_ITER_END(ti, trace, arena->flippedTraces, arena);
       }
     }
     res = MutatorContextStepInstruction(context);
@@ -1396,6 +1465,25 @@ static Res segNoFix(Seg seg, ScanState ss, Ref *refIO)
 }
 
 
+/* segTrivSweep -- sweep method for segs with nothing to prepare */
+
+static void segTrivSweep(Seg seg, Trace trace)
+{
+  AVERT(Seg, seg);
+  AVERT(Trace, trace);
+}
+
+
+/* segNoLazySweep -- lazy sweep method for segs that never defer */
+
+static void segNoLazySweep(Seg seg, Bool mayFree)
+{
+  AVERT(Seg, seg);
+  AVERT(Bool, mayFree);
+  NOTREACHED;
+}
+
+
 /* segNoReclaim -- reclaim method for non-GC segs */
 
 static void segNoReclaim(Seg seg, Trace trace)
@@ -1452,6 +1540,11 @@ Bool GCSegCheck(GCSeg gcseg)
 
   CHECKD_NOSIG(Ring, &gcseg->genRing);
 
+  /* A segment whose sweep is deferred is not white.
+     <design/seg#.method.lazy-sweep> */
+  CHECKD_NOSIG(Ring, &gcseg->sweepRing);
+  CHECKL(RingIsSingle(&gcseg->sweepRing) || seg->white == TraceSetEMPTY);
+
   return TRUE;
 }
 
@@ -1473,6 +1566,7 @@ static Res gcSegInit(Seg seg, Pool pool, Addr base, Size size, ArgList args)
   gcseg->buffer = NULL;
   RingInit(&gcseg->greyRing);
   RingInit(&gcseg->genRing);
+  RingInit(&gcseg->sweepRing);
 
   SetClassOfPoly(seg, CLASS(GCSeg));
   gcseg->sig = GCSegSig;
@@ -1504,8 +1598,13 @@ static void gcSegFinish(Inst inst)
   /* Don't leave a dangling buffer allocating into hyperspace. */
   AVER(gcseg->buffer == NULL); /* <design/check/#.common> */
 
+  /* A segment may be freed before its deferred sweep is finished. */
+  if (!RingIsSingle(&gcseg->sweepRing))
+    RingRemove(&gcseg->sweepRing);
+
   RingFinish(&gcseg->greyRing);
   RingFinish(&gcseg->genRing);
+  RingFinish(&gcseg->sweepRing);
 
   /* finish the superclass fields last */
   NextMethod(Inst, GCSeg, finish)(inst);
@@ -1873,6 +1972,9 @@ static Res gcSegMerge(Seg seg, Seg segHi,
   AVER(SegLimit(seg) == mid);
   AVER(SegBase(segHi) == mid);
   AVER(SegLimit(segHi) == limit);
+  /* <design/seg#.method.lazy-sweep> */
+  AVER(RingIsSingle(&gcseg->sweepRing));
+  AVER(RingIsSingle(&gcsegHi->sweepRing));
 
   buf = gcsegHi->buffer;      /* any buffer on segHi must be reassigned */
   AVER(buf == NULL || gcseg->buffer == NULL); /* See .buffer */
@@ -1906,6 +2008,7 @@ static Res gcSegMerge(Seg seg, Seg segHi,
   RingFinish(&gcsegHi->greyRing);
   RingRemove(&gcsegHi->genRing);
   RingFinish(&gcsegHi->genRing);
+  RingFinish(&gcsegHi->sweepRing);
 
   /* Reassign any buffer that was connected to segHi  */
   if (NULL != buf) {
@@ -1943,6 +2046,7 @@ static Res gcSegSplit(Seg seg, Seg segHi,
   AVER(mid < limit);
   AVER(SegBase(seg) == base);
   AVER(SegLimit(seg) == limit);
+  AVER(RingIsSingle(&gcseg->sweepRing)); /* <design/seg#.method.lazy-sweep> */
 
   grey = SegGrey(seg);
   buf = gcseg->buffer; /* Look for buffer to reassign to segHi */
@@ -1967,6 +2071,7 @@ static Res gcSegSplit(Seg seg, Seg segHi,
   RingInit(&gcsegHi->greyRing);
   RingInit(&gcsegHi->genRing);
   RingInsert(&gcseg->genRing, &gcsegHi->genRing);
+  RingInit(&gcsegHi->sweepRing);
   gcsegHi->sig = GCSegSig;
   gcSegSetGreyInternal(segHi, TraceSetEMPTY, grey);
 
@@ -2016,7 +2121,7 @@ static void gcSegGreyen(Seg seg, Trace trace)
   AVER(PoolArena(SegPool(seg)) == trace->arena);
 
   if (!TraceSetIsMember(SegWhite(seg), trace))
-    SegSetGrey(seg, TraceSetSingle(trace));
+    SegSetGrey(seg, TraceSetAdd(SegGrey(seg), trace));
 }
 
 
@@ -2094,7 +2199,9 @@ Bool SegClassCheck(SegClass klass)
   CHECKL(FUNCHECK(klass->scan));
   CHECKL(FUNCHECK(klass->fix));
   CHECKL(FUNCHECK(klass->fixEmergency));
+  CHECKL(FUNCHECK(klass->sweep));
   CHECKL(FUNCHECK(klass->reclaim));
+  CHECKL(FUNCHECK(klass->lazySweep));
   CHECKL(FUNCHECK(klass->walk));
 
   /* Check that segment classes override sets of related methods. */
@@ -2146,7 +2253,9 @@ DEFINE_CLASS(Seg, Seg, klass)
   klass->scan = segNoScan;
   klass->fix = segNoFix;
   klass->fixEmergency = segNoFix;
+  klass->sweep = segTrivSweep;
   klass->reclaim = segNoReclaim;
+  klass->lazySweep = segNoLazySweep;
   klass->walk = segTrivWalk;
   klass->sig = SegClassSig;
   AVERT(SegClass, klass);
@@ -2181,7 +2290,9 @@ DEFINE_CLASS(Seg, GCSeg, klass)
   klass->scan = segNoScan; /* no useful default method */
   klass->fix = segNoFix; /* no useful default method */
   klass->fixEmergency = segNoFix; /* no useful default method */
+  klass->sweep = segTrivSweep;
   klass->reclaim = segNoReclaim; /* no useful default method */
+  klass->lazySweep = segNoLazySweep;
   klass->walk = segTrivWalk;
   AVERT(SegClass, klass);
 }
@@ -27,6 +27,7 @@ void ShieldInit(Shield shield)
   shield->depth = 0;
   shield->unsynced = 0;
   shield->holds = 0;
+  shield->suspendClock = 0;
   shield->sig = ShieldSig;
 }
 
@@ -242,12 +243,41 @@ static void shieldSuspend(Arena arena)
   AVER(shield->inside);
 
   if (!shield->suspended) {
+    Clock start = ClockNow();
     ThreadRingSuspend(ArenaThreadRing(arena), ArenaDeadRing(arena));
     shield->suspended = TRUE;
+    shield->suspendClock = ClockNow();
+    EVENT2(MutatorSuspend, arena,
+           (double)(shield->suspendClock - start) / (double)ClocksPerSec());
   }
 }
 
 
+/* shieldResume -- resume the mutator
+ *
+ * Called from ShieldLeave, after the shield queue has been flushed,
+ * so that every segment is synced (.inv.unsynced.suspended).
+ */
+
+static void shieldResume(Arena arena)
+{
+  Shield shield;
+  Clock now;
+
+  AVERT(Arena, arena);
+  shield = ArenaShield(arena);
+  AVER(shield->suspended);
+  AVER(shield->unsynced == 0);
+
+  ThreadRingResume(ArenaThreadRing(arena), ArenaDeadRing(arena));
+  shield->suspended = FALSE;
+  now = ClockNow();
+  ArenaNotePause(arena, PauseKindSUSPEND, shield->suspendClock, now);
+  EVENT2(MutatorResume, arena,
+         (double)(now - shield->suspendClock) / (double)ClocksPerSec());
+}
+
+
 /* ShieldHold -- suspend mutator access to the unprotectable
  *
  * From outside <code/shield.c>, this is used when we really need to
@@ -697,10 +727,8 @@ void (ShieldLeave)(Arena arena)
 
   /* Ensuring the mutator is running at this point guarantees
      .inv.outside.running */
-  if (shield->suspended) {
-    ThreadRingResume(ArenaThreadRing(arena), ArenaDeadRing(arena));
-    shield->suspended = FALSE;
-  }
+  if (shield->suspended)
+    shieldResume(arena);
 
   shield->inside = FALSE;
 }
@@ -166,11 +166,36 @@ static void mapThreadRing(Ring threadRing, Ring deadRing, Bool (*func)(Thread))
 }
 
 
+/* threadRingBatch -- add all threads on a ring, except the current
+ * one, to a batch for <code/pthrdext.c>.
+ */
+
+static void threadRingBatch(Ring batch, Ring threadRing)
+{
+  Ring node, next;
+  pthread_t self;
+
+  AVERT(Ring, threadRing);
+  self = pthread_self();
+
+  RING_FOR(node, threadRing, next) {
+    Thread thread = RING_ELT(Thread, arenaRing, node);
+    AVERT(Thread, thread);
+    AVER(thread->alive);
+    if (!pthread_equal(self, thread->id)) /* .thread.id */
+      PThreadextBatchAdd(batch, &thread->thrextStruct);
+  }
+}
+
+
 /* ThreadRingSuspend -- suspend all threads on a ring, except the
  * current one.
+ *
+ * .suspend.batch: The threads are suspended as a batch, so that the
+ * cost is about one signal round trip, rather than one per thread.
  */
 
-static Bool threadSuspend(Thread thread)
+static Bool threadSuspended(Thread thread)
 {
   Res res;
   pthread_t self;
@@ -181,7 +206,7 @@ static Bool threadSuspend(Thread thread)
   /* .error.suspend: if PThreadextSuspend fails, we assume the thread
    * has been terminated. */
   AVER(thread->context == NULL);
-  res = PThreadextSuspend(&thread->thrextStruct, &thread->context);
+  res = PThreadextSuspended(&thread->thrextStruct, &thread->context);
   AVER(res == ResOK);
   AVER(thread->context != NULL);
   /* design.thread-manager.sol.thread.term.attempt */
@@ -192,34 +217,49 @@ static Bool threadSuspend(Thread thread)
 
 void ThreadRingSuspend(Ring threadRing, Ring deadRing)
 {
-  mapThreadRing(threadRing, deadRing, threadSuspend);
+  RingStruct batchStruct;
+
+  RingInit(&batchStruct);
+  threadRingBatch(&batchStruct, threadRing);
+  PThreadextSuspendBatch(&batchStruct); /* .suspend.batch */
+  RingFinish(&batchStruct);
+
+  mapThreadRing(threadRing, deadRing, threadSuspended);
 }
 
 
 /* ThreadRingResume -- resume all threads on a ring (expect the current one) */
 
 
-static Bool threadResume(Thread thread)
+static Bool threadResumed(Thread thread)
 {
   Res res;
+  MutatorContext context;
   pthread_t self;
   self = pthread_self();
   if (pthread_equal(self, thread->id)) /* .thread.id */
     return TRUE;
 
   /* .error.resume: If PThreadextResume fails, we assume the thread
-   * has been terminated. */
+   * has been terminated, and it is left suspended. */
   AVER(thread->context != NULL);
-  res = PThreadextResume(&thread->thrextStruct);
-  AVER(res == ResOK);
+  res = PThreadextSuspended(&thread->thrextStruct, &context);
+  AVER(res != ResOK);
   thread->context = NULL;
   /* design.thread-manager.sol.thread.term.attempt */
-  return res == ResOK;
+  return res != ResOK;
 }
 
 void ThreadRingResume(Ring threadRing, Ring deadRing)
 {
-  mapThreadRing(threadRing, deadRing, threadResume);
+  RingStruct batchStruct;
+
+  RingInit(&batchStruct);
+  threadRingBatch(&batchStruct, threadRing);
+  PThreadextResumeBatch(&batchStruct);
+  RingFinish(&batchStruct);
+
+  mapThreadRing(threadRing, deadRing, threadResumed);
 }
 
 
@@ -9,6 +9,8 @@
 
 #include "locus.h"
 #include "mpm.h"
+#include "lock.h"
+#include "par.h"
 #include <limits.h> /* for LONG_MAX */
 
 SRCID(trace, "$Id$");
@@ -51,6 +53,7 @@ Bool ScanStateCheck(ScanState ss)
   CHECKL(TraceSetSuper(ss->arena->busyTraces, ss->traces));
   CHECKL(RankCheck(ss->rank));
   CHECKL(BoolCheck(ss->wasMarked));
+  CHECKL(ss->fixLock == NULL || ss->fixLock == ss->arena->fixLock);
   /* @@@@ checks for counts missing */
   return TRUE;
 }
@@ -96,6 +99,7 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
   ScanStateSetZoneShift(ss, arena->zoneShift);
   ScanStateSetUnfixedSummary(ss, RefSetEMPTY);
   ss->fixedSummary = RefSetEMPTY;
+  ss->fixLock = NULL;
   ss->arena = arena;
   ss->wasMarked = TRUE;
   ScanStateSetWhite(ss, white);
@@ -106,6 +110,8 @@ void ScanStateInit(ScanState ss, TraceSet ts, Arena arena,
   STATISTIC(ss->snapCount = (Count)0);
   STATISTIC(ss->forwardedCount = (Count)0);
   STATISTIC(ss->preservedInPlaceCount = (Count)0);
+  STATISTIC(ss->lockedFixCount = (Count)0);
+  STATISTIC(ss->contendedFixCount = (Count)0);
   STATISTIC(ss->copiedSize = (Size)0);
   ss->scannedSize = (Size)0; /* see .work */
   ss->sig = ScanStateSig;
@@ -293,6 +299,8 @@ static void traceUpdateCounts(Trace trace, ScanState ss,
   STATISTIC(trace->snapCount += ss->snapCount);
   STATISTIC(trace->forwardedCount += ss->forwardedCount);
   STATISTIC(trace->preservedInPlaceCount += ss->preservedInPlaceCount);
+  STATISTIC(trace->lockedFixCount += ss->lockedFixCount);
+  STATISTIC(trace->contendedFixCount += ss->contendedFixCount);
 }
 
 
@@ -344,6 +352,21 @@ Bool TraceIsEmpty(Trace trace)
 }
 
 
+/* traceFinishSweep -- finish a deferred sweep before a trace uses a segment
+ *
+ * A segment whose sweep was deferred still contains dead objects, so
+ * the sweep must be finished before the segment is condemned or
+ * scanned.  The segment is not freed, because the caller is still
+ * using it.  <design/seg#.method.lazy-sweep>.
+ */
+
+static void traceFinishSweep(Seg seg)
+{
+  if (SegSweepIsDeferred(seg))
+    SegLazySweep(seg, FALSE);
+}
+
+
 /* TraceAddWhite -- add a segment to the white set of a trace */
 
 Res TraceAddWhite(Trace trace, Seg seg)
@@ -361,6 +384,8 @@ Res TraceAddWhite(Trace trace, Seg seg)
 
   condemnedBefore = trace->condemned;
 
+  traceFinishSweep(seg);
+
   /* Give the pool the opportunity to turn the segment white. */
   /* If it fails, unwind. */
   res = SegWhiten(seg, trace);
@@ -412,6 +437,13 @@ void TraceCondemnStart(Trace trace)
  *
  * TODO: Consider how to avoid this suspend in order to implement
  * incremental condemn.
+ *
+ * .whiten.disjoint: A segment may be white for at most one trace,
+ * because the non-moving pools keep only one set of colour tables per
+ * segment (see <design/poolams#.colour.single> and
+ * <design/poolawl#.awlseg.mark>). So segments that are already white
+ * for another busy trace are skipped here; that trace will reclaim
+ * them.
  */
 
 Res TraceCondemnEnd(double *mortalityReturn, Trace trace)
@@ -435,6 +467,8 @@ Res TraceCondemnEnd(double *mortalityReturn, Trace trace)
     RING_FOR(segNode, &gen->segRing, segNext) {
       GCSeg gcseg = RING_ELT(GCSeg, genRing, segNode);
       AVERC(GCSeg, gcseg);
+      if (SegWhite(&gcseg->segStruct) != TraceSetEMPTY)
+        continue; /* .whiten.disjoint */
       res = TraceAddWhite(trace, &gcseg->segStruct);
       if (res != ResOK)
         goto failBegin;
@@ -589,6 +623,7 @@ static Res traceFlip(Trace trace)
   Rank rank;
   struct rootFlipClosureStruct rfc;
   Res res;
+  Clock start = ClockNow(), end;
 
   AVERT(Trace, trace);
   rfc.ts = TraceSetSingle(trace);
@@ -653,10 +688,16 @@ static Res traceFlip(Trace trace)
   EVENT2(TraceFlipEnd, trace, arena);
 
   ShieldRelease(arena);
+  end = ClockNow();
+  trace->clocks += end - start;
+  ArenaNotePause(arena, PauseKindFLIP, start, end);
   return ResOK;
 
 failRootFlip:
   ShieldRelease(arena);
+  end = ClockNow();
+  trace->clocks += end - start;
+  ArenaNotePause(arena, PauseKindFLIP, start, end);
   return res;
 }
 
@@ -721,6 +762,7 @@ found:
   trace->notCondemned = (Size)0;
   trace->foundation = (Size)0;  /* nothing grey yet */
   trace->quantumWork = (Work)0; /* computed in TraceStart */
+  trace->clocks = 0;
   STATISTIC(trace->greySegCount = (Count)0);
   STATISTIC(trace->greySegMax = (Count)0);
   STATISTIC(trace->rootScanCount = (Count)0);
@@ -743,6 +785,9 @@ found:
   trace->forwardedSize = (Size)0; /* see .message.data */
   STATISTIC(trace->preservedInPlaceCount = (Count)0);
   trace->preservedInPlaceSize = (Size)0;  /* see .message.data */
+  STATISTIC(trace->parScanCount = (Count)0);
+  STATISTIC(trace->lockedFixCount = (Count)0);
+  STATISTIC(trace->contendedFixCount = (Count)0);
   STATISTIC(trace->reclaimCount = (Count)0);
   STATISTIC(trace->reclaimSize = (Size)0);
   trace->sig = TraceSig;
@@ -775,6 +820,14 @@ found:
 }
 
 
+/* traceWork -- a measure of the work done for this trace.
+ *
+ * <design/type#.work>.
+ */
+
+#define traceWork(trace) ((Work)((trace)->segScanSize + (trace)->rootScanSize))
+
+
 /* traceDestroyCommon -- common functionality for TraceDestroy*  */
 
 static void traceDestroyCommon(Trace trace)
@@ -848,13 +901,72 @@ void TraceDestroyFinished(Trace trace)
                     trace->forwardedCount, trace->forwardedSize,
                     trace->preservedInPlaceCount,
                     trace->preservedInPlaceSize));
+  STATISTIC(EVENT5(TraceStatPar, trace, trace->arena,
+                   trace->parScanCount, trace->lockedFixCount,
+                   trace->contendedFixCount));
   STATISTIC(EVENT4(TraceStatReclaim, trace, trace->arena,
                    trace->reclaimCount, trace->reclaimSize));
+  ArenaPauseStatsEmit(trace->arena);
+  PolicyTraceEnd(trace, traceWork(trace));
 
   traceDestroyCommon(trace);
 }
 
 
+/* traceParSweepBatch -- sweep a batch of white segments in parallel */
+
+typedef struct SweepBatchStruct {
+  Trace trace;                          /* trace being reclaimed */
+  Seg seg[TraceParSweepBATCH];          /* segments to sweep */
+} SweepBatchStruct;
+
+static void traceParSweepJob(Index i, Index worker, void *closure)
+{
+  SweepBatchStruct *batch = closure;
+  Seg seg = batch->seg[i];
+  UNUSED(worker);
+  Method(Seg, seg, sweep)(seg, batch->trace);
+}
+
+
+/* traceParSweep -- sweep the white segments in parallel
+ *
+ * See .par.sweep.
+ */
+
+static void traceParSweep(Trace trace)
+{
+  Arena arena = trace->arena;
+  SweepBatchStruct batch;
+  Count count = 0;
+  Ring genNode, genNext;
+
+  AVER(arena->par != NULL);
+
+  batch.trace = trace;
+  RING_FOR(genNode, &trace->genRing, genNext) {
+    Ring segNode, segNext;
+    GenDesc gen = GenDescOfTraceRing(genNode, trace);
+    AVERT(GenDesc, gen);
+    RING_FOR(segNode, &gen->segRing, segNext) {
+      GCSeg gcseg = RING_ELT(GCSeg, genRing, segNode);
+      Seg seg = &gcseg->segStruct;
+      if (TraceSetIsMember(SegWhite(seg), trace)
+          && PoolHasAttr(SegPool(seg), AttrPARSWEEP))
+      {
+        batch.seg[count++] = seg;
+        if (count == TraceParSweepBATCH) {
+          ParRun(arena->par, count, traceParSweepJob, &batch);
+          count = 0;
+        }
+      }
+    }
+  }
+  if (count > 0)
+    ParRun(arena->par, count, traceParSweepJob, &batch);
+}
+
+
 /* traceReclaim -- reclaim the remaining objects white for this trace */
 
 static void traceReclaim(Trace trace)
@@ -867,6 +979,8 @@ static void traceReclaim(Trace trace)
 
   arena = trace->arena;
   EVENT2(TraceReclaim, trace, arena);
+  if (arena->par != NULL)
+    traceParSweep(trace);
   RING_FOR(genNode, &trace->genRing, genNext) {
     Ring segNode, segNext;
     GenDesc gen = GenDescOfTraceRing(genNode, trace);
@@ -911,8 +1025,9 @@ static void traceReclaim(Trace trace)
 
 /* TraceRankForAccess -- Returns rank to scan at if we hit a barrier.
  *
- * We assume a single trace as otherwise we need to implement rank
- * filters on scanning.
+ * The rank depends on the band of the trace, and traces may be in
+ * different bands, so callers must scan for each flipped trace
+ * separately, at the rank returned for that trace.
  *
  * .scan.conservative: It's safe to scan at EXACT unless the band is
  * WEAK and in that case the segment should be weak.
@@ -936,23 +1051,16 @@ static void traceReclaim(Trace trace)
  * See the message <https://info.ravenbrook.com/mail/2012/08/30/16-46-42/0.txt>
  * for a description of these semantics.
  */
-Rank TraceRankForAccess(Arena arena, Seg seg)
+Rank TraceRankForAccess(Trace trace, Seg seg)
 {
-  TraceSet ts;
-  Trace trace;
-  TraceId ti;
   Rank band;
   RankSet rankSet;
 
-  AVERT(Arena, arena);
+  AVERT(Trace, trace);
   AVERT(Seg, seg);
+  AVER(TraceSetIsMember(trace->arena->flippedTraces, trace));
 
-  band = RankLIMIT; /* initialize with invalid rank */
-  ts = arena->flippedTraces;
-  AVER(TraceSetIsSingle(ts));
-  TRACE_SET_ITER(ti, trace, ts, arena)
-    band = traceBand(trace);
-  TRACE_SET_ITER_END(ti, trace, ts, arena);
+  band = traceBand(trace);
   rankSet = SegRankSet(seg);
   switch(band) {
   case RankAMBIG:
@@ -1114,6 +1222,71 @@ RefSet ScanStateSummary(ScanState ss)
 }
 
 
+/* traceScanSegEnd -- account for the scan of a segment
+ *
+ * Called after the segment has been scanned (successfully or not) and
+ * covered, to update the counts and the segment summary, and to finish
+ * the scan state.
+ */
+
+static void traceScanSegEnd(TraceSet ts, Arena arena, Seg seg,
+                            ScanState ss, ZoneSet white,
+                            Res res, Bool wasTotal)
+{
+  RefSet summary;
+
+  traceSetUpdateCounts(ts, arena, ss, traceAccountingPhaseSegScan);
+  /* Count segments scanned pointlessly */
+  STATISTIC({
+    TraceId ti; Trace trace;
+    Count whiteSegRefCount = 0;
+
+    TRACE_SET_ITER(ti, trace, ts, arena)
+      whiteSegRefCount += trace->whiteSegRefCount;
+    TRACE_SET_ITER_END(ti, trace, ts, arena);
+    if(whiteSegRefCount == 0)
+      TRACE_SET_ITER(ti, trace, ts, arena)
+        ++trace->pointlessScanCount;
+      TRACE_SET_ITER_END(ti, trace, ts, arena);
+  });
+
+  /* Following is true whether or not scan was total. */
+  /* <design/scan#.summary.subset>. */
+  /* .verify.segsummary: were the seg contents, as found by this
+   * scan, consistent with the recorded SegSummary?
+   */
+  AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))); /* <design/check/#.common> */
+
+  /* Write barrier deferral -- see <design/write-barrier#.deferral>. */
+  /* Did the segment refer to the white set? */
+  if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY) {
+    /* Boring scan.  One step closer to raising the write barrier. */
+    if (seg->defer > 0)
+      --seg->defer;
+  } else {
+    /* Interesting scan. Defer raising the write barrier. */
+    if (seg->defer < WB_DEFER_DELAY)
+      seg->defer = WB_DEFER_DELAY;
+  }
+
+  /* Only apply the write barrier if it is not deferred. */
+  if (seg->defer == 0) {
+    /* If we scanned every reference in the segment then we have a
+       complete summary we can set. Otherwise, we just have
+       information about more zones that the segment refers to. */
+    if (res == ResOK && wasTotal)
+      summary = ScanStateSummary(ss);
+    else
+      summary = RefSetUnion(SegSummary(seg), ScanStateSummary(ss));
+  } else {
+    summary = RefSetUNIV;
+  }
+  SegSetSummary(seg, summary);
+
+  ScanStateFinish(ss);
+}
+
+
 /* traceScanSegRes -- scan a segment to remove greyness
  *
  * @@@@ During scanning, the segment should be write-shielded to prevent
@@ -1126,7 +1299,6 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
   Bool wasTotal;
   ZoneSet white;
   Res res;
-  RefSet summary;
 
   /* The reason for scanning a segment is that it's grey. */
   AVER(TraceSetInter(ts, SegGrey(seg)) != TraceSetEMPTY);
@@ -1143,61 +1315,15 @@ static Res traceScanSegRes(TraceSet ts, Rank rank, Arena arena, Seg seg)
     ScanState ss = &ssStruct;
     ScanStateInit(ss, ts, arena, rank, white);
 
+    traceFinishSweep(seg);
+
     /* Expose the segment to make sure we can scan it. */
     ShieldExpose(arena, seg);
     res = SegScan(&wasTotal, seg, ss);
     /* Cover, regardless of result */
     ShieldCover(arena, seg);
 
-    traceSetUpdateCounts(ts, arena, ss, traceAccountingPhaseSegScan);
-    /* Count segments scanned pointlessly */
-    STATISTIC({
-      TraceId ti; Trace trace;
-      Count whiteSegRefCount = 0;
-
-      TRACE_SET_ITER(ti, trace, ts, arena)
-        whiteSegRefCount += trace->whiteSegRefCount;
-      TRACE_SET_ITER_END(ti, trace, ts, arena);
-      if(whiteSegRefCount == 0)
-        TRACE_SET_ITER(ti, trace, ts, arena)
-          ++trace->pointlessScanCount;
-        TRACE_SET_ITER_END(ti, trace, ts, arena);
-    });
-
-    /* Following is true whether or not scan was total. */
-    /* <design/scan#.summary.subset>. */
-    /* .verify.segsummary: were the seg contents, as found by this
-     * scan, consistent with the recorded SegSummary?
-     */
-    AVER(RefSetSub(ScanStateUnfixedSummary(ss), SegSummary(seg))); /* <design/check/#.common> */
-
-    /* Write barrier deferral -- see <design/write-barrier#.deferral>. */
-    /* Did the segment refer to the white set? */
-    if (ZoneSetInter(ScanStateUnfixedSummary(ss), white) == ZoneSetEMPTY) {
-      /* Boring scan.  One step closer to raising the write barrier. */
-      if (seg->defer > 0)
-        --seg->defer;
-    } else {
-      /* Interesting scan. Defer raising the write barrier. */
-      if (seg->defer < WB_DEFER_DELAY)
-        seg->defer = WB_DEFER_DELAY;
-    }
-
-    /* Only apply the write barrier if it is not deferred. */
-    if (seg->defer == 0) {
-      /* If we scanned every reference in the segment then we have a
-         complete summary we can set. Otherwise, we just have
-         information about more zones that the segment refers to. */
-      if (res == ResOK && wasTotal)
-        summary = ScanStateSummary(ss);
-      else
-        summary = RefSetUnion(SegSummary(seg), ScanStateSummary(ss));
-    } else {
-      summary = RefSetUNIV;
-    }
-    SegSetSummary(seg, summary);
-
-    ScanStateFinish(ss);
+    traceScanSegEnd(ts, arena, seg, ss, white, res, wasTotal);
   }
 
   if(res == ResOK) {
@@ -1232,6 +1358,255 @@ static Res traceScanSeg(TraceSet ts, Rank rank, Arena arena, Seg seg)
 }
 
 
+/* Parallel scanning .par
+ *
+ * If the arena was created with more than one GC thread (see
+ * MPS_KEY_ARENA_GC_THREADS), TraceAdvance scans grey segments in
+ * batches of up to TraceParBATCH segments, which are shared out among
+ * the worker threads <code/par.h>.
+ *
+ * .par.eligible: A segment goes into a batch only if its pool class
+ * has AttrPARSCAN (its scan method touches nothing but the segment
+ * being scanned), it is not white for the trace (so fixing never
+ * changes its contents or its colour tables), and it has no buffer (so
+ * fixing cannot allocate into it while it is being scanned).  Other
+ * segments are scanned serially, as before.
+ *
+ * .par.fix: The segment fix methods are not thread-safe: they allocate,
+ * copy objects, and update the shield, the grey rings and the tract
+ * tables.  So a scan state in a batch has its fix method replaced by
+ * traceParFix, which claims the arena's fix lock around the segment's
+ * fix method.  The format's scanning loop, MPS_FIX1, and the tests in
+ * _mps_fix2 that discard references to segments that aren't white all
+ * run in parallel.  Those tests only read the chunk and tract tables,
+ * which change under the fix lock only when a fix allocates a new
+ * segment, and no other worker can hold a reference into that until
+ * the lock is released.  The chunk tree would be rebalanced if the
+ * arena grew, so PolicyAlloc doesn't grow the arena while the workers
+ * are running <code/policy.c#grow.par>, and the fix fails instead (see
+ * .par.fail).  Serial scans pay nothing for any of this: _mps_fix2
+ * does not test for a parallel scan.
+ *
+ * .par.fix.limit: So the fix lock bounds the speed-up.  In a copying
+ * collection, nearly every reference that passes the zone test refers
+ * to a white segment and is fixed under the lock, and a scan that
+ * spends most of its time fixing gains little from more workers.  The
+ * TraceStatPar event counts the fixes made under the lock and those
+ * that found it held, so that contention can be measured.
+ *
+ * .par.shield: The main thread holds the shield (suspending the
+ * mutator) and exposes all the segments in the batch before starting
+ * the workers, so the shield never needs to suspend threads from a
+ * worker.  Covering, the summaries, the greyness and the counts are all
+ * updated by the main thread after the workers have finished, in the
+ * same way as traceScanSegRes does for a single segment.
+ *
+ * .par.fail: A segment whose scan failed (because fixing failed to
+ * allocate) is scanned again serially with traceScanSeg, which enters
+ * emergency mode if necessary.  Batches are not used in emergency mode.
+ *
+ * .par.event: The event buffers are not thread-safe, and the workers
+ * don't hold the arena lock <design/telemetry#.thread.par>.  So the
+ * main thread emits the SegScan event for each segment in the batch,
+ * and the workers call the scan method directly rather than via
+ * SegScan.  The scan methods of pools with AttrPARSCAN, and the sweep
+ * methods of pools with AttrPARSWEEP, emit no events when called from
+ * a worker (AMCScanNailed is only emitted in emergency mode, when
+ * batches are not used).  Events emitted by the segment fix methods
+ * are covered by .par.fix.  The critical-path events emitted by
+ * _mps_fix2 itself are not emitted for a scan state in a batch (see
+ * TRACE_FIX_EVENT).
+ *
+ * .par.sweep: Reclaiming is split into two phases. First, traceReclaim
+ * calls traceParSweep, which shares the white segments of pools with
+ * AttrPARSWEEP among the workers in batches of up to
+ * TraceParSweepBATCH, calling each segment's sweep method. A sweep
+ * method does the work that is private to the segment (such as
+ * counting free grains in its tables) and records the result in the
+ * segment. It must not touch the segment's memory (which may be
+ * protected), the pool generation, the arena, or the event buffers.
+ * Second, traceReclaim calls SegReclaim on every white segment
+ * serially, as before, and the reclaim method does the accounting
+ * (PoolGenAccountForReclaim, GenDescSurvived) and frees empty
+ * segments into the arena, using the result of the sweep.
+ */
+
+Res TraceParCreate(Arena arena)
+{
+  Count workers;
+  Lock fixLock;
+  ScanJob scanJob;
+  Par par;
+  void *p;
+  Res res;
+
+  AVERT(Arena, arena);
+  AVER(arena->par == NULL);
+
+  if (arena->gcThreads <= 1)
+    return ResOK;
+  workers = arena->gcThreads;
+  if (workers > TraceParBATCH)
+    workers = TraceParBATCH;
+
+  res = ControlAlloc(&p, arena, LockSize());
+  if (res != ResOK)
+    goto failLockAlloc;
+  fixLock = p;
+  res = ControlAlloc(&p, arena, TraceParBATCH * sizeof(ScanJobStruct));
+  if (res != ResOK)
+    goto failJobAlloc;
+  scanJob = p;
+  res = ParCreate(&par, arena, workers);
+  if (res != ResOK)
+    goto failParCreate;
+
+  LockInit(fixLock);
+  arena->fixLock = fixLock;
+  arena->scanJob = scanJob;
+  arena->par = par;
+  return ResOK;
+
+failParCreate:
+  ControlFree(arena, scanJob, TraceParBATCH * sizeof(ScanJobStruct));
+failJobAlloc:
+  ControlFree(arena, fixLock, LockSize());
+failLockAlloc:
+  return res;
+}
+
+void TraceParDestroy(Arena arena)
+{
+  AVERT(Arena, arena);
+  AVER(arena->busyTraces == TraceSetEMPTY);
+
+  if (arena->par == NULL)
+    return;
+
+  ParDestroy(arena->par);
+  LockFinish(arena->fixLock);
+  ControlFree(arena, arena->scanJob, TraceParBATCH * sizeof(ScanJobStruct));
+  ControlFree(arena, arena->fixLock, LockSize());
+  arena->par = NULL;
+  arena->scanJob = NULL;
+  arena->fixLock = NULL;
+}
+
+
+/* traceParScannable -- can segment be scanned in a batch?
+ *
+ * See .par.eligible.
+ */
+
+static Bool traceParScannable(Seg seg, TraceSet ts, ZoneSet white)
+{
+  return PoolHasAttr(SegPool(seg), AttrPARSCAN)
+    && !SegHasBuffer(seg)
+    && TraceSetInter(SegWhite(seg), ts) == TraceSetEMPTY
+    && ZoneSetInter(white, SegSummary(seg)) != ZoneSetEMPTY;
+}
+
+
+/* traceParFix -- fix a reference to a white segment, in a batch
+ *
+ * See .par.fix.
+ */
+
+static Res traceParFix(Seg seg, ScanState ss, Ref *refIO)
+{
+  Res res;
+  STATISTIC(++ss->lockedFixCount);
+  if (!LockClaimTry(ss->fixLock)) {
+    STATISTIC(++ss->contendedFixCount);
+    LockClaim(ss->fixLock);
+  }
+  res = SegFix(seg, ss, refIO);
+  LockRelease(ss->fixLock);
+  return res;
+}
+
+
+/* traceParScanJob -- scan one segment in a batch, on a worker thread */
+
+static void traceParScanJob(Index i, Index worker, void *closure)
+{
+  ScanJob job = &((ScanJob)closure)[i];
+  UNUSED(worker);
+  /* .par.event */
+  job->res = Method(Seg, job->seg, scan)(&job->wasTotal, job->seg,
+                                         &job->ssStruct);
+}
+
+
+/* traceParScan -- scan a batch of grey segments in parallel
+ *
+ * The batch consists of the segment found by traceFindGrey and any
+ * other eligible segments on the grey ring for the same rank.
+ */
+
+static void traceParScan(Trace trace, Rank rank, Seg first)
+{
+  Arena arena = trace->arena;
+  TraceSet ts = TraceSetSingle(trace);
+  ZoneSet white = traceSetWhiteUnion(ts, arena);
+  ScanJob jobs = arena->scanJob;
+  Count count = 0;
+  Ring node, nextNode;
+  Index i;
+
+  AVER(arena->par != NULL);
+  AVER(!ArenaEmergency(arena));
+  AVER(traceParScannable(first, ts, white));
+
+  jobs[count++].seg = first;
+  RING_FOR(node, ArenaGreyRing(arena, rank), nextNode) {
+    Seg seg = SegOfGreyRing(node);
+    if (count >= TraceParBATCH)
+      break;
+    if (seg != first && TraceSetIsMember(SegGrey(seg), trace)
+        && traceParScannable(seg, ts, white))
+      jobs[count++].seg = seg;
+  }
+
+  /* .par.shield */
+  ShieldHold(arena);
+  for (i = 0; i < count; ++i) {
+    ScanJob job = &jobs[i];
+    ScanState ss = &job->ssStruct;
+    ScanStateInit(ss, ts, arena, rank, white);
+    AVER(ss->fix == SegFix);
+    ss->fix = traceParFix; /* .par.fix */
+    ss->fixLock = arena->fixLock;
+    job->wasTotal = FALSE;
+    job->res = ResOK;
+    traceFinishSweep(job->seg); /* not thread-safe */
+    ShieldExpose(arena, job->seg);
+    EVENT5(SegScan, job->seg, SegPool(job->seg), arena, ts, rank);
+  }
+
+  ParRun(arena->par, count, traceParScanJob, jobs);
+  STATISTIC(trace->parScanCount += count);
+
+  for (i = 0; i < count; ++i) {
+    ScanJob job = &jobs[i];
+    ShieldCover(arena, job->seg);
+    traceScanSegEnd(ts, arena, job->seg, &job->ssStruct, white,
+                    job->res, job->wasTotal);
+    if (job->res == ResOK)
+      SegSetGrey(job->seg, TraceSetDiff(SegGrey(job->seg), ts));
+  }
+  ShieldRelease(arena);
+
+  /* .par.fail */
+  for (i = 0; i < count; ++i) {
+    if (jobs[i].res != ResOK) {
+      Res res = traceScanSeg(ts, rank, arena, jobs[i].seg);
+      AVER(res == ResOK);
+    }
+  }
+}
+
+
 /* TraceSegAccess -- handle barrier hit on a segment */
 
 void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
@@ -1265,20 +1640,34 @@ void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
     seg->defer = WB_DEFER_HIT;
 
   if (readHit) {
-    Rank rank;
     TraceSet traces;
+    TraceId ti;
+    Trace trace;
 
     AVER(SegRankSet(seg) != RankSetEMPTY);
 
-    /* Pick set of traces to scan for: */
-    traces = arena->flippedTraces;
-    rank = TraceRankForAccess(arena, seg);
-    res = traceScanSeg(traces, rank, arena, seg);
-
-    /* Allocation failures should be handled my emergency mode, and we don't
-       expect any other kind of failure in a normal GC that causes access
-       faults. */
-    AVER(res == ResOK);
+    /* Scan for each flipped trace for which the segment is grey.  The
+     * traces are scanned for separately, because they may be in
+     * different bands (see TraceRankForAccess).  Scanning for one
+     * trace may copy objects into this segment that are grey for
+     * another, so repeat until the segment is not grey for any. */
+    traces = TraceSetEMPTY;
+    while (TraceSetInter(SegGrey(seg), arena->flippedTraces)
+           != TraceSetEMPTY) {
+      TRACE_SET_ITER(ti, trace, TraceSetInter(SegGrey(seg),
+                                              arena->flippedTraces), arena)
+        res = traceScanSeg(TraceSetSingle(trace),
+                           TraceRankForAccess(trace, seg), arena, seg);
+
+        /* Allocation failures should be handled my emergency mode, and
+           we don't expect any other kind of failure in a normal GC that
+           causes access faults. */
+        AVER(res == ResOK);
+        traces = TraceSetAdd(traces, trace);
+      TRACE_SET_ITER_END(ti, trace, TraceSetInter(SegGrey(seg),
+                                                  arena->flippedTraces),
+                         arena);
+    }
 
     /* The pool should've done the job of removing the greyness that */
     /* was causing the segment to be protected, so that the mutator */
@@ -1286,8 +1675,6 @@ void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
     AVER(TraceSetInter(SegGrey(seg), traces) == TraceSetEMPTY);
 
     STATISTIC({
-      Trace trace;
-      TraceId ti;
       TRACE_SET_ITER(ti, trace, traces, arena)
         ++trace->readBarrierHitCount;
       TRACE_SET_ITER_END(ti, trace, traces, arena);
@@ -1304,6 +1691,21 @@ void TraceSegAccess(Arena arena, Seg seg, AccessSet mode)
 }
 
 
+/* TRACE_FIX_EVENT -- emit a critical-path event from _mps_fix2
+ *
+ * Not for a scan state in a parallel batch, as the event buffers are
+ * not thread-safe (see .par.event).  Critical-path events are only
+ * emitted in diagnostic varieties, so elsewhere this costs nothing.
+ */
+
+#if EVENT_ALL
+#define TRACE_FIX_EVENT(ss, event) \
+  BEGIN if ((ss)->fixLock == NULL) event; END
+#else
+#define TRACE_FIX_EVENT(ss, event) NOOP
+#endif
+
+
 /* _mps_fix2 (a.k.a. "TraceFix") -- second stage of fixing a reference
  *
  * _mps_fix2 is on the [critical path](../design/critical-path.txt).  A
@@ -1340,7 +1742,8 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
                 ZoneSetEMPTY);
 
   STATISTIC(++ss->fixRefCount);
-  EVENT_CRITICAL4(TraceFix, ss, mps_ref_io, ref, ss->rank);
+  TRACE_FIX_EVENT(ss, EVENT_CRITICAL4(TraceFix, ss, mps_ref_io, ref,
+                                      ss->rank));
 
   /* This sequence of tests is equivalent to calling TractOfAddr(),
    * but inlined so that we can distinguish between "not pointing to
@@ -1348,10 +1751,10 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
    * check the rank in the latter case. See
    * <design/trace#.fix.tractofaddr.inline>
    *
-   * If compilers fail to do a good job of inlining ChunkOfAddr and
-   * TreeFind then it may become necessary to inline at least the
-   * comparison against the root of the tree. See
-   * <https://info.ravenbrook.com/mail/2014/06/11/13-32-08/0/>
+   * ChunkOfAddr consults the arena's chunk cache before searching
+   * the chunk tree, so that the common case is a single indexed load
+   * and a bounds check whatever the number of chunks. See
+   * <design/arena#.chunk.cache>.
    */
   if (!ChunkOfAddr(&chunk, ss->arena, ref))
     /* Reference points outside MPS-managed address space: ignore. */
@@ -1378,14 +1781,14 @@ mps_res_t _mps_fix2(mps_ss_t mps_ss, mps_addr_t *mps_ref_io)
      * active traces. <design/trace#.fix.tractofaddr> */
     STATISTIC({
       ++ss->segRefCount;
-      EVENT_CRITICAL1(TraceFixSeg, seg);
+      TRACE_FIX_EVENT(ss, EVENT_CRITICAL1(TraceFixSeg, seg));
     });
     goto done;
   }
 
   STATISTIC(++ss->segRefCount);
   STATISTIC(++ss->whiteSegRefCount);
-  EVENT_CRITICAL1(TraceFixSeg, seg);
+  TRACE_FIX_EVENT(ss, EVENT_CRITICAL1(TraceFixSeg, seg));
   res = (*ss->fix)(seg, ss, &ref);
   if (res != ResOK) {
     /* SegFixEmergency must not fail. */
@@ -1631,20 +2034,13 @@ Res TraceStart(Trace trace, double mortality, double finishingTime)
 }
 
 
-/* traceWork -- a measure of the work done for this trace.
- *
- * <design/type#.work>.
- */
-
-#define traceWork(trace) ((Work)((trace)->segScanSize + (trace)->rootScanSize))
-
-
 /* TraceAdvance -- progress a trace by one step */
 
 void TraceAdvance(Trace trace)
 {
   Arena arena;
   Work oldWork, newWork;
+  Clock start = ClockNow(), end;
 
   AVERT(Trace, trace);
   arena = trace->arena;
@@ -1660,11 +2056,17 @@ void TraceAdvance(Trace trace)
     Rank rank;
 
     if (traceFindGrey(&seg, &rank, arena, trace->ti)) {
-      Res res;
-      res = traceScanSeg(TraceSetSingle(trace), rank, arena, seg);
-      /* Allocation failures should be handled by emergency mode, and we
-       * don't expect any other error in a normal GC trace. */
-      AVER(res == ResOK);
+      TraceSet ts = TraceSetSingle(trace);
+      if (arena->par != NULL && !ArenaEmergency(arena)
+          && traceParScannable(seg, ts, traceSetWhiteUnion(ts, arena))) {
+        traceParScan(trace, rank, seg);
+      } else {
+        Res res;
+        res = traceScanSeg(ts, rank, arena, seg);
+        /* Allocation failures should be handled by emergency mode, and
+         * we don't expect any other error in a normal GC trace. */
+        AVER(res == ResOK);
+      }
     } else {
       trace->state = TraceRECLAIM;
     }
@@ -1681,6 +2083,9 @@ void TraceAdvance(Trace trace)
   newWork = traceWork(trace);
   AVER(newWork >= oldWork);
   arena->tracedWork += newWork - oldWork;
+  end = ClockNow();
+  trace->clocks += end - start;
+  ArenaNotePause(arena, PauseKindINCREMENT, start, end);
 }
 
 
@@ -1748,8 +2153,9 @@ failCondemn:
 
 /* TracePoll -- Check if there's any tracing work to be done
  *
- * Consider starting a trace if none is running; advance the running
- * trace (if any) by one quantum.
+ * Consider starting a trace if none is running, or a nursery trace
+ * alongside the running traces; advance each running trace by one
+ * quantum.
  *
  * The collectWorldReturn and collectWorldAllowed arguments are as for
  * PolicyStartTrace.
@@ -1762,32 +2168,38 @@ Bool TracePoll(Work *workReturn, Bool *collectWorldReturn, Globals globals,
                Bool collectWorldAllowed)
 {
   Trace trace;
+  TraceId ti;
   Arena arena;
-  Work oldWork, newWork, work, endWork;
+  Work work = 0;
 
   AVERT(Globals, globals);
   arena = GlobalsArena(globals);
 
-  if (arena->busyTraces != TraceSetEMPTY) {
-    trace = ArenaTrace(arena, (TraceId)0);
-  } else {
+  if (arena->busyTraces == TraceSetEMPTY) {
     /* No traces are running: consider starting one now. */
     if (!PolicyStartTrace(&trace, collectWorldReturn, arena,
                           collectWorldAllowed))
       return FALSE;
+  } else if (arena->busyTraces != TraceSetUNIV) {
+    /* Consider starting a nursery trace alongside the running ones.
+     * See <code/policy.c#nursery>. */
+    (void)PolicyStartTrace(&trace, collectWorldReturn, arena, FALSE);
   }
 
-  AVER(arena->busyTraces == TraceSetSingle(trace));
-  oldWork = traceWork(trace);
-  endWork = oldWork + trace->quantumWork;
-  do {
-    TraceAdvance(trace);
-  } while (trace->state != TraceFINISHED && traceWork(trace) < endWork);
-  newWork = traceWork(trace);
-  AVER(newWork >= oldWork);
-  work = newWork - oldWork;
-  if (trace->state == TraceFINISHED)
-    TraceDestroyFinished(trace);
+  TRACE_SET_ITER(ti, trace, arena->busyTraces, arena)
+    Work oldWork, newWork, endWork;
+    oldWork = traceWork(trace);
+    endWork = oldWork + trace->quantumWork;
+    do {
+      TraceAdvance(trace);
+    } while (trace->state != TraceFINISHED && traceWork(trace) < endWork);
+    newWork = traceWork(trace);
+    AVER(newWork >= oldWork);
+    work += newWork - oldWork;
+    if (trace->state == TraceFINISHED)
+      TraceDestroyFinished(trace);
+  TRACE_SET_ITER_END(ti, trace, arena->busyTraces, arena);
+
   *workReturn = work;
   return TRUE;
 }
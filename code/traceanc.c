@@ -602,6 +602,32 @@ static void arenaExpose(Arena arena)
 }
 
 
+/* ArenaLazySweep -- finish deferred sweeps
+ *
+ * Finish the sweep of the first segment whose sweep was deferred by
+ * its pool, or of all of them if all is TRUE. Return TRUE if there
+ * was a segment to sweep. See <design/seg#.method.lazy-sweep>.
+ */
+
+Bool ArenaLazySweep(Arena arena, Bool all)
+{
+  Ring node, nextNode;
+  Bool workWasDone = FALSE;
+
+  AVERT(Arena, arena);
+  AVERT(Bool, all);
+
+  RING_FOR(node, &arena->sweepRing, nextNode) {
+    GCSeg gcseg = RING_ELT(GCSeg, sweepRing, node);
+    SegLazySweep(MustBeA(Seg, gcseg), TRUE);
+    workWasDone = TRUE;
+    if (!all)
+      break;
+  }
+  return workWasDone;
+}
+
+
 /* ArenaPostmortem -- enter the postmortem state */
 
 void ArenaPostmortem(Globals globals)
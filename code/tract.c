@@ -190,6 +190,7 @@ Res ChunkInit(Chunk chunk, Arena arena, Addr base, Addr limit, Size reserved,
   chunk->base = base;
   chunk->limit = limit;
   chunk->reserved = reserved;
+  chunk->node = NodeNONE;
   size = ChunkSize(chunk);
 
   /* .overhead.pages: Chunk overhead for the page allocation table. */
@@ -313,23 +314,41 @@ TreeKey ChunkKey(Tree tree)
 }
 
 
-/* ChunkOfAddr -- return the chunk which encloses an address */
+/* ChunkOfAddr -- return the chunk which encloses an address
+ *
+ * The chunk cache is consulted first, and the chunk tree is searched
+ * only on a miss. See <design/arena#.chunk.cache>.
+ */
+
+#define CHUNK_CACHE_INDEX(addr) \
+  (((Word)(addr) >> ChunkCacheSHIFT) & (ChunkCacheLENGTH - 1))
 
 Bool ChunkOfAddr(Chunk *chunkReturn, Arena arena, Addr addr)
 {
   Tree tree;
+  Chunk chunk;
+  Index i;
 
   AVER_CRITICAL(chunkReturn != NULL);
   AVERT_CRITICAL(Arena, arena);
   /* addr is arbitrary */
 
+  i = CHUNK_CACHE_INDEX(addr);
+  chunk = arena->chunkCache[i];
+  if (chunk != NULL && chunk->base <= addr && addr < chunk->limit) {
+    AVERT_CRITICAL(Chunk, chunk);
+    *chunkReturn = chunk;
+    return TRUE;
+  }
+
   if (TreeFind(&tree, ArenaChunkTree(arena), TreeKeyOfAddrVar(addr),
                ChunkCompare)
       == CompareEQUAL)
   {
-    Chunk chunk = ChunkOfTree(tree);
+    chunk = ChunkOfTree(tree);
     AVER_CRITICAL(chunk->base <= addr);
     AVER_CRITICAL(addr < chunk->limit);
+    arena->chunkCache[i] = chunk;
     *chunkReturn = chunk;
     return TRUE;
   }
@@ -144,6 +144,7 @@ typedef struct ChunkStruct {
   Size reserved;        /* reserved address space for chunk (including overhead
                            such as losses due to alignment): must not change
                            (or arena reserved calculation will break) */
+  Index node;           /* NUMA node of chunk's memory, or NodeNONE */
 } ChunkStruct;
 
 
@@ -151,6 +152,7 @@ typedef struct ChunkStruct {
 #define ChunkSize(chunk) AddrOffset((chunk)->base, (chunk)->limit)
 #define ChunkPageSize(chunk) RVALUE((chunk)->pageSize)
 #define ChunkPageShift(chunk) RVALUE((chunk)->pageShift)
+#define ChunkNode(chunk) RVALUE((chunk)->node)
 #define ChunkPagesToSize(chunk, pages) ((Size)(pages) << (chunk)->pageShift)
 #define ChunkSizeToPages(chunk, size) ((Count)((size) >> (chunk)->pageShift))
 #define ChunkPage(chunk, pi) (&(chunk)->pageTable[pi])
@@ -80,6 +80,22 @@ Size (VMMapped)(VM vm)
 }
 
 
+/* VMBind -- bind memory mapped in future to a NUMA node
+ *
+ * This is a hint: the implementation of VMMap asks the operating
+ * system to allocate the memory on the node if it can, and otherwise
+ * ignores it. <design/vm#.if.bind>.
+ */
+
+void VMBind(VM vm, Index node)
+{
+  AVERT(VM, vm);
+  AVER(VMMapped(vm) == 0);
+
+  vm->node = node;
+}
+
+
 /* VMCopy -- copy VM descriptor */
 
 void VMCopy(VM dest, VM src)
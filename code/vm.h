@@ -26,6 +26,7 @@ typedef struct VMStruct {
   Addr base, limit;             /* aligned boundaries of reserved space */
   Size reserved;                /* total reserved address space */
   Size mapped;                  /* total mapped memory */
+  Index node;                   /* NUMA node for mapped memory, or NodeNONE */
 } VMStruct;
 
 
@@ -34,6 +35,7 @@ typedef struct VMStruct {
 #define VMLimit(vm) RVALUE((vm)->limit)
 #define VMReserved(vm) RVALUE((vm)->reserved)
 #define VMMapped(vm) RVALUE((vm)->mapped)
+#define VMNode(vm) RVALUE((vm)->node)
 
 extern Size PageSize(void);
 extern Size (VMPageSize)(VM vm);
@@ -47,6 +49,7 @@ extern Res VMMap(VM vm, Addr base, Addr limit);
 extern void VMUnmap(VM vm, Addr base, Addr limit);
 extern Size (VMReserved)(VM vm);
 extern Size (VMMapped)(VM vm);
+extern void VMBind(VM vm, Index node);
 extern void VMCopy(VM dest, VM src);
 
 
@@ -36,6 +36,12 @@
  * .remap: Possibly this should use mremap to reduce the number of
  * distinct mappings.  According to our current testing, it doesn't
  * seem to be a problem.
+ *
+ * .numa: On Linux, memory mapped by a VM that is bound to a NUMA node
+ * (see VMBind) is given a preferred memory policy for that node using
+ * the mbind system call. The system call is made directly, so that the
+ * MPS doesn't depend on libnuma. On other operating systems the
+ * binding is ignored.
  */
 
 #include "mpm.h"
@@ -49,7 +55,12 @@
 #include <errno.h> /* errno */
 #include <sys/mman.h> /* see .feature.li in config.h */
 #include <sys/types.h> /* mmap, munmap */
-#include <unistd.h> /* getpagesize */
+#include <unistd.h> /* getpagesize, syscall */
+
+#if defined(MPS_OS_LI)
+#include <limits.h> /* CHAR_BIT */
+#include <sys/syscall.h> /* SYS_mbind */
+#endif
 
 SRCID(vmix, "$Id$");
 
@@ -125,6 +136,7 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit <= AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = 0;
+  vm->node = NodeNONE;
 
   vm->sig = VMSig;
   AVERT(VM, vm);
@@ -156,6 +168,47 @@ void VMFinish(VM vm)
 }
 
 
+/* vmBindRange -- ask for mapped memory to come from the VM's node
+ *
+ * The policy is only a preference, so failure is ignored: in
+ * particular, the node might not exist on this machine. See .numa.
+ */
+
+#if defined(MPS_OS_LI) && defined(SYS_mbind)
+
+#define vmMPOL_PREFERRED 1      /* MPOL_PREFERRED from <linux/mempolicy.h> */
+#define vmNodeMaskWORDS  4      /* words in node mask passed to mbind */
+#define vmNodeMaskBITS   (vmNodeMaskWORDS * sizeof(unsigned long) * CHAR_BIT)
+
+static void vmBindRange(VM vm, Addr base, Addr limit)
+{
+  unsigned long mask[vmNodeMaskWORDS];
+  size_t i, bits = sizeof mask[0] * CHAR_BIT;
+
+  if (vm->node >= vmNodeMaskBITS)
+    return;
+  for (i = 0; i < vmNodeMaskWORDS; ++i)
+    mask[i] = 0;
+  mask[vm->node / bits] = 1ul << (vm->node % bits);
+
+  /* The kernel reads one bit fewer than maxnode, hence the +1. */
+  (void)syscall(SYS_mbind, (void *)base, (unsigned long)AddrOffset(base, limit),
+                vmMPOL_PREFERRED, mask, (unsigned long)vmNodeMaskBITS + 1,
+                0u);
+}
+
+#else /* not Linux */
+
+static void vmBindRange(VM vm, Addr base, Addr limit)
+{
+  UNUSED(vm);
+  UNUSED(base);
+  UNUSED(limit);
+}
+
+#endif /* not Linux */
+
+
 /* VMMap -- map the given range of memory */
 
 Res VMMap(VM vm, Addr base, Addr limit)
@@ -181,6 +234,9 @@ Res VMMap(VM vm, Addr base, Addr limit)
     return ResMEMORY;
   }
 
+  if (vm->node != NodeNONE)
+    vmBindRange(vm, base, limit);
+
   vm->mapped += size;
   AVER(VMMapped(vm) <= VMReserved(vm));
 
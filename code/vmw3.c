@@ -139,6 +139,7 @@ Res VMInit(VM vm, Size size, Size grainSize, void *params)
   AVER(vm->limit <= AddrAdd((Addr)vm->block, reserved));
   vm->reserved = reserved;
   vm->mapped = 0;
+  vm->node = NodeNONE;
 
   vm->sig = VMSig;
   AVERT(VM, vm);
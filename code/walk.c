@@ -103,6 +103,9 @@ void mps_arena_formatted_objects_walk(mps_arena_t mps_arena,
   c.f = f;
   c.p = p;
   c.s = s;
+  /* Dead objects in segments whose sweep is deferred mustn't be
+     visited. <design/seg#.method.lazy-sweep> */
+  (void)ArenaLazySweep(arena, TRUE);
   ArenaFormattedObjectsWalk(arena, ArenaFormattedObjectsStep, &c, UNUSED_SIZE);
   ArenaLeave(arena);
 }